@@ -0,0 +1,216 @@
+/********************************************************************
+* algebra.cpp - algebraic simplification, and reassociation of literals
+*
+* On SSA form, after constant propagation (which folds the lines all
+* operands of which are literals). A literal operand of an add, mult,
+* == or != goes to the right, as does one on the left of a comparison,
+* which is mirrored (4 > i: i < 4), so that the passes after see one
+* form of each (gvn, ranges, ivsr). Int lines with a literal operand
+* then go by the identities of their operation:
+*     t = x + 0, x - 0, x * 1, x / 1  -> t = x
+*     t = x * 0, x % 1, x - x         -> t = 0
+*     t = 0 - x                       -> t = -x
+* and a literal combined with a value that was computed with one moves
+* onto the operand of that (looking through copies), wrapping as the
+* target does (c. fold.h):
+*     t1 = x + 4; t2 = t1 - 1  -> t2 = x + 3
+*     t1 = x * 2; t2 = t1 * 4  -> t2 = x * 8
+* The copies made are propagated by the copy pass, the lines no longer
+* used removed by dce. Doubles are only reordered (x + 0.0 is not x
+* for x = -0.0). A multiplication by a power of two is left as it is:
+* the IR has no shift; the code emitter shifts instead (c. x86.cpp).
+*
+********************************************************************/
+
+#include <map>
+
+#include "ir.h"
+#include "live.h"
+#include "ssa.h"
+#include "fold.h"
+#include "opt.h"
+
+#define ALGEBRA_PASSES 4 // bound on the passes over all lines
+#define ALGEBRA_CHAIN 16 // copies looked through for a definition
+
+// Op with its operands swapped: a < b is b > a
+static ir_Op
+swappedOp(ir_Op Op)
+{
+    switch(Op){
+    case op_lt: return op_gt;
+    case op_le: return op_ge;
+    case op_gt: return op_lt;
+    case op_ge: return op_le;
+    default: return Op;
+    }
+}
+
+// Returns 1 if O is an int literal (Value: its value)
+static int
+intImm(Operand const& O, long& Value)
+{
+    if ( !(O.isImm()) || constOf(O).isFlt() )
+	return 0;
+    Value = constOf(O).IntVal();
+    return 1;
+}
+
+static void
+makeCopy(SSA_Entry& Line, Operand const& O)
+{
+    Line.setOp(op_copy);
+    Line.setLHS(O);
+    Line.setRHS(Operand());
+}
+
+// t = X + C, as a sub for C < 0, or a copy for C = 0
+static void
+makeAdd(SSA_Entry& Line, Operand const& X, long C)
+{
+    if ( (0 == C) ){
+	makeCopy(Line, X);
+	return;
+    }
+    int sub = ( (0 > C) && (intMin() != C) );
+    Line.setOp( (sub)?op_sub:op_add );
+    Line.setLHS(X);
+    Line.setRHS(constOperand(Const_Val( (sub)?-C:C )));
+}
+
+// the line defining O, through copies (-1: none, or not a value op)
+static int
+defOf(ir_Rep const& List, std::map<Operand, int> const& Defs, Operand O)
+{
+    for ( int k = 0; k < ALGEBRA_CHAIN; k++ ){
+	std::map<Operand, int>::const_iterator iter = Defs.find(O);
+	if ( (Defs.end() == iter) )
+	    return -1;
+	SSA_Entry const& def = List[iter->second];
+	if ( (op_copy != def.Op()) )
+	    return iter->second;
+	if ( !(isValue(def.LHS())) )
+	    return -1;
+	O = def.LHS();
+    }
+    return -1;
+}
+
+// t = x +- c2 (x * c2) with x = y +- c1 (y * c1): t = y + c (y * c)
+static int
+reassociate(ir_Rep& List, int I, std::map<Operand, int> const& Defs)
+{
+    SSA_Entry& line = List[I];
+    long c2, c1;
+    int d = defOf(List, Defs, line.LHS());
+    if ( (-1 == d) || !(intImm(line.RHS(), c2)) )
+	return 0;
+    SSA_Entry const& def = List[d];
+    if ( !(isValue(def.LHS())) || !(intImm(def.RHS(), c1)) )
+	return 0;
+    Operand y = def.LHS();
+
+    if ( (op_mult == line.Op()) && (op_mult == def.Op()) ){
+	line.setLHS(y);
+	line.setRHS(constOperand(Const_Val(wrapInt(c1 * c2))));
+	return 1;
+    }
+    if ( ( (op_add != line.Op()) && (op_sub != line.Op()) ) ||
+	 ( (op_add != def.Op()) && (op_sub != def.Op()) ) )
+	return 0;
+    c1 = (op_add == def.Op())?c1:-c1;
+    c2 = (op_add == line.Op())?c2:-c2;
+    makeAdd(line, y, wrapInt(c1 + c2));
+    return 1;
+}
+
+// the identities above, on an int line
+static int
+simplifyLine(SSA_Entry& Line)
+{
+    Operand l = Line.LHS(), r = Line.RHS();
+    long c;
+    if ( (op_sub == Line.Op()) && isValue(l) && (l == r) ){
+	makeCopy(Line, constOperand(Const_Val(0L)));
+	return 1;
+    }
+    if ( (op_sub == Line.Op()) && intImm(l, c) && (0 == c) && isValue(r) ){
+	Line.setOp(op_neg);
+	Line.setLHS(r);
+	Line.setRHS(Operand());
+	return 1;
+    }
+    if ( !(intImm(r, c)) || l.isImm() )
+	return 0;
+
+    switch(Line.Op()){
+    case op_add: case op_sub:
+	if ( (0 != c) )
+	    return 0;
+	makeCopy(Line, l);
+	return 1;
+    case op_mult:
+	if ( (0 == c) )
+	    makeCopy(Line, r);
+	else if ( (1 == c) )
+	    makeCopy(Line, l);
+	return ( (0 == c) || (1 == c) );
+    case op_div:
+	if ( (1 == c) )
+	    makeCopy(Line, l);
+	return (1 == c);
+    case op_mod:
+	if ( (1 == c) )
+	    makeCopy(Line, constOperand(Const_Val(0L)));
+	return (1 == c);
+    default:
+	return 0;
+    }
+}
+
+int
+algebraSSA(ir_Rep& List)
+{
+    int changes = 0;
+    opd_Set flt;
+    findFloats(List, flt);
+    std::map<Operand, int> defs;
+    for ( size_t i = 0; i < List.size(); i++ )
+	if ( isValueOp(List[i].Op()) && (op_phi != List[i].Op()) &&
+	     isValue(List[i].Target()) )
+	    defs[List[i].Target()] = i;
+
+    int changed = 1;
+    for ( int pass = 0; (changed) && (pass < ALGEBRA_PASSES); pass++ ){
+	changed = 0;
+	for ( size_t i = 0; i < List.size(); i++ ){
+	    SSA_Entry& line = List[i];
+	    ir_Op op = line.Op();
+	    if ( ( (op_add == op) || (op_mult == op) ||
+		   ( (op_lt <= op) && (op_ne >= op) ) ) &&
+		 line.LHS().isImm() && !(line.RHS().isImm()) ){
+		Operand l = line.LHS();
+		line.setOp(swappedOp(op));
+		line.setLHS(line.RHS());
+		line.setRHS(l);
+		changed++;
+	    }
+	    if ( !(isValueOp(line.Op())) || (op_phi == line.Op()) ||
+		 !(isValue(line.Target())) || isFltOperand(line.LHS(), flt) ||
+		 isFltOperand(line.RHS(), flt) )
+		continue;
+	    if ( reassociate(List, i, defs) )
+		changed++;
+	    if ( simplifyLine(line) )
+		changed++;
+	}
+	changes += changed;
+    }
+    return changes;
+}
+
+int
+simplifyAlgebra(ir_Rep& List)
+{
+    return withSSA(List, algebraSSA);
+}
@@ -18,6 +18,7 @@
 #include <sstream>
 #include <cstdlib>
 #include "lexer.h"
+#include "ir.h"
 
 extern int option_Debug;
 
@@ -127,7 +128,8 @@ Node_AST(Node_AST* lC = 0, Node_AST* rC = 0)
 
     ~Node_AST() {}
 
-    virtual std::string Addr(void) { return addr_; } // not const
+    std::string Addr(void) const { return addr_; } // as in the source
+    virtual Operand Opd(void) { return opd_; } // IR operand, not const
     // as re-defined in IdExpr_AST, where it is not const
 
     int Line(void) const { return line_; }
@@ -139,6 +141,18 @@ Node_AST(Node_AST* lC = 0, Node_AST* rC = 0)
 
     void setParent(Node_AST* Par) { parent_ = Par; }
     void setAddr(std::string Addr) { addr_ = Addr; }
+    void setOpd(Operand O) { opd_ = O; }
+
+    // loop tiling (c. tile.cpp): New takes the place of the child Old
+    void replaceChild(Node_AST* Old, Node_AST* New)
+    {
+	Node_AST*& child = (Old == lChild_)?lChild_:rChild_;
+	if ( (Old != child) )
+	    return;
+	child = New;
+	New->setParent(this);
+	New->RefCountPlus();
+    }
 
     int RefCount(void) const { return ref_Count_; }
     void RefCountPlus(void) { ref_Count_++; }
@@ -159,6 +173,7 @@ protected: // we don't really use protected variables in children
     int line_;
     int col_;
     std::string addr_;
+    Operand opd_; // set by the visitor (c. visitor.h)
     Env* env_;
     static int label_Count_;
     int ref_Count_; // Objects might be a child of several other objects
@@ -360,8 +375,7 @@ private:
 class IdExpr_AST: public Expr_AST{
 public:
 IdExpr_AST(token Type, token Op, int I = 0, int W = 0)
-    : Expr_AST(Type, Op, 0, 0), initialized_(I), warning_Emitted_(W), 
-	tmp_Addr_("")
+    : Expr_AST(Type, Op, 0, 0), initialized_(I), warning_Emitted_(W)
     { 
 	setAddr(Op.Lex());
 	if (option_Debug) std::cout << "\tcreated an Id = " << addr_ << "\n";
@@ -373,16 +387,16 @@ IdExpr_AST(token Type, token Op, int I = 0, int W = 0)
     int WarningEmitted(void) const { return warning_Emitted_; }
     void Warned(void) { warning_Emitted_ = 1; }
 
-    std::string TmpAddr(void) const { return tmp_Addr_; }
-    void setTmpAddr(std::string A) { tmp_Addr_ = A; } 
+    Operand TmpOpd(void) const { return tmp_Opd_; }
+    void setTmpOpd(Operand O) { tmp_Opd_ = O; } 
 
-    std::string Addr(void)
+    Operand Opd(void)
     {
-	std::string ret = Node_AST::Addr();
+	Operand ret = Node_AST::Opd();
 
-	if ( ("" != TmpAddr()) ){
-	    ret = TmpAddr();
-	    setTmpAddr("");
+	if ( !(TmpOpd().isNone()) ){
+	    ret = TmpOpd();
+	    setTmpOpd(Operand());
 	}
 
 	return ret;
@@ -393,7 +407,7 @@ IdExpr_AST(token Type, token Op, int I = 0, int W = 0)
 private:
     int initialized_;
     int warning_Emitted_;
-    std::string tmp_Addr_; // used for Incr type descendants
+    Operand tmp_Opd_; // used for Incr type descendants
 };
 
 // C99 6.5 (2): Between sequence points, value cannot be read and stored.
@@ -476,7 +490,7 @@ ArrayIdExpr_AST(ArrayVarDecl_AST* B, IdExpr_AST* N, int AI,
 		std::vector<Expr_AST*>* Access, 
 		std::vector<std::string>* Final = 0, std::string A = "")
     : IdExpr_AST(N->Type(), N->Op()), base_(B), base_Id_(N), 
-	all_IntVals_(AI), dims_(Access), dims_Final_(Final)
+	all_IntVals_(AI), dims_(Access), dims_Final_(Final), const_Off_(A)
     {
 	if (AI){
 	    std::ostringstream tmp_Stream;
@@ -502,6 +516,7 @@ ArrayIdExpr_AST(const ArrayIdExpr_AST& r)
 	all_IntVals_ = r.allInts();
 	dims_ = r.Dims();
 	dims_Final_ = r.DimsFinal();
+	const_Off_ = r.ConstOffset();
     }
 
     ~ArrayIdExpr_AST()
@@ -522,6 +537,7 @@ ArrayIdExpr_AST(const ArrayIdExpr_AST& r)
     int numDims(void) const { return num_Dims_; }
 
     std::vector<std::string>* DimsFinal(void) const { return dims_Final_;}
+    std::string ConstOffset(void) const { return const_Off_; }
     void addToDimsFinalEnd(std::string V) { dims_Final_->push_back(V); }
     void addToDimsFinalFront(std::string V) 
     {
@@ -536,6 +552,7 @@ private:
     int all_IntVals_; // if 1, have names (strings) in dims_Final_
     std::vector<Expr_AST*>* dims_; // access encoded in expressions
     std::vector<std::string>* dims_Final_; // filled in by visitor sometimes
+    std::string const_Off_; // bytes, if all_IntVals_
     int num_Dims_;
 };
 
@@ -938,6 +955,8 @@ ArrayVarDecl_AST(IdExpr_AST* Name, std::vector<Expr_AST*>* D, int I, int W )
     std::vector<Expr_AST*>* Dims(void) const { return dims_; }
 
     std::vector<std::string>* DimsFinal(void) const {return dims_Final_;}
+    std::vector<Operand> const& DimOpds(void) const { return dim_Opds_; }
+    void addDimOpd(Operand O) { dim_Opds_.push_back(O); }
     virtual void addToDimsFinalEnd(std::string V) { dims_Final_->push_back(V); }
     virtual void addToDimsFinalFront(std::string V) 
     {
@@ -950,9 +969,10 @@ private:
     std::vector<Expr_AST*>* dims_;
     int num_Dims_;
     int all_IntVals_;
-    std::vector<std::string>* dims_Final_; // run-time filled in: array bounds'
-    // final expression after evaluating the expressions in dims_ (as strings,
-    // either an integer or a tmp variable), for reference later in visitor
+    std::vector<std::string>* dims_Final_; // compile-time array bounds
+    std::vector<Operand> dim_Opds_; // run-time filled in: array bounds'
+    // final expression after evaluating the expressions in dims_ (a
+    // variable or a tmp), for reference later in visitor
 };
 
 // C99: doesn't exist (c. also comment to PreIncrIdExpr_AST)
@@ -1075,6 +1095,24 @@ For_AST(IterExprList_AST* Expr, Block_AST* Block)
 
     ~For_AST() {}
 
+    // loop interchange (c. interchange.cpp): trade the (init; cond; iter)
+    // lists with F
+    void swapExprList(For_AST* F)
+    {
+	Node_AST* tmp = lChild_;
+	lChild_ = F->lChild_;
+	F->lChild_ = tmp;
+	lChild_->setParent(this);
+	F->lChild_->setParent(F);
+    }
+
+    // loop tiling: a new (init; cond; iter) list
+    void setExprList(IterExprList_AST* L)
+    {
+	lChild_ = L;
+	lChild_->setParent(this);
+    }
+
     void accept(AST_Visitor* Visitor) { Visitor->visit(this); }
 };
 
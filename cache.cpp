@@ -0,0 +1,46 @@
+/********************************************************************
+* cache.cpp - implementation file for cache.h
+*
+********************************************************************/
+
+#include "cache.h"
+
+void errExit(int pError, const char* msg, ...);
+
+Cache_Sim::Cache_Sim(int Size, int Line, int Ways)
+    : line_(Line), ways_(Ways), sets_(0), clock_(0), accesses_(0),
+      misses_(0)
+{
+    if ( (0 >= Line) || (0 >= Ways) || (0 != Size % (Line * Ways)) ||
+	 (0 == Size / (Line * Ways)) )
+	errExit(0, "invalid cache: %d bytes, %d byte lines, %d ways", Size,
+		Line, Ways);
+    sets_ = Size / (Line * Ways);
+    tags_.assign(sets_ * ways_, -1);
+    used_.assign(sets_ * ways_, 0);
+}
+
+void
+Cache_Sim::access(long Addr, int Bytes)
+{
+    for ( long line = Addr / line_; line <= (Addr + Bytes - 1) / line_;
+	  line++ ){
+	accesses_++;
+	clock_++;
+	int first = (line % sets_) * ways_;
+	int lru = first;
+	int way;
+	for ( way = first; way < first + ways_; way++ ){
+	    if ( (line == tags_[way]) )
+		break;
+	    if ( (used_[way] < used_[lru]) )
+		lru = way;
+	}
+	if ( (first + ways_ == way) ){
+	    misses_++;
+	    way = lru;
+	    tags_[way] = line;
+	}
+	used_[way] = clock_;
+    }
+}
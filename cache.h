@@ -0,0 +1,43 @@
+/********************************************************************
+* cache.h - cache simulator for the element accesses of -run (-C)
+*
+* Trace:  the VM hands on the address and width of each array element
+*         it loads or stores (a vector op: all of its lanes at once);
+*         variables, tmps and literals don't take part (registers, as
+*         far as the cache is concerned).
+* Cache:  one level, set associative, of Size bytes in lines of Line
+*         bytes, Ways lines per set, least recently used line replaced;
+*         an access spanning lines touches each of them. Addresses are
+*         offsets into the VM's memory (a line starts at 0).
+*
+********************************************************************/
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <vector>
+
+class Cache_Sim{
+public:
+    Cache_Sim(int Size, int Line, int Ways);
+
+    void access(long Addr, int Bytes);
+
+    int Size(void) const { return sets_ * ways_ * line_; }
+    int Line(void) const { return line_; }
+    int Ways(void) const { return ways_; }
+    long Accesses(void) const { return accesses_; } // of lines
+    long Misses(void) const { return misses_; }
+
+private:
+    int line_;
+    int ways_;
+    int sets_;
+    std::vector<long> tags_; // [set * ways_ + way]: line held (-1: none)
+    std::vector<long> used_; // when it was last used
+    long clock_;
+    long accesses_;
+    long misses_;
+};
+
+#endif
@@ -0,0 +1,400 @@
+/********************************************************************
+* cfg.cpp - implementation file for cfg.h
+*
+********************************************************************/
+
+#include <algorithm>
+#include "ir.h"
+#include "cfg.h"
+
+int
+isJump(ir_Op Op)
+{
+    return ( (op_goto == Op) || (op_iffalse == Op) || (op_iftrue == Op) );
+}
+
+int
+isCondJump(ir_Op Op)
+{
+    return ( (op_iffalse == Op) || (op_iftrue == Op) );
+}
+
+// no fall-through to the next line (the only syscall is exit)
+int
+endsFlow(SSA_Entry const& Line)
+{
+    return ( (op_goto == Line.Op()) || (op_syscall == Line.Op()) );
+}
+
+// label a jump goes to (-1: no jump)
+int
+jumpLabel(SSA_Entry const& Line)
+{
+    if ( (op_goto == Line.Op()) )
+	return Line.Target().Id();
+    if ( isCondJump(Line.Op()) )
+	return Line.RHS().Id();
+    return -1;
+}
+
+CFG::CFG(ir_Rep const& List)
+    : list_(&List)
+{
+    makeBlocks();
+    makeEdges();
+    makeRPO();
+    makeDominators();
+    makeFrontiers();
+    makeLoops();
+}
+
+void
+CFG::makeBlocks(void)
+{
+    ir_Rep const& list = *list_;
+    int n = list.size();
+    line_Block_.assign(n, -1);
+    if ( (0 == n) )
+	return;
+
+    std::vector<int> leader(n, 0);
+    leader[0] = 1;
+    for ( int i = 0; i < n; i++ ){
+	if ( list[i].hasLabels() )
+	    leader[i] = 1;
+	if ( (isJump(list[i].Op()) || endsFlow(list[i])) && (i + 1 < n) )
+	    leader[i + 1] = 1;
+    }
+
+    int first = 0;
+    for ( int i = 1; i <= n; i++ ){
+	if ( (i == n) || leader[i] ){
+	    int id = blocks_.size();
+	    blocks_.push_back(Basic_Block(id, first, i - 1));
+	    for ( int j = first; j < i; j++ )
+		line_Block_[j] = id;
+	    std::vector<int> labels = list[first].Labels();
+	    for ( size_t k = 0; k < labels.size(); k++ )
+		label_Block_[labels[k]] = id;
+	    first = i;
+	}
+    }
+}
+
+// a label in the run-time error section, or of a block that pushes the
+// arguments of an error, and goes there
+int
+CFG::isErrorExit(int Label) const
+{
+    ir_Rep const& list = *list_;
+    int b = blockOfLabel(Label);
+    if ( (-1 == b) )
+	return 1;
+    Basic_Block const& block = blocks_[b];
+    for ( int k = block.First(); k < block.Last(); k++ )
+	if ( (op_pushl != list[k].Op()) )
+	    return 0;
+    SSA_Entry const& last = list[block.Last()];
+    return ( (op_goto == last.Op()) && (-1 == blockOfLabel(jumpLabel(last))) );
+}
+
+int
+CFG::blockOfLabel(int Label) const
+{
+    std::map<int, int>::const_iterator iter = label_Block_.find(Label);
+    if ( (label_Block_.end() == iter) )
+	return -1;
+    return iter->second;
+}
+
+void
+CFG::makeEdges(void)
+{
+    ir_Rep const& list = *list_;
+    for ( size_t b = 0; b < blocks_.size(); b++ ){
+	SSA_Entry const& last = list[blocks_[b].Last()];
+	int label = jumpLabel(last);
+	if ( (-1 != label) ){
+	    int to = blockOfLabel(label);
+	    if ( (-1 == to) )
+		blocks_[b].addExit(label);
+	    else{
+		blocks_[b].addSucc(to);
+		blocks_[to].addPred(b);
+	    }
+	}
+	if ( !(endsFlow(last)) && (b + 1 < blocks_.size()) ){
+	    // iffalse to the very next line: one edge only
+	    std::vector<int> const& s = blocks_[b].Succs();
+	    if ( (s.end() == std::find(s.begin(), s.end(), b + 1)) ){
+		blocks_[b].addSucc(b + 1);
+		blocks_[b + 1].addPred(b);
+	    }
+	}
+    }
+}
+
+// iterative DFS from the entry block (lists can be long)
+void
+CFG::makeRPO(void)
+{
+    int n = blocks_.size();
+    rpo_No_.assign(n, -1);
+    if ( (0 == n) )
+	return;
+
+    std::vector<int> post;
+    std::vector<int> visited(n, 0);
+    std::vector<std::pair<int, size_t> > stack;
+    stack.push_back(std::make_pair(0, 0));
+    visited[0] = 1;
+    while ( !(stack.empty()) ){
+	int b = stack.back().first;
+	size_t k = stack.back().second;
+	std::vector<int> const& s = blocks_[b].Succs();
+	if ( (k < s.size()) ){
+	    stack.back().second++;
+	    if ( !(visited[s[k]]) ){
+		visited[s[k]] = 1;
+		stack.push_back(std::make_pair(s[k], 0));
+	    }
+	}
+	else{
+	    post.push_back(b);
+	    stack.pop_back();
+	}
+    }
+
+    rpo_.assign(post.rbegin(), post.rend());
+    for ( size_t i = 0; i < rpo_.size(); i++ )
+	rpo_No_[rpo_[i]] = i;
+}
+
+// Cooper, Harvey, Kennedy: "A Simple, Fast Dominance Algorithm"
+void
+CFG::makeDominators(void)
+{
+    int n = blocks_.size();
+    if ( (0 == n) )
+	return;
+    std::vector<int> idom(n, -1);
+    idom[0] = 0;
+
+    int changed = 1;
+    while (changed){
+	changed = 0;
+	for ( size_t i = 1; i < rpo_.size(); i++ ){
+	    int b = rpo_[i];
+	    int new_Idom = -1;
+	    std::vector<int> const& p = blocks_[b].Preds();
+	    for ( size_t k = 0; k < p.size(); k++ ){
+		if ( (-1 == idom[p[k]]) )
+		    continue;
+		if ( (-1 == new_Idom) ){
+		    new_Idom = p[k];
+		    continue;
+		}
+		int f1 = p[k], f2 = new_Idom; // intersect
+		while ( (f1 != f2) ){
+		    while ( (rpo_No_[f1] > rpo_No_[f2]) ) f1 = idom[f1];
+		    while ( (rpo_No_[f2] > rpo_No_[f1]) ) f2 = idom[f2];
+		}
+		new_Idom = f1;
+	    }
+	    if ( (idom[b] != new_Idom) ){
+		idom[b] = new_Idom;
+		changed = 1;
+	    }
+	}
+    }
+
+    for ( int b = 1; b < n; b++ ){
+	if ( (-1 == idom[b]) )
+	    continue;
+	blocks_[b].setIdom(idom[b]);
+	blocks_[idom[b]].addDomKid(b);
+    }
+}
+
+int
+CFG::dominates(int A, int B) const
+{
+    if ( !(isReachable(B)) )
+	return 0;
+    while ( (A != B) && (0 != B) )
+	B = blocks_[B].Idom();
+    return (A == B);
+}
+
+void
+CFG::makeFrontiers(void)
+{
+    for ( size_t b = 0; b < blocks_.size(); b++ ){
+	std::vector<int> const& p = blocks_[b].Preds();
+	if ( (2 > p.size()) || !(isReachable(b)) )
+	    continue;
+	for ( size_t k = 0; k < p.size(); k++ ){
+	    int runner = p[k];
+	    if ( !(isReachable(runner)) )
+		continue;
+	    while ( (runner != blocks_[b].Idom()) ){
+		std::vector<int> const& f = blocks_[runner].Frontier();
+		if ( (f.end() == std::find(f.begin(), f.end(), (int)b)) )
+		    blocks_[runner].addFrontier(b);
+		if ( (0 == runner) ) break;
+		runner = blocks_[runner].Idom();
+	    }
+	}
+    }
+}
+
+// Natural loops: a back edge L -> H (H dominates L) adds H and all
+// blocks reaching L without passing H. Loops with the same header merge.
+void
+CFG::makeLoops(void)
+{
+    std::map<int, int> header_Loop;
+    for ( size_t i = 0; i < rpo_.size(); i++ ){
+	int l = rpo_[i];
+	std::vector<int> const& s = blocks_[l].Succs();
+	for ( size_t k = 0; k < s.size(); k++ ){
+	    int h = s[k];
+	    if ( !(dominates(h, l)) )
+		continue;
+	    if ( (header_Loop.end() == header_Loop.find(h)) ){
+		header_Loop[h] = loops_.size();
+		loops_.push_back(Loop_Info(h));
+		loops_.back().addBlock(h);
+	    }
+	    Loop_Info& loop = loops_[header_Loop[h]];
+	    loop.addLatch(l);
+
+	    std::vector<int> work;
+	    if ( !(loop.contains(l)) ){
+		loop.addBlock(l);
+		work.push_back(l);
+	    }
+	    while ( !(work.empty()) ){
+		int b = work.back();
+		work.pop_back();
+		std::vector<int> const& p = blocks_[b].Preds();
+		for ( size_t j = 0; j < p.size(); j++ )
+		    if ( isReachable(p[j]) && !(loop.contains(p[j])) ){
+			loop.addBlock(p[j]);
+			work.push_back(p[j]);
+		    }
+	    }
+	}
+    }
+
+    // nesting: the parent is the smallest other loop containing the header
+    for ( size_t i = 0; i < loops_.size(); i++ ){
+	int best = -1;
+	for ( size_t j = 0; j < loops_.size(); j++ ){
+	    if ( (i == j) || !(loops_[j].contains(loops_[i].Header())) )
+		continue;
+	    if ( (loops_[j].Blocks().size() <= loops_[i].Blocks().size()) )
+		continue;
+	    if ( (-1 == best) ||
+		 (loops_[j].Blocks().size() < loops_[best].Blocks().size()) )
+		best = j;
+	}
+	loops_[i].setParent(best);
+    }
+    for ( size_t i = 0; i < loops_.size(); i++ ){
+	int d = 1;
+	for ( int p = loops_[i].Parent(); -1 != p; p = loops_[p].Parent() )
+	    d++;
+	loops_[i].setDepth(d);
+    }
+
+    // innermost loop of each block
+    for ( size_t i = 0; i < loops_.size(); i++ ){
+	std::set<int>::const_iterator iter;
+	for ( iter = loops_[i].Blocks().begin();
+	      iter != loops_[i].Blocks().end(); iter++ ){
+	    int cur = blocks_[*iter].Loop();
+	    if ( (-1 == cur) || (loops_[cur].Depth() < loops_[i].Depth()) )
+		blocks_[*iter].setLoop(i);
+	}
+    }
+}
+
+int
+CFG::loopDepth(int B) const
+{
+    int l = blocks_[B].Loop();
+    return ( (-1 == l) )?0:loops_[l].Depth();
+}
+
+// the one block entering loop L from outside, going nowhere else
+// (-1: none)
+int
+CFG::preheader(int L) const
+{
+    Loop_Info const& loop = loops_[L];
+    std::vector<int> const& preds = blocks_[loop.Header()].Preds();
+    int pre = -1;
+    for ( size_t k = 0; k < preds.size(); k++ ){
+	if ( loop.contains(preds[k]) )
+	    continue;
+	if ( (-1 != pre) )
+	    return -1;
+	pre = preds[k];
+    }
+    if ( (-1 == pre) || (1 != blocks_[pre].Succs().size()) )
+	return -1;
+    return pre;
+}
+
+std::string
+dotEscape(std::string const& Str)
+{
+    std::string ret;
+    for ( size_t i = 0; i < Str.size(); i++ ){
+	if ( ('"' == Str[i]) || ('\\' == Str[i]) || ('{' == Str[i]) ||
+	     ('}' == Str[i]) || ('<' == Str[i]) || ('>' == Str[i]) ||
+	     ('|' == Str[i]) )
+	    ret += '\\';
+	ret += Str[i];
+    }
+    return ret;
+}
+
+// one record per block: header (id, dominator, loop), then its lines
+void
+CFG::printDot(std::ostream& Out, std::string Name) const
+{
+    ir_Rep const& list = *list_;
+    Out << "digraph \"" << dotEscape(Name) << "\" {\n";
+    Out << "    node [shape=record, fontname=\"Courier\"];\n";
+    for ( size_t b = 0; b < blocks_.size(); b++ ){
+	Out << "    B" << b << " [label=\"{B" << b;
+	if ( (0 != b) && (-1 != blocks_[b].Idom()) )
+	    Out << " (idom B" << blocks_[b].Idom() << ")";
+	if ( (-1 != blocks_[b].Loop()) )
+	    Out << " (loop " << blocks_[b].Loop() << ", depth "
+		<< loopDepth(b) << ")";
+	if ( !(isReachable(b)) )
+	    Out << " (unreachable)";
+	Out << "|";
+	for ( int i = blocks_[b].First(); i <= blocks_[b].Last(); i++ )
+	    Out << dotEscape(list[i].str()) << "\\l";
+	Out << "}\"];\n";
+    }
+    for ( size_t b = 0; b < blocks_.size(); b++ ){
+	std::vector<int> const& s = blocks_[b].Succs();
+	for ( size_t k = 0; k < s.size(); k++ ){
+	    Out << "    B" << b << " -> B" << s[k];
+	    if ( dominates(s[k], b) )
+		Out << " [style=dashed]"; // back edge
+	    Out << ";\n";
+	}
+	std::vector<int> const& e = blocks_[b].ExitTargets();
+	for ( size_t k = 0; k < e.size(); k++ ){
+	    Out << "    B" << b << " -> \"" << dotEscape(ir_Labels[e[k]]);
+	    Out << "\" [style=dotted];\n";
+	}
+    }
+    Out << "}\n";
+}
@@ -0,0 +1,137 @@
+/********************************************************************
+* cfg.h - control-flow graph over the IR
+*
+* Blocks: a leader is the first line, a labeled line, or the line
+*         after a jump (goto, iffalse, iftrue) or exit syscall.
+*         Blocks are ranges [First(), Last()] of lines of the list
+*         the graph was built from; any pass changing the list has
+*         to rebuild the graph.
+* Edges:  jumps resolve through the labels of the list; a jump to a
+*         label outside of it (the run-time error section) leaves the
+*         graph, and is recorded in the block instead (ExitTargets()).
+* Info:   reverse post-order, immediate dominators (Cooper, Harvey,
+*         Kennedy), dominance frontiers, and natural loops merged by
+*         header, with their nesting (and preheaders).
+*
+********************************************************************/
+
+#ifndef CFG_H_
+#define CFG_H_
+
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <ostream>
+
+#include "ir.h"
+
+int isJump(ir_Op Op);
+int isCondJump(ir_Op Op);
+int endsFlow(SSA_Entry const& Line);
+int jumpLabel(SSA_Entry const& Line);
+
+class Basic_Block{
+public:
+Basic_Block(int Id = -1, int First = 0, int Last = 0)
+    : id_(Id), first_(First), last_(Last), idom_(-1), loop_(-1) {}
+
+    int Id(void) const { return id_; }
+    int First(void) const { return first_; }
+    int Last(void) const { return last_; }
+    int Size(void) const { return last_ - first_ + 1; }
+    int Idom(void) const { return idom_; }
+    int Loop(void) const { return loop_; } // innermost loop (-1: none)
+
+    std::vector<int> const& Succs(void) const { return succs_; }
+    std::vector<int> const& Preds(void) const { return preds_; }
+    std::vector<int> const& DomKids(void) const { return dom_Kids_; }
+    std::vector<int> const& Frontier(void) const { return frontier_; }
+    std::vector<int> const& ExitTargets(void) const { return exits_; }
+
+    void addSucc(int B) { succs_.push_back(B); }
+    void addPred(int B) { preds_.push_back(B); }
+    void addDomKid(int B) { dom_Kids_.push_back(B); }
+    void addFrontier(int B) { frontier_.push_back(B); }
+    void addExit(int Label) { exits_.push_back(Label); }
+    void setIdom(int B) { idom_ = B; }
+    void setLoop(int L) { loop_ = L; }
+
+private:
+    int id_;
+    int first_;
+    int last_;
+    int idom_; // -1: entry, or unreachable
+    int loop_;
+    std::vector<int> succs_;
+    std::vector<int> preds_;
+    std::vector<int> dom_Kids_;
+    std::vector<int> frontier_;
+    std::vector<int> exits_; // labels jumped to outside of the list
+};
+
+class Loop_Info{
+public:
+Loop_Info(int Header = -1)
+    : header_(Header), parent_(-1), depth_(1) {}
+
+    int Header(void) const { return header_; }
+    int Parent(void) const { return parent_; }
+    int Depth(void) const { return depth_; }
+    std::set<int> const& Blocks(void) const { return blocks_; }
+    std::vector<int> const& Latches(void) const { return latches_; }
+    int contains(int B) const { return (blocks_.end() != blocks_.find(B)); }
+
+    void addBlock(int B) { blocks_.insert(B); }
+    void addLatch(int B) { latches_.push_back(B); }
+    void setParent(int L) { parent_ = L; }
+    void setDepth(int D) { depth_ = D; }
+
+private:
+    int header_;
+    int parent_; // enclosing loop (-1: outermost)
+    int depth_;  // 1: outermost
+    std::set<int> blocks_;
+    std::vector<int> latches_; // sources of back edges
+};
+
+class CFG{
+public:
+    CFG(ir_Rep const& List);
+
+    ir_Rep const& List(void) const { return *list_; }
+    int numBlocks(void) const { return blocks_.size(); }
+    Basic_Block const& Block(int B) const { return blocks_[B]; }
+    std::vector<Basic_Block> const& Blocks(void) const { return blocks_; }
+    int blockOfLine(int Line) const { return line_Block_[Line]; }
+    int blockOfLabel(int Label) const;
+    int isErrorExit(int Label) const;
+
+    std::vector<int> const& RPO(void) const { return rpo_; }
+    int isReachable(int B) const { return (-1 != rpo_No_[B]); }
+    int dominates(int A, int B) const;
+    int loopDepth(int B) const;
+
+    std::vector<Loop_Info> const& Loops(void) const { return loops_; }
+    int preheader(int L) const;
+
+    void printDot(std::ostream& Out, std::string Name) const;
+
+private:
+    void makeBlocks(void);
+    void makeEdges(void);
+    void makeRPO(void);
+    void makeDominators(void);
+    void makeFrontiers(void);
+    void makeLoops(void);
+
+    ir_Rep const* list_;
+    std::vector<Basic_Block> blocks_;
+    std::vector<int> line_Block_;
+    std::map<int, int> label_Block_;
+    std::vector<int> rpo_;
+    std::vector<int> rpo_No_; // -1: unreachable
+    std::vector<Loop_Info> loops_;
+};
+
+#endif
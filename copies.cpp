@@ -0,0 +1,198 @@
+/********************************************************************
+* copies.cpp - copy propagation, and coalescing of tmps
+*
+* Copy propagation: on SSA form, a copy t = x (x a value or a literal)
+*         makes t another name for x; its uses read x instead, and the
+*         copy goes (a NOP, c. sccp.cpp). The post-increment copies and
+*         the results of || and && the visitor makes are mostly such.
+* Coalescing: out of SSA form, tmps share a name wherever their live
+*         ranges don't interfere (one defined while the other is live;
+*         a copy between the two doesn't count). A tmp copied to or
+*         from another value takes that one's name first (a variable's
+*         as well), so the copy becomes x = x and goes; the others take
+*         the first name free, so there are as few tmps as a greedy
+*         pass over the definitions finds. Ints and doubles don't share
+*         (c. findFloats()). Variables keep their names.
+*
+********************************************************************/
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "ssa.h"
+#include "opt.h"
+
+int
+copyPropSSA(ir_Rep& List)
+{
+    int changes = 0;
+    std::map<Operand, Operand> names;
+    for ( size_t i = 0; i < List.size(); i++ ){
+	SSA_Entry& line = List[i];
+	if ( (op_copy != line.Op()) || !(isValue(line.Target())) )
+	    continue;
+	Operand from = line.LHS();
+	if ( !(isValue(from)) && !(from.isImm()) )
+	    continue;
+	std::map<Operand, Operand>::const_iterator iter = names.find(from);
+	if ( (names.end() != iter) )
+	    from = iter->second;
+	if ( (from == line.Target()) )
+	    continue;
+	names[line.Target()] = from;
+	makeNOP(line);
+	changes++;
+    }
+    if ( (0 == changes) )
+	return 0;
+
+    // a copy may come after a use of its target (along a back edge)
+    std::map<Operand, Operand>::iterator iter;
+    for ( iter = names.begin(); iter != names.end(); iter++ ){
+	std::map<Operand, Operand>::const_iterator next;
+	while ( (names.end() != (next = names.find(iter->second))) )
+	    iter->second = next->second;
+    }
+    for ( size_t i = 0; i < List.size(); i++ )
+	replaceUses(List[i], names);
+
+    return changes;
+}
+
+int
+propagateCopies(ir_Rep& List)
+{
+    return withSSA(List, copyPropSSA);
+}
+
+/***************************************
+* Coalescing
+***************************************/
+typedef std::set<std::pair<Operand, Operand> > interf_Set;
+
+int
+interferes(interf_Set const& Interf, Operand const& A, Operand const& B)
+{
+    return Interf.count(std::make_pair(std::min(A, B), std::max(A, B)));
+}
+
+void
+findInterference(ir_Rep const& List, interf_Set& Interf)
+{
+    CFG g(List);
+    Liveness live(g);
+    std::vector<Operand> defs, uses;
+
+    for ( int b = 0; b < g.numBlocks(); b++ ){
+	opd_Set cur = live.LiveOut(b);
+	for ( int i = g.Block(b).Last(); i >= g.Block(b).First(); i-- ){
+	    lineDefs(List[i], defs);
+	    for ( size_t k = 0; k < defs.size(); k++ ){
+		Operand d = defs[k];
+		opd_Set::const_iterator iter;
+		for ( iter = cur.begin(); iter != cur.end(); iter++ ){
+		    if ( (*iter == d) )
+			continue;
+		    if ( (op_copy == List[i].Op()) && (List[i].LHS() == *iter) )
+			continue;
+		    Interf.insert(std::make_pair(std::min(d, *iter),
+						 std::max(d, *iter)));
+		}
+		cur.erase(d);
+	    }
+	    lineUses(List[i], uses);
+	    cur.insert(uses.begin(), uses.end());
+	}
+    }
+}
+
+// Returns the number of tmps gone
+int
+coalesceTmps(ir_Rep& List)
+{
+    if ( inSSA() || List.empty() )
+	return 0;
+
+    interf_Set interf;
+    findInterference(List, interf);
+    opd_Set flt;
+    findFloats(List, flt);
+
+    // the values each tmp is copied to or from
+    std::map<Operand, std::vector<Operand> > partners;
+    for ( size_t i = 0; i < List.size(); i++ ){
+	SSA_Entry const& line = List[i];
+	if ( (op_copy != line.Op()) || !(isValue(line.Target())) ||
+	     !(isValue(line.LHS())) )
+	    continue;
+	partners[line.Target()].push_back(line.LHS());
+	partners[line.LHS()].push_back(line.Target());
+    }
+
+    // a name, and the values given it
+    std::map<Operand, std::vector<Operand> > given;
+    std::map<Operand, Operand> names;
+    std::vector<Operand> free; // tmp names, in order of first use
+    std::vector<Operand> defs;
+    int tmps = 0;
+    for ( size_t i = 0; i < List.size(); i++ ){
+	lineDefs(List[i], defs);
+	if ( defs.empty() || !(defs[0].isTmp()) || names.count(defs[0]) )
+	    continue;
+	Operand d = defs[0];
+	tmps++;
+
+	std::vector<Operand> cand;
+	std::vector<Operand> const& p = partners[d];
+	for ( size_t k = 0; k < p.size(); k++ ){
+	    if ( p[k].isVar() )
+		cand.push_back(p[k]);
+	    else if ( names.count(p[k]) )
+		cand.push_back(names[p[k]]);
+	}
+	cand.insert(cand.end(), free.begin(), free.end());
+
+	Operand name = d;
+	for ( size_t k = 0; k < cand.size(); k++ ){
+	    if ( (flt.count(cand[k]) != flt.count(d)) )
+		continue;
+	    std::vector<Operand>& members = given[cand[k]];
+	    if ( members.empty() )
+		members.push_back(cand[k]);
+	    size_t j = 0;
+	    for ( ; j < members.size(); j++ )
+		if ( interferes(interf, d, members[j]) )
+		    break;
+	    if ( (members.size() == j) ){
+		name = cand[k];
+		break;
+	    }
+	}
+	if ( (name == d) ){
+	    free.push_back(d);
+	    given[d].push_back(d);
+	}
+	else
+	    given[name].push_back(d);
+	names[d] = name;
+    }
+    if ( (free.size() == static_cast<size_t>(tmps)) )
+	return 0;
+
+    for ( size_t i = 0; i < List.size(); i++ ){
+	SSA_Entry& line = List[i];
+	lineDefs(line, defs);
+	replaceUses(line, names);
+	if ( !(defs.empty()) && names.count(defs[0]) )
+	    line.setTarget(names[defs[0]]);
+	if ( (op_copy == line.Op()) && (line.Target() == line.LHS()) )
+	    makeNOP(line);
+    }
+    removeNOPs(List);
+
+    return tmps - free.size();
+}
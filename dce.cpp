@@ -0,0 +1,112 @@
+/********************************************************************
+* dce.cpp - dead code, and unreachable block elimination
+*
+* Dead code:   a line computing a value (without side effects, c.
+*              hasSideEffect()) not live right after it goes, as does a
+*              copy of a value to itself. Removing a line can make the
+*              lines computing its operands dead, so liveness is redone
+*              until nothing changes.
+* Unreachable: blocks not reached from the entry go (code after a goto,
+*              a break, or a branch resolved by sccp).
+* In SSA form lines are turned into NOPs (c. sccp.cpp), and phi
+* arguments coming from blocks that went are dropped.
+*
+********************************************************************/
+
+#include <vector>
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "ssa.h"
+#include "opt.h"
+
+void
+makeNOP(SSA_Entry& Line)
+{
+    Line = SSA_Entry(op_nop, Operand(), Operand(), Operand(), Line.Frame(),
+		     Line.LabelChain());
+}
+
+int
+removeUnreachable(ir_Rep& List)
+{
+    CFG g(List);
+    int removed = 0;
+    if ( !(inSSA()) ){
+	size_t out = 0;
+	for ( size_t i = 0; i < List.size(); i++ )
+	    if ( g.isReachable(g.blockOfLine(i)) )
+		List[out++] = List[i];
+	removed = List.size() - out;
+	List.resize(out);
+	return removed;
+    }
+
+    for ( size_t i = 0; i < List.size(); i++ ){
+	SSA_Entry& line = List[i];
+	if ( g.isReachable(g.blockOfLine(i)) ){
+	    if ( (op_phi != line.Op()) )
+		continue;
+	    Phi_Info& info = ir_Phis[line.LHS().Id()];
+	    for ( int k = info.Size() - 1; k >= 0; k-- ){
+		int pred = g.blockOfLabel(info.Pred(k));
+		if ( (-1 == pred) || !(g.isReachable(pred)) )
+		    info.removeArg(k);
+	    }
+	}
+	else if ( (op_nop != line.Op()) ){
+	    makeNOP(line);
+	    removed++;
+	}
+    }
+    return removed;
+}
+
+// one backward sweep over each block; returns the number of lines removed
+int
+sweepDeadLines(ir_Rep& List)
+{
+    CFG g(List);
+    Liveness live(g);
+    std::vector<Operand> defs, uses;
+    int removed = 0;
+
+    for ( int b = 0; b < g.numBlocks(); b++ ){
+	if ( !(g.isReachable(b)) )
+	    continue;
+	opd_Set cur = live.LiveOut(b);
+	for ( int i = g.Block(b).Last(); i >= g.Block(b).First(); i-- ){
+	    SSA_Entry& line = List[i];
+	    lineDefs(line, defs);
+	    int dead = !(defs.empty()) && !(hasSideEffect(line)) &&
+		!(cur.count(defs[0]));
+	    if ( (op_copy == line.Op()) && (line.Target() == line.LHS()) )
+		dead = 1;
+	    if ( dead ){
+		makeNOP(line);
+		removed++;
+		continue;
+	    }
+	    for ( size_t k = 0; k < defs.size(); k++ )
+		cur.erase(defs[k]);
+	    if ( (op_phi == line.Op()) )
+		continue;
+	    lineUses(line, uses);
+	    cur.insert(uses.begin(), uses.end());
+	}
+    }
+    return removed;
+}
+
+int
+removeDeadCode(ir_Rep& List)
+{
+    int removed = 0;
+    for ( int n = sweepDeadLines(List); 0 != n; n = sweepDeadLines(List) )
+	removed += n;
+
+    if ( (0 != removed) && !(inSSA()) )
+	removeNOPs(List);
+    return removed;
+}
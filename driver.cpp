@@ -14,6 +14,12 @@
 #include "parser.h"
 #include "ir.h" 
 #include "visitor.h"
+#include "opt.h"
+#include "cfg.h"
+#include "x86.h"
+#include "vm.h"
+#include "jit.h"
+#include "cache.h"
 
 void preProcess(std::string);
 
@@ -26,7 +32,20 @@ extern int emitRtError_Section;
 int option_Debug = 0;
 int option_Preproc = 0;  // pre-process, create file, and exit
 int option_IR = 0;       // create IR, create IR file, and exit
-int option_OptLevel = 0; // 0 - remove NOPs
+int option_OptLevel = -1; // -1: none; 0: remove NOPs; 1-3: c. opt.cpp
+int option_Stats = 0;     // print per-pass statistics
+std::string option_Passes; // explicit pass list (overrides option_OptLevel)
+int option_Dot = 0;       // write CFG of the final IR to <basename>.dot
+int option_Asm = 0;       // write x86-64 assembly to <basename>.s
+int option_Run = 0;       // run the IR (-run)
+int option_Jit = 0;       // run x86-64 code in process (-jit)
+int option_GprLimit = -1; // registers assigned per class (-1: all)
+int option_SseLimit = -1;
+int option_Unroll = 4;    // copies per partially unrolled loop (-U)
+int option_Tile = 32;     // iterations per tile of a tiled loop (-T)
+int option_CacheSize = 0; // cache simulated for -run (-C; 0: none)
+int option_CacheLine = 0;
+int option_CacheWays = 0;
 
 std::string base_Name;
 std::fstream* input; // first source file, then preproc'ed file
@@ -159,25 +178,111 @@ startParse(void)
     std::cout << "\n";
 }
 
+void
+writeDot(ir_Rep const& List)
+{
+    std::string name_Str = base_Name + ".dot";
+    std::ofstream out(name_Str.c_str());
+    if ( !(out.good()) )
+	errExit(1, "can't open file <%s>", name_Str.c_str());
+
+    CFG cfg(List);
+    cfg.printDot(out, base_Name);
+}
+
+void
+writeAsm(ir_Rep const& List, ir_Rep const& Errors)
+{
+    std::string name_Str = base_Name + ".s";
+    std::ofstream out(name_Str.c_str());
+    if ( !(out.good()) )
+	errExit(1, "can't open file <%s>", name_Str.c_str());
+
+    emitX86(List, Errors, out);
+}
+
+// to std::cerr, after what the program printed
+void
+runProgram(ir_Rep const& List, ir_Rep const& Errors)
+{
+    Cache_Sim* cache = 0;
+    if ( (0 < option_CacheSize) )
+	cache = new Cache_Sim(option_CacheSize, option_CacheLine,
+			      option_CacheWays);
+    VM_Result r = runIR(List, Errors, cache);
+    std::cerr << "\nrun: exit status " << r.Status() << ", ";
+    std::cerr << r.Count() << " instructions in ";
+    std::cerr << r.Usec() / 1000.0 << " ms";
+    if ( (0 < r.Usec()) )
+	std::cerr << " (" << r.Count() / static_cast<double>(r.Usec()) << " M instructions/s)";
+    std::cerr << "\n";
+    if ( (0 == cache) )
+	return;
+    std::cerr << "cache: " << cache->Size() << " bytes, " << cache->Line();
+    std::cerr << " byte lines, " << cache->Ways() << " ways: ";
+    std::cerr << cache->Accesses() << " accesses, " << cache->Misses();
+    std::cerr << " misses";
+    if ( (0 < cache->Accesses()) )
+	std::cerr << " (" << 100.0 * cache->Misses() / cache->Accesses() << "%)";
+    std::cerr << "\n";
+    delete cache;
+}
+
+void
+runJitted(ir_Rep const& List, ir_Rep const& Errors)
+{
+    JIT_Result r = runJIT(List, Errors, base_Name + ".dec");
+    std::cerr << "\njit: exit status " << r.Status() << ", ";
+    std::cerr << r.Bytes() << " bytes in " << r.Usec() / 1000.0 << " ms, ";
+    std::cerr << "ran " << r.RunUsec() / 1000.0 << " ms\n";
+}
+
+// run the passes selected by -O/-P in place over List
+void
+optimizeIR(ir_Rep& List)
+{
+    Pass_Manager PM;
+    if ( ("" != option_Passes) ){
+	if ( (-1 == buildPassList(PM, option_Passes)) ){
+	    std::cerr << "invalid pass list <" << option_Passes << ">; ";
+	    std::cerr << "passes are:\n";
+	    printPassTable();
+	    errExit(0, "aborting");
+	}
+    }
+    else if ( (0 <= option_OptLevel) )
+	buildPipeline(PM, option_OptLevel);
+    else
+	return;
+
+    PM.run(List);
+    if (option_Stats)
+	PM.printStats();
+}
+
 void
 astToIR(void)
 {
+    int first_Line = 1; // error section continues the numbering
+
     if ( (0 != pFirst_Node) ){
 
 	printSTInfo();
+	if ( ("" == option_Passes) && (3 <= option_OptLevel) ){
+	    interchangeLoops(pFirst_Node);
+	    tileLoops(pFirst_Node);
+	}
 	MakeIR_Visitor* IR_Root = new MakeIR_Visitor();
 	pFirst_Node->accept(IR_Root);
 
 	if (emitRtError_Section)
 	    printDataSection();
 
-	if ( !(option_OptLevel) )	
-	    printIR_List(iR_List);
-
-	if ( (1 == option_OptLevel) ){
-	    iR_List_2 = removeNOPs(iR_List);
-	    printIR_List(iR_List_2);
-	}
+	optimizeIR(iR_List);
+	printIR_List(iR_List);
+	first_Line += iR_List.size();
+	if (option_Dot)
+	    writeDot(iR_List);
 //	delete IR_Root; // ** TO DO: clarify why can't delete
     }
     else{
@@ -187,6 +292,21 @@ astToIR(void)
 
     if (emitRtError_Section){
 	makeRtErrorTargetTable(iR_RtError_Targets);
-	printIR_List(iR_RtError_Targets);
+	printIR_List(iR_RtError_Targets, first_Line);
     }
+    if ( !(option_Asm) && !(option_Run) && !(option_Jit) )
+	return;
+    if ( (no_lex_Errors) || (no_par_Errors) ){
+	std::cerr << "no assembly written, nothing run (errors found)\n";
+	return;
+    }
+    // the bound checks of arrays of constant size jump there as well
+    if ( iR_RtError_Targets.empty() )
+	makeRtErrorTargetTable(iR_RtError_Targets);
+    if (option_Asm)
+	writeAsm(iR_List, iR_RtError_Targets);
+    if (option_Run)
+	runProgram(iR_List, iR_RtError_Targets);
+    if (option_Jit)
+	runJitted(iR_List, iR_RtError_Targets);
 }
@@ -64,7 +64,10 @@ void
 usageErr(std::string Name)
 {
     std::cerr << "Usage: " << Name << ": ";
-    std::cerr << "[-d] [-O 0] [-p] [-i] <file_Name.dec>\n";
+    std::cerr << "[-d] [-O 0-3] [-P pass,...] [-R gprs,sses] [-U n] [-T n] [-C bytes,line,ways] ";
+    std::cerr << "[-s] [-g] ";
+    std::cerr << "[-S] [-run] [-jit] [-p] [-i] ";
+    std::cerr << "<file_Name.dec>\n";
     exit(EXIT_FAILURE);
 }
 
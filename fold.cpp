@@ -0,0 +1,159 @@
+/********************************************************************
+* fold.cpp - implementation file for fold.h
+*
+********************************************************************/
+
+#include <cmath>
+#include <climits>
+#include <sstream>
+#include <iomanip>
+
+#include "ir.h"
+#include "tables.h"
+#include "fold.h"
+
+Const_Val
+constOf(Operand const& Imm)
+{
+    IR_Const const& c = ir_Consts[Imm.Id()];
+    if ( c.isFlt() )
+	return Const_Val(c.FltVal(), 1);
+    return Const_Val(wrapInt(c.IntVal()));
+}
+
+// a double is spelled so that it reads back as one (c. IR_Const)
+Operand
+constOperand(Const_Val const& V)
+{
+    std::ostringstream tmp_Stream;
+    if ( !(V.isFlt()) )
+	tmp_Stream << V.IntVal();
+    else{
+	tmp_Stream << std::setprecision(17) << V.FltVal();
+	if ( (std::string::npos == tmp_Stream.str().find_first_of(".eE")) )
+	    tmp_Stream << ".0";
+    }
+    return makeImmOperand(tmp_Stream.str());
+}
+
+// to the range of an int on the target (two's complement)
+long
+wrapInt(long V)
+{
+    unsigned long mask = (8 * TYPE_WIDTH_INT < 8 * sizeof(long))?
+	( (1UL << (8 * TYPE_WIDTH_INT)) - 1 ):~0UL;
+    unsigned long u = static_cast<unsigned long>(V) & mask;
+    unsigned long sign = (mask >> 1) + 1;
+    return ( (u & sign) )?-static_cast<long>(mask - u) - 1:
+	static_cast<long>(u);
+}
+
+// the limits of an int on the target
+long
+intMin(void)
+{
+    return wrapInt(1L << (8 * TYPE_WIDTH_INT - 1));
+}
+
+long
+intMax(void)
+{
+    return -(intMin() + 1);
+}
+
+int
+foldFlt(ir_Op Op, double L, double R, Const_Val& Result)
+{
+    double res;
+    switch(Op){
+    case op_add: res = L + R; break;
+    case op_sub: res = L - R; break;
+    case op_mult: res = L * R; break;
+    case op_div:
+	if ( (0 == R) ) return 0;
+	res = L / R;
+	break;
+    case op_neg: res = -L; break;
+    case op_not: Result = Const_Val(0 == L); return 1;
+    case op_lt: Result = Const_Val(L < R); return 1;
+    case op_le: Result = Const_Val(L <= R); return 1;
+    case op_gt: Result = Const_Val(L > R); return 1;
+    case op_ge: Result = Const_Val(L >= R); return 1;
+    case op_eq: Result = Const_Val(L == R); return 1;
+    case op_ne: Result = Const_Val(L != R); return 1;
+    default: return 0;
+    }
+    if ( !(std::isfinite(res)) )
+	return 0;
+    Result = Const_Val(res, 1);
+    return 1;
+}
+
+int
+foldInt(ir_Op Op, long L, long R, Const_Val& Result)
+{
+    long int_Min = wrapInt(1L << (8 * TYPE_WIDTH_INT - 1));
+    long res;
+    switch(Op){
+    case op_add: res = L + R; break;
+    case op_sub: res = L - R; break;
+    case op_mult: res = static_cast<long>(static_cast<unsigned long>(L) *
+					  static_cast<unsigned long>(R));
+	break;
+    case op_div: case op_mod:
+	if ( (0 == R) || ( (int_Min == L) && (-1 == R) ) )
+	    return 0;
+	res = (op_div == Op)?(L / R):(L % R);
+	break;
+    case op_neg: res = -L; break;
+    case op_not: res = (0 == L); break;
+    case op_lt: res = (L < R); break;
+    case op_le: res = (L <= R); break;
+    case op_gt: res = (L > R); break;
+    case op_ge: res = (L >= R); break;
+    case op_eq: res = (L == R); break;
+    case op_ne: res = (L != R); break;
+    default: return 0;
+    }
+    Result = Const_Val(wrapInt(res));
+    return 1;
+}
+
+// Type: the type cast to (op_cast only)
+int
+foldOp(ir_Op Op, Const_Val const& L, Const_Val const& R, int Type,
+       Const_Val& Result)
+{
+    switch(Op){
+    case op_copy:
+	Result = L;
+	return 1;
+    case op_mod:
+	if ( L.isFlt() || R.isFlt() )
+	    return 0;
+	break;
+    case op_cast:
+	if ( (tok_double == Type) )
+	    Result = Const_Val(L.FltVal(), 1);
+	else if ( (tok_bool == Type) )
+	    Result = Const_Val(!(L.isZero()));
+	else if ( (tok_int == Type) && L.isFlt() ){
+	    long int_Min = wrapInt(1L << (8 * TYPE_WIDTH_INT - 1));
+	    if ( !(std::isfinite(L.FltVal())) || (L.FltVal() < int_Min) ||
+		 (L.FltVal() > -(int_Min + 1)) )
+		return 0;
+	    Result = Const_Val(static_cast<long>(L.FltVal()));
+	}
+	else if ( (tok_int == Type) )
+	    Result = L;
+	else
+	    return 0;
+	return 1;
+    default:
+	break;
+    }
+
+    if ( L.isFlt() || R.isFlt() )
+	return foldFlt(Op, L.FltVal(), R.FltVal(), Result);
+    return foldInt(Op, L.IntVal(), R.IntVal(), Result);
+}
@@ -0,0 +1,50 @@
+/********************************************************************
+* fold.h - compile-time evaluation of IR operations
+*
+* Values: int (TYPE_WIDTH_INT wide, wrapping as on the target), or
+*         double. Comparisons and ! yield an int 0 or 1.
+* Not folded: division by zero, an int division overflowing, % of
+*         doubles, and results that are not finite (these are left
+*         for run time).
+*
+********************************************************************/
+
+#ifndef FOLD_H_
+#define FOLD_H_
+
+#include "ir.h"
+
+class Const_Val{
+public:
+Const_Val(long I = 0)
+    : is_Flt_(0), i_Val_(I), f_Val_(I) {}
+Const_Val(double F, int)
+    : is_Flt_(1), i_Val_(static_cast<long>(F)), f_Val_(F) {}
+
+    int isFlt(void) const { return is_Flt_; }
+    long IntVal(void) const { return i_Val_; }
+    double FltVal(void) const { return f_Val_; }
+    int isZero(void) const { return (is_Flt_)?(0 == f_Val_):(0 == i_Val_); }
+
+    bool operator==(Const_Val const& r) const
+    {
+	return ( (is_Flt_ == r.is_Flt_) &&
+		 ( (is_Flt_)?(f_Val_ == r.f_Val_):(i_Val_ == r.i_Val_) ) );
+    }
+    bool operator!=(Const_Val const& r) const { return !(*this == r); }
+
+private:
+    int is_Flt_;
+    long i_Val_;
+    double f_Val_;
+};
+
+Const_Val constOf(Operand const& Imm);
+Operand constOperand(Const_Val const& V);
+long wrapInt(long V);
+long intMin(void);
+long intMax(void);
+int foldOp(ir_Op Op, Const_Val const& L, Const_Val const& R, int Type,
+	   Const_Val& Result);
+
+#endif
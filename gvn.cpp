@@ -0,0 +1,160 @@
+/********************************************************************
+* gvn.cpp - global value numbering (dominator-based; Briggs, Cooper,
+*           Simpson)
+*
+* On SSA form, walking the dominator tree: a line computing the same
+* operation on the same values as a line in a dominating block (or
+* earlier in its own) is redundant; its value is taken from the first
+* one, and the line goes. The table of expressions is scoped to the
+* subtree of the block an expression was found in; the value a name
+* is replaced by (its leader) is valid wherever the name was.
+* - copies make their target a name for the value copied;
+* - a phi with all arguments the same is that argument;
+* - operands of +, *, ==, != are ordered, so a + b and b + a match;
+* - a division is numbered as well: once the first one didn't trap,
+*   the same one later doesn't either;
+* - loads of array elements are not numbered (stores in between; c.
+*   memory.cpp).
+* Lines removed are turned into NOPs (c. sccp.cpp).
+*
+********************************************************************/
+
+#include <map>
+#include <vector>
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "ssa.h"
+#include "opt.h"
+
+class VN_Key{
+public:
+VN_Key(int Op = op_nop, Operand L = Operand(), Operand R = Operand())
+    : op_(Op), l_(L), r_(R) {}
+
+    bool operator<(VN_Key const& r) const
+    {
+	if ( (op_ != r.op_) ) return (op_ < r.op_);
+	if ( (l_ != r.l_) ) return (l_ < r.l_);
+	return (r_ < r.r_);
+    }
+
+private:
+    int op_;
+    Operand l_;
+    Operand r_;
+};
+
+int
+isCommutative(ir_Op Op)
+{
+    return ( (op_add == Op) || (op_mult == Op) || (op_eq == Op) ||
+	     (op_ne == Op) );
+}
+
+Operand
+findLeader(std::map<Operand, Operand> const& Leader, Operand O)
+{
+    std::map<Operand, Operand>::const_iterator iter;
+    while ( (Leader.end() != (iter = Leader.find(O))) )
+	O = iter->second;
+    return O;
+}
+
+// the value of line I if it is the same as one seen before (else none)
+Operand
+numberLine(SSA_Entry const& Line, std::map<VN_Key, Operand>& Table,
+	   std::vector<VN_Key>& Added)
+{
+    Operand l = Line.LHS(), r = Line.RHS();
+    if ( (op_phi == Line.Op()) ){
+	Phi_Info const& info = ir_Phis[l.Id()];
+	if ( (0 == info.Size()) )
+	    return Operand();
+	for ( int k = 1; k < info.Size(); k++ )
+	    if ( (info.Arg(k) != info.Arg(0)) )
+		return Operand();
+	return ( (info.Arg(0) != Line.Target()) )?info.Arg(0):Operand();
+    }
+    if ( (op_copy == Line.Op()) )
+	return ( (isValue(l) || l.isImm()) )?l:Operand();
+    if ( l.isElem() || r.isElem() )
+	return Operand();
+
+    if ( isCommutative(Line.Op()) && (r < l) )
+	std::swap(l, r);
+    VN_Key key(Line.Op(), l, r);
+    std::map<VN_Key, Operand>::const_iterator iter = Table.find(key);
+    if ( (Table.end() != iter) )
+	return iter->second;
+    Table[key] = Line.Target();
+    Added.push_back(key);
+    return Operand();
+}
+
+int
+gvnSSA(ir_Rep& List)
+{
+    int changes = 0;
+    if ( List.empty() )
+	return 0;
+
+    CFG g(List);
+    std::map<Operand, Operand> leader;
+    std::map<VN_Key, Operand> table;
+    std::vector<std::vector<VN_Key> > added(g.numBlocks());
+    std::vector<std::pair<int, int> > walk; // block, 1: leaving it
+
+    walk.push_back(std::make_pair(0, 0));
+    while ( !(walk.empty()) ){
+	int b = walk.back().first;
+	int leaving = walk.back().second;
+	walk.pop_back();
+	if ( leaving ){
+	    for ( size_t k = 0; k < added[b].size(); k++ )
+		table.erase(added[b][k]);
+	    continue;
+	}
+	walk.push_back(std::make_pair(b, 1));
+
+	for ( int i = g.Block(b).First(); i <= g.Block(b).Last(); i++ ){
+	    SSA_Entry& line = List[i];
+	    std::map<Operand, Operand> cur; // uses, by their leaders
+	    std::vector<Operand> uses;
+	    lineUses(line, uses);
+	    for ( size_t k = 0; k < uses.size(); k++ )
+		cur[uses[k]] = findLeader(leader, uses[k]);
+	    replaceUses(line, cur);
+
+	    if ( !(isValueOp(line.Op())) || !(isValue(line.Target())) )
+		continue;
+	    Operand same = numberLine(line, table, added[b]);
+	    if ( same.isNone() )
+		continue;
+	    leader[line.Target()] = same;
+	    makeNOP(line);
+	    changes++;
+	}
+
+	std::vector<int> const& kids = g.Block(b).DomKids();
+	for ( size_t k = 0; k < kids.size(); k++ )
+	    walk.push_back(std::make_pair(kids[k], 0));
+    }
+
+    // phi arguments along back edges, seen before their leaders were
+    std::map<Operand, Operand> all;
+    std::map<Operand, Operand>::const_iterator iter;
+    for ( iter = leader.begin(); iter != leader.end(); iter++ )
+	all[iter->first] = findLeader(leader, iter->first);
+    for ( size_t i = 0; i < List.size(); i++ )
+	replaceUses(List[i], all);
+
+    return changes;
+}
+
+int
+numberValues(ir_Rep& List)
+{
+    return withSSA(List, gvnSSA);
+}
@@ -0,0 +1,679 @@
+/********************************************************************
+* interchange.cpp - loop interchange (on the AST, before the visitor)
+*
+* Arrays are stored row-major (c. adj_Offset(): the last dimension
+* varies fastest), so in
+*     for (i = e1; i REL f1; i++) for (j = e2; j REL f2; j++) a[j][i] = e;
+* each inner iteration moves a row ahead. For a perfect nest of two for
+* loops (the outer body is the inner loop only), the inner body being
+* assignments, the cost of each loop as the inner one is summed over
+* the array accesses: 0 for an access it doesn't move, the element
+* stride (up to INTERCHANGE_LINE, a cache line) for one it does. If the
+* outer loop costs less, the two (init; cond; iter) lists change places.
+* That doesn't change what the nest computes, as checked (conservatively):
+* - both loops are i = e; i REL e; i++ (or i--, i += c, i = i + c), on
+*   int variables, with bounds that don't mention the other loop's
+*   variable or anything the body writes (the nest is rectangular),
+* - the body only loads, computes and stores (no increments, branches
+*   or declarations),
+* - an array the body writes is accessed at the one subscript list, a
+*   subscript of which is affine in just one of the two variables:
+*   iterations meeting at an element agree in that variable, and so
+*   run in the same order either way; no subscript reads such an array,
+* - scalars the body writes are int sums s = s + e, s = s - e (s += e,
+*   s -= e), not read otherwise (the order of the terms doesn't matter),
+* - neither variable is read after the nest (other than in a for loop
+*   setting it first): the values they are left with differ.
+* Runs at -O 3, per pair of loops (in a deeper nest, the innermost two).
+* With -s, the element strides of each nest are listed (to std::cerr),
+* as it is and interchanged, and whether it was.
+*
+********************************************************************/
+
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "ast.h"
+#include "nest.h"
+#include "opt.h"
+
+extern int option_Stats;
+
+// the variable a plain (scalar) variable reference names (0: not one);
+// scalar references are the IdExpr_AST object of the declaration
+IdExpr_AST*
+scalarOf(Node_AST* N)
+{
+    if ( (0 == N) || (dynamic_cast<ArrayIdExpr_AST*>(N)) ||
+	 (dynamic_cast<PreIncrIdExpr_AST*>(N)) ||
+	 (dynamic_cast<PostIncrIdExpr_AST*>(N)) )
+	return 0;
+    return dynamic_cast<IdExpr_AST*>(N);
+}
+
+// variables and arrays referenced in N (declared names excepted)
+void
+collectRefs(Node_AST* N, std::set<IdExpr_AST*>& Vars,
+	    std::set<ArrayVarDecl_AST*>& Arrays)
+{
+    if ( (0 == N) )
+	return;
+    IterExprList_AST* list = dynamic_cast<IterExprList_AST*>(N);
+    if ( (0 != list) ){
+	collectRefs(list->Init(), Vars, Arrays);
+	collectRefs(list->Cond(), Vars, Arrays);
+	collectRefs(list->Iter(), Vars, Arrays);
+	return;
+    }
+    PreIncrIdExpr_AST* pre = dynamic_cast<PreIncrIdExpr_AST*>(N);
+    PostIncrIdExpr_AST* post = dynamic_cast<PostIncrIdExpr_AST*>(N);
+    ArrayIdExpr_AST* elem = dynamic_cast<ArrayIdExpr_AST*>(N);
+    ArrayVarDecl_AST* decl = dynamic_cast<ArrayVarDecl_AST*>(N);
+    std::vector<Expr_AST*>* dims = 0;
+    if ( (0 != pre) )
+	Vars.insert(pre->Name());
+    else if ( (0 != post) )
+	Vars.insert(post->Name());
+    else if ( (0 != elem) ){
+	Arrays.insert(elem->Base());
+	dims = elem->Dims();
+    }
+    else if ( (0 != decl) )
+	dims = decl->Dims();
+    else if ( (dynamic_cast<Decl_AST*>(N)) )
+	return;
+    else if ( (0 != scalarOf(N)) )
+	Vars.insert(scalarOf(N));
+    else{
+	collectRefs(N->LChild(), Vars, Arrays);
+	collectRefs(N->RChild(), Vars, Arrays);
+	return;
+    }
+    if ( (0 != dims) )
+	for ( size_t k = 0; k < dims->size(); k++ )
+	    collectRefs((*dims)[k], Vars, Arrays);
+}
+
+int
+mentions(Node_AST* N, IdExpr_AST* V)
+{
+    std::set<IdExpr_AST*> vars;
+    std::set<ArrayVarDecl_AST*> arrays;
+    collectRefs(N, vars, arrays);
+    return vars.count(V);
+}
+
+// loads and arithmetic only (no increments, assignments or logic)
+int
+isPure(Node_AST* N)
+{
+    if ( (0 == N) )
+	return 1;
+    if ( (dynamic_cast<IntExpr_AST*>(N)) || (dynamic_cast<FltExpr_AST*>(N)) ||
+	 (dynamic_cast<Tmp_AST*>(N)) || (0 != scalarOf(N)) )
+	return 1;
+    ArrayIdExpr_AST* elem = dynamic_cast<ArrayIdExpr_AST*>(N);
+    if ( (0 != elem) ){
+	if ( (dynamic_cast<PreIncrArrayIdExpr_AST*>(N)) ||
+	     (dynamic_cast<PostIncrArrayIdExpr_AST*>(N)) )
+	    return 0;
+	for ( size_t k = 0; k < elem->Dims()->size(); k++ )
+	    if ( !(isPure((*elem->Dims())[k])) )
+		return 0;
+	return 1;
+    }
+    if ( (dynamic_cast<ArithmExpr_AST*>(N)) ||
+	 (dynamic_cast<UnaryArithmExpr_AST*>(N)) ||
+	 (dynamic_cast<CoercedExpr_AST*>(N)) || (dynamic_cast<RelExpr_AST*>(N)) )
+	return ( isPure(N->LChild()) && isPure(N->RChild()) );
+    return 0;
+}
+
+// value of an int literal (0: not one)
+int
+intLiteral(Node_AST* N, long& Value)
+{
+    IntExpr_AST* lit = dynamic_cast<IntExpr_AST*>(N);
+    if ( (0 == lit) )
+	return 0;
+    Value = atol(lit->Addr().c_str());
+    return 1;
+}
+
+// c of an iteration expression V++, V--, V += c, V -= c, V = V + c,
+// V = c + V, V = V - c (0: not one)
+static long
+stepOf(Expr_AST* E, IdExpr_AST* V)
+{
+    PreIncrIdExpr_AST* pre = dynamic_cast<PreIncrIdExpr_AST*>(E);
+    if ( (0 != pre) )
+	return ( (V == pre->Name()) )?pre->IncValue():0;
+    PostIncrIdExpr_AST* post = dynamic_cast<PostIncrIdExpr_AST*>(E);
+    if ( (0 != post) )
+	return ( (V == post->Name()) )?post->IncValue():0;
+    AssignExpr_AST* assign = dynamic_cast<AssignExpr_AST*>(E);
+    if ( (0 == assign) || (V != assign->LChild()) )
+	return 0;
+
+    long c;
+    ModAssignExpr_AST* mod = dynamic_cast<ModAssignExpr_AST*>(E);
+    if ( (0 != mod) ){
+	if ( !(intLiteral(mod->RChild(), c)) )
+	    return 0;
+	if ( (tok_assign_plus == mod->ModType().Tok()) )
+	    return c;
+	if ( (tok_assign_minus == mod->ModType().Tok()) )
+	    return -c;
+	return 0;
+    }
+    ArithmExpr_AST* rhs = dynamic_cast<ArithmExpr_AST*>(assign->RChild());
+    if ( (0 == rhs) )
+	return 0;
+    tokenType op = rhs->Op().Tok();
+    if ( (V == rhs->LChild()) && (intLiteral(rhs->RChild(), c)) ){
+	if ( (tok_plus == op) )
+	    return c;
+	if ( (tok_minus == op) )
+	    return -c;
+    }
+    if ( (tok_plus == op) && (V == rhs->RChild()) &&
+	 (intLiteral(rhs->LChild(), c)) )
+	return c;
+    return 0;
+}
+
+// L: For as a loop of the shape above (0: it isn't one)
+int
+headerOf(For_AST* F, Nest_Loop& L)
+{
+    if ( (0 == F) || (dynamic_cast<While_AST*>(F)) )
+	return 0;
+    IterExprList_AST* list = dynamic_cast<IterExprList_AST*>(F->LChild());
+    if ( (0 == list) || (0 == list->Init()) || (0 == list->Cond()) ||
+	 (0 == list->Iter()) )
+	return 0;
+    AssignExpr_AST* init = dynamic_cast<AssignExpr_AST*>(list->Init());
+    if ( (0 == init) || (dynamic_cast<ModAssignExpr_AST*>(init)) )
+	return 0;
+    IdExpr_AST* var = scalarOf(init->LChild());
+    if ( (0 == var) || (tok_int != var->Type().Tok()) ||
+	 !(isPure(init->RChild())) || (mentions(init->RChild(), var)) )
+	return 0;
+    RelExpr_AST* cond = dynamic_cast<RelExpr_AST*>(list->Cond());
+    if ( (0 == cond) || (var != cond->LChild()) ||
+	 !(isPure(cond->RChild())) || (mentions(cond->RChild(), var)) )
+	return 0;
+    long step = stepOf(list->Iter(), var);
+    if ( (0 == step) )
+	return 0;
+    L = Nest_Loop(F, var, step);
+    return 1;
+}
+
+static int
+isWrapper(Node_AST* N)
+{
+    return ( (typeid(*N) == typeid(Block_AST)) ||
+	     (typeid(*N) == typeid(StmtList_AST)) ||
+	     (typeid(*N) == typeid(Stmt_AST)) );
+}
+
+// statements of a block (end of block markers and empty ones left out)
+void
+collectStmts(Node_AST* N, std::vector<Node_AST*>& Stmts)
+{
+    if ( (0 == N) || (dynamic_cast<EOB_AST*>(N)) ||
+	 (dynamic_cast<NOP_AST*>(N)) )
+	return;
+    if ( !(isWrapper(N)) ){
+	Stmts.push_back(N);
+	return;
+    }
+    collectStmts(N->LChild(), Stmts);
+    collectStmts(N->RChild(), Stmts);
+}
+
+int
+hasLoop(Node_AST* N)
+{
+    if ( (0 == N) || (dynamic_cast<Expr_AST*>(N)) )
+	return 0;
+    if ( (dynamic_cast<For_AST*>(N)) )
+	return 1;
+    return ( hasLoop(N->LChild()) || hasLoop(N->RChild()) );
+}
+
+static int
+contains(Node_AST* N, Node_AST* Part)
+{
+    if ( (0 == N) || (dynamic_cast<Expr_AST*>(N)) )
+	return 0;
+    if ( (N == Part) )
+	return 1;
+    return ( contains(N->LChild(), Part) || contains(N->RChild(), Part) );
+}
+
+// structurally the same expression (reads of the same variables)
+static int
+sameExpr(Node_AST* A, Node_AST* B)
+{
+    if ( (A == B) )
+	return 1;
+    if ( (0 == A) || (0 == B) )
+	return 0;
+    long a, b;
+    if ( (intLiteral(A, a)) && (intLiteral(B, b)) )
+	return (a == b);
+    ArrayIdExpr_AST* elemA = dynamic_cast<ArrayIdExpr_AST*>(A);
+    ArrayIdExpr_AST* elemB = dynamic_cast<ArrayIdExpr_AST*>(B);
+    if ( (0 != elemA) || (0 != elemB) ){
+	if ( (0 == elemA) || (0 == elemB) || (elemA->Base() != elemB->Base()) )
+	    return 0;
+	for ( size_t k = 0; k < elemA->Dims()->size(); k++ )
+	    if ( !(sameExpr((*elemA->Dims())[k], (*elemB->Dims())[k])) )
+		return 0;
+	return 1;
+    }
+    if ( (dynamic_cast<ArithmExpr_AST*>(A)) && (dynamic_cast<ArithmExpr_AST*>(B)) )
+	return ( (dynamic_cast<Expr_AST*>(A)->Op().Tok() ==
+		  dynamic_cast<Expr_AST*>(B)->Op().Tok()) &&
+		 (sameExpr(A->LChild(), B->LChild())) &&
+		 (sameExpr(A->RChild(), B->RChild())) );
+    if ( (dynamic_cast<UnaryArithmExpr_AST*>(A)) &&
+	 (dynamic_cast<UnaryArithmExpr_AST*>(B)) )
+	return ( (dynamic_cast<Expr_AST*>(A)->Op().Tok() ==
+		  dynamic_cast<Expr_AST*>(B)->Op().Tok()) &&
+		 (sameExpr(A->LChild(), B->LChild())) );
+    return 0;
+}
+
+// C: coefficient of V in E, if E is affine in V (0: it isn't)
+int
+coefOf(Node_AST* E, IdExpr_AST* V, long& C)
+{
+    C = 0;
+    if ( (E == V) ){
+	C = 1;
+	return 1;
+    }
+    if ( !(mentions(E, V)) )
+	return 1;
+    long l, r;
+    tokenType op = tok_eof;
+    if ( (dynamic_cast<ArithmExpr_AST*>(E)) ||
+	 (dynamic_cast<UnaryArithmExpr_AST*>(E)) )
+	op = dynamic_cast<Expr_AST*>(E)->Op().Tok();
+    if ( (dynamic_cast<UnaryArithmExpr_AST*>(E)) ){
+	if ( (tok_minus != op) || !(coefOf(E->LChild(), V, l)) )
+	    return 0;
+	C = -l;
+	return 1;
+    }
+    if ( (tok_plus != op) && (tok_minus != op) && (tok_mult != op) )
+	return 0;
+    if ( (tok_mult == op) ){
+	long k;
+	if ( (intLiteral(E->LChild(), k)) && (coefOf(E->RChild(), V, r)) )
+	    C = k * r;
+	else if ( (intLiteral(E->RChild(), k)) && (coefOf(E->LChild(), V, l)) )
+	    C = k * l;
+	else
+	    return 0;
+	return 1;
+    }
+    if ( !(coefOf(E->LChild(), V, l)) || !(coefOf(E->RChild(), V, r)) )
+	return 0;
+    C = (tok_plus == op)?(l + r):(l - r);
+    return 1;
+}
+
+// array element references in N, in order (those in subscripts first)
+void
+collectElems(Node_AST* N, std::vector<ArrayIdExpr_AST*>& Elems)
+{
+    if ( (0 == N) )
+	return;
+    ArrayIdExpr_AST* elem = dynamic_cast<ArrayIdExpr_AST*>(N);
+    if ( (0 != elem) ){
+	for ( size_t k = 0; k < elem->Dims()->size(); k++ )
+	    collectElems((*elem->Dims())[k], Elems);
+	Elems.push_back(elem);
+	return;
+    }
+    if ( (0 != scalarOf(N)) )
+	return;
+    collectElems(N->LChild(), Elems);
+    collectElems(N->RChild(), Elems);
+}
+
+// elements between the accesses of E in two iterations of L in a row;
+// Cost: that up to INTERCHANGE_LINE (all of it if not a constant)
+std::string
+strideOf(ArrayIdExpr_AST* E, Nest_Loop const& L, long& Cost)
+{
+    std::vector<Expr_AST*>& dims = *(E->Dims());
+    std::vector<long> coef(dims.size());
+    int outer = -1; // outermost dimension L moves
+    for ( size_t k = 0; k < dims.size(); k++ ){
+	if ( !(coefOf(dims[k], L.Var(), coef[k])) ){
+	    Cost = INTERCHANGE_LINE;
+	    return "?";
+	}
+	if ( (0 != coef[k]) && (-1 == outer) )
+	    outer = k;
+    }
+
+    if ( (-1 == outer) ){
+	Cost = 0;
+	return "0";
+    }
+
+    std::ostringstream tmp_Stream;
+    ArrayVarDecl_AST* base = E->Base();
+    long stride = 0;
+    if ( (base->allInts()) ){
+	long size = 1;
+	for ( int k = dims.size() - 1; k >= 0; k-- ){
+	    stride += coef[k] * L.Step() * size;
+	    if ( (0 < k) )
+		size *= atol((*base->DimsFinal())[k].c_str());
+	}
+	Cost = (0 > stride)?-stride:stride;
+	if ( (INTERCHANGE_LINE < Cost) )
+	    Cost = INTERCHANGE_LINE;
+	tmp_Stream << stride;
+	return tmp_Stream.str();
+    }
+
+    // dimensions set at run-time: the sizes by name, if the one moved
+    Cost = INTERCHANGE_LINE;
+    if ( (static_cast<size_t>(outer) + 1 == dims.size()) ){
+	stride = coef[outer] * L.Step();
+	Cost = (0 > stride)?-stride:stride;
+	if ( (INTERCHANGE_LINE < Cost) )
+	    Cost = INTERCHANGE_LINE;
+	tmp_Stream << stride;
+	return tmp_Stream.str();
+    }
+    for ( size_t k = outer + 1; k < dims.size(); k++ )
+	if ( (0 != coef[k]) )
+	    return "?";
+    stride = coef[outer] * L.Step();
+    if ( (1 != stride) )
+	tmp_Stream << stride << "*";
+    for ( size_t k = outer + 1; k < dims.size(); k++ ){
+	Expr_AST* size = (*base->Dims())[k];
+	if ( (k > static_cast<size_t>(outer) + 1) )
+	    tmp_Stream << "*";
+	if ( (0 != scalarOf(size)) )
+	    tmp_Stream << size->Op().Lex();
+	else if ( (dynamic_cast<IntExpr_AST*>(size)) )
+	    tmp_Stream << size->Addr();
+	else
+	    tmp_Stream << "?";
+    }
+    return tmp_Stream.str();
+}
+
+// Var of a for loop setting it first (init V = e, e not reading V)?
+static int
+setsFirst(For_AST* F, IdExpr_AST* V)
+{
+    IterExprList_AST* list = dynamic_cast<IterExprList_AST*>(F->LChild());
+    if ( (0 == list) )
+	return 0;
+    AssignExpr_AST* init = dynamic_cast<AssignExpr_AST*>(list->Init());
+    return ( (0 != init) && !(dynamic_cast<ModAssignExpr_AST*>(init)) &&
+	     (V == init->LChild()) && !(mentions(init->RChild(), V)) );
+}
+
+// could N, outside of Nest, read the value Nest leaves in V?
+static int
+readOutside(Node_AST* N, Node_AST* Nest, IdExpr_AST* V)
+{
+    if ( (0 == N) || (N == Nest) )
+	return 0;
+    For_AST* loop = dynamic_cast<For_AST*>(N);
+    if ( (0 != loop) && (setsFirst(loop, V)) && !(contains(loop, Nest)) )
+	return 0;
+    Assign_AST* assign = dynamic_cast<Assign_AST*>(N);
+    if ( (0 != assign) && !(dynamic_cast<ModAssign_AST*>(N)) &&
+	 (V == assign->LChild()) )
+	return mentions(assign->RChild(), V);
+    if ( (dynamic_cast<Expr_AST*>(N)) || (dynamic_cast<Decl_AST*>(N)) ||
+	 (dynamic_cast<IterExprList_AST*>(N)) )
+	return mentions(N, V);
+    return ( readOutside(N->LChild(), Nest, V) ||
+	     readOutside(N->RChild(), Nest, V) );
+}
+
+// s of s = s + e, s = s - e, s += e, s -= e (int s); E: e (0: not one)
+static IdExpr_AST*
+sumOf(Assign_AST* A, Node_AST*& E)
+{
+    IdExpr_AST* s = scalarOf(A->LChild());
+    if ( (0 == s) || (tok_int != s->Type().Tok()) )
+	return 0;
+    ModAssign_AST* mod = dynamic_cast<ModAssign_AST*>(A);
+    if ( (0 != mod) ){
+	E = mod->RChild();
+	tokenType t = mod->ModType().Tok();
+	return ( (tok_assign_plus == t) || (tok_assign_minus == t) )?s:0;
+    }
+    ArithmExpr_AST* rhs = dynamic_cast<ArithmExpr_AST*>(A->RChild());
+    if ( (0 == rhs) || (tok_int != rhs->Type().Tok()) || (s != rhs->LChild()) ||
+	 ( (tok_plus != rhs->Op().Tok()) && (tok_minus != rhs->Op().Tok()) ) )
+	return 0;
+    E = rhs->RChild();
+    return s;
+}
+
+// why the loops of a nest (outermost first) can't run in another order
+// ("": they can); the iterations meeting at an element of an array the
+// body writes agree in all loop variables but one
+std::string
+whyNotPermuted(std::vector<Nest_Loop> const& Loops, Node_AST* Root,
+	       std::vector<Node_AST*> const& Body)
+{
+    std::set<IdExpr_AST*> ivs;
+    for ( size_t l = 0; l < Loops.size(); l++ )
+	ivs.insert(Loops[l].Var());
+
+    // what the body writes, and reads
+    std::set<IdExpr_AST*> sums;
+    std::set<ArrayVarDecl_AST*> written;
+    std::set<IdExpr_AST*> vars;
+    std::set<ArrayVarDecl_AST*> arrays;
+    for ( size_t k = 0; k < Body.size(); k++ ){
+	Assign_AST* assign = dynamic_cast<Assign_AST*>(Body[k]);
+	ArrayIdExpr_AST* elem = dynamic_cast<ArrayIdExpr_AST*>(assign->LChild());
+	if ( (0 != elem) ){
+	    written.insert(elem->Base());
+	    collectRefs(assign->LChild(), vars, arrays);
+	    collectRefs(assign->RChild(), vars, arrays);
+	    continue;
+	}
+	Node_AST* term = 0;
+	IdExpr_AST* s = sumOf(assign, term);
+	if ( (ivs.count(scalarOf(assign->LChild()))) )
+	    return "loop variable set in the body";
+	if ( (0 == s) )
+	    return scalarOf(assign->LChild())->Op().Lex() + " set in the body";
+	sums.insert(s);
+	collectRefs(term, vars, arrays);
+    }
+    std::set<IdExpr_AST*>::const_iterator iter;
+    for ( iter = sums.begin(); iter != sums.end(); iter++ )
+	if ( (vars.count(*iter)) )
+	    return (*iter)->Op().Lex() + " summed and read in the body";
+
+    // rectangular, and not changed by the body
+    for ( size_t l = 0; l < Loops.size(); l++ ){
+	IterExprList_AST* list = Loops[l].List();
+	std::set<IdExpr_AST*> bound_Vars;
+	std::set<ArrayVarDecl_AST*> bound_Arrays;
+	collectRefs(dynamic_cast<AssignExpr_AST*>(list->Init())->RChild(),
+		    bound_Vars, bound_Arrays);
+	collectRefs(list->Cond()->RChild(), bound_Vars, bound_Arrays);
+	for ( size_t m = 0; m < Loops.size(); m++ )
+	    if ( (m != l) && (bound_Vars.count(Loops[m].Var())) )
+		return "bounds not rectangular";
+	for ( iter = sums.begin(); iter != sums.end(); iter++ )
+	    if ( (bound_Vars.count(*iter)) )
+		return "bounds set in the body";
+	std::set<ArrayVarDecl_AST*>::const_iterator a_Iter;
+	for ( a_Iter = written.begin(); a_Iter != written.end(); a_Iter++ )
+	    if ( (bound_Arrays.count(*a_Iter)) )
+		return "bounds set in the body";
+    }
+
+    // an array written: one subscript list, which tells the iterations apart
+    std::vector<ArrayIdExpr_AST*> elems;
+    for ( size_t k = 0; k < Body.size(); k++ ){
+	collectElems(Body[k]->LChild(), elems);
+	collectElems(Body[k]->RChild(), elems);
+    }
+    for ( size_t k = 0; k < elems.size(); k++ ){
+	std::vector<Expr_AST*>& dims = *(elems[k]->Dims());
+	for ( size_t d = 0; d < dims.size(); d++ ){
+	    std::set<IdExpr_AST*> sub_Vars;
+	    std::set<ArrayVarDecl_AST*> sub_Arrays;
+	    collectRefs(dims[d], sub_Vars, sub_Arrays);
+	    std::set<ArrayVarDecl_AST*>::const_iterator a_Iter;
+	    for ( a_Iter = written.begin(); a_Iter != written.end(); a_Iter++ )
+		if ( (sub_Arrays.count(*a_Iter)) )
+		    return (*a_Iter)->Name() + " written and read in a subscript";
+	}
+	if ( !(written.count(elems[k]->Base())) )
+	    continue;
+	for ( size_t m = 0; m < k; m++ )
+	    if ( (elems[m]->Base() == elems[k]->Base()) &&
+		 !(sameExpr(elems[m], elems[k])) )
+		return elems[k]->Base()->Name() + " accessed at two subscripts";
+	// a variable is pinned by a subscript affine in it alone
+	int free = 0;
+	for ( size_t l = 0; l < Loops.size(); l++ ){
+	    int pinned = 0;
+	    for ( size_t d = 0; d < dims.size(); d++ ){
+		int alone = 1;
+		for ( size_t m = 0; m < Loops.size(); m++ ){
+		    long c;
+		    if ( !(coefOf(dims[d], Loops[m].Var(), c)) ||
+			 ( (m == l) != (0 != c) ) )
+			alone = 0;
+		}
+		pinned = ( (pinned) || (alone) );
+	    }
+	    free += !(pinned);
+	}
+	if ( (1 < free) )
+	    return elems[k]->Base()->Name() + " written by several iterations";
+    }
+
+    for ( size_t l = 0; l < Loops.size(); l++ )
+	if ( (readOutside(Root, Loops[0].For(), Loops[l].Var())) )
+	    return Loops[l].Name() + " read after the loops";
+    return "";
+}
+
+// tries to interchange the loops of a nest headed by F (1: done)
+static int
+interchangeNest(For_AST* F, Node_AST* Root)
+{
+    std::vector<Node_AST*> stmts;
+    collectStmts(F->RChild(), stmts);
+    if ( (1 != stmts.size()) || !(dynamic_cast<For_AST*>(stmts[0])) )
+	return 0;
+    For_AST* inner = dynamic_cast<For_AST*>(stmts[0]);
+    if ( (hasLoop(inner->RChild())) )
+	return 0; // the pair below
+
+    Nest_Loop loops[2];
+    Nest_Loop& out = loops[0];
+    Nest_Loop& in = loops[1];
+    std::ostringstream tmp_Stream;
+    std::string why;
+    std::vector<Node_AST*> body;
+    std::vector<ArrayIdExpr_AST*> elems;
+    IterExprList_AST* list = dynamic_cast<IterExprList_AST*>(F->LChild());
+    int line = ( (0 != list) && (0 != list->Init()) )?list->Init()->Line():
+	F->Line();
+    if ( !(headerOf(F, out)) || !(headerOf(inner, in)) ||
+	 (out.Var() == in.Var()) )
+	why = "loops not of the form i = e; i < e; i++";
+    else{
+	tmp_Stream << " (" << out.Name() << ", " << in.Name() << ")";
+	collectStmts(inner->RChild(), body);
+	for ( size_t k = 0; k < body.size(); k++ ){
+	    Assign_AST* assign = dynamic_cast<Assign_AST*>(body[k]);
+	    if ( (0 == assign) || (0 == assign->RChild()) ||
+		 !(isPure(assign->LChild())) || !(isPure(assign->RChild())) )
+		why = "body not only assignments";
+	}
+    }
+
+    long cost_In = 0;
+    long cost_Out = 0;
+    if ( ("" == why) ){
+	for ( size_t k = 0; k < body.size(); k++ ){
+	    collectElems(body[k]->LChild(), elems);
+	    collectElems(body[k]->RChild(), elems);
+	}
+	std::ostringstream in_Stream;
+	std::ostringstream out_Stream;
+	for ( size_t k = 0; k < elems.size(); k++ ){
+	    long cost;
+	    std::string sep = (0 == k)?" ":", ";
+	    in_Stream << sep << elems[k]->Base()->Name() << " ";
+	    in_Stream << strideOf(elems[k], in, cost);
+	    cost_In += cost;
+	    out_Stream << sep << elems[k]->Base()->Name() << " ";
+	    out_Stream << strideOf(elems[k], out, cost);
+	    cost_Out += cost;
+	}
+	tmp_Stream << ": strides in " << in.Name() << ":" << in_Stream.str();
+	tmp_Stream << "; in " << out.Name() << ":" << out_Stream.str();
+	if ( (cost_Out < cost_In) )
+	    why = whyNotPermuted(std::vector<Nest_Loop>(loops, loops + 2), Root,
+				 body);
+    }
+
+    int done = ( ("" == why) && (cost_Out < cost_In) );
+    if ( (done) )
+	F->swapExprList(inner);
+    if (option_Stats){
+	std::cerr << "interchange: loops at line " << line;
+	std::cerr << tmp_Stream.str() << "; ";
+	if ( (done) )
+	    std::cerr << "interchanged\n";
+	else if ( ("" == why) )
+	    std::cerr << "kept\n";
+	else
+	    std::cerr << "kept (" << why << ")\n";
+    }
+    return done;
+}
+
+static int
+interchangeIn(Node_AST* N, Node_AST* Root)
+{
+    if ( (0 == N) || (dynamic_cast<Expr_AST*>(N)) )
+	return 0;
+    int n = 0;
+    For_AST* loop = dynamic_cast<For_AST*>(N);
+    if ( (0 != loop) && !(dynamic_cast<While_AST*>(loop)) )
+	n += interchangeNest(loop, Root);
+    return n + interchangeIn(N->LChild(), Root) +
+	interchangeIn(N->RChild(), Root);
+}
+
+int
+interchangeLoops(Node_AST* Root)
+{
+    return interchangeIn(Root, Root);
+}
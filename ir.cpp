@@ -4,86 +4,402 @@
 ********************************************************************/
 
 #include <fstream>
+#include <cstdlib>
 #include "ir.h"
+#include "tables.h"
 
 ir_Rep iR_List;
-ir_Rep iR_List_2; // nop's removed
 ir_Rep iR_RtError_Targets;
 
-// run-time error management 
+// run-time error management
 std::vector<RtError_Type*> rtError_Table;
 std::vector<Ds_Object*> Ds_Table;
 
-std::vector<std::string>
-appendLabels(std::vector<std::string> Old, const std::vector<std::string>& Add)
+// name tables (operand handles index into these)
+std::vector<IR_Var> ir_Vars;
+std::vector<IR_Const> ir_Consts;
+std::vector<std::string> ir_Labels;
+std::vector<IR_Frame> ir_Frames;
+std::vector<std::string> ir_Syms;
+std::vector<std::string> ir_Regs;
+std::vector<Label_Link> ir_LabelLinks;
+std::vector<Phi_Info> ir_Phis;
+int ir_TmpCount = 0; // highest tmp number in use
+int ir_SrcLine = -1;
+
+// lookup side of the interned tables
+std::map<std::string, int> var_Ids;
+std::map<std::string, int> const_Ids;
+std::map<std::string, int> label_Ids;
+std::map<std::string, int> frame_Ids;
+std::map<std::string, int> sym_Ids;
+std::map<std::string, int> reg_Ids;
+
+const char* ir_OpName[op_Count] = {
+    "nop", "=",
+    "+", "-", "*", "/", "%", "-", "!", "*",
+    "<", "<=", ">", ">=", "==", "!=",
+    "cast", "dec", "lea",
+    "iffalse", "iftrue", "goto",
+    "call", "syscall", "movl", "pushl",
+    "v=", "v+", "v-", "v*",
+    "phi"
+};
+
+IR_Const::IR_Const(std::string Lex)
+    : lex_(Lex), is_Flt_(0), i_Val_(0), f_Val_(0)
 {
-    std::vector<std::string> ret;
- 
-    ret = Old;
+    if ( (std::string::npos != Lex.find_first_of(".eE")) &&
+	 (std::string::npos == Lex.find_first_of("xX")) ){
+	is_Flt_ = 1;
+	f_Val_ = strtod(Lex.c_str(), 0);
+	i_Val_ = static_cast<long>(f_Val_);
+    }
+    else{
+	i_Val_ = strtol(Lex.c_str(), 0, 0); // octal/hex as in the lexer
+	f_Val_ = static_cast<double>(i_Val_);
+    }
+}
+
+int
+Phi_Info::findPred(int Label) const
+{
+    for ( size_t i = 0; i < preds_.size(); i++ )
+	if ( (preds_[i] == Label) )
+	    return i;
+    return -1;
+}
+
+void
+Phi_Info::removeArg(int I)
+{
+    args_.erase(args_.begin() + I);
+    preds_.erase(preds_.begin() + I);
+}
+
+int
+internName(std::string Name, std::map<std::string, int>& Ids,
+	   std::vector<std::string>& Table)
+{
+    std::map<std::string, int>::const_iterator iter = Ids.find(Name);
+    if ( (Ids.end() != iter) )
+	return iter->second;
+    Table.push_back(Name);
+    return ( (Ids[Name] = Table.size() - 1) );
+}
+
+// a variable is identified by its name and declaring frame (shadowing)
+int
+internVar(std::string Name, int Frame)
+{
+    std::ostringstream key;
+    key << Name << "@" << Frame;
+    std::map<std::string, int>::const_iterator iter = var_Ids.find(key.str());
+    if ( (var_Ids.end() != iter) )
+	return iter->second;
+    ir_Vars.push_back(IR_Var(Name, Frame));
+    return ( (var_Ids[key.str()] = ir_Vars.size() - 1) );
+}
+
+int
+internConst(std::string Lex)
+{
+    std::map<std::string, int>::const_iterator iter = const_Ids.find(Lex);
+    if ( (const_Ids.end() != iter) )
+	return iter->second;
+    ir_Consts.push_back(IR_Const(Lex));
+    return ( (const_Ids[Lex] = ir_Consts.size() - 1) );
+}
+
+int
+internLabel(std::string Name) { return internName(Name,label_Ids,ir_Labels); }
+
+int
+internSym(std::string Name) { return internName(Name, sym_Ids, ir_Syms); }
+
+int
+internReg(std::string Name) { return internName(Name, reg_Ids, ir_Regs); }
+
+// frames without a name (error section) are -1
+int
+internFrame(std::string Name)
+{
+    if ( ("" == Name) )
+	return -1;
+    std::map<std::string, int>::const_iterator iter = frame_Ids.find(Name);
+    if ( (frame_Ids.end() != iter) )
+	return iter->second;
+    ir_Frames.push_back(IR_Frame(Name, findEnvByName(root_Env, Name)));
+    return ( (frame_Ids[Name] = ir_Frames.size() - 1) );
+}
+
+// new tmp for use by passes (numbered after those of the visitor)
+Operand
+makeTmpOperand(void)
+{
+    return Operand(opd_Tmp, ++ir_TmpCount);
+}
+
+Operand
+makeImmOperand(std::string Lex)
+{
+    return Operand(opd_Imm, internConst(Lex));
+}
+
+// new label for use by passes
+int
+makeLabelId(void)
+{
+    static int count = 0;
+
+    std::ostringstream tmp_Stream;
+    tmp_Stream << "L_o" << ++count;
+    return internLabel(tmp_Stream.str());
+}
+
+// a variable as named in Scope (the frame declaring it: shadowing)
+Operand
+makeVarOperand(std::string Name, Env* Scope)
+{
+    Env* pDecl = ( (0 != Scope) )?findVarFrame(Scope, Name):0;
+    if ( (0 == pDecl) )
+	errExit(0, "no declaration of %s in IR", Name.c_str());
+    int decl_Frame = internFrame(pDecl->getTableName());
+    return Operand(opd_Var, internVar(Name, decl_Frame));
+}
+
+// (-off)base: Offset an opd_Imm (bytes) or an opd_Tmp
+Operand
+makeElemOperand(Operand Base, Operand Offset)
+{
+    return Operand(opd_Elem, Base.Id(), Offset.Kind(), Offset.Id());
+}
+
+std::string
+operandStr(Operand const& O)
+{
+    std::ostringstream tmp_Stream;
+    Operand off;
+
+    switch(O.Kind()){
+    case opd_None: break;
+    case opd_Tmp: tmp_Stream << "t" << O.Id(); break;
+    case opd_Var: tmp_Stream << ir_Vars[O.Id()].Name(); break;
+    case opd_Imm: tmp_Stream << ir_Consts[O.Id()].Lex(); break;
+    case opd_Label: tmp_Stream << ir_Labels[O.Id()]; break;
+    case opd_Reg: tmp_Stream << ir_Regs[O.Id()]; break;
+    case opd_Sym: tmp_Stream << ir_Syms[O.Id()]; break;
+    case opd_Type: tmp_Stream << token(static_cast<tokenType>(O.Id())).Lex();
+	break;
+    case opd_Phi: // t3 (L_o1), a (L2)
+	for ( int i = 0; i < ir_Phis[O.Id()].Size(); i++ ){
+	    if ( (0 != i) ) tmp_Stream << ", ";
+	    tmp_Stream << operandStr(ir_Phis[O.Id()].Arg(i)) << " (";
+	    tmp_Stream << ir_Labels[ir_Phis[O.Id()].Pred(i)] << ")";
+	}
+	break;
+    case opd_Elem:
+	off = O.Offset();
+	tmp_Stream << "(-" << ( (off.isImm())?"$":"" ) << operandStr(off);
+	tmp_Stream << ")" << ir_Vars[O.Id()].Name();
+	break;
+    default:
+	errExit(0, "invalid IR operand kind (%d)", O.Kind());
+    }
+
+    return tmp_Stream.str();
+}
+
+ir_Op
+opFromToken(token const& Op, int Unary)
+{
+    switch(Op.Tok()){
+    case tok_nop: return op_nop;
+    case tok_eq: return op_copy;
+    case tok_plus: case tok_assign_plus: return op_add;
+    case tok_minus: case tok_assign_minus: return (Unary)?op_neg:op_sub;
+    case tok_mult: case tok_assign_mult: return (Unary)?op_scale:op_mult;
+    case tok_div: case tok_assign_div: return op_div;
+    case tok_mod: return op_mod;
+    case tok_log_not: return op_not;
+    case tok_lt: return op_lt;
+    case tok_le: return op_le;
+    case tok_gt: return op_gt;
+    case tok_ge: return op_ge;
+    case tok_log_eq: return op_eq;
+    case tok_log_ne: return op_ne;
+    case tok_cast: return op_cast;
+    case tok_dec: return op_dec;
+    case tok_lea: return op_lea;
+    case tok_iffalse: return op_iffalse;
+    case tok_iftrue: return op_iftrue;
+    case tok_goto: return op_goto;
+    case tok_call: return op_call;
+    case tok_syscall: return op_syscall;
+    case tok_movl: return op_movl;
+    case tok_pushl: return op_pushl;
+    default:
+	errExit(0, "invalid IR operation (%s)", Op.Lex().c_str());
+    }
+    return op_nop;
+}
+
+// basic type names, as in dec: and cast: lines
+tokenType
+typeFromLex(std::string const& Lex)
+{
+    tokenType types[] = { tok_int, tok_double, tok_bool, tok_string };
+    for ( int i = 0; i < 4; i++ )
+	if ( (token(types[i]).Lex() == Lex) )
+	    return types[i];
+    errExit(0, "invalid type in IR (%s)", Lex.c_str());
+    return tok_err;
+}
+
+SSA_Entry::SSA_Entry(std::vector<std::string> Labels, token Op,
+		     Operand Target, Operand LHS, Operand RHS,
+		     std::string Frame)
+    : labels_(-1), src_Line_(ir_SrcLine), lanes_(1), target_(Target),
+      lHS_(LHS), rHS_(RHS)
+{
+    op_ = opFromToken(Op, RHS.isNone());
+    frame_ = internFrame(Frame);
+
+    std::vector<int> label_Ids;
     std::vector<std::string>::const_iterator iter;
-    for ( iter = Add.begin(); iter != Add.end(); iter++)
-        ret.push_back(*iter);
+    for ( iter = Labels.begin(); iter != Labels.end(); iter++ )
+	label_Ids.push_back(internLabel(*iter));
+    replaceLabels(label_Ids);
+}
 
+std::vector<int>
+SSA_Entry::Labels() const
+{
+    std::vector<int> ret;
+    for ( int l = labels_; -1 != l; l = ir_LabelLinks[l].Next() )
+	ret.push_back(ir_LabelLinks[l].Label());
     return ret;
 }
 
-ir_Rep
-removeNOPs(ir_Rep const& Old)
+void
+SSA_Entry::replaceLabels(std::vector<int> const& Labels)
 {
-    ir_Rep ir_New;
-    ir_Rep::const_iterator iter;
-    SSA_Entry* line;
-    std::vector<std::string> labels;
-    int Reset = 1;
-
-    for ( iter = Old.begin(); iter != Old.end(); iter++){
-	int is_Nop = ("nop" == (iter->second)->Op().Lex());
-	int no_Lab = (iter->second)->Labels().empty();
-
-	if ( !(is_Nop) ){
-	    line = new SSA_Entry( *(iter->second) );
-	    if ( !(labels.empty()) ){
-		labels = appendLabels(line->Labels(), labels);  
-		line->replaceLabels(labels);
-	    }
-	    labels.clear();
-	    insertLine(line, ir_New, Reset);
-	    Reset = 0;
-	}
-	else if ( is_Nop && !(no_Lab) ){
-	    labels = appendLabels(labels, (iter->second)->Labels());  
-	}
+    labels_ = -1;
+    std::vector<int>::const_reverse_iterator iter;
+    for ( iter = Labels.rbegin(); iter != Labels.rend(); iter++ ){
+	ir_LabelLinks.push_back(Label_Link(*iter, labels_));
+	labels_ = ir_LabelLinks.size() - 1;
     }
+}
+
+void
+SSA_Entry::addLabel(int Label)
+{
+    std::vector<int> labels = Labels();
+    labels.push_back(Label);
+    replaceLabels(labels);
+}
 
-    // print last if it was NOP
-    iter--; 
-    int is_Nop = ("nop" == (iter->second)->Op().Lex());
-    if (is_Nop){
-	line = new SSA_Entry( *(iter->second) );
-	insertLine(line, ir_New, Reset);
-	Reset = 0; // not really necessary as this case couldn't happen
+// Make ir_LabelLinks hold the chains of the lines of List only (links of
+// lines changed or removed since are gone)
+void
+compactLabelLinks(ir_Rep& List)
+{
+    std::vector<Label_Link> links;
+    for ( size_t i = 0; i < List.size(); i++ ){
+	std::vector<int> labels = List[i].Labels();
+	int head = -1;
+	for ( size_t k = labels.size(); k > 0; k-- ){
+	    links.push_back(Label_Link(labels[k - 1], head));
+	    head = links.size() - 1;
+	}
+	List[i].setLabelChain(head);
     }
+    ir_LabelLinks.swap(links);
+}
 
-    return ir_New;
+int
+isVectorOp(ir_Op Op)
+{
+    return ( (op_vcopy <= Op) && (op_vmult >= Op) );
+}
+
+void
+SSA_Entry::print() const
+{
+    std::cout << str();
 }
 
-void 
-insertLine(SSA_Entry* Line, ir_Rep& List, int Reset)
+std::string
+SSA_Entry::str() const
 {
-    static int current = 0;
-    if (Reset) current = 0;
+    std::ostringstream tmp_Stream;
+    std::string tmp_String;
+    for ( int l = labels_; -1 != l; l = ir_LabelLinks[l].Next() ){
+	tmp_String += ir_Labels[ir_LabelLinks[l].Label()];
+	tmp_String += ": ";
+    }
+    tmp_Stream.width(LABELS);
+    tmp_Stream << tmp_String;
+
+    std::string target = operandStr(target_);
+    std::string LHS = operandStr(lHS_);
+    std::string RHS = operandStr(rHS_);
+    if ( (op_pushl == op_) ) // AT&T immediate
+	target = "$" + target;
+    else if ( (op_iffalse == op_) || (op_iftrue == op_) )
+	LHS = "goto";
+
+    std::string name = ir_OpName[op_];
+    if ( isVectorOp(Op()) ){
+	std::ostringstream lanes_Stream;
+	lanes_Stream << "<" << lanes_ << ">";
+	name += lanes_Stream.str();
+    }
+    tmp_Stream.width(SSA);
+    tmp_Stream << name;
+    tmp_Stream << ":";
+    tmp_Stream.width(SSA);
+    tmp_Stream << target;
+    if ( ("" != LHS) )
+	tmp_Stream << ",";
+    else
+	tmp_Stream << " ";
+    tmp_Stream.width(SSA);
+    tmp_Stream << LHS;
+    if ( ("" != RHS) )
+	tmp_Stream << ",";
+    else
+	tmp_Stream << " ";
+    tmp_Stream.width(SSA);
+    tmp_Stream << RHS;
+
+    tmp_String = "(";
+    tmp_String += ( (-1 != frame_) )?ir_Frames[frame_].Name():"";
+    tmp_String += ")";
+    tmp_Stream.width(ENV);
+    tmp_Stream << tmp_String;
+
+    return tmp_Stream.str();
+}
 
-    List[++current]= Line;
+void
+insertLine(SSA_Entry const& Line, ir_Rep& List)
+{
+    List.push_back(Line);
 }
 
+// First: number of the first line (the error section continues the
+// numbering of the list printed before it)
 void
-printIR_List(const ir_Rep& List)
+printIR_List(const ir_Rep& List, int First)
 {
     ir_Rep::const_iterator iter;
+    int no = First;
     for (iter = List.begin(); iter != List.end(); iter++){
 	std::cout.width(LINE);
-	std::cout << iter->first << " ";
-	(iter->second)->print();
+	std::cout << no++ << " ";
+	iter->print();
 	std::cout << "\n";
     }
 }
@@ -129,18 +445,19 @@ makeRtErrorTargetTable(ir_Rep& Target)
 {
     std::vector<std::string> labels;
     std::string frame = "";
-    std::string target, LHS, RHS;
+    Operand none;
+    Operand exit_Sym(opd_Sym, internSym("exit"));
+    ir_SrcLine = -1;
 
     // some NOPs for visual clarity
     token op = token(tok_nop);
-    SSA_Entry* line = new SSA_Entry(labels, op, target, LHS, RHS, frame); 
+    SSA_Entry line = SSA_Entry(labels, op, none, none, none, frame);
     insertLine(line, Target);
     insertLine(line, Target);
 
     // emit a syscall exit to not fall into this section
     op = token(tok_syscall);
-    target = "exit";
-    line = new SSA_Entry(labels, op, target, LHS, RHS, frame); 
+    line = SSA_Entry(labels, op, exit_Sym, none, none, frame);
     insertLine(line, Target);
 
     std::vector<RtError_Type*>::const_iterator iter;
@@ -148,17 +465,15 @@ makeRtErrorTargetTable(ir_Rep& Target)
     for ( iter = rtError_Table.begin(); iter != rtError_Table.end(); iter++){
 	labels.push_back( (*iter)->Label() );
 	op = token(tok_pushl);
-	target = "$";
-	target += (*iter)->Ds_Addr();
-	line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	Operand msg(opd_Sym, internSym((*iter)->Ds_Addr()));
+	line = SSA_Entry(labels, op, msg, none, none, frame);
 	insertLine(line, Target);
 	labels.clear();
-	LHS = "";
 
-	if ( (rtError_Table.back() != *iter) ){ 
+	if ( (rtError_Table.back() != *iter) ){
 	    op = token(tok_goto);
-	    target = "L_eExit";
-	    line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	    Operand exit_Label(opd_Label, internLabel("L_eExit"));
+	    line = SSA_Entry(labels, op, exit_Label, none, none, frame);
 	    insertLine(line, Target);
 	}
     }
@@ -166,14 +481,13 @@ makeRtErrorTargetTable(ir_Rep& Target)
     // common exit point
     op = token(tok_call);
     labels.push_back("L_eExit");
-    target = "printf";
-    line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+    line = SSA_Entry(labels, op, Operand(opd_Sym, internSym("printf")), none,
+		     none, frame);
     insertLine(line, Target);
     labels.clear();
 
     op = token(tok_syscall);
-    target = "exit";
-    line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+    line = SSA_Entry(labels, op, exit_Sym, none, none, frame);
     insertLine(line, Target);
 }
 
@@ -196,6 +510,3 @@ printDataSection(void)
 	(*iter)->print();
     std::cout << "---------------------------------------------------\n\n";
 }
-
-
-
@@ -2,7 +2,14 @@
 * ir.h - IR for decaf
 *
 * Note: includes handling .data section, and emission or RT error
-*       section 
+*       section
+*
+* Representation: an ir_Rep is a vector of fixed-size SSA_Entry lines.
+*                 A line is an opcode, up to three operand handles
+*                 (target, LHS, RHS), a frame id, and the head of its
+*                 label chain. Names (variables, literals, labels,
+*                 frames, symbols) are stored once, in the tables
+*                 below; text is only produced when printing.
 *
 ********************************************************************/
 
@@ -34,15 +41,189 @@ class SSA_Entry;
 class RtError_Type;
 class Ds_Object;
 
-typedef std::map<int, SSA_Entry*> ir_Rep;
+// Opcodes. Two pairs share a mnemonic, but not a semantic:
+// op_neg    -: t, a     (t = -a)
+// op_scale  *: t, w     (t = t * w; finalizes array offsets)
+// op_phi    only in SSA form (c. ssa.h); LHS is an opd_Phi
+// Vector ops (printed with their lanes, e.g. v+<4>) work on Lanes()
+// consecutive elements, each operand an opd_Elem naming the first:
+// op_vcopy  v=: t, a    (a may also be a scalar, copied to each lane)
+// op_vadd   v+: t, a, b (and op_vsub, op_vmult: lane by lane)
+enum ir_Op{
+    op_nop, op_copy,
+    op_add, op_sub, op_mult, op_div, op_mod, op_neg, op_not, op_scale,
+    op_lt, op_le, op_gt, op_ge, op_eq, op_ne,
+    op_cast, op_dec, op_lea,
+    op_iffalse, op_iftrue, op_goto,
+    op_call, op_syscall, op_movl, op_pushl,
+    op_vcopy, op_vadd, op_vsub, op_vmult,
+    op_phi,
+    op_Count
+};
+
+// Operand kinds. An opd_Elem is an array element (-off)base: Id() is
+// the base variable, Offset() the byte offset (an opd_Imm or opd_Tmp).
+// An opd_Phi indexes the arguments of a phi line in ir_Phis.
+enum ir_OpdType{
+    opd_None, opd_Tmp, opd_Var, opd_Imm, opd_Label, opd_Elem, opd_Reg,
+    opd_Sym, opd_Type, opd_Phi
+};
+
+class Operand{
+public:
+Operand(int Kind = opd_None, int Id = 0, int Off_Kind = opd_None, int Off=0)
+    : kind_(Kind), off_Kind_(Off_Kind), id_(Id), off_(Off) {}
+
+    int Kind(void) const { return kind_; }
+    int Id(void) const { return id_; }
+    Operand Offset(void) const { return Operand(off_Kind_, off_); }
+
+    int isNone(void) const { return (opd_None == kind_); }
+    int isTmp(void) const { return (opd_Tmp == kind_); }
+    int isVar(void) const { return (opd_Var == kind_); }
+    int isImm(void) const { return (opd_Imm == kind_); }
+    int isElem(void) const { return (opd_Elem == kind_); }
+
+    bool operator==(Operand const& r) const
+    {
+	return ( (kind_ == r.kind_) && (id_ == r.id_) &&
+		 (off_Kind_ == r.off_Kind_) && (off_ == r.off_) );
+    }
+    bool operator!=(Operand const& r) const { return !(*this == r); }
+    bool operator<(Operand const& r) const
+    {
+	if ( (kind_ != r.kind_) ) return (kind_ < r.kind_);
+	if ( (id_ != r.id_) ) return (id_ < r.id_);
+	if ( (off_Kind_ != r.off_Kind_) ) return (off_Kind_ < r.off_Kind_);
+	return (off_ < r.off_);
+    }
+
+private:
+    unsigned char kind_;
+    unsigned char off_Kind_;
+    int id_;
+    int off_;
+};
+
+// Name tables operand handles resolve through
+class IR_Var{
+public:
+IR_Var(std::string Name = "", int Frame = -1)
+    : name_(Name), frame_(Frame) {}
+
+    std::string Name(void) const { return name_; }
+    int Frame(void) const { return frame_; } // declaring frame
+
+private:
+    std::string name_;
+    int frame_;
+};
+
+class IR_Const{
+public:
+    IR_Const(std::string Lex = "");
+
+    std::string Lex(void) const { return lex_; }
+    int isFlt(void) const { return is_Flt_; }
+    long IntVal(void) const { return i_Val_; }
+    double FltVal(void) const { return f_Val_; }
+
+private:
+    std::string lex_; // as spelled in the source
+    int is_Flt_;
+    long i_Val_;
+    double f_Val_;
+};
+
+class IR_Frame{
+public:
+IR_Frame(std::string Name = "", Env* E = 0)
+    : name_(Name), env_(E) {}
+
+    std::string Name(void) const { return name_; }
+    Env* getEnv(void) const { return env_; }
+
+private:
+    std::string name_;
+    Env* env_;
+};
+
+// Labels of a line are a chain through ir_LabelLinks. Links are never
+// changed once made, so copied lines can't affect each other; those no
+// line uses any more are dropped between passes (compactLabelLinks()).
+class Label_Link{
+public:
+Label_Link(int L = -1, int N = -1)
+    : label_(L), next_(N) {}
+
+    int Label(void) const { return label_; }
+    int Next(void) const { return next_; }
+
+private:
+    int label_;
+    int next_;
+};
+
+// Arguments of a phi: one value per predecessor, identified by the
+// first label of the predecessor block
+class Phi_Info{
+public:
+    Phi_Info(void) {}
+
+    int Size(void) const { return args_.size(); }
+    Operand Arg(int I) const { return args_[I]; }
+    int Pred(int I) const { return preds_[I]; }
+    int findPred(int Label) const;
+
+    void addArg(Operand O, int Pred)
+    {
+	args_.push_back(O);
+	preds_.push_back(Pred);
+    }
+    void setArg(int I, Operand O) { args_[I] = O; }
+    void removeArg(int I);
+
+private:
+    std::vector<Operand> args_;
+    std::vector<int> preds_;
+};
+
+// from ir.cpp
+extern std::vector<IR_Var> ir_Vars;
+extern std::vector<IR_Const> ir_Consts;
+extern std::vector<std::string> ir_Labels;
+extern std::vector<IR_Frame> ir_Frames;
+extern std::vector<std::string> ir_Syms;
+extern std::vector<std::string> ir_Regs;
+extern std::vector<Label_Link> ir_LabelLinks;
+extern std::vector<Phi_Info> ir_Phis;
+extern int ir_TmpCount;
+extern int ir_SrcLine; // set by the visitor, taken by new lines
+extern const char* ir_OpName[op_Count];
+
+int internVar(std::string Name, int Frame);
+int internConst(std::string Lex);
+int internLabel(std::string Name);
+int internFrame(std::string Name);
+int internSym(std::string Name);
+int internReg(std::string Name);
+Operand makeTmpOperand(void);
+Operand makeImmOperand(std::string Lex);
+Operand makeVarOperand(std::string Name, Env* Scope);
+Operand makeElemOperand(Operand Base, Operand Offset);
+int makeLabelId(void);
+std::string operandStr(Operand const& O);
+tokenType typeFromLex(std::string const& Lex);
+int isVectorOp(ir_Op Op);
+
+typedef std::vector<SSA_Entry> ir_Rep;
 // from ir.cpp
 extern ir_Rep iR_List;
-extern ir_Rep iR_List_2;
 extern ir_Rep iR_RtError_Targets;
 
-void insertLine(SSA_Entry*, ir_Rep&, int Reset = 0);
-void printIR_List(ir_Rep const&);
-ir_Rep removeNOPs(ir_Rep const&);
+void insertLine(SSA_Entry const&, ir_Rep&);
+void compactLabelLinks(ir_Rep& List);
+void printIR_List(ir_Rep const&, int First = 1);
 
 // also from ir.cpp
 extern std::vector<RtError_Type*> rtError_Table;
@@ -53,79 +234,54 @@ void makeRtErrorTargetTable(ir_Rep& Target);
 void printDataSection(void);
 
 class SSA_Entry{
-public: 
-SSA_Entry(std::vector<std::string> Labels, token Op, std::string Target, 
-	  std::string LHS, std::string RHS, std::string Frame) 
-    : labels_(Labels), op_(Op), target_(Target), lHS_(LHS), rHS_(RHS),
-	frame_(Frame)
-    { }   
-
-    SSA_Entry(SSA_Entry const& r)
-    {
-	labels_ = r.Labels();
-	op_ = r.Op();
-	target_ = r.Target();
-	lHS_ = r.LHS();
-	rHS_ = r.RHS();
-	frame_ = r.Frame();
-    }
+public:
+    SSA_Entry(void)
+	: op_(op_nop), frame_(-1), labels_(-1), src_Line_(-1), lanes_(1) {}
 
-    void print() const
-    {
-	std::ostringstream tmp_Stream;
-	std::string tmp_String;
-	std::vector<std::string>::const_iterator iter;
-	for (iter = labels_.begin(); iter != labels_.end(); iter++){
-	    tmp_String += *iter;
-	    tmp_String += ": ";
-	}
-	tmp_Stream.width(LABELS);
-	tmp_Stream << tmp_String;
+    // front end: handles made by the visitor; labels and frame by name
+    SSA_Entry(std::vector<std::string> Labels, token Op, Operand Target,
+	      Operand LHS, Operand RHS, std::string Frame);
 
-	tmp_Stream.width(SSA);
-	tmp_Stream << op_.Lex();
-	tmp_Stream << ":";
-	tmp_Stream.width(SSA);
-	tmp_Stream << target_;
-	if ( ("" != lHS_) )
-	    tmp_Stream << ",";
-	else
-	    tmp_Stream << " ";
-	tmp_Stream.width(SSA);
-	tmp_Stream << lHS_;
-	if ( ("" != rHS_) )
-	    tmp_Stream << ",";
-	else
-	    tmp_Stream << " ";
-	tmp_Stream.width(SSA);
-	tmp_Stream << rHS_;
-
-	tmp_String = "(";
-	tmp_String += frame_;
-	tmp_String += ")";
-	tmp_Stream.width(ENV);
-	tmp_Stream << tmp_String;
+    // back end: built from handles by passes
+SSA_Entry(ir_Op Op, Operand Target = Operand(), Operand LHS = Operand(),
+	  Operand RHS = Operand(), int Frame = -1, int Labels = -1)
+    : op_(Op), frame_(Frame), labels_(Labels), src_Line_(-1), lanes_(1),
+	target_(Target), lHS_(LHS), rHS_(RHS)
+    { }
 
-	std::cout << tmp_Stream.str();
-    }
+    void print() const;
+    std::string str() const;
+
+    void addLabel(int Label);
+    void replaceLabels(std::vector<int> const& Labels);
+    void setLabelChain(int Head) { labels_ = Head; }
 
-    void addLabel(std::string Label) { labels_.push_back(Label); }
-    void replaceLabels(std::vector<std::string> Labels) { labels_ = Labels; }
+    std::vector<int> Labels() const;
+    int LabelChain(void) const { return labels_; }
+    int hasLabels(void) const { return (-1 != labels_); }
+    ir_Op Op(void) const { return static_cast<ir_Op>(op_); }
+    Operand Target(void) const { return target_; }
+    Operand LHS(void) const { return lHS_; }
+    Operand RHS(void) const { return rHS_; }
+    int Frame(void) const { return frame_; }
+    int SrcLine(void) const { return src_Line_; } // -1: not known
+    int Lanes(void) const { return lanes_; }      // of a vector op
 
-    std::vector<std::string> Labels() const { return labels_; }
-    token Op(void) const { return op_; }
-    std::string Target(void) const { return target_; }
-    std::string LHS(void) const { return lHS_; }
-    std::string RHS(void) const { return rHS_; }
-    std::string Frame(void) const { return frame_;}
+    void setOp(ir_Op Op) { op_ = Op; }
+    void setTarget(Operand O) { target_ = O; }
+    void setLHS(Operand O) { lHS_ = O; }
+    void setRHS(Operand O) { rHS_ = O; }
+    void setLanes(int W) { lanes_ = W; }
 
 private:
-    std::vector<std::string> labels_;
-    token op_;
-    std::string target_;
-    std::string lHS_;
-    std::string rHS_;
-    std::string frame_;
+    int op_;
+    int frame_;
+    int labels_; // head of chain in ir_LabelLinks (-1: none)
+    int src_Line_; // of the statement the visitor translated
+    int lanes_;
+    Operand target_;
+    Operand lHS_;
+    Operand rHS_;
 };
 
 // objects put into the data section of memory
@@ -0,0 +1,470 @@
+/********************************************************************
+* ivsr.cpp - strength reduction of induction variables, and linear-
+*            function test replacement
+*
+* On SSA form, per loop with a preheader and one latch (inner loops
+* first, c. licm.cpp):
+* Basic induction variables are phis of the header set to i + c (c a
+* constant) along the back edge. Values derived from them by adding
+* (subtracting) values the loop doesn't change, and by multiplying
+* with constants, are a * i + b; so are the offsets of array elements
+* (c. adj_Offset(): index times the size of the dimension, plus the
+* next index, times the width). Each one used other than to derive
+* another one, with a multiply on the way from i, gets a phi of its
+* own: its value for i on entry (computed in the preheader), plus
+* a * c at the end of the latch. The multiplies left unused go (dead
+* code).
+* Test replacement: the exit test i < n (i <= n; c = 1, and i and n
+* constants on entry, i not above n) compares one of the new values
+* with its value for n instead (by !=, exact in wrapping arithmetic
+* for the trip counts taken). i then goes if all that is left of it
+* is its increment.
+*
+********************************************************************/
+
+#include <map>
+#include <set>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "ssa.h"
+#include "fold.h"
+#include "opt.h"
+
+#define IVSR_MAX_COEF (1L << 24) // larger a, a * c aren't reduced
+
+// a * i + b, i the phi of a basic induction variable
+class IV_Info{
+public:
+IV_Info(Operand Base = Operand(), long Coef = 1, int Line = -1,
+	int Mult = 0)
+    : base_(Base), coef_(Coef), line_(Line), mult_(Mult) {}
+
+    Operand Base(void) const { return base_; }
+    long Coef(void) const { return coef_; }
+    int Line(void) const { return line_; }   // defining it (-1: i)
+    int hasMult(void) const { return mult_; } // on the way from i
+
+private:
+    Operand base_;
+    long coef_;
+    int line_;
+    int mult_;
+};
+
+// a basic induction variable: i = phi(init, next), next = i + c
+class IV_Basic{
+public:
+IV_Basic(Operand Init = Operand(), Operand Next = Operand(), long Step = 0,
+	 int Incr = -1)
+    : init_(Init), next_(Next), step_(Step), incr_(Incr) {}
+
+    Operand Init(void) const { return init_; }
+    Operand Next(void) const { return next_; }
+    long Step(void) const { return step_; }
+    int Incr(void) const { return incr_; }
+
+private:
+    Operand init_;
+    Operand next_;
+    long step_;
+    int incr_;
+};
+
+int
+isIntConst(Operand const& O)
+{
+    return ( O.isImm() && !(constOf(O).isFlt()) );
+}
+
+void
+countUses(ir_Rep const& List, std::map<Operand, int>& Count)
+{
+    std::vector<Operand> uses;
+    Count.clear();
+    for ( size_t i = 0; i < List.size(); i++ ){
+	lineUses(List[i], uses);
+	for ( size_t k = 0; k < uses.size(); k++ )
+	    Count[uses[k]]++;
+    }
+}
+
+class IV_Reducer{
+public:
+    IV_Reducer(ir_Rep& List, CFG const& G, int Loop);
+
+    int apply(void);
+
+private:
+    int findBasic(void);
+    void findDerived(void);
+    Operand replay(Operand X, Operand Base, Operand Val,
+		   std::map<Operand, Operand>& Done);
+    int prepareTest(Operand& Root, Operand& Last);
+    void removeBasic(void);
+    void insertLines(void);
+
+    ir_Rep& list_;
+    CFG const& g_;
+    Loop_Info const& loop_;
+    int pre_, latch_;
+    std::set<Operand> inside_;            // defined in the loop
+    std::map<Operand, IV_Basic> basic_;
+    std::map<Operand, IV_Info> ivs_;
+    std::vector<Operand> roots_;
+    std::vector<SSA_Entry> pre_Lines_;    // end of the preheader
+    std::vector<SSA_Entry> phi_Lines_;    // start of the header
+    std::vector<SSA_Entry> latch_Lines_;  // end of the latch
+    std::map<Operand, Operand> reduced_;  // root -> its phi
+};
+
+IV_Reducer::IV_Reducer(ir_Rep& List, CFG const& G, int Loop)
+    : list_(List), g_(G), loop_(G.Loops()[Loop]), pre_(G.preheader(Loop)),
+      latch_(-1)
+{
+    if ( (1 == loop_.Latches().size()) )
+	latch_ = loop_.Latches()[0];
+
+    std::vector<Operand> defs;
+    std::set<int>::const_iterator iter;
+    for ( iter = loop_.Blocks().begin(); iter != loop_.Blocks().end(); iter++ )
+	for ( int i = g_.Block(*iter).First(); i <= g_.Block(*iter).Last(); i++ ){
+	    lineDefs(list_[i], defs);
+	    inside_.insert(defs.begin(), defs.end());
+	}
+}
+
+int
+IV_Reducer::findBasic(void)
+{
+    std::map<Operand, int> def_Line;
+    std::vector<Operand> defs;
+    std::set<int>::const_iterator iter;
+    for ( iter = loop_.Blocks().begin(); iter != loop_.Blocks().end(); iter++ )
+	for ( int i = g_.Block(*iter).First(); i <= g_.Block(*iter).Last(); i++ ){
+	    lineDefs(list_[i], defs);
+	    if ( !(defs.empty()) )
+		def_Line[defs[0]] = i;
+	}
+
+    Basic_Block const& head = g_.Block(loop_.Header());
+    for ( int i = head.First(); i <= head.Last(); i++ ){
+	SSA_Entry const& line = list_[i];
+	if ( (op_phi != line.Op()) )
+	    continue;
+	Phi_Info const& info = ir_Phis[line.LHS().Id()];
+	if ( (2 != info.Size()) )
+	    continue;
+	int from_Pre = (g_.blockOfLabel(info.Pred(0)) == pre_);
+	Operand init = info.Arg(from_Pre?0:1), next = info.Arg(from_Pre?1:0);
+	if ( (g_.blockOfLabel(info.Pred(from_Pre?1:0)) != latch_) ||
+	     !(def_Line.count(next)) )
+	    continue;
+
+	int incr = def_Line[next];
+	SSA_Entry const& add = list_[incr];
+	Operand i_Opd = line.Target();
+	long step = 0;
+	if ( (op_add == add.Op()) && (add.LHS() == i_Opd) &&
+	     isIntConst(add.RHS()) )
+	    step = constOf(add.RHS()).IntVal();
+	else if ( (op_add == add.Op()) && (add.RHS() == i_Opd) &&
+		  isIntConst(add.LHS()) )
+	    step = constOf(add.LHS()).IntVal();
+	else if ( (op_sub == add.Op()) && (add.LHS() == i_Opd) &&
+		  isIntConst(add.RHS()) )
+	    step = -constOf(add.RHS()).IntVal();
+	if ( (0 == step) || (IVSR_MAX_COEF < labs(step)) )
+	    continue;
+
+	basic_[i_Opd] = IV_Basic(init, next, step, incr);
+	ivs_[i_Opd] = IV_Info(i_Opd, 1, -1, 0);
+	ivs_[next] = IV_Info(i_Opd, 1, incr, 0);
+    }
+    return !(basic_.empty());
+}
+
+void
+IV_Reducer::findDerived(void)
+{
+    std::set<int> incrs;
+    std::map<Operand, IV_Basic>::const_iterator b;
+    for ( b = basic_.begin(); b != basic_.end(); b++ )
+	incrs.insert(b->second.Incr());
+
+    // in reverse post-order operands are seen before their uses
+    std::vector<int> const& rpo = g_.RPO();
+    for ( size_t k = 0; k < rpo.size(); k++ ){
+	if ( !(loop_.contains(rpo[k])) )
+	    continue;
+	for ( int i = g_.Block(rpo[k]).First(); i <= g_.Block(rpo[k]).Last(); i++ ){
+	    SSA_Entry const& line = list_[i];
+	    ir_Op op = line.Op();
+	    if ( incrs.count(i) || !(isValue(line.Target())) ||
+		 ( (op_add != op) && (op_sub != op) && (op_mult != op) ) )
+		continue;
+
+	    Operand iv = line.LHS(), other = line.RHS();
+	    int sign = 1;
+	    if ( !(ivs_.count(iv)) ){
+		std::swap(iv, other);
+		sign = (op_sub == op)?-1:1;
+	    }
+	    if ( !(ivs_.count(iv)) || ivs_.count(other) )
+		continue;
+	    IV_Info const& from = ivs_[iv];
+	    if ( (op_mult == op) ){
+		if ( !(isIntConst(other)) )
+		    continue;
+		long coef = from.Coef() * constOf(other).IntVal();
+		if ( (IVSR_MAX_COEF < labs(coef)) )
+		    continue;
+		ivs_[line.Target()] = IV_Info(from.Base(), coef, i, 1);
+	    }
+	    else{
+		if ( !(isIntConst(other)) &&
+		     ( !(isValue(other)) || inside_.count(other) ) )
+		    continue;
+		ivs_[line.Target()] = IV_Info(from.Base(), sign * from.Coef(),
+					      i, from.hasMult());
+	    }
+	}
+    }
+
+    // roots: used other than to derive another one
+    std::set<Operand> derived_Only;
+    std::map<Operand, IV_Info>::const_iterator iter;
+    std::vector<Operand> uses;
+    std::map<Operand, int> used;
+    for ( size_t i = 0; i < list_.size(); i++ ){
+	lineUses(list_[i], uses);
+	std::vector<Operand> defs;
+	lineDefs(list_[i], defs);
+	int deriving = !(defs.empty()) && ivs_.count(defs[0]) &&
+	    (-1 != ivs_[defs[0]].Line()) && !(incrs.count(i));
+	for ( size_t k = 0; k < uses.size(); k++ )
+	    if ( !(deriving) )
+		used[uses[k]]++;
+    }
+    for ( iter = ivs_.begin(); iter != ivs_.end(); iter++ )
+	if ( iter->second.hasMult() && used.count(iter->first) )
+	    roots_.push_back(iter->first);
+}
+
+// X (derived from Base) recomputed in the preheader, with Val for Base
+Operand
+IV_Reducer::replay(Operand X, Operand Base, Operand Val,
+		   std::map<Operand, Operand>& Done)
+{
+    if ( (X == Base) )
+	return Val;
+    std::map<Operand, IV_Info>::const_iterator iter = ivs_.find(X);
+    if ( (ivs_.end() == iter) )
+	return X;
+    if ( Done.count(X) )
+	return Done[X];
+
+    SSA_Entry const& line = list_[iter->second.Line()];
+    Operand l = replay(line.LHS(), Base, Val, Done);
+    Operand r = replay(line.RHS(), Base, Val, Done);
+    Operand t = makeTmpOperand();
+    pre_Lines_.push_back(SSA_Entry(line.Op(), t, l, r, line.Frame()));
+    Done[X] = t;
+    return t;
+}
+
+// i < n: r != r(n); prepares r(n)
+int
+IV_Reducer::prepareTest(Operand& Root, Operand& Last)
+{
+    Basic_Block const& head = g_.Block(loop_.Header());
+    SSA_Entry const& jump = list_[head.Last()];
+    if ( (op_iffalse != jump.Op()) || (head.First() == head.Last()) )
+	return 0;
+    SSA_Entry const& test = list_[head.Last() - 1];
+    if ( (test.Target() != jump.Target()) ||
+	 ( (op_lt != test.Op()) && (op_le != test.Op()) ) ||
+	 !(basic_.count(test.LHS())) || !(isIntConst(test.RHS())) )
+	return 0;
+
+    Operand i_Opd = test.LHS();
+    IV_Basic const& iv = basic_[i_Opd];
+    if ( (1 != iv.Step()) || !(isIntConst(iv.Init())) )
+	return 0;
+    long init = constOf(iv.Init()).IntVal();
+    long n = constOf(test.RHS()).IntVal() + ( (op_le == test.Op())?1:0 );
+    if ( (init > n) )
+	return 0;
+
+    for ( size_t k = 0; k < roots_.size(); k++ ){
+	IV_Info const& r = ivs_[roots_[k]];
+	if ( (r.Base() != i_Opd) || (0 == r.Coef()) ||
+	     ( (1L << 31) / labs(r.Coef()) <= n - init ) )
+	    continue;
+	std::map<Operand, Operand> done;
+	Root = roots_[k];
+	Last = replay(roots_[k], i_Opd, constOperand(Const_Val(n)), done);
+	return 1;
+    }
+    return 0;
+}
+
+// after dead code went: i with no uses but its own increment goes
+void
+IV_Reducer::removeBasic(void)
+{
+    std::map<Operand, int> count;
+    countUses(list_, count);
+    std::map<Operand, IV_Basic>::const_iterator iter;
+    for ( iter = basic_.begin(); iter != basic_.end(); iter++ ){
+	Operand i_Opd = iter->first, next = iter->second.Next();
+	if ( (1 != count[i_Opd]) || (1 != count[next]) )
+	    continue;
+	for ( size_t i = 0; i < list_.size(); i++ )
+	    if ( (list_[i].Target() == i_Opd) || (list_[i].Target() == next) )
+		makeNOP(list_[i]);
+    }
+}
+
+// the new lines go in (line numbers change)
+void
+IV_Reducer::insertLines(void)
+{
+    int at_Pre = g_.Block(pre_).Last();
+    if ( !(isJump(list_[at_Pre].Op())) )
+	at_Pre++;
+    int at_Head = g_.Block(loop_.Header()).First();
+    int at_Latch = g_.Block(latch_).Last();
+    if ( !(isJump(list_[at_Latch].Op())) )
+	at_Latch++;
+
+    // the header's labels move up to its first phi, those of a jump
+    // ending the preheader (latch) up to the lines put in front of it
+    phi_Lines_[0].setLabelChain(list_[at_Head].LabelChain());
+    list_[at_Head].setLabelChain(-1);
+    if ( !(pre_Lines_.empty()) && (at_Head != at_Pre) ){
+	pre_Lines_[0].setLabelChain(list_[at_Pre].LabelChain());
+	list_[at_Pre].setLabelChain(-1);
+    }
+    if ( (at_Head != at_Latch) ){
+	latch_Lines_[0].setLabelChain(list_[at_Latch].LabelChain());
+	list_[at_Latch].setLabelChain(-1);
+    }
+
+    ir_Rep out;
+    out.reserve(list_.size() + pre_Lines_.size() + 2 * phi_Lines_.size());
+    for ( int i = 0; i <= static_cast<int>(list_.size()); i++ ){
+	if ( (at_Pre == i) )
+	    out.insert(out.end(), pre_Lines_.begin(), pre_Lines_.end());
+	if ( (at_Latch == i) )
+	    out.insert(out.end(), latch_Lines_.begin(), latch_Lines_.end());
+	if ( (at_Head == i) )
+	    out.insert(out.end(), phi_Lines_.begin(), phi_Lines_.end());
+	if ( (i < static_cast<int>(list_.size())) )
+	    out.push_back(list_[i]);
+    }
+    list_.swap(out);
+}
+
+// Returns the number of values reduced
+int
+IV_Reducer::apply(void)
+{
+    if ( (-1 == pre_) || (-1 == latch_) || !(findBasic()) )
+	return 0;
+    findDerived();
+    if ( roots_.empty() )
+	return 0;
+
+    int pre_Label = list_[g_.Block(pre_).First()].Labels()[0];
+    int latch_Label = list_[g_.Block(latch_).First()].Labels()[0];
+    int frame = list_[g_.Block(loop_.Header()).First()].Frame();
+    int latch_Frame = list_[g_.Block(latch_).Last()].Frame();
+    for ( size_t k = 0; k < roots_.size(); k++ ){
+	IV_Info const& iv = ivs_[roots_[k]];
+	IV_Basic const& basic = basic_[iv.Base()];
+	std::map<Operand, Operand> done;
+	Operand init = replay(roots_[k], iv.Base(), basic.Init(), done);
+
+	Operand r = makeTmpOperand(), next = makeTmpOperand();
+	Phi_Info info;
+	info.addArg(init, pre_Label);
+	info.addArg(next, latch_Label);
+	ir_Phis.push_back(info);
+	phi_Lines_.push_back(SSA_Entry(op_phi, r,
+				       Operand(opd_Phi, ir_Phis.size() - 1),
+				       Operand(), frame));
+	long step = wrapInt(iv.Coef() * basic.Step());
+	latch_Lines_.push_back(SSA_Entry(op_add, next, r,
+					 constOperand(Const_Val(step)),
+					 latch_Frame));
+	reduced_[roots_[k]] = r;
+    }
+    Operand root, last;
+    if ( prepareTest(root, last) ){
+	SSA_Entry& test = list_[g_.Block(loop_.Header()).Last() - 1];
+	test = SSA_Entry(op_ne, test.Target(), reduced_[root], last,
+			 test.Frame(), test.LabelChain());
+    }
+
+    // a root is r wherever it is defined (r changes at the latch only)
+    for ( size_t k = 0; k < roots_.size(); k++ ){
+	SSA_Entry& line = list_[ivs_[roots_[k]].Line()];
+	line = SSA_Entry(op_copy, line.Target(), reduced_[roots_[k]],
+			 Operand(), line.Frame(), line.LabelChain());
+    }
+    std::set<int>::const_iterator iter;
+    for ( iter = loop_.Blocks().begin(); iter != loop_.Blocks().end(); iter++ )
+	for ( int i = g_.Block(*iter).First(); i <= g_.Block(*iter).Last(); i++ )
+	    if ( (op_copy != list_[i].Op()) ||
+		 !(reduced_.count(list_[i].Target())) )
+		replaceUses(list_[i], reduced_);
+
+    // the multiplies (lines only deriving the roots) go; then i may
+    insertLines();
+    removeDeadCode(list_);
+    removeBasic();
+    return roots_.size();
+}
+
+int
+ivsrSSA(ir_Rep& List)
+{
+    if ( List.empty() )
+	return 0;
+
+    std::vector<std::pair<int, int> > order;
+    {
+	CFG g(List);
+	std::vector<Loop_Info> const& loops = g.Loops();
+	for ( size_t l = 0; l < loops.size(); l++ ){
+	    int first = g.Block(loops[l].Header()).First();
+	    order.push_back(std::make_pair(-loops[l].Depth(),
+					   List[first].Labels()[0]));
+	}
+    }
+    std::sort(order.begin(), order.end());
+
+    int reduced = 0;
+    for ( size_t k = 0; k < order.size(); k++ ){
+	CFG g(List);
+	int header = g.blockOfLabel(order[k].second);
+	std::vector<Loop_Info> const& loops = g.Loops();
+	for ( size_t l = 0; l < loops.size(); l++ )
+	    if ( (loops[l].Header() == header) ){
+		IV_Reducer r(List, g, l);
+		reduced += r.apply();
+	    }
+    }
+    return reduced;
+}
+
+int
+reduceStrength(ir_Rep& List)
+{
+    return withSSA(List, ivsrSSA);
+}
@@ -0,0 +1,648 @@
+/********************************************************************
+* jit.cpp - implementation file for jit.h
+*
+********************************************************************/
+
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ir.h"
+#include "x86.h"
+#include "jit.h"
+
+void errExit(int pError, const char* msg, ...);
+
+/***************************************
+* Operands (AT&T syntax)
+***************************************/
+enum asm_OpdKind{ asm_Reg, asm_Imm, asm_Mem, asm_Label };
+
+// rip: base of a %rip relative operand
+static const int reg_Rip = 16;
+
+class Asm_Operand{
+public:
+    Asm_Operand(void)
+	: kind_(asm_Label), reg_(-1), size_(0), imm_(0), base_(-1),
+	  index_(-1), indirect_(0) {}
+
+    int Kind(void) const { return kind_; }
+    int Reg(void) const { return reg_; }    // asm_Reg: number 0-15
+    int Size(void) const { return size_; }  // of a register; xmm: 16
+    long Imm(void) const { return imm_; }   // asm_Imm; asm_Mem: disp.
+    int Base(void) const { return base_; }
+    int Index(void) const { return index_; }
+    std::string Sym(void) const { return sym_; } // %rip relative, label
+    int isIndirect(void) const { return indirect_; }
+    int isXmm(void) const { return ( (asm_Reg == kind_) && (16 == size_) ); }
+
+    void parse(std::string const& Text,
+	       std::map<std::string, long> const& Externals);
+
+private:
+    int kind_;
+    int reg_;
+    int size_;
+    long imm_;
+    int base_;
+    int index_;
+    std::string sym_;
+    int indirect_;
+};
+
+static const char* regs_64[] = { "rax", "rcx", "rdx", "rbx", "rsp", "rbp",
+				 "rsi", "rdi" };
+static const char* regs_32[] = { "eax", "ecx", "edx", "ebx", "esp", "ebp",
+				 "esi", "edi" };
+static const char* regs_8[] = { "al", "cl", "dl", "bl" };
+
+// %eax -> 0, size 4; %r12d -> 12, size 4; %xmm3 -> 3, size 16
+int
+regNumber(std::string Name, int& Size)
+{
+    if ( (0 == Name.compare(0, 3, "xmm")) ){
+	Size = 16;
+	return atoi(Name.c_str() + 3);
+    }
+    for ( int k = 0; k < 8; k++ ){
+	if ( (Name == regs_64[k]) ){ Size = 8; return k; }
+	if ( (Name == regs_32[k]) ){ Size = 4; return k; }
+	if ( (k < 4) && (Name == regs_8[k]) ){ Size = 1; return k; }
+    }
+    if ( ('r' == Name[0]) && isdigit(Name[1]) ){
+	char suffix = Name[Name.size() - 1];
+	Size = ( ('d' == suffix) )?4:( ('b' == suffix) )?1:8;
+	return atoi(Name.c_str() + 1);
+    }
+    errExit(0, "jit: unknown register %%%s", Name.c_str());
+    return -1;
+}
+
+void
+Asm_Operand::parse(std::string const& Text,
+		   std::map<std::string, long> const& Externals)
+{
+    std::string t = Text;
+    if ( ('*' == t[0]) ){
+	indirect_ = 1;
+	t = t.substr(1);
+    }
+    if ( ('%' == t[0]) ){
+	kind_ = asm_Reg;
+	reg_ = regNumber(t.substr(1), size_);
+	return;
+    }
+    if ( ('$' == t[0]) ){
+	kind_ = asm_Imm;
+	std::map<std::string, long>::const_iterator iter;
+	if ( (Externals.end() != (iter = Externals.find(t.substr(1)))) )
+	    imm_ = iter->second;
+	else
+	    imm_ = strtol(t.c_str() + 1, 0, 0);
+	return;
+    }
+    size_t paren = t.find('(');
+    if ( (std::string::npos == paren) ){
+	kind_ = asm_Label;
+	sym_ = t;
+	return;
+    }
+
+    kind_ = asm_Mem;
+    std::string disp = t.substr(0, paren);
+    if ( ("" != disp) && !(isdigit(disp[0])) && ('-' != disp[0]) )
+	sym_ = disp;
+    else
+	imm_ = strtol(disp.c_str(), 0, 0);
+    std::string inner = t.substr(paren + 1, t.find(')') - paren - 1);
+    std::string base = inner.substr(0, inner.find(','));
+    int size;
+    base_ = ( ("%rip" == base) )?reg_Rip:regNumber(base.substr(1), size);
+    if ( (std::string::npos != inner.find(',')) )
+	index_ = regNumber(inner.substr(inner.find(',') + 2), size);
+}
+
+/***************************************
+* Assembler
+***************************************/
+enum asm_Section{ sec_Text, sec_Data, sec_None };
+
+// a 32 bit displacement to a symbol, from the end of its instruction
+class Asm_Fixup{
+public:
+Asm_Fixup(size_t At = 0, size_t End = 0, std::string Sym = "")
+    : at_(At), end_(End), sym_(Sym) {}
+
+    size_t At(void) const { return at_; }
+    size_t End(void) const { return end_; }
+    std::string Sym(void) const { return sym_; }
+
+private:
+    size_t at_;
+    size_t end_;
+    std::string sym_;
+};
+
+class X86_Asm{
+public:
+    X86_Asm(void) : section_(sec_Text), locals_(0) {}
+
+    void addExternal(std::string const& Name, long Addr)
+    {
+	externals_[Name] = Addr;
+    }
+    void line(std::string const& Line);
+    // code, padding, data; Offset: of a symbol in the result
+    void link(std::vector<unsigned char>& Image);
+    size_t Offset(std::string const& Sym);
+
+    // # comments: text offset, and the comment
+    std::vector<std::pair<size_t, std::string> > const& Marks(void) const
+    {
+	return marks_;
+    }
+    size_t TextSize(void) const { return text_.size(); }
+
+private:
+    void instruction(std::string const& Mnem,
+		     std::vector<Asm_Operand> const& Ops);
+    void directive(std::string const& Name, std::string const& Args);
+    void byte(int B) { text_.push_back(static_cast<unsigned char>(B)); }
+    void imm(long V, int Bytes);
+    void encode(int Prefix, int W, std::string const& Opcode, int Reg,
+		Asm_Operand const& Rm, int Imm_Bytes = 0, long Imm = 0);
+    void jump(std::string const& Opcode, std::string const& Label);
+    void aluOp(int Ext, int W, std::vector<Asm_Operand> const& Ops);
+
+    std::vector<unsigned char> text_;
+    std::vector<unsigned char> data_;
+    int section_;
+    int locals_;                               // 1: labels defined
+    std::map<std::string, std::pair<int, size_t> > syms_;
+    std::map<std::string, long> externals_;
+    std::vector<Asm_Fixup> fixups_;
+    std::vector<std::pair<size_t, std::string> > marks_;
+    size_t data_Start_;
+};
+
+void
+X86_Asm::imm(long V, int Bytes)
+{
+    for ( int k = 0; k < Bytes; k++ )
+	byte( (V >> (8 * k)) & 0xff );
+}
+
+int
+fitsByte(long V)
+{
+    return ( (-128 <= V) && (127 >= V) );
+}
+
+// [Prefix] [REX] Opcode ModRM [SIB] [disp] [imm]; Reg: register or
+// opcode extension of ModRM
+void
+X86_Asm::encode(int Prefix, int W, std::string const& Opcode, int Reg,
+		Asm_Operand const& Rm, int Imm_Bytes, long Imm)
+{
+    if (Prefix)
+	byte(Prefix);
+    int rm = ( (asm_Reg == Rm.Kind()) )?Rm.Reg():Rm.Base();
+    int rex = (W << 3) | ( (8 <= Reg) << 2 );
+    if ( (asm_Mem == Rm.Kind()) && (0 <= Rm.Index()) && (8 <= Rm.Index()) )
+	rex |= 2;
+    if ( (reg_Rip != rm) && (8 <= rm) )
+	rex |= 1;
+    if (rex)
+	byte(0x40 | rex);
+    for ( size_t k = 0; k < Opcode.size(); k++ )
+	byte(static_cast<unsigned char>(Opcode[k]));
+
+    int reg = (Reg & 7) << 3;
+    if ( (asm_Reg == Rm.Kind()) ){
+	byte(0xc0 | reg | (rm & 7));
+	imm(Imm, Imm_Bytes);
+	return;
+    }
+    if ( (reg_Rip == rm) ){
+	byte(0x05 | reg);
+	size_t at = text_.size();
+	fixups_.push_back(Asm_Fixup(at, at + 4 + Imm_Bytes, Rm.Sym()));
+	imm(0, 4);
+	imm(Imm, Imm_Bytes);
+	return;
+    }
+    long disp = Rm.Imm();
+    int mod = ( (0 == disp) && (5 != (rm & 7)) )?0:( fitsByte(disp) )?1:2;
+    if ( (0 <= Rm.Index()) ){
+	byte( (mod << 6) | reg | 4 );
+	byte( ((Rm.Index() & 7) << 3) | (rm & 7) );
+    }
+    else{
+	byte( (mod << 6) | reg | (rm & 7) );
+	if ( (4 == (rm & 7)) ) // %rsp, %r12
+	    byte(0x24);
+    }
+    imm(disp, ( (1 == mod) )?1:( (2 == mod) )?4:0);
+    imm(Imm, Imm_Bytes);
+}
+
+void
+X86_Asm::jump(std::string const& Opcode, std::string const& Label)
+{
+    for ( size_t k = 0; k < Opcode.size(); k++ )
+	byte(static_cast<unsigned char>(Opcode[k]));
+    size_t at = text_.size();
+    fixups_.push_back(Asm_Fixup(at, at + 4, Label));
+    imm(0, 4);
+}
+
+// add, or, and, sub, xor, cmp (Ext: their /digit)
+void
+X86_Asm::aluOp(int Ext, int W, std::vector<Asm_Operand> const& Ops)
+{
+    Asm_Operand const& src = Ops[0];
+    Asm_Operand const& dst = Ops[1];
+    if ( (asm_Imm == src.Kind()) ){
+	if ( fitsByte(src.Imm()) )
+	    encode(0, W, "\x83", Ext, dst, 1, src.Imm());
+	else
+	    encode(0, W, "\x81", Ext, dst, 4, src.Imm());
+    }
+    else if ( (asm_Reg == src.Kind()) )
+	encode(0, W, std::string(1, Ext * 8 + 1), src.Reg(), dst);
+    else
+	encode(0, W, std::string(1, Ext * 8 + 3), dst.Reg(), src);
+}
+
+struct Asm_Cond{
+    const char* name;
+    int code;
+};
+
+static const Asm_Cond conds[] = {
+    { "e", 0x4 }, { "ne", 0x5 }, { "l", 0xc }, { "le", 0xe }, { "g", 0xf },
+    { "ge", 0xd }, { "a", 0x7 }, { "ae", 0x3 }, { "p", 0xa }, { "np", 0xb }
+};
+
+int
+condCode(std::string const& Cc)
+{
+    for ( size_t k = 0; k < sizeof(conds) / sizeof(conds[0]); k++ )
+	if ( (Cc == conds[k].name) )
+	    return conds[k].code;
+    return -1;
+}
+
+void
+X86_Asm::instruction(std::string const& Mnem,
+		     std::vector<Asm_Operand> const& Ops)
+{
+    size_t n = Ops.size();
+    Asm_Operand none;
+    Asm_Operand const& src = ( (0 < n) )?Ops[0]:none;
+    Asm_Operand const& dst = ( (1 < n) )?Ops[1]:none;
+    int w = ( ('q' == Mnem[Mnem.size() - 1]) );
+    std::string sse = Mnem;
+    int cc;
+
+    if ( ("movl" == Mnem) || ("movq" == Mnem) ){
+	if ( (asm_Imm == src.Kind()) && (asm_Reg == dst.Kind()) && !w ){
+	    if ( (8 <= dst.Reg()) )
+		byte(0x41);
+	    byte(0xb8 + (dst.Reg() & 7));
+	    imm(src.Imm(), 4);
+	}
+	else if ( (asm_Imm == src.Kind()) )
+	    encode(0, w, "\xc7", 0, dst, 4, src.Imm());
+	else if ( (asm_Reg == src.Kind()) )
+	    encode(0, w, "\x89", src.Reg(), dst);
+	else
+	    encode(0, w, "\x8b", dst.Reg(), src);
+    }
+    else if ( ("movabsq" == Mnem) ){
+	byte( (8 <= dst.Reg())?0x49:0x48 );
+	byte(0xb8 + (dst.Reg() & 7));
+	imm(src.Imm(), 8);
+    }
+    else if ( ("movsd" == Mnem) ){
+	if ( dst.isXmm() )
+	    encode(0xf2, 0, std::string("\x0f\x10", 2), dst.Reg(), src);
+	else
+	    encode(0xf2, 0, std::string("\x0f\x11", 2), src.Reg(), dst);
+    }
+    else if ( ("movslq" == Mnem) )
+	encode(0, 1, "\x63", dst.Reg(), src);
+    else if ( ("movzbl" == Mnem) )
+	encode(0, 0, std::string("\x0f\xb6", 2), dst.Reg(), src);
+    else if ( ("addl" == Mnem) || ("addq" == Mnem) )
+	aluOp(0, w, Ops);
+    else if ( ("subl" == Mnem) || ("subq" == Mnem) )
+	aluOp(5, w, Ops);
+    else if ( ("andq" == Mnem) )
+	aluOp(4, w, Ops);
+    else if ( ("xorl" == Mnem) )
+	aluOp(6, w, Ops);
+    else if ( ("cmpl" == Mnem) )
+	aluOp(7, w, Ops);
+    else if ( ("andb" == Mnem) )
+	encode(0, 0, "\x20", src.Reg(), dst);
+    else if ( ("orb" == Mnem) )
+	encode(0, 0, "\x08", src.Reg(), dst);
+    else if ( ("imull" == Mnem) ){
+	if ( (asm_Imm == src.Kind()) )
+	    encode(0, 0, "\x69", dst.Reg(), dst, 4, src.Imm());
+	else
+	    encode(0, 0, std::string("\x0f\xaf", 2), dst.Reg(), src);
+    }
+    else if ( ("shll" == Mnem) )
+	encode(0, 0, "\xc1", 4, dst, 1, src.Imm());
+    else if ( ("testl" == Mnem) )
+	encode(0, 0, "\x85", src.Reg(), dst);
+    else if ( ("idivl" == Mnem) )
+	encode(0, 0, "\xf7", 7, src);
+    else if ( ("negl" == Mnem) )
+	encode(0, 0, "\xf7", 3, src);
+    else if ( ("cltd" == Mnem) )
+	byte(0x99);
+    else if ( ("leave" == Mnem) )
+	byte(0xc9);
+    else if ( ("ret" == Mnem) )
+	byte(0xc3);
+    else if ( ("cvtsi2sdl" == Mnem) )
+	encode(0xf2, 0, std::string("\x0f\x2a", 2), dst.Reg(), src);
+    else if ( ("cvttsd2si" == Mnem) )
+	encode(0xf2, 0, std::string("\x0f\x2c", 2), dst.Reg(), src);
+    else if ( ("addsd" == sse) || ("mulsd" == sse) || ("subsd" == sse) ||
+	      ("divsd" == sse) ){
+	char op = ( ("addsd" == sse) )?0x58:( ("mulsd" == sse) )?0x59:
+	    ( ("subsd" == sse) )?0x5c:0x5e;
+	encode(0xf2, 0, std::string("\x0f", 1) + op, dst.Reg(), src);
+    }
+    else if ( ("movdqu" == Mnem) || ("movupd" == Mnem) ){
+	int prefix = ( ("movdqu" == Mnem) )?0xf3:0x66;
+	char load = ( ("movdqu" == Mnem) )?0x6f:0x10;
+	char store = ( ("movdqu" == Mnem) )?0x7f:0x11;
+	if ( dst.isXmm() )
+	    encode(prefix, 0, std::string("\x0f", 1) + load, dst.Reg(), src);
+	else
+	    encode(prefix, 0, std::string("\x0f", 1) + store, src.Reg(), dst);
+    }
+    else if ( ("movd" == Mnem) )
+	encode(0x66, 0, std::string("\x0f\x6e", 2), dst.Reg(), src);
+    else if ( ("pshufd" == Mnem) )
+	encode(0x66, 0, std::string("\x0f\x70", 2), Ops[2].Reg(), dst, 1,
+	       src.Imm());
+    else if ( ("paddd" == sse) || ("psubd" == sse) || ("unpcklpd" == sse) ||
+	      ("addpd" == sse) || ("subpd" == sse) || ("mulpd" == sse) ){
+	char op = ( ("paddd" == sse) )?0xfe:( ("psubd" == sse) )?0xfa:
+	    ( ("unpcklpd" == sse) )?0x14:( ("addpd" == sse) )?0x58:
+	    ( ("subpd" == sse) )?0x5c:0x59;
+	encode(0x66, 0, std::string("\x0f", 1) + op, dst.Reg(), src);
+    }
+    else if ( ("pmulld" == Mnem) )
+	encode(0x66, 0, std::string("\x0f\x38\x40", 3), dst.Reg(), src);
+    else if ( ("xorpd" == Mnem) )
+	encode(0x66, 0, std::string("\x0f\x57", 2), dst.Reg(), src);
+    else if ( ("ucomisd" == Mnem) )
+	encode(0x66, 0, std::string("\x0f\x2e", 2), dst.Reg(), src);
+    else if ( (0 == Mnem.compare(0, 3, "set")) &&
+	      (-1 != (cc = condCode(Mnem.substr(3)))) )
+	encode(0, 0, std::string("\x0f", 1) + static_cast<char>(0x90 + cc), 0,
+	       src);
+    else if ( ("jmp" == Mnem) )
+	jump("\xe9", src.Sym());
+    else if ( ('j' == Mnem[0]) && (-1 != (cc = condCode(Mnem.substr(1)))) )
+	jump(std::string("\x0f", 1) + static_cast<char>(0x80 + cc), src.Sym());
+    else if ( ("call" == Mnem) && src.isIndirect() )
+	encode(0, 0, "\xff", 2, src);
+    else if ( ("pushq" == Mnem) && (asm_Imm == src.Kind()) ){
+	byte(0x68);
+	imm(src.Imm(), 4);
+    }
+    else if ( ("pushq" == Mnem) || ("popq" == Mnem) ){
+	if ( (8 <= src.Reg()) )
+	    byte(0x41);
+	byte( ( ("pushq" == Mnem) )?(0x50 + (src.Reg() & 7)):
+	      (0x58 + (src.Reg() & 7)) );
+    }
+    else if ( ("leaq" == Mnem) )
+	encode(0, 1, "\x8d", dst.Reg(), src);
+    else
+	errExit(0, "jit: can't encode %s", Mnem.c_str());
+}
+
+void
+X86_Asm::directive(std::string const& Name, std::string const& Args)
+{
+    std::vector<unsigned char>& out = ( (sec_Text == section_) )?text_:data_;
+    if ( (".text" == Name) )
+	section_ = sec_Text;
+    else if ( (".data" == Name) )
+	section_ = sec_Data;
+    else if ( (".section" == Name) )
+	section_ = ( (0 == Args.compare(0, 7, ".rodata")) )?sec_Data:sec_None;
+    else if ( (".align" == Name) ){
+	size_t a = atoi(Args.c_str());
+	while ( (0 != out.size() % a) )
+	    out.push_back(0);
+    }
+    else if ( (".quad" == Name) ){
+	std::istringstream in(Args);
+	std::string v;
+	while ( std::getline(in, v, ',') ){
+	    unsigned long q = strtoul(v.c_str(), 0, 0);
+	    for ( int k = 0; k < 8; k++ )
+		out.push_back( (q >> (8 * k)) & 0xff );
+	}
+    }
+    else if ( (".asciz" == Name) ){
+	for ( size_t k = Args.find('"') + 1; k < Args.size(); k++ ){
+	    if ( ('"' == Args[k]) )
+		break;
+	    if ( ('\\' == Args[k]) ){
+		k++;
+		out.push_back( ('n' == Args[k])?'\n':('t' == Args[k])?'\t':
+			       Args[k] );
+	    }
+	    else
+		out.push_back(Args[k]);
+	}
+	out.push_back(0);
+    }
+    // .globl, .type, .size: a single symbol, nothing to link
+}
+
+void
+X86_Asm::line(std::string const& Line)
+{
+    size_t first = Line.find_first_not_of(" \t");
+    if ( (std::string::npos == first) )
+	return;
+    std::string l = Line.substr(first);
+
+    if ( ('#' == l[0]) ){
+	marks_.push_back(std::make_pair(text_.size(), l.substr(2)));
+	return;
+    }
+    if ( (':' == l[l.size() - 1]) ){
+	std::string name = l.substr(0, l.size() - 1);
+	std::ostringstream tmp_Stream;
+	if ( ("1" == name) ){ // defines the label 1f refers to
+	    tmp_Stream << "1f." << locals_++;
+	    name = tmp_Stream.str();
+	}
+	size_t at = ( (sec_Text == section_) )?text_.size():data_.size();
+	syms_[name] = std::make_pair(section_, at);
+	return;
+    }
+
+    size_t gap = l.find_first_of(" \t");
+    std::string mnem = l.substr(0, gap);
+    std::string args;
+    if ( (std::string::npos != gap) )
+	args = l.substr(l.find_first_not_of(" \t", gap));
+    if ( ('.' == mnem[0]) ){
+	directive(mnem, args);
+	return;
+    }
+
+    // operands: split at the commas outside of parentheses
+    std::vector<Asm_Operand> ops;
+    int depth = 0;
+    std::string cur;
+    for ( size_t k = 0; k <= args.size(); k++ ){
+	if ( (args.size() == k) || ( (',' == args[k]) && (0 == depth) ) ){
+	    size_t b = cur.find_first_not_of(" \t");
+	    if ( (std::string::npos != b) ){
+		Asm_Operand o;
+		std::string t = cur.substr(b);
+		if ( ("1f" == t) ){
+		    std::ostringstream tmp_Stream;
+		    tmp_Stream << "1f." << locals_;
+		    t = tmp_Stream.str();
+		}
+		o.parse(t, externals_);
+		ops.push_back(o);
+	    }
+	    cur = "";
+	    continue;
+	}
+	if ( ('(' == args[k]) ) depth++;
+	if ( (')' == args[k]) ) depth--;
+	cur += args[k];
+    }
+    instruction(mnem, ops);
+}
+
+size_t
+X86_Asm::Offset(std::string const& Sym)
+{
+    std::map<std::string, std::pair<int, size_t> >::const_iterator iter;
+    if ( (syms_.end() == (iter = syms_.find(Sym))) )
+	errExit(0, "jit: undefined symbol %s", Sym.c_str());
+    if ( (sec_Text == iter->second.first) )
+	return iter->second.second;
+    return data_Start_ + iter->second.second;
+}
+
+void
+X86_Asm::link(std::vector<unsigned char>& Image)
+{
+    data_Start_ = (text_.size() + 15) & ~static_cast<size_t>(15);
+    for ( size_t i = 0; i < fixups_.size(); i++ ){
+	long rel = static_cast<long>(Offset(fixups_[i].Sym())) -
+	    static_cast<long>(fixups_[i].End());
+	for ( int k = 0; k < 4; k++ )
+	    text_[fixups_[i].At() + k] = (rel >> (8 * k)) & 0xff;
+    }
+    Image = text_;
+    Image.resize(data_Start_, 0xcc); // int3
+    Image.insert(Image.end(), data_.begin(), data_.end());
+}
+
+/***************************************
+* Running
+***************************************/
+long
+usecSince(struct timeval const& Start)
+{
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return (now.tv_sec - Start.tv_sec) * 1000000L +
+	(now.tv_usec - Start.tv_usec);
+}
+
+void
+writePerfMap(X86_Asm& Asm, unsigned char* Base, std::string const& Name)
+{
+    std::ostringstream name_Stream;
+    name_Stream << "/tmp/perf-" << getpid() << ".map";
+    std::ofstream out(name_Stream.str().c_str());
+    if ( !(out.good()) )
+	errExit(1, "can't open file <%s>", name_Stream.str().c_str());
+
+    std::vector<std::pair<size_t, std::string> > marks = Asm.Marks();
+    size_t start = Asm.Offset("main");
+    std::string what = "main";
+    for ( size_t k = 0; k <= marks.size(); k++ ){
+	size_t end = ( (marks.size() == k) )?Asm.TextSize():marks[k].first;
+	if ( (end > start) )
+	    out << std::hex
+		<< reinterpret_cast<unsigned long>(Base + start) << " "
+		<< end - start << std::dec << " " << Name << " " << what
+		<< "\n";
+	if ( (marks.size() != k) ){
+	    start = marks[k].first;
+	    what = marks[k].second;
+	}
+    }
+}
+
+JIT_Result
+runJIT(ir_Rep const& List, ir_Rep const& Errors, std::string const& Name)
+{
+    struct timeval t_Start;
+    gettimeofday(&t_Start, 0);
+
+    std::stringstream text;
+    emitX86(List, Errors, text, 1);
+    X86_Asm as;
+    as.addExternal("printf", reinterpret_cast<long>(&printf));
+    std::string l;
+    while ( std::getline(text, l) )
+	as.line(l);
+    std::vector<unsigned char> image;
+    as.link(image);
+
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t size = (image.size() + page - 1) / page * page;
+    void* mem = mmap(0, size, PROT_READ | PROT_WRITE,
+		     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if ( (MAP_FAILED == mem) )
+	errExit(1, "jit: mmap");
+    unsigned char* base = static_cast<unsigned char*>(mem);
+    memcpy(base, &image[0], image.size());
+    if ( (-1 == mprotect(mem, size, PROT_READ | PROT_EXEC)) )
+	errExit(1, "jit: mprotect");
+    writePerfMap(as, base, Name);
+    long usec = usecSince(t_Start);
+
+    typedef int (*decaf_Main)(void);
+    decaf_Main entry = reinterpret_cast<decaf_Main>(base + as.Offset("main"));
+    gettimeofday(&t_Start, 0);
+    int status = entry();
+    fflush(stdout);
+    long run_Usec = usecSince(t_Start);
+
+    munmap(mem, size);
+    return JIT_Result(status, image.size(), usec, run_Usec);
+}
@@ -0,0 +1,46 @@
+/********************************************************************
+* jit.h - x86-64 code for the IR, run in process (-jit)
+*
+* Code:    the assembly of x86.h (calls by address) goes through a
+*          small assembler for the instructions x86.cpp emits; the
+*          bytes are written to anonymous memory mapped writable, which
+*          is then made executable instead (never both). Constants and
+*          strings follow the code in the same mapping, in reach of
+*          %rip relative operands.
+* Frame:   as for -S (c. x86.h), on the stack of the compiler; main()
+*          is called, and returns 1 after a run-time error.
+* Profile: /tmp/perf-<pid>.map names each run of code translated from
+*          one source line (<basename>.dec line 12, from the # line
+*          comments), so perf report attributes samples to it.
+*
+********************************************************************/
+
+#ifndef JIT_H_
+#define JIT_H_
+
+#include <string>
+
+#include "ir.h"
+
+class JIT_Result{
+public:
+JIT_Result(int Status = 0, long Bytes = 0, long Usec = 0, long Run_Usec = 0)
+    : status_(Status), bytes_(Bytes), usec_(Usec), run_Usec_(Run_Usec) {}
+
+    int Status(void) const { return status_; }
+    long Bytes(void) const { return bytes_; }     // code and data
+    long Usec(void) const { return usec_; }       // to executable memory
+    long RunUsec(void) const { return run_Usec_; }
+
+private:
+    int status_;
+    long bytes_;
+    long usec_;
+    long run_Usec_;
+};
+
+// Name: of the source file, for the perf map
+JIT_Result runJIT(ir_Rep const& List, ir_Rep const& Errors,
+		  std::string const& Name);
+
+#endif
@@ -0,0 +1,168 @@
+/********************************************************************
+* jumps.cpp - jump threading, branch simplification, label cleanup
+*
+* Out of SSA form only (a retargeted jump changes the predecessors the
+* phis name). Repeated until nothing changes:
+* Threading:   a jump to a goto goes where that goto goes; a conditional
+*              jump to a conditional jump testing the same operand (no
+*              line runs in between) goes where that one goes, or past
+*              it, by the sense of the two.
+* Branches:    iffalse c goto L1; goto L2; L1: becomes iftrue c goto L2,
+*              and a jump to the next line goes. Lines after a goto up
+*              to the next label are never reached, and go as well.
+* Labels:      labels no jump refers to are dropped first (the run-time
+*              error section, made later, only has jumps into itself).
+*
+********************************************************************/
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "ir.h"
+#include "cfg.h"
+#include "ssa.h"
+#include "opt.h"
+
+static void
+setJumpLabel(SSA_Entry& Line, int Label)
+{
+    if ( (op_goto == Line.Op()) )
+	Line.setTarget(Operand(opd_Label, Label));
+    else
+	Line.setRHS(Operand(opd_Label, Label));
+}
+
+// label of line I, made if it has none
+static int
+labelOf(ir_Rep& List, size_t I, std::map<int, size_t>& At)
+{
+    if ( (List[I].hasLabels()) )
+	return List[I].Labels()[0];
+    int label = makeLabelId();
+    List[I].addLabel(label);
+    At[label] = I;
+    return label;
+}
+
+// final target of a jump from line I to Label
+static int
+threadJump(ir_Rep& List, size_t I, int Label, std::map<int, size_t>& At)
+{
+    SSA_Entry const& from = List[I];
+    std::set<size_t> seen;
+    for ( ;; ){
+	std::map<int, size_t>::const_iterator iter = At.find(Label);
+	if ( (At.end() == iter) || (seen.count(iter->second)) )
+	    return Label; // not in List (error section), or a cycle
+	size_t at = iter->second;
+	seen.insert(at);
+	SSA_Entry const& to = List[at];
+	if ( (op_goto == to.Op()) )
+	    Label = to.Target().Id();
+	else if ( isCondJump(from.Op()) && isCondJump(to.Op()) &&
+		  (from.Target() == to.Target()) ){
+	    if ( (from.Op() == to.Op()) )
+		Label = to.RHS().Id();
+	    else if ( (at + 1 < List.size()) )
+		Label = labelOf(List, at + 1, At);
+	    else
+		return Label;
+	}
+	else
+	    return Label;
+    }
+}
+
+static int
+threadOnce(ir_Rep& List)
+{
+    std::map<int, size_t> at;
+    for ( size_t i = 0; i < List.size(); i++ ){
+	std::vector<int> labels = List[i].Labels();
+	for ( size_t k = 0; k < labels.size(); k++ )
+	    at[labels[k]] = i;
+    }
+
+    int changes = 0;
+    for ( size_t i = 0; i < List.size(); i++ ){
+	if ( (op_nop == List[i].Op()) || !(isJump(List[i].Op())) )
+	    continue;
+	int label = jumpLabel(List[i]);
+	int to = threadJump(List, i, label, at);
+	if ( (to != label) ){
+	    setJumpLabel(List[i], to);
+	    label = to;
+	    changes++;
+	}
+
+	// (a label not in List is in the run-time error section)
+	std::map<int, size_t>::const_iterator iter = at.find(label);
+	long dest = ( (at.end() == iter) )?-1:iter->second;
+	if ( (long(i) + 1 == dest) ){
+	    makeNOP(List[i]);
+	    changes++;
+	    continue;
+	}
+	if ( isCondJump(List[i].Op()) && (long(i) + 2 == dest) &&
+	     (op_goto == List[i + 1].Op()) && !(List[i + 1].hasLabels()) ){
+	    ir_Op inverse = (op_iffalse == List[i].Op())?op_iftrue:op_iffalse;
+	    List[i].setOp(inverse);
+	    setJumpLabel(List[i], List[i + 1].Target().Id());
+	    makeNOP(List[i + 1]);
+	    changes++;
+	    continue;
+	}
+	if ( (op_goto == List[i].Op()) )
+	    for ( size_t k = i + 1; k < List.size(); k++ ){
+		if ( (List[k].hasLabels()) )
+		    break;
+		if ( (op_nop != List[k].Op()) ){
+		    makeNOP(List[k]);
+		    changes++;
+		}
+	    }
+    }
+    return changes;
+}
+
+// labels no jump refers to go; returns the number dropped
+static int
+dropUnusedLabels(ir_Rep& List)
+{
+    std::set<int> used;
+    for ( size_t i = 0; i < List.size(); i++ )
+	if ( (-1 != jumpLabel(List[i])) )
+	    used.insert(jumpLabel(List[i]));
+
+    int dropped = 0;
+    for ( size_t i = 0; i < List.size(); i++ ){
+	if ( !(List[i].hasLabels()) )
+	    continue;
+	std::vector<int> labels = List[i].Labels();
+	std::vector<int> keep;
+	for ( size_t k = 0; k < labels.size(); k++ )
+	    if ( (used.count(labels[k])) )
+		keep.push_back(labels[k]);
+	if ( (keep.size() != labels.size()) ){
+	    List[i].replaceLabels(keep);
+	    dropped += labels.size() - keep.size();
+	}
+    }
+    return dropped;
+}
+
+int
+threadJumps(ir_Rep& List)
+{
+    if ( (inSSA()) || (List.empty()) )
+	return 0;
+
+    int changes = 0;
+    for ( int n = 1; 0 != n; changes += n ){
+	removeNOPs(List);
+	n = dropUnusedLabels(List) + threadOnce(List);
+    }
+    removeNOPs(List);
+    return changes;
+}
@@ -0,0 +1,130 @@
+/********************************************************************
+* licm.cpp - loop-invariant code motion
+*
+* On SSA form: loops are the natural loops of the back edges of the
+* flow graph (a jump to a label of a block dominating it; c. cfg.h).
+* A line in a loop computing a value from operands none of which is
+* defined in the loop (or only by lines hoisted already) computes the
+* same value on every iteration: it is moved to the preheader, the one
+* block entering the loop from outside (at its end, before its jump).
+* Hoisted are arithmetic, casts, and compares, as the offsets of array
+* elements with indices the loop doesn't change (dimension sizes times
+* the index, times the width), and the compares of their bound checks;
+* the jumps to the error section stay where they are, so an error is
+* reported when (and only if) it was before. Not hoisted:
+* - lines with side effects (c. hasSideEffect(): stores, and
+*   divisions that may trap);
+* - loads of array elements (the loop may store to them).
+* Inner loops go first; what they hoist may be hoisted further out.
+* Loops without a preheader stay as they are.
+*
+********************************************************************/
+
+#include <set>
+#include <vector>
+#include <algorithm>
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "ssa.h"
+#include "opt.h"
+
+// a line computing the same value on every iteration, given the values
+// defined in the loop
+int
+isInvariant(SSA_Entry const& Line, std::set<Operand> const& Inside)
+{
+    if ( !(isValueOp(Line.Op())) || (op_phi == Line.Op()) ||
+	 !(isValue(Line.Target())) || hasSideEffect(Line) ||
+	 Line.LHS().isElem() || Line.RHS().isElem() )
+	return 0;
+
+    std::vector<Operand> uses;
+    lineUses(Line, uses);
+    for ( size_t k = 0; k < uses.size(); k++ )
+	if ( Inside.count(uses[k]) )
+	    return 0;
+    return 1;
+}
+
+// Returns the number of lines moved out of loop L
+int
+hoistLoop(ir_Rep& List, CFG const& G, int L)
+{
+    Loop_Info const& loop = G.Loops()[L];
+    int pre = G.preheader(L);
+    if ( (-1 == pre) )
+	return 0;
+
+    std::set<Operand> inside;
+    std::vector<Operand> defs;
+    std::set<int>::const_iterator iter;
+    for ( iter = loop.Blocks().begin(); iter != loop.Blocks().end(); iter++ )
+	for ( int i = G.Block(*iter).First(); i <= G.Block(*iter).Last(); i++ ){
+	    lineDefs(List[i], defs);
+	    inside.insert(defs.begin(), defs.end());
+	}
+
+    // in reverse post-order a definition comes before its uses
+    std::vector<SSA_Entry> moved;
+    std::vector<int> const& rpo = G.RPO();
+    for ( size_t k = 0; k < rpo.size(); k++ ){
+	if ( !(loop.contains(rpo[k])) )
+	    continue;
+	for ( int i = G.Block(rpo[k]).First(); i <= G.Block(rpo[k]).Last(); i++ ){
+	    SSA_Entry& line = List[i];
+	    if ( !(isInvariant(line, inside)) )
+		continue;
+	    moved.push_back(SSA_Entry(line.Op(), line.Target(), line.LHS(),
+				      line.RHS(), line.Frame()));
+	    inside.erase(line.Target());
+	    makeNOP(line);
+	}
+    }
+    if ( moved.empty() )
+	return 0;
+
+    int at = G.Block(pre).Last();
+    if ( !(isJump(List[at].Op())) )
+	at++;
+    List.insert(List.begin() + at, moved.begin(), moved.end());
+    return moved.size();
+}
+
+int
+licmSSA(ir_Rep& List)
+{
+    if ( List.empty() )
+	return 0;
+
+    // loops by the label of their header, innermost first
+    std::vector<std::pair<int, int> > order;
+    {
+	CFG g(List);
+	std::vector<Loop_Info> const& loops = g.Loops();
+	for ( size_t l = 0; l < loops.size(); l++ ){
+	    int first = g.Block(loops[l].Header()).First();
+	    order.push_back(std::make_pair(-loops[l].Depth(),
+					   List[first].Labels()[0]));
+	}
+    }
+    std::sort(order.begin(), order.end());
+
+    int moved = 0;
+    for ( size_t k = 0; k < order.size(); k++ ){
+	CFG g(List);
+	int header = g.blockOfLabel(order[k].second);
+	std::vector<Loop_Info> const& loops = g.Loops();
+	for ( size_t l = 0; l < loops.size(); l++ )
+	    if ( (loops[l].Header() == header) )
+		moved += hoistLoop(List, g, l);
+    }
+    return moved;
+}
+
+int
+hoistInvariants(ir_Rep& List)
+{
+    return withSSA(List, licmSSA);
+}
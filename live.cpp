@@ -0,0 +1,227 @@
+/********************************************************************
+* live.cpp - implementation file for live.h
+*
+********************************************************************/
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+
+int
+isValue(Operand const& O)
+{
+    return ( O.isTmp() || O.isVar() );
+}
+
+// lines computing a value into their target
+int
+isValueOp(ir_Op Op)
+{
+    switch(Op){
+    case op_copy: case op_add: case op_sub: case op_mult: case op_div:
+    case op_mod: case op_neg: case op_not: case op_scale:
+    case op_lt: case op_le: case op_gt: case op_ge: case op_eq: case op_ne:
+    case op_cast: case op_phi:
+	return 1;
+    default:
+	return 0;
+    }
+}
+
+void
+lineDefs(SSA_Entry const& Line, std::vector<Operand>& Defs)
+{
+    Defs.clear();
+    if ( isValueOp(Line.Op()) && isValue(Line.Target()) )
+	Defs.push_back(Line.Target());
+}
+
+void
+addUse(Operand const& O, std::vector<Operand>& Uses)
+{
+    if ( isValue(O) )
+	Uses.push_back(O);
+    else if ( O.isElem() && isValue(O.Offset()) )
+	Uses.push_back(O.Offset());
+}
+
+void
+lineUses(SSA_Entry const& Line, std::vector<Operand>& Uses)
+{
+    Uses.clear();
+    switch(Line.Op()){
+    case op_nop: case op_dec: case op_lea: case op_goto: case op_call:
+    case op_syscall: case op_movl: case op_pushl:
+	break;
+    case op_iffalse: case op_iftrue:
+	addUse(Line.Target(), Uses);
+	break;
+    case op_scale: // t = t * w
+	addUse(Line.Target(), Uses);
+	addUse(Line.LHS(), Uses);
+	break;
+    case op_phi:
+	for ( int i = 0; i < ir_Phis[Line.LHS().Id()].Size(); i++ )
+	    addUse(ir_Phis[Line.LHS().Id()].Arg(i), Uses);
+	break;
+    default:
+	if ( Line.Target().isElem() ) // store: the offset is read
+	    addUse(Line.Target(), Uses);
+	addUse(Line.LHS(), Uses);
+	addUse(Line.RHS(), Uses);
+	break;
+    }
+}
+
+// Everything but computing a value into a tmp or scalar variable. An
+// integer division is kept unless its divisor is a non-zero literal.
+int
+hasSideEffect(SSA_Entry const& Line)
+{
+    if ( !(isValueOp(Line.Op())) || !(isValue(Line.Target())) )
+	return 1;
+    if ( (op_div == Line.Op()) || (op_mod == Line.Op()) ){
+	Operand d = Line.RHS();
+	if ( !(d.isImm()) )
+	    return 1;
+	if ( !(ir_Consts[d.Id()].isFlt()) && (0 == ir_Consts[d.Id()].IntVal()) )
+	    return 1;
+    }
+    return 0;
+}
+
+// the values holding doubles (Flt also gets the arrays of doubles)
+void
+findFloats(ir_Rep const& List, opd_Set& Flt)
+{
+    Flt.clear();
+    for ( size_t i = 0; i < List.size(); i++ )
+	if ( (op_dec == List[i].Op()) && (tok_double == List[i].LHS().Id()) )
+	    Flt.insert(Operand(opd_Var, List[i].Target().Id()));
+
+    std::vector<Operand> defs;
+    int changed = 1;
+    while (changed){
+	changed = 0;
+	for ( size_t i = 0; i < List.size(); i++ ){
+	    SSA_Entry const& line = List[i];
+	    lineDefs(line, defs);
+	    if ( defs.empty() || Flt.count(defs[0]) )
+		continue;
+	    int flt = isFltValue(line, Flt);
+	    if ( (op_phi == line.Op()) )
+		for ( int k = 0; k < ir_Phis[line.LHS().Id()].Size(); k++ )
+		    if ( isFltOperand(ir_Phis[line.LHS().Id()].Arg(k), Flt) )
+			flt = 1;
+	    if ( flt ){
+		Flt.insert(defs[0]);
+		changed = 1;
+	    }
+	}
+    }
+}
+
+// does Line compute a double (to its target; not a phi)?
+int
+isFltValue(SSA_Entry const& Line, opd_Set const& Flt)
+{
+    switch(Line.Op()){
+    case op_copy: case op_neg:
+	return isFltOperand(Line.LHS(), Flt);
+    case op_add: case op_sub: case op_mult: case op_div:
+	return ( isFltOperand(Line.LHS(), Flt) ||
+		 isFltOperand(Line.RHS(), Flt) );
+    case op_cast:
+	return (tok_double == Line.RHS().Id());
+    default:
+	return 0;
+    }
+}
+
+int
+isFltOperand(Operand const& O, opd_Set const& Flt)
+{
+    if ( O.isImm() )
+	return ir_Consts[O.Id()].isFlt();
+    if ( O.isElem() )
+	return Flt.count(Operand(opd_Var, O.Id()));
+    return Flt.count(O);
+}
+
+// backward dataflow: in = use + (out - def), out = union of in of succs
+Liveness::Liveness(CFG const& G)
+    : cfg_(&G)
+{
+    int n = G.numBlocks();
+    ir_Rep const& list = G.List();
+    std::vector<opd_Set> use(n), def(n);
+    std::vector<Operand> defs, uses;
+
+    std::vector<opd_Set> phi_Out(n); // used by phis of successors
+    for ( int b = 0; b < n; b++ ){
+	for ( int i = G.Block(b).Last(); i >= G.Block(b).First(); i-- ){
+	    lineDefs(list[i], defs);
+	    for ( size_t k = 0; k < defs.size(); k++ ){
+		def[b].insert(defs[k]);
+		use[b].erase(defs[k]);
+	    }
+	    if ( (op_phi == list[i].Op()) ){
+		Phi_Info const& info = ir_Phis[list[i].LHS().Id()];
+		for ( int k = 0; k < info.Size(); k++ ){
+		    int pred = G.blockOfLabel(info.Pred(k));
+		    if ( (-1 != pred) && isValue(info.Arg(k)) )
+			phi_Out[pred].insert(info.Arg(k));
+		}
+		continue;
+	    }
+	    lineUses(list[i], uses);
+	    for ( size_t k = 0; k < uses.size(); k++ )
+		use[b].insert(uses[k]);
+	}
+    }
+
+    live_In_.assign(n, opd_Set());
+    live_Out_.assign(n, opd_Set());
+    std::vector<int> const& rpo = G.RPO();
+    int changed = 1;
+    while (changed){
+	changed = 0;
+	for ( int k = rpo.size() - 1; k >= 0; k-- ){
+	    int b = rpo[k];
+	    opd_Set out = phi_Out[b];
+	    std::vector<int> const& s = G.Block(b).Succs();
+	    for ( size_t j = 0; j < s.size(); j++ )
+		out.insert(live_In_[s[j]].begin(), live_In_[s[j]].end());
+
+	    opd_Set in = use[b];
+	    opd_Set::const_iterator iter;
+	    for ( iter = out.begin(); iter != out.end(); iter++ )
+		if ( (def[b].end() == def[b].find(*iter)) )
+		    in.insert(*iter);
+
+	    if ( (in != live_In_[b]) || (out != live_Out_[b]) ){
+		live_In_[b].swap(in);
+		live_Out_[b].swap(out);
+		changed = 1;
+	    }
+	}
+    }
+}
+
+opd_Set
+Liveness::liveAfter(int I) const
+{
+    int b = cfg_->blockOfLine(I);
+    opd_Set live = live_Out_[b];
+    std::vector<Operand> defs, uses;
+    for ( int i = cfg_->Block(b).Last(); i > I; i-- ){
+	lineDefs(cfg_->List()[i], defs);
+	for ( size_t k = 0; k < defs.size(); k++ )
+	    live.erase(defs[k]);
+	if ( (op_phi == cfg_->List()[i].Op()) )
+	    continue;
+	lineUses(cfg_->List()[i], uses);
+	live.insert(uses.begin(), uses.end());
+    }
+    return live;
+}
@@ -0,0 +1,50 @@
+/********************************************************************
+* live.h - def/use of IR lines, and liveness over a CFG
+*
+* Values: tmps and scalar variables. An array element is memory; only
+*         the tmp in its offset counts as a use (also when stored to).
+*         Registers (%esp) are not tracked.
+* Doubles: variables declared double, and the values computed from
+*         one (or from a double literal, or cast to double).
+* Phis:   (c. ssa.h) an argument is live out of the predecessor it
+*         comes from, not into the block of the phi.
+*
+********************************************************************/
+
+#ifndef LIVE_H_
+#define LIVE_H_
+
+#include <vector>
+#include <set>
+
+#include "ir.h"
+#include "cfg.h"
+
+typedef std::set<Operand> opd_Set;
+
+int isValue(Operand const& O);
+int isValueOp(ir_Op Op);
+void lineDefs(SSA_Entry const& Line, std::vector<Operand>& Defs);
+void lineUses(SSA_Entry const& Line, std::vector<Operand>& Uses);
+int hasSideEffect(SSA_Entry const& Line);
+void findFloats(ir_Rep const& List, opd_Set& Flt);
+int isFltOperand(Operand const& O, opd_Set const& Flt);
+int isFltValue(SSA_Entry const& Line, opd_Set const& Flt);
+
+class Liveness{
+public:
+    Liveness(CFG const& G);
+
+    opd_Set const& LiveIn(int B) const { return live_In_[B]; }
+    opd_Set const& LiveOut(int B) const { return live_Out_[B]; }
+
+    // values live right after line I (walks back from the block end)
+    opd_Set liveAfter(int I) const;
+
+private:
+    CFG const* cfg_;
+    std::vector<opd_Set> live_In_;
+    std::vector<opd_Set> live_Out_;
+};
+
+#endif
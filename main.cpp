@@ -21,6 +21,7 @@
 #include <string>
 #include <cstdarg>
 #include <cstring>
+#include <cstdio>
 
 #include "compiler.h"
 #include "driver.h"
@@ -33,6 +34,19 @@ extern int option_Debug;
 extern int option_Preproc;
 extern int option_IR;
 extern int option_OptLevel;
+extern int option_Stats;
+extern std::string option_Passes;
+extern int option_Dot;
+extern int option_Asm;
+extern int option_Run;
+extern int option_Jit;
+extern int option_GprLimit;
+extern int option_SseLimit;
+extern int option_Unroll;
+extern int option_Tile;
+extern int option_CacheSize;
+extern int option_CacheLine;
+extern int option_CacheWays;
 
 extern std::string base_Name; // from preproc.cpp
 extern std::fstream* input;
@@ -46,7 +60,20 @@ main(int argc, char* argv[])
     int opt;
     char* pArg;
     std::string err = "unexpected error while processing command line options";
-    std::string opt_Str = ":dpiO:"; 
+    std::string opt_Str = ":dpiO:P:sgSR:U:T:C:"; 
+
+    // -run, -jit are words, not clusters of options (getopt: -r -u -n)
+    for ( int i = 1; i < argc; i++ ){
+	int* word = ( (0 == strcmp("-run", argv[i])) )?&option_Run:
+	    ( (0 == strcmp("-jit", argv[i])) )?&option_Jit:0;
+	if ( (0 == word) )
+	    continue;
+	*word = 1;
+	for ( int k = i; k < argc; k++ )
+	    argv[k] = argv[k + 1];
+	argc--;
+	i--;
+    }
 
     while ( (-1 != (opt = getopt(argc, argv, opt_Str.c_str()))) ){
 	if ( ('?' == opt) || (':' == opt) ){
@@ -62,11 +89,36 @@ main(int argc, char* argv[])
 	case 'i': option_IR = 1; option_Preproc = 0; break;
 	case 'O': 
 	    pArg = optarg;
-	    if ( (0 == strcmp(pArg, "0")) )
-		option_OptLevel = 1;
+	    if ( (1 == strlen(pArg)) && ('0' <= *pArg) && ('3' >= *pArg) )
+		option_OptLevel = *pArg - '0';
 	    else
 		errExit(0, "invalid optimization level %s", pArg);
 	    break;
+	case 'P': option_Passes = optarg; break;
+	case 's': option_Stats = 1; break;
+	case 'g': option_Dot = 1; break;
+	case 'S': option_Asm = 1; break;
+	case 'R':
+	    if ( (2 != sscanf(optarg, "%d,%d", &option_GprLimit,
+			      &option_SseLimit)) )
+		errExit(0, "invalid register limits %s (-R gprs,sses)", optarg);
+	    break;
+	case 'U':
+	    if ( (1 != sscanf(optarg, "%d", &option_Unroll)) ||
+		 (1 > option_Unroll) )
+		errExit(0, "invalid unroll factor %s", optarg);
+	    break;
+	case 'T':
+	    if ( (1 != sscanf(optarg, "%d", &option_Tile)) ||
+		 (1 > option_Tile) )
+		errExit(0, "invalid tile size %s", optarg);
+	    break;
+	case 'C':
+	    if ( (3 != sscanf(optarg, "%d,%d,%d", &option_CacheSize,
+			      &option_CacheLine, &option_CacheWays)) ||
+		 (1 > option_CacheSize) )
+		errExit(0, "invalid cache %s (-C bytes,line,ways)", optarg);
+	    break;
 	default: 
 	    errExit(0, err.c_str());
 	    break;
@@ -0,0 +1,432 @@
+/********************************************************************
+* memory.cpp - redundant loads, and dead stores of array elements
+*
+* On SSA form, after value numbering (an offset computed twice is then
+* one tmp): the offset of an element is a literal, or k * r + c for a
+* tmp r, followed through copies, and + - * by literals. Two elements
+* of an array are the same if their offsets are; they are distinct if
+* the offsets are literals, or in terms of one r and k, and c differs
+* by an element at least; else either may be the other. Elements of
+* different arrays are distinct.
+* Loads:  along an extended basic block (a block with one predecessor
+*         goes on from the state its predecessor ends with), an element
+*         stored to, or loaded into a tmp, is read from that value
+*         until a store to an element that may be it:
+*             (-$4)a = t1; t2 = (-$4)a + 1  ->  ...; t2 = t1 + 1
+*         A value computed into an element (a[i]++ makes (-t)a =
+*         (-t)a + 1) is computed into a new tmp, then stored, once a
+*         load reads it. A value of the other type than the array
+*         isn't read (the store converts it).
+* Stores: a store to an element stored to again later in its block,
+*         with no load in between that may read it, goes (unless it
+*         divides, and may trap).
+* Scalar variables are values in SSA form; sccp, copies and dce do the
+* same for them. Lines removed are turned into NOPs (c. sccp.cpp).
+*
+********************************************************************/
+
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "ssa.h"
+#include "opt.h"
+
+#define MEMORY_CHAIN 16 // definitions followed for an offset, at most
+
+// an element: Scale * Root + Const bytes into Base (no Root: a literal)
+class Mem_Addr{
+public:
+Mem_Addr(int Base = -1, Operand Root = Operand(), long Scale = 0,
+	 long Const = 0)
+    : base_(Base), root_(Root), scale_(Scale), const_(Const) {}
+
+    int Base(void) const { return base_; }
+    Operand Root(void) const { return root_; }
+    long Scale(void) const { return scale_; }
+    long Const(void) const { return const_; }
+
+    bool operator<(Mem_Addr const& r) const
+    {
+	if ( (base_ != r.base_) ) return (base_ < r.base_);
+	if ( (root_ != r.root_) ) return (root_ < r.root_);
+	if ( (scale_ != r.scale_) ) return (scale_ < r.scale_);
+	return (const_ < r.const_);
+    }
+
+private:
+    int base_;
+    Operand root_;
+    long scale_;
+    long const_;
+};
+
+// what an element holds: a value, or (Line != -1) what Line computes
+class Mem_Val{
+public:
+Mem_Val(Operand V = Operand(), int Line = -1)
+    : val_(V), line_(Line) {}
+
+    Operand Val(void) const { return val_; }
+    int Line(void) const { return line_; }
+
+private:
+    Operand val_;
+    int line_;
+};
+
+typedef std::map<Mem_Addr, Mem_Val> mem_State;
+
+class Mem_Pass{
+public:
+    Mem_Pass(ir_Rep& List);
+
+    int forwardLoads(void);
+    int removeStores(void);
+
+private:
+    void findDefs(void);
+    int intImm(Operand const& O, long& V) const;
+    Mem_Addr addrOf(Operand const& E) const;
+    int sameElem(Mem_Addr const& A, Mem_Addr const& B) const;
+    void kill(mem_State& State, Mem_Addr const& A, int Whole = 0) const;
+    int memBarrier(SSA_Entry const& Line) const;
+    Operand loadOf(Operand const& O, mem_State const& State);
+    void splitStores(void);
+
+    ir_Rep& list_;
+    opd_Set flt_;
+    std::map<Operand, int> defs_; // SSA value -> its line
+    std::map<int, Operand> split_; // store line -> tmp computed first
+};
+
+Mem_Pass::Mem_Pass(ir_Rep& List)
+    : list_(List)
+{
+    findFloats(list_, flt_);
+}
+
+void
+Mem_Pass::findDefs(void)
+{
+    defs_.clear();
+    std::vector<Operand> defs;
+    for ( size_t i = 0; i < list_.size(); i++ ){
+	lineDefs(list_[i], defs);
+	for ( size_t k = 0; k < defs.size(); k++ )
+	    defs_[defs[k]] = i;
+    }
+}
+
+int
+Mem_Pass::intImm(Operand const& O, long& V) const
+{
+    if ( !(O.isImm()) || ir_Consts[O.Id()].isFlt() )
+	return 0;
+    V = ir_Consts[O.Id()].IntVal();
+    return 1;
+}
+
+Mem_Addr
+Mem_Pass::addrOf(Operand const& E) const
+{
+    Operand root = E.Offset();
+    long scale = 1, c = 0, v;
+    if ( intImm(root, v) )
+	return Mem_Addr(E.Id(), Operand(), 0, v);
+
+    for ( int k = 0; k < MEMORY_CHAIN; k++ ){
+	std::map<Operand, int>::const_iterator iter = defs_.find(root);
+	if ( (defs_.end() == iter) )
+	    break;
+	SSA_Entry const& line = list_[iter->second];
+	Operand l = line.LHS(), r = line.RHS(), next;
+	long add = 0, mult = 1;
+	switch(line.Op()){
+	case op_copy:
+	    if ( intImm(l, v) )
+		return Mem_Addr(E.Id(), Operand(), 0, c + scale * v);
+	    next = l;
+	    break;
+	case op_add:
+	    if ( intImm(r, add) )
+		next = l;
+	    else if ( intImm(l, add) )
+		next = r;
+	    break;
+	case op_sub:
+	    if ( intImm(r, add) ){
+		next = l;
+		add = -add;
+	    }
+	    break;
+	case op_mult:
+	    if ( intImm(r, mult) )
+		next = l;
+	    else if ( intImm(l, mult) )
+		next = r;
+	    break;
+	default:
+	    break;
+	}
+	if ( !(isValue(next)) )
+	    break;
+	root = next;
+	c += scale * add;
+	scale *= mult;
+    }
+
+    return Mem_Addr(E.Id(), root, scale, c);
+}
+
+// 1: A and B are one element, 0: they are distinct, -1: may be one
+int
+Mem_Pass::sameElem(Mem_Addr const& A, Mem_Addr const& B) const
+{
+    if ( (A.Base() != B.Base()) )
+	return 0;
+    if ( (A.Root() != B.Root()) || (A.Scale() != B.Scale()) )
+	return -1;
+    if ( (A.Const() == B.Const()) )
+	return 1;
+    long width = ( flt_.count(Operand(opd_Var, A.Base())) )?8:4;
+    return ( (labs(A.Const() - B.Const()) >= width) )?0:-1;
+}
+
+// forget the elements a store to A may change (all of its array if
+// Whole)
+void
+Mem_Pass::kill(mem_State& State, Mem_Addr const& A, int Whole) const
+{
+    mem_State::iterator iter;
+    for ( iter = State.begin(); iter != State.end(); ){
+	if ( (Whole) && (A.Base() == iter->first.Base()) )
+	    State.erase(iter++);
+	else if ( (0 != sameElem(A, iter->first)) )
+	    State.erase(iter++);
+	else
+	    iter++;
+    }
+}
+
+// does Line touch memory other than by an element operand? (-1: all
+// of it; else the array, as a variable id)
+int
+Mem_Pass::memBarrier(SSA_Entry const& Line) const
+{
+    switch(Line.Op()){
+    case op_call: case op_syscall:
+	return -1;
+    case op_dec: case op_lea: // a new array
+	return Line.Target().Id();
+    default:
+	if ( isVectorOp(Line.Op()) )
+	    return -1;
+	return -2;
+    }
+}
+
+// O, or the value the element it names holds
+Operand
+Mem_Pass::loadOf(Operand const& O, mem_State const& State)
+{
+    if ( !(O.isElem()) )
+	return O;
+    mem_State::const_iterator iter = State.find(addrOf(O));
+    if ( (State.end() == iter) )
+	return O;
+    if ( (-1 == iter->second.Line()) )
+	return iter->second.Val();
+    int line = iter->second.Line();
+    if ( !(split_.count(line)) )
+	split_[line] = makeTmpOperand();
+    return split_[line];
+}
+
+// the blocks of Blocks reached (lines sccp removed are NOPs, so a block
+// it resolved a jump away from still falls through)
+static void
+reachedOf(CFG const& G, std::vector<int> const& Blocks, std::vector<int>& Out)
+{
+    Out.clear();
+    for ( size_t k = 0; k < Blocks.size(); k++ )
+	if ( G.isReachable(Blocks[k]) )
+	    Out.push_back(Blocks[k]);
+}
+
+int
+Mem_Pass::forwardLoads(void)
+{
+    findDefs();
+    CFG g(list_);
+    std::vector<int> const& rpo = g.RPO();
+    std::vector<int> rpo_No(g.numBlocks(), -1);
+    for ( size_t k = 0; k < rpo.size(); k++ )
+	rpo_No[rpo[k]] = k;
+
+    int changes = 0;
+    std::vector<mem_State> out(g.numBlocks());
+    for ( size_t k = 0; k < rpo.size(); k++ ){
+	int b = rpo[k];
+	std::vector<int> preds;
+	reachedOf(g, g.Block(b).Preds(), preds);
+	mem_State state;
+	if ( (1 == preds.size()) && (rpo_No[preds[0]] < rpo_No[b]) )
+	    state = out[preds[0]];
+
+	for ( int i = g.Block(b).First(); i <= g.Block(b).Last(); i++ ){
+	    SSA_Entry& line = list_[i];
+	    int barrier = memBarrier(line);
+	    if ( (-1 == barrier) ){
+		state.clear();
+		continue;
+	    }
+	    if ( (-2 != barrier) ){
+		kill(state, Mem_Addr(barrier), 1);
+		continue;
+	    }
+
+	    Operand l = loadOf(line.LHS(), state);
+	    Operand r = loadOf(line.RHS(), state);
+	    changes += (l != line.LHS()) + (r != line.RHS());
+	    line.setLHS(l);
+	    line.setRHS(r);
+	    Operand t = line.Target();
+	    if ( isCondJump(line.Op()) ){
+		line.setTarget(loadOf(t, state));
+		changes += (t != line.Target());
+		continue;
+	    }
+	    if ( !(isValueOp(line.Op())) || (op_phi == line.Op()) )
+		continue;
+
+	    // a load into a tmp: the element holds its value
+	    if ( (op_copy == line.Op()) && isValue(t) && line.LHS().isElem() ){
+		state[addrOf(line.LHS())] = Mem_Val(t);
+		continue;
+	    }
+	    if ( !(t.isElem()) )
+		continue;
+	    Mem_Addr a = addrOf(t);
+	    kill(state, a);
+	    int flt = flt_.count(Operand(opd_Var, a.Base()));
+	    if ( (isFltValue(line, flt_) != flt) )
+		continue;
+	    if ( (op_copy == line.Op()) && ( isValue(l) || l.isImm() ) )
+		state[a] = Mem_Val(l);
+	    else
+		state[a] = Mem_Val(Operand(), i);
+	}
+	out[b].swap(state);
+    }
+    splitStores();
+
+    return changes;
+}
+
+// the stores a load reads from compute into their tmp first
+void
+Mem_Pass::splitStores(void)
+{
+    if ( split_.empty() )
+	return;
+    ir_Rep out;
+    for ( size_t i = 0; i < list_.size(); i++ ){
+	std::map<int, Operand>::const_iterator iter = split_.find(i);
+	if ( (split_.end() == iter) ){
+	    out.push_back(list_[i]);
+	    continue;
+	}
+	SSA_Entry line = list_[i];
+	Operand elem = line.Target();
+	line.setTarget(iter->second);
+	out.push_back(line);
+	out.push_back(SSA_Entry(op_copy, elem, iter->second, Operand(),
+				line.Frame()));
+    }
+    list_.swap(out);
+    split_.clear();
+}
+
+int
+Mem_Pass::removeStores(void)
+{
+    findDefs();
+    CFG g(list_);
+    std::vector<int> const& rpo = g.RPO();
+    std::vector<int> rpo_No(g.numBlocks(), -1);
+    for ( size_t k = 0; k < rpo.size(); k++ )
+	rpo_No[rpo[k]] = k;
+
+    // backwards, a block with one successor, of which it is the only
+    // predecessor, goes on from the state the successor starts with
+    int removed = 0;
+    std::vector<std::vector<Mem_Addr> > in(g.numBlocks());
+    for ( int n = rpo.size() - 1; n >= 0; n-- ){
+	int b = rpo[n];
+	std::vector<int> succs, preds;
+	reachedOf(g, g.Block(b).Succs(), succs);
+	if ( (1 == succs.size()) )
+	    reachedOf(g, g.Block(succs[0]).Preds(), preds);
+	std::vector<Mem_Addr> later; // stored to further down
+	if ( (1 == preds.size()) && (rpo_No[succs[0]] > n) &&
+	     g.Block(b).ExitTargets().empty() )
+	    later = in[succs[0]];
+	for ( int i = g.Block(b).Last(); i >= g.Block(b).First(); i-- ){
+	    SSA_Entry& line = list_[i];
+	    int barrier = memBarrier(line);
+	    if ( (-2 != barrier) ){
+		later.clear();
+		continue;
+	    }
+	    Operand t = line.Target();
+	    if ( isValueOp(line.Op()) && t.isElem() ){
+		Mem_Addr a = addrOf(t);
+		size_t k = 0;
+		while ( (k < later.size()) && (1 != sameElem(a, later[k])) )
+		    k++;
+		if ( (k < later.size()) && (op_div != line.Op()) &&
+		     (op_mod != line.Op()) ){
+		    makeNOP(line);
+		    removed++;
+		    continue;
+		}
+		later.push_back(a);
+	    }
+
+	    // loads: the stores further down no longer hide what they read
+	    Operand reads[3] = { line.LHS(), line.RHS(),
+				 ( isCondJump(line.Op()) )?t:Operand() };
+	    for ( int j = 0; j < 3; j++ ){
+		if ( !(reads[j].isElem()) )
+		    continue;
+		Mem_Addr a = addrOf(reads[j]);
+		for ( size_t k = 0; k < later.size(); )
+		    if ( (0 != sameElem(a, later[k])) )
+			later.erase(later.begin() + k);
+		    else
+			k++;
+	    }
+	}
+	in[b].swap(later);
+    }
+
+    return removed;
+}
+
+int
+memorySSA(ir_Rep& List)
+{
+    Mem_Pass pass(List);
+    int changes = pass.forwardLoads();
+    return changes + pass.removeStores();
+}
+
+int
+forwardMemory(ir_Rep& List)
+{
+    return withSSA(List, memorySSA);
+}
@@ -0,0 +1,59 @@
+/********************************************************************
+* nest.h - perfect loop nests on the AST, as interchange.cpp finds them
+*
+* The for loops interchange.cpp works on (c. the shape described
+* there), and what it asks of the statements in them: references,
+* subscripts affine in a loop variable, the strides of an access, and
+* whether the loops of a nest may run in another order. Shared with
+* tile.cpp, which reorders the iterations of a nest as well.
+*
+********************************************************************/
+
+#ifndef NEST_H_
+#define NEST_H_
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+
+#define INTERCHANGE_LINE 8 // elements per cache line (cost of a stride)
+
+// a for loop as above: Var = ...; Var REL ...; Var += Step
+class Nest_Loop{
+public:
+Nest_Loop(For_AST* F = 0, IdExpr_AST* V = 0, long S = 0)
+    : for_(F), var_(V), step_(S) {}
+
+    For_AST* For(void) const { return for_; }
+    IdExpr_AST* Var(void) const { return var_; }
+    long Step(void) const { return step_; }
+    std::string Name(void) const { return var_->Op().Lex(); }
+    IterExprList_AST* List(void) const
+    {
+	return dynamic_cast<IterExprList_AST*>(for_->LChild());
+    }
+
+private:
+    For_AST* for_;
+    IdExpr_AST* var_;
+    long step_;
+};
+
+IdExpr_AST* scalarOf(Node_AST* N);
+void collectRefs(Node_AST* N, std::set<IdExpr_AST*>& Vars,
+		 std::set<ArrayVarDecl_AST*>& Arrays);
+int mentions(Node_AST* N, IdExpr_AST* V);
+int isPure(Node_AST* N);
+int intLiteral(Node_AST* N, long& Value);
+int headerOf(For_AST* F, Nest_Loop& L);
+void collectStmts(Node_AST* N, std::vector<Node_AST*>& Stmts);
+int hasLoop(Node_AST* N);
+int coefOf(Node_AST* E, IdExpr_AST* V, long& C);
+void collectElems(Node_AST* N, std::vector<ArrayIdExpr_AST*>& Elems);
+std::string strideOf(ArrayIdExpr_AST* E, Nest_Loop const& L, long& Cost);
+std::string whyNotPermuted(std::vector<Nest_Loop> const& Loops,
+			   Node_AST* Root, std::vector<Node_AST*> const& Body);
+
+#endif
@@ -0,0 +1,278 @@
+/********************************************************************
+* opt.cpp - pass manager, and optimization passes over the IR
+*
+********************************************************************/
+
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sstream>
+#include <iostream>
+
+#include "ir.h"
+#include "opt.h"
+#include "ssa.h"
+#include "regalloc.h"
+
+void errExit(int pError, const char* msg, ...);
+
+// all passes available by name (-P), in no particular order
+class Pass_Entry{
+public:
+Pass_Entry(const char* N, ir_Pass P, const char* D)
+    : name_(N), pass_(P), descr_(D) {}
+
+    std::string Name(void) const { return name_; }
+    ir_Pass Pass(void) const { return pass_; }
+    std::string Descr(void) const { return descr_; }
+
+private:
+    const char* name_;
+    ir_Pass pass_;
+    const char* descr_;
+};
+
+static const Pass_Entry pass_Table[] = {
+    Pass_Entry("nops", removeNOPs, "remove NOPs, moving labels down"),
+    Pass_Entry("ssa", toSSA, "into SSA form (pruned; phis, renaming)"),
+    Pass_Entry("unssa", fromSSA, "out of SSA form (phi copies, coalescing)"),
+    Pass_Entry("sccp", propagateConstants,
+	       "sparse conditional constant propagation, and folding"),
+    Pass_Entry("unreach", removeUnreachable, "remove unreachable blocks"),
+    Pass_Entry("dce", removeDeadCode, "remove lines computing dead values"),
+    Pass_Entry("algebra", simplifyAlgebra,
+	       "algebraic identities, literals reassociated and to the right"),
+    Pass_Entry("gvn", numberValues,
+	       "global value numbering (redundant computations, copies)"),
+    Pass_Entry("memory", forwardMemory,
+	       "redundant loads, and dead stores, of array elements"),
+    Pass_Entry("ranges", removeRangeChecks,
+	       "value ranges; remove branches they decide (bound checks)"),
+    Pass_Entry("licm", hoistInvariants,
+	       "loop-invariant code motion (to the loop preheader)"),
+    Pass_Entry("ivsr", reduceStrength,
+	       "strength reduction of induction variables, test replacement"),
+    Pass_Entry("version", versionLoops,
+	       "loop versioning: bound checks hoisted to loop entry"),
+    Pass_Entry("copies", propagateCopies,
+	       "copy propagation (uses of a copy read what it copies)"),
+    Pass_Entry("coalesce", coalesceTmps,
+	       "tmps share names where their live ranges don't interfere"),
+    Pass_Entry("rotate", rotateLoops,
+	       "loop rotation: the loop test copied to the bottom"),
+    Pass_Entry("unroll", unrollLoops,
+	       "loop unrolling (full for small constant trip counts; -U)"),
+    Pass_Entry("vectorize", vectorizeLoops,
+	       "loop vectorization (unit-stride element ops, scalar rest)"),
+    Pass_Entry("scalar", replaceArrays,
+	       "scalar replacement of small arrays (literal subscripts)"),
+    Pass_Entry("jumps", threadJumps,
+	       "jump threading, branch simplification, unused labels"),
+    Pass_Entry("regalloc", allocateRegisters,
+	       "linear-scan register assignment (x86-64), spills to frame"),
+};
+static const int no_Passes = sizeof(pass_Table) / sizeof(pass_Table[0]);
+
+// Pipelines:
+// -O 0: remove NOPs
+// -O 1: and unreachable blocks; constant propagation, algebraic
+//       simplification, copy propagation, and dead code elimination
+//       (in SSA form); tmps are coalesced at the end, then jumps
+//       threaded
+// -O 2: -O 1, with value numbering after constant propagation, and
+//       range analysis removing bound checks (and the blocks reporting
+//       them) after that; then loads of elements read the values
+//       stored, and stores written over go; loop-invariant code motion,
+//       and strength reduction of induction variables (the offsets it
+//       makes simplified again); loops are rotated after coalescing
+// -O 3: -O 2, with loops unrolled first (before SSA form), constants
+//       propagated into the copies, and small arrays then subscripted
+//       by literals only replaced by tmps; then loops are versioned to
+//       hoist the bound checks left, vectorized, and unrolled again
+//       (those without bound checks now)
+void
+buildPipeline(Pass_Manager& PM, int Level)
+{
+    PM.addPassByName("nops");
+    if ( (1 > Level) )
+	return;
+
+    PM.addPassByName("unreach");
+    if ( (3 <= Level) ){
+	PM.addPassByName("unroll");
+	PM.addPassByName("sccp");
+	PM.addPassByName("scalar");
+    }
+    PM.addPassByName("ssa");
+    PM.addPassByName("sccp");
+    PM.addPassByName("algebra");
+    PM.addPassByName("copies");
+    if ( (2 <= Level) ){
+	PM.addPassByName("gvn");
+	PM.addPassByName("ranges");
+	PM.addPassByName("unreach");
+	PM.addPassByName("memory");
+	PM.addPassByName("licm");
+	PM.addPassByName("ivsr");
+	PM.addPassByName("sccp"); // the values of the new ones on entry
+	PM.addPassByName("algebra");
+    }
+    PM.addPassByName("dce");
+    PM.addPassByName("unssa");
+    if ( (3 <= Level) ){
+	PM.addPassByName("version");
+	PM.addPassByName("unreach");
+	PM.addPassByName("dce");
+	PM.addPassByName("vectorize");
+	PM.addPassByName("unroll");
+    }
+    PM.addPassByName("coalesce");
+    if ( (2 <= Level) )
+	PM.addPassByName("rotate");
+    PM.addPassByName("jumps");
+}
+
+// List: comma separated pass names, run in that order
+int
+buildPassList(Pass_Manager& PM, std::string List)
+{
+    std::istringstream in(List);
+    std::string name;
+    while ( std::getline(in, name, ',') ){
+	if ( ("" == name) ) continue;
+	if ( (-1 == PM.addPassByName(name)) )
+	    return -1;
+    }
+
+    return 0;
+}
+
+void
+printPassTable(void)
+{
+    for ( int i = 0; i < no_Passes; i++ ){
+	std::cerr.width(10);
+	std::cerr << pass_Table[i].Name() << " - " << pass_Table[i].Descr();
+	std::cerr << "\n";
+    }
+}
+
+void
+Pass_Manager::addPass(std::string Name, ir_Pass P)
+{
+    names_.push_back(Name);
+    passes_.push_back(P);
+}
+
+int
+Pass_Manager::addPassByName(std::string Name)
+{
+    for ( int i = 0; i < no_Passes; i++ )
+	if ( (pass_Table[i].Name() == Name) ){
+	    addPass(Name, pass_Table[i].Pass());
+	    return 0;
+	}
+
+    return -1;
+}
+
+// peak resident set size so far, in KB
+static long
+peakRss(void)
+{
+    struct rusage usage;
+    if ( (-1 == getrusage(RUSAGE_SELF, &usage)) )
+	return 0;
+    return usage.ru_maxrss;
+}
+
+void
+Pass_Manager::run(ir_Rep& List)
+{
+    struct timeval t_Start, t_End;
+
+    for ( size_t i = 0; i < passes_.size(); i++ ){
+	int before = List.size();
+	gettimeofday(&t_Start, 0);
+	int changes = passes_[i](List);
+	gettimeofday(&t_End, 0);
+	compactLabelLinks(List); // drop the links of removed lines
+	long usec = (t_End.tv_sec - t_Start.tv_sec) * 1000000L +
+	    (t_End.tv_usec - t_Start.tv_usec);
+	Pass_Stats s(names_[i], before, List.size(), changes, usec, peakRss());
+	stats_.push_back(s);
+    }
+}
+
+// to std::cerr, so that IR output (and -i files) stay untouched
+void
+Pass_Manager::printStats(void) const
+{
+    std::ostringstream tmp_Stream;
+    tmp_Stream << "---------------------------------------------------";
+    tmp_Stream << "----------------\n";
+    tmp_Stream.width(10); tmp_Stream << "pass";
+    tmp_Stream.width(8); tmp_Stream << "before";
+    tmp_Stream.width(8); tmp_Stream << "after";
+    tmp_Stream.width(9); tmp_Stream << "changes";
+    tmp_Stream.width(10); tmp_Stream << "IR bytes";
+    tmp_Stream.width(10); tmp_Stream << "usec";
+    tmp_Stream.width(12); tmp_Stream << "max RSS KB";
+    tmp_Stream << "\n";
+
+    std::vector<Pass_Stats>::const_iterator iter;
+    for ( iter = stats_.begin(); iter != stats_.end(); iter++ ){
+	tmp_Stream.width(10); tmp_Stream << iter->Name();
+	tmp_Stream.width(8); tmp_Stream << iter->Before();
+	tmp_Stream.width(8); tmp_Stream << iter->After();
+	tmp_Stream.width(9); tmp_Stream << iter->Changes();
+	tmp_Stream.width(10); tmp_Stream << iter->After() * sizeof(SSA_Entry);
+	tmp_Stream.width(10); tmp_Stream << iter->Usec();
+	tmp_Stream.width(12); tmp_Stream << iter->Rss();
+	tmp_Stream << "\n";
+    }
+    tmp_Stream << "---------------------------------------------------";
+    tmp_Stream << "----------------\n";
+
+    std::cerr << tmp_Stream.str();
+}
+
+/***************************************
+* Passes
+***************************************/
+// Remove NOPs in place. Labels of a NOP move down to the next line that
+// is not a NOP; a trailing NOP stays (something has to carry its labels).
+int
+removeNOPs(ir_Rep& List)
+{
+    if ( List.empty() )
+	return 0;
+
+    size_t out = 0;
+    std::vector<int> labels;
+    for ( size_t i = 0; i < List.size(); i++ ){
+	SSA_Entry line = List[i];
+	if ( (op_nop != line.Op()) ){
+	    if ( !(labels.empty()) ){
+		std::vector<int> mine = line.Labels();
+		mine.insert(mine.end(), labels.begin(), labels.end());
+		line.replaceLabels(mine);
+		labels.clear();
+	    }
+	    List[out++] = line;
+	}
+	else if ( line.hasLabels() ){
+	    std::vector<int> l = line.Labels();
+	    labels.insert(labels.end(), l.begin(), l.end());
+	}
+    }
+
+    if ( (op_nop == List.back().Op()) ){ // carries all labels pending
+	SSA_Entry line = List.back();
+	line.replaceLabels(labels);
+	List[out++] = line;
+    }
+
+    int removed = List.size() - out;
+    List.resize(out);
+    return removed;
+}
@@ -0,0 +1,92 @@
+/********************************************************************
+* opt.h - IR optimization passes, and the pass manager running them
+*
+* A pass works in place on an ir_Rep, and returns the number of
+* changes it made (0: nothing to do). Passes are registered by name
+* in the pass table (opt.cpp); -O <n> selects a pipeline, -P <list>
+* an explicit sequence, and -s prints per-pass statistics.
+*
+********************************************************************/
+
+#ifndef OPT_H_
+#define OPT_H_
+
+#include <string>
+#include <vector>
+
+#include "ir.h"
+
+typedef int (*ir_Pass)(ir_Rep&);
+
+// statistics of one run of one pass
+class Pass_Stats{
+public:
+Pass_Stats(std::string Name = "", int Before = 0, int After = 0,
+	   int Changes = 0, long Usec = 0, long Rss = 0)
+    : name_(Name), before_(Before), after_(After), changes_(Changes),
+	usec_(Usec), rss_(Rss) {}
+
+    std::string Name(void) const { return name_; }
+    int Before(void) const { return before_; }
+    int After(void) const { return after_; }
+    int Changes(void) const { return changes_; }
+    long Usec(void) const { return usec_; }
+    long Rss(void) const { return rss_; }
+
+private:
+    std::string name_;
+    int before_;   // # lines
+    int after_;
+    int changes_;  // as reported by the pass
+    long usec_;    // wall time
+    long rss_;     // peak resident set after the pass (KB)
+};
+
+class Pass_Manager{
+public:
+    Pass_Manager(void) {}
+
+    void addPass(std::string Name, ir_Pass P);
+    int addPassByName(std::string Name);
+    void run(ir_Rep& List);
+    void printStats(void) const;
+
+    std::vector<std::string> Names(void) const { return names_; }
+
+private:
+    std::vector<std::string> names_;
+    std::vector<ir_Pass> passes_;
+    std::vector<Pass_Stats> stats_;
+};
+
+void buildPipeline(Pass_Manager& PM, int Level);
+int buildPassList(Pass_Manager& PM, std::string List);
+void printPassTable(void);
+void makeNOP(SSA_Entry& Line); // dce.cpp
+
+// passes
+int removeNOPs(ir_Rep& List);
+int propagateConstants(ir_Rep& List); // sccp.cpp
+int removeUnreachable(ir_Rep& List); // dce.cpp
+int removeDeadCode(ir_Rep& List);
+int simplifyAlgebra(ir_Rep& List); // algebra.cpp
+int numberValues(ir_Rep& List); // gvn.cpp
+int forwardMemory(ir_Rep& List); // memory.cpp
+int removeRangeChecks(ir_Rep& List); // ranges.cpp
+int hoistInvariants(ir_Rep& List); // licm.cpp
+int reduceStrength(ir_Rep& List); // ivsr.cpp
+int versionLoops(ir_Rep& List); // version.cpp
+int propagateCopies(ir_Rep& List); // copies.cpp
+int coalesceTmps(ir_Rep& List);
+int threadJumps(ir_Rep& List); // jumps.cpp
+int rotateLoops(ir_Rep& List); // rotate.cpp
+int unrollLoops(ir_Rep& List); // unroll.cpp
+int vectorizeLoops(ir_Rep& List); // vectorize.cpp
+int replaceArrays(ir_Rep& List); // scalar.cpp
+
+// on the AST, before the visitor makes the IR
+class Node_AST;
+int interchangeLoops(Node_AST* Root); // interchange.cpp
+int tileLoops(Node_AST* Root); // tile.cpp
+
+#endif
@@ -0,0 +1,418 @@
+/********************************************************************
+* ranges.cpp - value ranges of ints, and the branches they decide
+*
+* On SSA form: each int value gets a range [lo, hi], found by
+* iterating over the blocks in reverse post-order until nothing
+* changes (a phi that keeps growing is widened to the int limits, and
+* narrowed again after). The range of a value where it is used is
+* further restricted by the branch conditions on the way there: for
+* each edge P -> X with X dominating the use and P its only
+* predecessor, the comparison P branches on holds (or fails).
+* A conditional jump whose condition is known then goes (or becomes a
+* goto). This removes array bound checks (c. compAndJumpFalse()) on
+* indices that are known to be in range: the induction variable of a
+* loop bounded by the dimension, or an index tested before already.
+* Doubles have no range.
+*
+********************************************************************/
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "ssa.h"
+#include "fold.h"
+#include "opt.h"
+
+#define RANGE_WIDEN 3   // updates of a phi before it is widened
+#define RANGE_PASSES 50 // bound on the passes over all blocks
+
+class Val_Range{
+public:
+Val_Range(long Lo = 1, long Hi = 0, int Flt = 0) // default: empty
+    : lo_(Lo), hi_(Hi), flt_(Flt) {}
+
+    static Val_Range full(int Flt = 0)
+    {
+	return Val_Range(intMin(), intMax(), Flt);
+    }
+
+    long Lo(void) const { return lo_; }
+    long Hi(void) const { return hi_; }
+    int isFlt(void) const { return flt_; }
+    int isEmpty(void) const { return (lo_ > hi_); }
+    int isFull(void) const
+    {
+	return ( (intMin() == lo_) && (intMax() == hi_) );
+    }
+    int isConst(void) const { return ( !(flt_) && (lo_ == hi_) ); }
+    int has(long V) const { return ( (lo_ <= V) && (V <= hi_) ); }
+
+    // int bounds beyond those of an int overflow: any value then
+    Val_Range clamped(void) const
+    {
+	if ( isEmpty() ) return *this;
+	if ( (lo_ < intMin()) || (hi_ > intMax()) ) return full(flt_);
+	return *this;
+    }
+    Val_Range join(Val_Range const& r) const
+    {
+	if ( isEmpty() ) return r;
+	if ( r.isEmpty() ) return *this;
+	return Val_Range(std::min(lo_, r.lo_), std::max(hi_, r.hi_),
+			 flt_ || r.flt_);
+    }
+    Val_Range meet(Val_Range const& r) const
+    {
+	if ( flt_ ) return *this;
+	return Val_Range(std::max(lo_, r.lo_), std::min(hi_, r.hi_));
+    }
+
+    bool operator==(Val_Range const& r) const
+    {
+	if ( isEmpty() && r.isEmpty() ) return true;
+	return ( (lo_ == r.lo_) && (hi_ == r.hi_) && (flt_ == r.flt_) );
+    }
+    bool operator!=(Val_Range const& r) const { return !(*this == r); }
+
+private:
+    long lo_;
+    long hi_;
+    int flt_; // a double: no bounds known
+};
+
+class Range_Solver{
+public:
+    Range_Solver(ir_Rep& List);
+
+    void solve(void);
+    int rewrite(void);
+
+private:
+    Val_Range rangeAt(Operand const& O, int B, int Depth = 0) const;
+    Val_Range restrict(Operand const& V, Val_Range R, int P, int X,
+		       int Depth) const;
+    Val_Range evalLine(int I) const;
+    int pass(int Narrow);
+
+    ir_Rep& list_;
+    CFG cfg_;
+    std::map<Operand, Val_Range> vals_;
+    std::map<Operand, int> def_Line_;
+    std::map<Operand, int> updates_;
+    std::map<int, int> flt_Vars_; // declared double
+};
+
+Range_Solver::Range_Solver(ir_Rep& List)
+    : list_(List), cfg_(List)
+{
+    std::vector<Operand> defs;
+    for ( size_t i = 0; i < list_.size(); i++ ){
+	SSA_Entry const& line = list_[i];
+	lineDefs(line, defs);
+	if ( !(defs.empty()) )
+	    def_Line_[defs[0]] = i;
+	if ( (op_dec == line.Op()) && (tok_double == line.LHS().Id()) )
+	    flt_Vars_[line.Target().Id()] = 1;
+    }
+}
+
+// the range of O where block B starts (or anywhere in it, after its
+// definition), restricted by the conditions B is reached under
+Val_Range
+Range_Solver::rangeAt(Operand const& O, int B, int Depth) const
+{
+    if ( O.isImm() ){
+	Const_Val c = constOf(O);
+	return ( (c.isFlt()) )?Val_Range::full(1):
+	    Val_Range(c.IntVal(), c.IntVal());
+    }
+    if ( O.isElem() )
+	return Val_Range::full(flt_Vars_.count(O.Id()));
+    if ( !(isValue(O)) )
+	return Val_Range::full();
+
+    Val_Range r;
+    std::map<Operand, Val_Range>::const_iterator iter = vals_.find(O);
+    if ( (vals_.end() != iter) )
+	r = iter->second;
+    else if ( !(def_Line_.count(O)) ) // from outside
+	r = Val_Range::full(O.isVar() && flt_Vars_.count(O.Id()));
+    if ( r.isEmpty() || r.isFlt() || (4 < Depth) )
+	return r;
+
+    for ( int x = B; (0 != x) && (-1 != cfg_.Block(x).Idom()); ){
+	int p = cfg_.Block(x).Idom();
+	std::vector<int> const& preds = cfg_.Block(x).Preds();
+	if ( (1 == preds.size()) && (p == preds[0]) &&
+	     (2 == cfg_.Block(p).Succs().size()) )
+	    r = restrict(O, r, p, x, Depth);
+	x = p;
+    }
+    return r;
+}
+
+// V as restricted by the edge P -> X, with P ending in a branch
+Val_Range
+Range_Solver::restrict(Operand const& V, Val_Range R, int P, int X,
+		       int Depth) const
+{
+    SSA_Entry const& jump = list_[cfg_.Block(P).Last()];
+    if ( !(isCondJump(jump.Op())) )
+	return R;
+    int to_Label = (cfg_.blockOfLabel(jumpLabel(jump)) == X);
+    int truth = (op_iffalse == jump.Op())?!(to_Label):to_Label;
+    Operand c = jump.Target();
+
+    if ( (c == V) ){
+	if ( !(truth) )
+	    return R.meet(Val_Range(0, 0));
+	if ( (0 <= R.Lo()) )
+	    return R.meet(Val_Range(1, R.Hi()));
+	return R;
+    }
+
+    std::map<Operand, int>::const_iterator iter = def_Line_.find(c);
+    if ( (def_Line_.end() == iter) )
+	return R;
+    SSA_Entry const& cmp = list_[iter->second];
+    ir_Op op = cmp.Op();
+    Operand other;
+    if ( (cmp.LHS() == V) )
+	other = cmp.RHS();
+    else if ( (cmp.RHS() == V) ){ // mirror: o < v is v > o
+	other = cmp.LHS();
+	switch(op){
+	case op_lt: op = op_gt; break;
+	case op_le: op = op_ge; break;
+	case op_gt: op = op_lt; break;
+	case op_ge: op = op_le; break;
+	default: break;
+	}
+    }
+    else
+	return R;
+    if ( !(truth) ){
+	switch(op){
+	case op_lt: op = op_ge; break;
+	case op_le: op = op_gt; break;
+	case op_gt: op = op_le; break;
+	case op_ge: op = op_lt; break;
+	case op_eq: op = op_ne; break;
+	case op_ne: op = op_eq; break;
+	default: return R;
+	}
+    }
+
+    Val_Range o = rangeAt(other, P, Depth + 1);
+    if ( o.isEmpty() || o.isFlt() )
+	return R;
+    switch(op){
+    case op_lt: return R.meet(Val_Range(intMin(), o.Hi() - 1));
+    case op_le: return R.meet(Val_Range(intMin(), o.Hi()));
+    case op_gt: return R.meet(Val_Range(o.Lo() + 1, intMax()));
+    case op_ge: return R.meet(Val_Range(o.Lo(), intMax()));
+    case op_eq: return R.meet(o);
+    case op_ne:
+	if ( o.isConst() && (o.Lo() == R.Lo()) )
+	    return Val_Range(R.Lo() + 1, R.Hi());
+	if ( o.isConst() && (o.Lo() == R.Hi()) )
+	    return Val_Range(R.Lo(), R.Hi() - 1);
+	return R;
+    default:
+	return R;
+    }
+}
+
+// a comparison: [0, 1], or decided
+Val_Range
+compareRanges(ir_Op Op, Val_Range const& L, Val_Range const& R)
+{
+    Val_Range unknown(0, 1);
+    if ( L.isFlt() || R.isFlt() )
+	return unknown;
+    int always = 0, never = 0;
+    switch(Op){
+    case op_lt: always = (L.Hi() < R.Lo()); never = (L.Lo() >= R.Hi()); break;
+    case op_le: always = (L.Hi() <= R.Lo()); never = (L.Lo() > R.Hi()); break;
+    case op_gt: always = (L.Lo() > R.Hi()); never = (L.Hi() <= R.Lo()); break;
+    case op_ge: always = (L.Lo() >= R.Hi()); never = (L.Hi() < R.Lo()); break;
+    case op_eq:
+	always = (L.isConst() && R.isConst() && (L.Lo() == R.Lo()));
+	never = ( (L.Hi() < R.Lo()) || (R.Hi() < L.Lo()) );
+	break;
+    case op_ne:
+	never = (L.isConst() && R.isConst() && (L.Lo() == R.Lo()));
+	always = ( (L.Hi() < R.Lo()) || (R.Hi() < L.Lo()) );
+	break;
+    default:
+	break;
+    }
+    if ( always ) return Val_Range(1, 1);
+    if ( never ) return Val_Range(0, 0);
+    return unknown;
+}
+
+Val_Range
+Range_Solver::evalLine(int I) const
+{
+    SSA_Entry const& line = list_[I];
+    int b = cfg_.blockOfLine(I);
+
+    if ( (op_phi == line.Op()) ){
+	Val_Range r;
+	Phi_Info const& info = ir_Phis[line.LHS().Id()];
+	for ( int k = 0; k < info.Size(); k++ ){
+	    int pred = cfg_.blockOfLabel(info.Pred(k));
+	    if ( (-1 != pred) && cfg_.isReachable(pred) )
+		r = r.join(rangeAt(info.Arg(k), pred));
+	}
+	return r;
+    }
+
+    Val_Range l = rangeAt(line.LHS(), b);
+    Val_Range r = rangeAt(line.RHS(), b);
+    ir_Op op = line.Op();
+    if ( (op_copy == op) )
+	return l;
+    if ( (op_cast == op) ){
+	if ( (tok_double == line.RHS().Id()) )
+	    return Val_Range::full(1);
+	if ( (tok_bool == line.RHS().Id()) )
+	    return Val_Range(0, 1);
+	return ( (l.isFlt()) )?Val_Range::full():l;
+    }
+    if ( (op_not == op) )
+	return compareRanges(op_eq, l, Val_Range(0, 0));
+    if ( (op_lt <= op) && (op <= op_ne) )
+	return ( (l.isEmpty() || r.isEmpty()) )?Val_Range():
+	    compareRanges(op, l, r);
+
+    if ( l.isEmpty() || ( (op_neg != op) && r.isEmpty() ) )
+	return Val_Range();
+    if ( l.isFlt() || r.isFlt() )
+	return Val_Range::full(1);
+    if ( ( l.isFull() || r.isFull() ) && (op_neg != op) )
+	return Val_Range::full();
+
+    switch(op){
+    case op_add:
+	return Val_Range(l.Lo() + r.Lo(), l.Hi() + r.Hi()).clamped();
+    case op_sub:
+	return Val_Range(l.Lo() - r.Hi(), l.Hi() - r.Lo()).clamped();
+    case op_neg:
+	return Val_Range(-l.Hi(), -l.Lo()).clamped();
+    case op_mult:{
+	long p[4] = { l.Lo() * r.Lo(), l.Lo() * r.Hi(),
+		      l.Hi() * r.Lo(), l.Hi() * r.Hi() };
+	return Val_Range(*std::min_element(p, p + 4),
+			 *std::max_element(p, p + 4)).clamped();
+    }
+    case op_mod: // sign of the dividend, less than the divisor
+	if ( r.isConst() && (0 < r.Lo()) )
+	    return Val_Range( (0 <= l.Lo())?0:-(r.Lo() - 1),
+			      (0 >= l.Hi())?0:(r.Lo() - 1) );
+	return Val_Range::full();
+    case op_div:
+	if ( r.isConst() && (0 < r.Lo()) )
+	    return Val_Range(l.Lo() / r.Lo(), l.Hi() / r.Lo());
+	return Val_Range::full();
+    default:
+	return Val_Range::full();
+    }
+}
+
+// one pass over all blocks; returns the number of ranges changed
+int
+Range_Solver::pass(int Narrow)
+{
+    int changed = 0;
+    std::vector<int> const& rpo = cfg_.RPO();
+    std::vector<Operand> defs;
+    for ( size_t k = 0; k < rpo.size(); k++ ){
+	Basic_Block const& blk = cfg_.Block(rpo[k]);
+	for ( int i = blk.First(); i <= blk.Last(); i++ ){
+	    lineDefs(list_[i], defs);
+	    if ( defs.empty() )
+		continue;
+	    Val_Range old = rangeAt(defs[0], 0);
+	    Val_Range cur = evalLine(i);
+	    if ( (op_phi == list_[i].Op()) && !(old.isEmpty()) ){
+		if ( Narrow ){
+		    if ( (cur.join(old) != old) ) // only ever shrink
+			cur = old;
+		}
+		else if ( (RANGE_WIDEN < ++updates_[defs[0]]) ){
+		    cur = cur.join(old);
+		    cur = Val_Range( (cur.Lo() < old.Lo())?intMin():cur.Lo(),
+				     (cur.Hi() > old.Hi())?intMax():cur.Hi(),
+				     cur.isFlt() );
+		}
+	    }
+	    if ( (cur != old) ){
+		vals_[defs[0]] = cur;
+		changed++;
+	    }
+	}
+    }
+    return changed;
+}
+
+void
+Range_Solver::solve(void)
+{
+    if ( (0 == cfg_.numBlocks()) )
+	return;
+    for ( int n = 0; (n < RANGE_PASSES) && (0 != pass(0)); n++ )
+	;
+    for ( int n = 0; n < 2; n++ )
+	pass(1);
+}
+
+// Returns the number of branches decided
+int
+Range_Solver::rewrite(void)
+{
+    int changes = 0;
+    for ( int b = 0; b < cfg_.numBlocks(); b++ ){
+	if ( !(cfg_.isReachable(b)) )
+	    continue;
+	SSA_Entry& jump = list_[cfg_.Block(b).Last()];
+	if ( !(isCondJump(jump.Op())) || (2 != cfg_.Block(b).Succs().size()) )
+	    continue;
+	Val_Range c = rangeAt(jump.Target(), b);
+	if ( c.isEmpty() || c.isFlt() || ( !(c.isConst()) && c.has(0) ) )
+	    continue;
+	int taken = (op_iffalse == jump.Op())?c.isConst() && (0 == c.Lo()):
+	    !(c.has(0));
+	int to = cfg_.blockOfLabel(jumpLabel(jump));
+	if ( taken ){
+	    dropPhiArgs(list_, cfg_, b, b + 1);
+	    jump = SSA_Entry(op_goto, jump.RHS(), Operand(), Operand(),
+			     jump.Frame(), jump.LabelChain());
+	}
+	else{
+	    dropPhiArgs(list_, cfg_, b, to);
+	    makeNOP(jump);
+	}
+	changes++;
+    }
+    return changes;
+}
+
+int
+rangesSSA(ir_Rep& List)
+{
+    Range_Solver solver(List);
+    solver.solve();
+    return solver.rewrite();
+}
+
+int
+removeRangeChecks(ir_Rep& List)
+{
+    return withSSA(List, rangesSSA);
+}
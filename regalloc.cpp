@@ -0,0 +1,443 @@
+/********************************************************************
+* regalloc.cpp - implementation file for regalloc.h
+*
+********************************************************************/
+
+#include <map>
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+
+#include "tables.h"
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "ssa.h"
+#include "opt.h"
+#include "regalloc.h"
+
+extern int option_GprLimit; // -R (-1: all)
+extern int option_SseLimit;
+
+int regs_Active = 0;
+
+Reg_File::Reg_File(void)
+{
+    const char* gprs[] = { "%ebx", "%r12d", "%r13d", "%r14d", "%r15d",
+			   "%esi", "%edi", "%r8d" };
+    const char* gpr_Scratch[] = { "%r9d", "%r10d", "%r11d" };
+    for ( size_t i = 0; i < sizeof(gprs) / sizeof(gprs[0]); i++ )
+	regs_[reg_Int].push_back(gprs[i]);
+    for ( size_t i = 0; i < sizeof(gpr_Scratch) / sizeof(gpr_Scratch[0]); i++ )
+	scratch_[reg_Int].push_back(gpr_Scratch[i]);
+
+    for ( int i = 2; i < 16; i++ ){
+	std::ostringstream tmp_Stream;
+	tmp_Stream << "%xmm" << i;
+	if ( (12 < i) )
+	    scratch_[reg_Flt].push_back(tmp_Stream.str());
+	else
+	    regs_[reg_Flt].push_back(tmp_Stream.str());
+    }
+}
+
+void
+Reg_File::limit(int Class, int N)
+{
+    if ( (0 <= N) && (static_cast<size_t>(N) < regs_[Class].size()) )
+	regs_[Class].resize(N);
+}
+
+Reg_File&
+targetRegs(void)
+{
+    static Reg_File regs;
+    static int limited = 0;
+    if ( !(limited) ){
+	regs.limit(reg_Int, option_GprLimit);
+	regs.limit(reg_Flt, option_SseLimit);
+	limited = 1;
+    }
+    return regs;
+}
+
+int
+isAllocated(void)
+{
+    return regs_Active;
+}
+
+class Live_Interval{
+public:
+Live_Interval(Operand V = Operand(), int Start = 0, int End = 0)
+    : value_(V), start_(Start), end_(End) {}
+
+    Operand Value(void) const { return value_; }
+    int Start(void) const { return start_; }
+    int End(void) const { return end_; }
+
+    void extend(int I)
+    {
+	if ( (I < start_) ) start_ = I;
+	if ( (I > end_) ) end_ = I;
+    }
+
+    bool operator<(Live_Interval const& r) const
+    {
+	if ( (start_ != r.start_) ) return (start_ < r.start_);
+	return (value_ < r.value_);
+    }
+
+private:
+    Operand value_;
+    int start_;
+    int end_;
+};
+
+void
+buildIntervals(ir_Rep const& List, std::vector<Live_Interval>& Intervals)
+{
+    CFG g(List);
+    Liveness live(g);
+    std::map<Operand, Live_Interval> found;
+    std::vector<Operand> defs, uses;
+
+    for ( size_t i = 0; i < List.size(); i++ ){
+	lineDefs(List[i], defs);
+	lineUses(List[i], uses);
+	uses.insert(uses.end(), defs.begin(), defs.end());
+	for ( size_t k = 0; k < uses.size(); k++ ){
+	    if ( !(found.count(uses[k])) )
+		found[uses[k]] = Live_Interval(uses[k], i, i);
+	    found[uses[k]].extend(i);
+	}
+    }
+    for ( int b = 0; b < g.numBlocks(); b++ ){
+	opd_Set::const_iterator iter;
+	for ( iter = live.LiveIn(b).begin(); iter != live.LiveIn(b).end(); iter++ )
+	    found[*iter].extend(g.Block(b).First());
+	for ( iter = live.LiveOut(b).begin(); iter != live.LiveOut(b).end(); iter++ )
+	    found[*iter].extend(g.Block(b).Last());
+    }
+
+    Intervals.clear();
+    std::map<Operand, Live_Interval>::const_iterator iter;
+    for ( iter = found.begin(); iter != found.end(); iter++ )
+	Intervals.push_back(iter->second);
+    std::sort(Intervals.begin(), Intervals.end());
+}
+
+int
+endsBefore(Live_Interval const& L, Live_Interval const& R)
+{
+    return (L.End() < R.End());
+}
+
+// Regs: the register of each value given one (index into the class)
+void
+scanIntervals(std::vector<Live_Interval> const& Intervals, int Regs,
+	      std::map<Operand, int>& Assigned, std::set<Operand>& Spilled)
+{
+    std::vector<Live_Interval> active; // by end
+    std::vector<int> free;
+    for ( int r = Regs - 1; r >= 0; r-- )
+	free.push_back(r);
+
+    for ( size_t k = 0; k < Intervals.size(); k++ ){
+	Live_Interval const& cur = Intervals[k];
+	while ( !(active.empty()) && (active[0].End() < cur.Start()) ){
+	    free.push_back(Assigned[active[0].Value()]);
+	    active.erase(active.begin());
+	}
+
+	if ( free.empty() ){
+	    if ( active.empty() || (active.back().End() <= cur.End()) ){
+		Spilled.insert(cur.Value());
+		continue;
+	    }
+	    Live_Interval last = active.back();
+	    active.pop_back();
+	    free.push_back(Assigned[last.Value()]);
+	    Assigned.erase(last.Value());
+	    Spilled.insert(last.Value());
+	}
+
+	Assigned[cur.Value()] = free.back();
+	free.pop_back();
+	active.insert(std::upper_bound(active.begin(), active.end(), cur,
+				       endsBefore), cur);
+    }
+}
+
+// a new frame slot for a spilled tmp, in the outermost frame
+Operand
+makeSlot(ir_Rep const& List, int Flt)
+{
+    static int count = 0;
+
+    int frame = -1;
+    for ( size_t i = 0; (i < List.size()) && (-1 == frame); i++ )
+	frame = List[i].Frame();
+    if ( (-1 == frame) )
+	errExit(0, "register allocation: no frame to spill to");
+
+    std::ostringstream tmp_Stream;
+    tmp_Stream << "_s" << ++count;
+    std::string name = tmp_Stream.str();
+    std::string type = token( (Flt)?tok_double:tok_int ).Lex();
+    ST[ir_Frames[frame].Name()].insertName(name, type, "stack",
+					   typeWidth(type));
+    return Operand(opd_Var, internVar(name, frame));
+}
+
+/***************************************
+* Verification
+***************************************/
+typedef std::map<Operand, Operand> reg_State; // location -> value in it
+
+// the operands Line reads values from (c. lineUses())
+void
+usePositions(SSA_Entry const& Line, std::vector<Operand>& Opds)
+{
+    Opds.clear();
+    switch(Line.Op()){
+    case op_nop: case op_dec: case op_lea: case op_goto: case op_call:
+    case op_syscall: case op_movl: case op_pushl: case op_phi:
+	break;
+    case op_iffalse: case op_iftrue:
+	Opds.push_back(Line.Target());
+	break;
+    case op_scale:
+	Opds.push_back(Line.Target());
+	Opds.push_back(Line.LHS());
+	break;
+    default:
+	if ( Line.Target().isElem() )
+	    Opds.push_back(Line.Target());
+	Opds.push_back(Line.LHS());
+	Opds.push_back(Line.RHS());
+	break;
+    }
+}
+
+// the (location, value) pairs line I reads
+void
+readPairs(SSA_Entry const& After, SSA_Entry const& Before,
+	  std::vector<std::pair<Operand, Operand> >& Pairs)
+{
+    std::vector<Operand> a, b;
+    usePositions(After, a);
+    usePositions(Before, b);
+    Pairs.clear();
+    for ( size_t k = 0; (k < a.size()) && (k < b.size()); k++ ){
+	if ( a[k].isElem() && b[k].isElem() ){
+	    if ( isValue(b[k].Offset()) )
+		Pairs.push_back(std::make_pair(a[k].Offset(), b[k].Offset()));
+	}
+	else if ( isValue(b[k]) )
+	    Pairs.push_back(std::make_pair(a[k], b[k]));
+    }
+}
+
+void
+stepState(SSA_Entry const& After, SSA_Entry const& Before, reg_State& S)
+{
+    std::vector<Operand> defs;
+    lineDefs(Before, defs);
+    if ( defs.empty() )
+	return;
+    if ( (op_copy == Before.Op()) && (Before.LHS() == defs[0]) ){
+	S[After.Target()] = defs[0]; // a reload or spill
+	return;
+    }
+    reg_State::iterator iter = S.begin();
+    while ( (S.end() != iter) ) // the old value is gone everywhere
+	if ( (iter->second == defs[0]) )
+	    S.erase(iter++);
+	else
+	    iter++;
+    S[After.Target()] = defs[0];
+}
+
+// a location only set along some paths keeps its value (the others
+// read it uninitialized); set to different ones, it holds neither
+void
+meetState(reg_State& Into, reg_State const& From)
+{
+    reg_State::const_iterator iter;
+    for ( iter = From.begin(); iter != From.end(); iter++ ){
+	reg_State::iterator at = Into.find(iter->first);
+	if ( (Into.end() == at) )
+	    Into[iter->first] = iter->second;
+	else if ( (at->second != iter->second) )
+	    at->second = Operand();
+    }
+}
+
+// Before: for each line of After, the line it stands for (a reload or
+// spill of v stands for v = v)
+void
+verifyAllocation(ir_Rep const& After, ir_Rep const& Before)
+{
+    CFG g(After);
+    std::vector<reg_State> in(g.numBlocks());
+    std::vector<int> seen(g.numBlocks(), 0);
+    std::vector<int> const& rpo = g.RPO();
+    if ( rpo.empty() )
+	return;
+    seen[rpo[0]] = 1;
+
+    int changed = 1;
+    while (changed){
+	changed = 0;
+	for ( size_t k = 0; k < rpo.size(); k++ ){
+	    int b = rpo[k];
+	    reg_State s = in[b];
+	    for ( int i = g.Block(b).First(); i <= g.Block(b).Last(); i++ )
+		stepState(After[i], Before[i], s);
+	    std::vector<int> const& succs = g.Block(b).Succs();
+	    for ( size_t j = 0; j < succs.size(); j++ ){
+		reg_State next = in[succs[j]];
+		if ( !(seen[succs[j]]) )
+		    next = s;
+		else
+		    meetState(next, s);
+		if ( !(seen[succs[j]]) || (next != in[succs[j]]) ){
+		    in[succs[j]] = next;
+		    seen[succs[j]] = 1;
+		    changed = 1;
+		}
+	    }
+	}
+    }
+
+    std::vector<std::pair<Operand, Operand> > pairs;
+    for ( size_t k = 0; k < rpo.size(); k++ ){
+	int b = rpo[k];
+	reg_State s = in[b];
+	for ( int i = g.Block(b).First(); i <= g.Block(b).Last(); i++ ){
+	    readPairs(After[i], Before[i], pairs);
+	    for ( size_t j = 0; j < pairs.size(); j++ ){
+		reg_State::const_iterator at = s.find(pairs[j].first);
+		if ( (s.end() == at) || (at->second == pairs[j].second) )
+		    continue;
+		errExit(0, "register allocation: %s doesn't hold %s (%s)",
+			operandStr(pairs[j].first).c_str(),
+			operandStr(pairs[j].second).c_str(),
+			After[i].str().c_str());
+	    }
+	    stepState(After[i], Before[i], s);
+	}
+    }
+}
+
+/***************************************
+* Rewriting
+***************************************/
+// Returns the number of values given a register
+int
+allocateRegisters(ir_Rep& List)
+{
+    if ( inSSA() )
+	fromSSA(List);
+    if ( isAllocated() || List.empty() )
+	return 0;
+
+    Reg_File& regs = targetRegs();
+    opd_Set flt;
+    findFloats(List, flt);
+    std::vector<Live_Interval> all, by_Class[reg_Classes];
+    buildIntervals(List, all);
+    for ( size_t k = 0; k < all.size(); k++ )
+	by_Class[flt.count(all[k].Value())?reg_Flt:reg_Int].push_back(all[k]);
+
+    std::map<Operand, Operand> loc; // value -> register, or its slot
+    std::set<Operand> spilled;
+    for ( int c = 0; c < reg_Classes; c++ ){
+	std::map<Operand, int> assigned;
+	scanIntervals(by_Class[c], regs.Regs(c).size(), assigned, spilled);
+	std::map<Operand, int>::const_iterator iter;
+	for ( iter = assigned.begin(); iter != assigned.end(); iter++ )
+	    loc[iter->first] = Operand(opd_Reg,
+				       internReg(regs.Regs(c)[iter->second]));
+    }
+    std::set<Operand>::const_iterator iter;
+    for ( iter = spilled.begin(); iter != spilled.end(); iter++ )
+	loc[*iter] = ( (iter->isVar()) )?*iter:makeSlot(List, flt.count(*iter));
+
+    ir_Rep out, before;
+    std::vector<Operand> defs, uses;
+    for ( size_t i = 0; i < List.size(); i++ ){
+	SSA_Entry line = List[i];
+	if ( (op_dec == line.Op()) ){
+	    out.push_back(line);
+	    before.push_back(line);
+	    continue;
+	}
+	lineDefs(line, defs);
+	lineUses(line, uses);
+
+	// spilled values read go through scratch registers
+	std::map<Operand, Operand> to;
+	int used[reg_Classes] = { 0, 0 };
+	ir_Rep reloads, reload_For;
+	for ( size_t k = 0; k < uses.size(); k++ ){
+	    Operand v = uses[k];
+	    if ( to.count(v) )
+		continue;
+	    if ( !(spilled.count(v)) ){
+		to[v] = loc[v];
+		continue;
+	    }
+	    int c = flt.count(v)?reg_Flt:reg_Int;
+	    if ( (static_cast<size_t>(used[c]) == regs.Scratch(c).size()) )
+		errExit(0, "register allocation: out of scratch registers");
+	    to[v] = Operand(opd_Reg, internReg(regs.Scratch(c)[used[c]++]));
+	    reloads.push_back(SSA_Entry(op_copy, to[v], loc[v], Operand(),
+					line.Frame()));
+	    reload_For.push_back(SSA_Entry(op_copy, v, v, Operand(),
+					   line.Frame()));
+	}
+	SSA_Entry orig = line;
+	replaceUses(line, to);
+
+	SSA_Entry spill;
+	if ( !(defs.empty()) ){
+	    Operand d = defs[0];
+	    if ( !(spilled.count(d)) )
+		line.setTarget(loc[d]);
+	    else{
+		int c = flt.count(d)?reg_Flt:reg_Int;
+		if ( !(to.count(d)) ){
+		    if ( (static_cast<size_t>(used[c]) == regs.Scratch(c).size()) )
+			errExit(0, "register allocation: out of scratch registers");
+		    to[d] = Operand(opd_Reg,
+				    internReg(regs.Scratch(c)[used[c]++]));
+		}
+		line.setTarget(to[d]);
+		spill = SSA_Entry(op_copy, loc[d], to[d], Operand(),
+				  line.Frame());
+	    }
+	}
+
+	if ( !(reloads.empty()) ){
+	    reloads[0].setLabelChain(line.LabelChain());
+	    line.setLabelChain(-1);
+	    out.insert(out.end(), reloads.begin(), reloads.end());
+	    before.insert(before.end(), reload_For.begin(), reload_For.end());
+	}
+	out.push_back(line);
+	before.push_back(orig);
+	if ( (op_nop != spill.Op()) ){
+	    out.push_back(spill);
+	    before.push_back(SSA_Entry(op_copy, defs[0], defs[0], Operand(),
+				       line.Frame()));
+	}
+    }
+
+    verifyAllocation(out, before);
+    List.swap(out);
+    regs_Active = 1;
+    return all.size() - spilled.size();
+}
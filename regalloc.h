@@ -0,0 +1,67 @@
+/********************************************************************
+* regalloc.h - register assignment over the IR (linear scan;
+*              Poletto, Sarkar)
+*
+* Target:    a register file of two classes, ints (GPR) and doubles
+*            (SSE); x86-64 by default. A few registers of each class
+*            are scratch (reloads and spills), and %eax, %ecx, %edx,
+*            %xmm0, %xmm1 are left to the code emitter (c. x86.h). -R
+*            g,s limits the number of registers assigned per class.
+* Intervals: a value (tmp or scalar variable) lives from its first to
+*            its last line in list order, extended over the blocks it
+*            is live into or out of (c. live.h); a value live around a
+*            loop spans all of it. An interval ending at a line
+*            doesn't hand its register to one starting there.
+* Spills:    when a class runs out, the interval ending last goes to
+*            memory: a variable to its own slot, a tmp to one added to
+*            the Symbol_Table of the outermost frame (_s<n>). Its uses
+*            are reloaded into a scratch register right before the
+*            line (=: %r10d, _s1), its definitions stored right after.
+* Result:    tmps and scalar variables are replaced by registers (ints
+*            by their 32 bit names, as TYPE_WIDTH_INT); variables stay
+*            in dec: lines, as bases of array elements, and in reloads
+*            and spills. The result is checked (verifyAllocation()):
+*            along every path, a register or slot read holds the value
+*            the line read before allocation. A line's target may get
+*            the register of an element offset the line reads, as in
+*            t = v * (-t)b: the code emitter reads all operands of a
+*            line before it writes the target (c. x86.cpp).
+*
+********************************************************************/
+
+#ifndef REGALLOC_H_
+#define REGALLOC_H_
+
+#include <string>
+#include <vector>
+
+#include "ir.h"
+
+enum reg_Class{ reg_Int, reg_Flt, reg_Classes };
+
+class Reg_File{
+public:
+    Reg_File(void); // x86-64
+
+    std::vector<std::string> const& Regs(int Class) const
+    {
+	return regs_[Class];
+    }
+    std::vector<std::string> const& Scratch(int Class) const
+    {
+	return scratch_[Class];
+    }
+    void limit(int Class, int N);
+
+private:
+    std::vector<std::string> regs_[reg_Classes];
+    std::vector<std::string> scratch_[reg_Classes];
+};
+
+Reg_File& targetRegs(void);
+int isAllocated(void);
+
+// passes
+int allocateRegisters(ir_Rep& List);
+
+#endif
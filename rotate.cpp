@@ -0,0 +1,110 @@
+/********************************************************************
+* rotate.cpp - loop rotation (the test of a loop moves to its bottom)
+*
+* The visitor makes loops as
+*     H: test; iffalse t goto Out; body; goto H; Out:
+* a taken goto and a conditional jump per iteration. Out of SSA form,
+* each goto back to the header of a loop is replaced by a copy of the
+* header block, its test jumping on to the line after the header:
+*     H: test; iffalse t goto Out; B: body; test; iffalse t goto Out;
+*     goto B; Out:
+* which 'jumps' (c. jumps.cpp) turns into iftrue t goto B, the one jump
+* per iteration; the header stays as the guard run on entry. break and
+* continue keep their targets: Out, and the iteration expression or the
+* header (which now only runs the test once more).
+* Rotated are headers of at most ROTATE_MAX_LINES lines ending in a
+* conditional jump out of the loop, with the next line in the loop.
+*
+********************************************************************/
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "ir.h"
+#include "cfg.h"
+#include "ssa.h"
+#include "opt.h"
+
+#define ROTATE_MAX_LINES 8
+
+// label of line I, made if it has none
+static int
+firstLabel(ir_Rep& List, int I)
+{
+    if ( !(List[I].hasLabels()) )
+	List[I].addLabel(makeLabelId());
+    return List[I].Labels()[0];
+}
+
+// header block of a loop that can be copied to its latches (-1: none)
+static int
+rotatableHeader(CFG const& G, Loop_Info const& Loop)
+{
+    Basic_Block const& head = G.Block(Loop.Header());
+    SSA_Entry const& jump = G.List()[head.Last()];
+    if ( !(isCondJump(jump.Op())) || (ROTATE_MAX_LINES < head.Size()) ||
+	 (head.Id() + 1 >= G.numBlocks()) || !(Loop.contains(head.Id() + 1)) )
+	return -1;
+    int out = G.blockOfLabel(jumpLabel(jump));
+    if ( (-1 == out) || (Loop.contains(out)) )
+	return -1;
+    for ( int i = head.First(); i < head.Last(); i++ ){
+	ir_Op op = G.List()[i].Op();
+	if ( (op_call == op) || (op_syscall == op) || (op_dec == op) ||
+	     (op_phi == op) )
+	    return -1;
+    }
+    return head.Id();
+}
+
+int
+rotateLoops(ir_Rep& List)
+{
+    if ( (inSSA()) || (List.empty()) )
+	return 0;
+
+    // line of a goto back to a header -> [first, last] line of the header
+    CFG g(List);
+    std::map<int, std::pair<int, int> > latches;
+    for ( size_t l = 0; l < g.Loops().size(); l++ ){
+	Loop_Info const& loop = g.Loops()[l];
+	int h = rotatableHeader(g, loop);
+	if ( (-1 == h) )
+	    continue;
+	for ( size_t k = 0; k < loop.Latches().size(); k++ ){
+	    int last = g.Block(loop.Latches()[k]).Last();
+	    if ( (op_goto == List[last].Op()) &&
+		 (h == g.blockOfLabel(List[last].Target().Id())) )
+		latches[last] = std::make_pair(g.Block(h).First(),
+					       g.Block(h).Last());
+	}
+    }
+    if ( latches.empty() )
+	return 0;
+
+    ir_Rep old = List;
+    std::map<int, int> on; // line -> label of the line after its header
+    std::map<int, std::pair<int, int> >::const_iterator iter;
+    for ( iter = latches.begin(); iter != latches.end(); iter++ )
+	on[iter->first] = firstLabel(old, iter->second.second + 1);
+
+    List.clear();
+    for ( size_t i = 0; i < old.size(); i++ ){
+	iter = latches.find(i);
+	if ( (latches.end() == iter) ){
+	    List.push_back(old[i]);
+	    continue;
+	}
+	// the goto's labels (continue, iteration) go to the copy
+	for ( int k = iter->second.first; k <= iter->second.second; k++ ){
+	    SSA_Entry line = old[k];
+	    line.setLabelChain( (k == iter->second.first)?old[i].LabelChain():
+				-1 );
+	    List.push_back(line);
+	}
+	List.push_back(SSA_Entry(op_goto, Operand(opd_Label, on[i]),
+				 Operand(), Operand(), old[i].Frame()));
+    }
+    return latches.size();
+}
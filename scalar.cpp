@@ -0,0 +1,229 @@
+/********************************************************************
+* scalar.cpp - scalar replacement of small arrays
+*
+* Out of SSA form, after constant propagation: an array declared with
+* literal dimensions, of at most SCALAR_ELEMS elements, whose elements
+* are only read and written at literal offsets (all subscripts
+* constant, or made so by fully unrolling the loops over it, c.
+* unroll.cpp), becomes a tmp per element used:
+*     dec a; (-$4)a = t1; t2 = (-$4)a * 2
+*  -> dec a; t9 = 0; t9 = t1; t2 = t9 * 2
+* so no element is loaded or stored any more, and the passes after
+* (SSA form, sccp, copies) see the values through them. The tmps are
+* set to 0 (0.0) at the declaration, for an element read before it is
+* written; a value of the other type stored to an element is cast to
+* the one of the array first, as the store would convert it. Arrays
+* on the heap, arrays with bounds computed at run time (c. op_lea), and
+* arrays an element of which a vector op touches are left alone. With
+* -s, the arrays replaced are listed (to std::cerr).
+*
+********************************************************************/
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "ir.h"
+#include "live.h"
+#include "ssa.h"
+#include "tables.h"
+#include "opt.h"
+
+#define SCALAR_ELEMS 16
+
+extern int option_Stats;
+
+// an array that may be replaced, and the tmps of its elements so far
+class Scalar_Array{
+public:
+Scalar_Array(int Width = 0, int Elem = 0, int Flt = 0)
+    : width_(Width), elem_(Elem), flt_(Flt), kept_(0), uses_(0) {}
+
+    int Width(void) const { return width_; } // bytes
+    int Elem(void) const { return elem_; }   // bytes per element
+    int isFlt(void) const { return flt_; }
+    int Kept(void) const { return kept_; }
+    int Uses(void) const { return uses_; }
+    std::map<int, Operand> const& Tmps(void) const { return tmps_; }
+
+    void keep(void) { kept_ = 1; }
+    void use(void) { uses_++; }
+    Operand tmpAt(int Off)
+    {
+	std::map<int, Operand>::const_iterator iter = tmps_.find(Off);
+	if ( (tmps_.end() != iter) )
+	    return iter->second;
+	return (tmps_[Off] = makeTmpOperand());
+    }
+
+private:
+    int width_;
+    int elem_;
+    int flt_;
+    int kept_;
+    int uses_;
+    std::map<int, Operand> tmps_; // byte offset -> tmp
+};
+
+// the arrays declared in List that may be replaced, by variable
+static void
+findArrays(ir_Rep const& List, std::map<int, Scalar_Array>& Arrays)
+{
+    for ( size_t i = 0; i < List.size(); i++ ){
+	if ( (op_dec != List[i].Op()) )
+	    continue;
+	int v = List[i].Target().Id();
+	if ( (-1 == ir_Vars[v].Frame()) )
+	    continue;
+	std::string name = ir_Vars[v].Name();
+	std::map<std::string, Symbol_Table>::iterator iter;
+	iter = ST.find(ir_Frames[ir_Vars[v].Frame()].Name());
+	if ( (ST.end() == iter) || (-1 == iter->second.findName(name)) ||
+	     ("stack" != iter->second.getMemType(name)) )
+	    continue;
+	int flt = (tok_double == List[i].LHS().Id());
+	int elem = (flt)?TYPE_WIDTH_FLT:TYPE_WIDTH_INT;
+	int width = iter->second.getWidth(name);
+	if ( (0 < width) && (SCALAR_ELEMS * elem >= width) )
+	    Arrays[v] = Scalar_Array(width, elem, flt);
+    }
+}
+
+// O (an operand of a line of kind Op) in a way that keeps its array
+static void
+checkOperand(Operand const& O, ir_Op Op, std::map<int, Scalar_Array>& Arrays)
+{
+    if ( !(O.isVar()) && !(O.isElem()) )
+	return;
+    std::map<int, Scalar_Array>::iterator iter = Arrays.find(O.Id());
+    if ( (Arrays.end() == iter) )
+	return;
+    if ( O.isVar() ){ // the array as a whole (op_lea), or a scalar
+	iter->second.keep();
+	return;
+    }
+    Operand off = O.Offset();
+    Scalar_Array& a = iter->second;
+    int use = ( (op_iffalse == Op) || (op_iftrue == Op) ||
+		( isValueOp(Op) && (op_phi != Op) && (op_scale != Op) ) );
+    if ( !(use) || !(off.isImm()) || ir_Consts[off.Id()].isFlt() ){
+	a.keep();
+	return;
+    }
+    long bytes = ir_Consts[off.Id()].IntVal();
+    if ( (0 > bytes) || (a.Width() <= bytes) || (0 != bytes % a.Elem()) )
+	a.keep();
+    a.use();
+}
+
+// O, or the tmp of the element it names
+static Operand
+scalarOf(Operand const& O, std::map<int, Scalar_Array>& Arrays)
+{
+    if ( !(O.isElem()) || !(Arrays.count(O.Id())) )
+	return O;
+    return Arrays[O.Id()].tmpAt(ir_Consts[O.Offset().Id()].IntVal());
+}
+
+// Returns the number of arrays replaced
+int
+replaceArrays(ir_Rep& List)
+{
+    if ( (inSSA()) || (List.empty()) )
+	return 0;
+
+    std::map<int, Scalar_Array> arrays;
+    findArrays(List, arrays);
+    for ( size_t i = 0; (i < List.size()) && !(arrays.empty()); i++ ){
+	SSA_Entry const& line = List[i];
+	if ( (op_dec == line.Op()) )
+	    continue;
+	if ( isVectorOp(line.Op()) ){
+	    if ( arrays.count(line.Target().Id()) )
+		arrays[line.Target().Id()].keep();
+	    if ( arrays.count(line.LHS().Id()) )
+		arrays[line.LHS().Id()].keep();
+	    if ( arrays.count(line.RHS().Id()) )
+		arrays[line.RHS().Id()].keep();
+	    continue;
+	}
+	checkOperand(line.Target(), line.Op(), arrays);
+	checkOperand(line.LHS(), line.Op(), arrays);
+	checkOperand(line.RHS(), line.Op(), arrays);
+    }
+
+    std::map<int, Scalar_Array>::iterator iter;
+    for ( iter = arrays.begin(); iter != arrays.end(); ){
+	if ( (iter->second.Kept()) || (0 == iter->second.Uses()) )
+	    arrays.erase(iter++);
+	else
+	    iter++;
+    }
+    if ( arrays.empty() )
+	return 0;
+
+    opd_Set flt;
+    findFloats(List, flt);
+    ir_Rep out;
+    std::vector<int> decs; // in out
+    for ( size_t i = 0; i < List.size(); i++ ){
+	SSA_Entry line = List[i];
+	if ( (op_dec == line.Op()) ){
+	    if ( arrays.count(line.Target().Id()) )
+		decs.push_back(out.size());
+	    out.push_back(line);
+	    continue;
+	}
+	if ( (op_iffalse == line.Op()) || (op_iftrue == line.Op()) ){
+	    line.setTarget(scalarOf(line.Target(), arrays));
+	    out.push_back(line);
+	    continue;
+	}
+	line.setLHS(scalarOf(line.LHS(), arrays));
+	line.setRHS(scalarOf(line.RHS(), arrays));
+	Operand t = line.Target();
+	if ( !(t.isElem()) || !(arrays.count(t.Id())) ){
+	    out.push_back(line);
+	    continue;
+	}
+
+	// a store: to the tmp of the element, converted as it would be
+	int to_Flt = arrays[t.Id()].isFlt();
+	Operand elem = scalarOf(t, arrays);
+	if ( (isFltValue(List[i], flt) == to_Flt) ){
+	    line.setTarget(elem);
+	    out.push_back(line);
+	    continue;
+	}
+	Operand val = makeTmpOperand();
+	line.setTarget(val);
+	out.push_back(line);
+	out.push_back(SSA_Entry(op_cast, elem, val,
+				Operand(opd_Type, (to_Flt)?tok_double:tok_int),
+				line.Frame()));
+    }
+
+    // the tmps start out as 0, after the declaration
+    ir_Rep init;
+    for ( int k = decs.size() - 1; k >= 0; k-- ){
+	SSA_Entry const& dec = out[decs[k]];
+	Scalar_Array const& a = arrays[dec.Target().Id()];
+	init.clear();
+	std::map<int, Operand>::const_iterator elem;
+	for ( elem = a.Tmps().begin(); elem != a.Tmps().end(); elem++ )
+	    init.push_back(SSA_Entry(op_copy, elem->second,
+				     makeImmOperand( (a.isFlt())?"0.0":"0" ),
+				     Operand(), dec.Frame()));
+	out.insert(out.begin() + decs[k] + 1, init.begin(), init.end());
+    }
+    List.swap(out);
+
+    for ( iter = arrays.begin(); (option_Stats) && (iter != arrays.end());
+	  iter++ )
+	std::cerr << "scalar: " << ir_Vars[iter->first].Name() << ", "
+		  << iter->second.Width() / iter->second.Elem()
+		  << " elements, " << iter->second.Tmps().size()
+		  << " used, replaced by tmps\n";
+
+    return arrays.size();
+}
@@ -0,0 +1,314 @@
+/********************************************************************
+* sccp.cpp - sparse conditional constant propagation (Wegman, Zadeck)
+*
+* On SSA form: values start unknown (top), and only drop (to a
+* constant, then to varying) while blocks are found executable from
+* the entry along edges whose branch conditions allow them. Then
+* - uses of constant values become literals, their definitions go;
+* - branches on a constant become a goto, or go;
+* - blocks never found executable go, as do phi arguments coming in
+*   along edges never taken.
+* Lines removed in SSA form are turned into NOPs (keeping their labels,
+* which name blocks for phis); leaving SSA form removes them.
+*
+********************************************************************/
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "ssa.h"
+#include "fold.h"
+#include "opt.h"
+
+enum lat_State{ lat_Top, lat_Const, lat_Bottom };
+
+class Lat_Val{
+public:
+Lat_Val(int State = lat_Top, Const_Val C = Const_Val())
+    : state_(State), c_(C) {}
+
+    int State(void) const { return state_; }
+    Const_Val Const(void) const { return c_; }
+
+    bool operator!=(Lat_Val const& r) const
+    {
+	return ( (state_ != r.state_) ||
+		 ( (lat_Const == state_) && (c_ != r.c_) ) );
+    }
+
+private:
+    int state_;
+    Const_Val c_;
+};
+
+Lat_Val
+latMeet(Lat_Val const& A, Lat_Val const& B)
+{
+    if ( (lat_Top == A.State()) ) return B;
+    if ( (lat_Top == B.State()) ) return A;
+    if ( (lat_Bottom == A.State()) || (lat_Bottom == B.State()) )
+	return Lat_Val(lat_Bottom);
+    return ( (A.Const() == B.Const()) )?A:Lat_Val(lat_Bottom);
+}
+
+class SCCP_Solver{
+public:
+    SCCP_Solver(ir_Rep& List);
+
+    void solve(void);
+    int rewrite(void);
+
+private:
+    Lat_Val valueOf(Operand const& O) const;
+    void setValue(Operand const& O, Lat_Val const& V);
+    void addEdge(int From, int To);
+    void visitLine(int I);
+    void visitPhi(int I);
+    void visitJump(int I);
+    int edgeExec(int From, int To) const;
+
+    ir_Rep& list_;
+    CFG cfg_;
+    std::map<Operand, Lat_Val> vals_;
+    std::map<Operand, std::vector<int> > uses_;
+    std::set<Operand> defined_;
+    std::vector<int> block_Exec_;
+    std::set<std::pair<int, int> > edge_Exec_;
+    std::vector<std::pair<int, int> > flow_Work_;
+    std::vector<int> ssa_Work_;
+};
+
+SCCP_Solver::SCCP_Solver(ir_Rep& List)
+    : list_(List), cfg_(List)
+{
+    std::vector<Operand> defs, uses;
+    for ( size_t i = 0; i < list_.size(); i++ ){
+	lineDefs(list_[i], defs);
+	defined_.insert(defs.begin(), defs.end());
+	lineUses(list_[i], uses);
+	for ( size_t k = 0; k < uses.size(); k++ )
+	    uses_[uses[k]].push_back(i);
+    }
+    block_Exec_.assign(cfg_.numBlocks(), 0);
+}
+
+// a value never defined in the list comes from outside (varying)
+Lat_Val
+SCCP_Solver::valueOf(Operand const& O) const
+{
+    if ( O.isImm() )
+	return Lat_Val(lat_Const, constOf(O));
+    if ( !(isValue(O)) || !(defined_.count(O)) )
+	return Lat_Val(lat_Bottom);
+    std::map<Operand, Lat_Val>::const_iterator iter = vals_.find(O);
+    return ( (vals_.end() == iter) )?Lat_Val():iter->second;
+}
+
+void
+SCCP_Solver::setValue(Operand const& O, Lat_Val const& V)
+{
+    if ( !(valueOf(O) != V) )
+	return;
+    vals_[O] = V;
+    std::map<Operand, std::vector<int> >::const_iterator iter=uses_.find(O);
+    if ( (uses_.end() != iter) )
+	ssa_Work_.insert(ssa_Work_.end(), iter->second.begin(),
+			 iter->second.end());
+}
+
+int
+SCCP_Solver::edgeExec(int From, int To) const
+{
+    return edge_Exec_.count(std::make_pair(From, To));
+}
+
+void
+SCCP_Solver::addEdge(int From, int To)
+{
+    if ( (-1 == To) || edgeExec(From, To) )
+	return;
+    edge_Exec_.insert(std::make_pair(From, To));
+    flow_Work_.push_back(std::make_pair(From, To));
+}
+
+void
+SCCP_Solver::visitPhi(int I)
+{
+    int b = cfg_.blockOfLine(I);
+    Phi_Info const& info = ir_Phis[list_[I].LHS().Id()];
+    Lat_Val v;
+    for ( int k = 0; k < info.Size(); k++ ){
+	int pred = cfg_.blockOfLabel(info.Pred(k));
+	if ( (-1 != pred) && edgeExec(pred, b) )
+	    v = latMeet(v, valueOf(info.Arg(k)));
+    }
+    setValue(list_[I].Target(), v);
+}
+
+// the edges out of a block, from its last line
+void
+SCCP_Solver::visitJump(int I)
+{
+    int b = cfg_.blockOfLine(I);
+    SSA_Entry const& line = list_[I];
+    int next = ( (b + 1 < cfg_.numBlocks()) )?(b + 1):-1;
+    int to = ( (-1 != jumpLabel(line)) )?cfg_.blockOfLabel(jumpLabel(line)):-1;
+
+    if ( (op_goto == line.Op()) )
+	addEdge(b, to);
+    else if ( isCondJump(line.Op()) ){
+	Lat_Val c = valueOf(line.Target());
+	if ( (lat_Top == c.State()) )
+	    return;
+	if ( (lat_Const == c.State()) ){
+	    int taken = (op_iffalse == line.Op())?c.Const().isZero():
+		!(c.Const().isZero());
+	    addEdge(b, (taken)?to:next);
+	}
+	else{
+	    addEdge(b, to);
+	    addEdge(b, next);
+	}
+    }
+    else if ( !(endsFlow(line)) )
+	addEdge(b, next);
+}
+
+void
+SCCP_Solver::visitLine(int I)
+{
+    SSA_Entry const& line = list_[I];
+    if ( (op_phi == line.Op()) ){
+	visitPhi(I);
+	return;
+    }
+    if ( (I == cfg_.Block(cfg_.blockOfLine(I)).Last()) )
+	visitJump(I);
+
+    std::vector<Operand> defs;
+    lineDefs(line, defs);
+    if ( defs.empty() )
+	return;
+
+    Lat_Val l = valueOf(line.LHS());
+    Lat_Val r = ( (op_cast == line.Op()) || (op_neg == line.Op()) ||
+		  (op_not == line.Op()) || (op_copy == line.Op()) )?
+	Lat_Val(lat_Const):valueOf(line.RHS());
+    if ( (lat_Bottom == l.State()) || (lat_Bottom == r.State()) ){
+	setValue(defs[0], Lat_Val(lat_Bottom));
+	return;
+    }
+    if ( (lat_Top == l.State()) || (lat_Top == r.State()) )
+	return;
+
+    Const_Val res;
+    int type = ( (op_cast == line.Op()) )?line.RHS().Id():-1;
+    if ( foldOp(line.Op(), l.Const(), r.Const(), type, res) )
+	setValue(defs[0], Lat_Val(lat_Const, res));
+    else
+	setValue(defs[0], Lat_Val(lat_Bottom));
+}
+
+void
+SCCP_Solver::solve(void)
+{
+    if ( (0 == cfg_.numBlocks()) )
+	return;
+    flow_Work_.push_back(std::make_pair(-1, 0));
+    while ( !(flow_Work_.empty()) || !(ssa_Work_.empty()) ){
+	while ( !(flow_Work_.empty()) ){
+	    int b = flow_Work_.back().second;
+	    flow_Work_.pop_back();
+	    Basic_Block const& blk = cfg_.Block(b);
+	    if ( block_Exec_[b] ){ // phis see one more edge
+		for ( int i = blk.First(); (i <= blk.Last()) &&
+			  ((op_phi == list_[i].Op()) ||
+			   (op_nop == list_[i].Op())); i++ )
+		    if ( (op_phi == list_[i].Op()) )
+			visitPhi(i);
+		continue;
+	    }
+	    block_Exec_[b] = 1;
+	    for ( int i = blk.First(); i <= blk.Last(); i++ )
+		visitLine(i);
+	}
+	while ( !(ssa_Work_.empty()) ){
+	    int i = ssa_Work_.back();
+	    ssa_Work_.pop_back();
+	    if ( block_Exec_[cfg_.blockOfLine(i)] )
+		visitLine(i);
+	}
+    }
+}
+
+// Returns the number of lines removed, plus branches resolved
+int
+SCCP_Solver::rewrite(void)
+{
+    int changes = 0;
+    std::map<Operand, Operand> consts;
+    std::map<Operand, Lat_Val>::const_iterator iter;
+    for ( iter = vals_.begin(); iter != vals_.end(); iter++ )
+	if ( (lat_Const == iter->second.State()) )
+	    consts[iter->first] = constOperand(iter->second.Const());
+
+    for ( size_t i = 0; i < list_.size(); i++ ){
+	SSA_Entry& line = list_[i];
+	int b = cfg_.blockOfLine(i);
+	if ( (op_nop == line.Op()) )
+	    continue;
+	if ( !(block_Exec_[b]) ){
+	    makeNOP(line);
+	    changes++;
+	    continue;
+	}
+
+	std::vector<Operand> defs;
+	lineDefs(line, defs);
+	if ( !(defs.empty()) && consts.count(defs[0]) ){
+	    makeNOP(line);
+	    changes++;
+	    continue;
+	}
+	replaceUses(line, consts);
+
+	if ( (op_phi == line.Op()) ){ // arguments along edges never taken
+	    Phi_Info& info = ir_Phis[line.LHS().Id()];
+	    for ( int k = info.Size() - 1; k >= 0; k-- ){
+		int pred = cfg_.blockOfLabel(info.Pred(k));
+		if ( (-1 == pred) || !(edgeExec(pred, b)) )
+		    info.removeArg(k);
+	    }
+	}
+	else if ( isCondJump(line.Op()) && line.Target().isImm() ){
+	    Const_Val c = constOf(line.Target());
+	    int taken = (op_iffalse == line.Op())?c.isZero():!(c.isZero());
+	    if ( taken )
+		line = SSA_Entry(op_goto, line.RHS(), Operand(), Operand(),
+				 line.Frame(), line.LabelChain());
+	    else
+		makeNOP(line);
+	    changes++;
+	}
+    }
+
+    return changes;
+}
+
+int
+sccpSSA(ir_Rep& List)
+{
+    SCCP_Solver solver(List);
+    solver.solve();
+    return solver.rewrite();
+}
+
+int
+propagateConstants(ir_Rep& List)
+{
+    return withSSA(List, sccpSSA);
+}
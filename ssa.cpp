@@ -0,0 +1,469 @@
+/********************************************************************
+* ssa.cpp - implementation file for ssa.h
+*
+********************************************************************/
+
+#include <map>
+#include <set>
+#include <algorithm>
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "opt.h"
+#include "ssa.h"
+
+int ssa_Active = 0;
+std::map<int, Operand> ssa_Origins; // new tmp -> name it renames
+std::set<int> ssa_Labels;           // labels added by toSSA
+std::set<int> ssa_Scaled;           // targets of t = t * w, as mult
+
+int
+inSSA(void)
+{
+    return ssa_Active;
+}
+
+Operand
+ssaOrigin(Operand const& O)
+{
+    if ( !(O.isTmp()) )
+	return O;
+    std::map<int, Operand>::const_iterator iter = ssa_Origins.find(O.Id());
+    if ( (ssa_Origins.end() == iter) )
+	return O;
+    return iter->second;
+}
+
+int
+firstLabel(ir_Rep const& List, CFG const& G, int B)
+{
+    return List[G.Block(B).First()].Labels()[0];
+}
+
+// O with its value (or the value in its offset) renamed by Map
+Operand
+renameOperand(Operand const& O, std::map<Operand, Operand> const& Map)
+{
+    Operand val = ( (O.isElem()) )?O.Offset():O;
+    if ( !(isValue(val)) )
+	return O;
+    std::map<Operand, Operand>::const_iterator iter = Map.find(val);
+    if ( (Map.end() == iter) )
+	return O;
+    Operand to = iter->second;
+    if ( O.isElem() )
+	return Operand(opd_Elem, O.Id(), to.Kind(), to.Id());
+    return to;
+}
+
+// rename the uses of a line (not its definition)
+void
+renameUses(SSA_Entry& Line, std::map<Operand, Operand> const& Map)
+{
+    switch(Line.Op()){
+    case op_nop: case op_dec: case op_lea: case op_goto: case op_call:
+    case op_syscall: case op_movl: case op_pushl: case op_phi:
+	break;
+    case op_iffalse: case op_iftrue:
+	Line.setTarget(renameOperand(Line.Target(), Map));
+	break;
+    case op_scale:
+	Line.setTarget(renameOperand(Line.Target(), Map));
+	Line.setLHS(renameOperand(Line.LHS(), Map));
+	break;
+    default:
+	if ( Line.Target().isElem() )
+	    Line.setTarget(renameOperand(Line.Target(), Map));
+	Line.setLHS(renameOperand(Line.LHS(), Map));
+	Line.setRHS(renameOperand(Line.RHS(), Map));
+	break;
+    }
+}
+
+// as renameUses, and the arguments of a phi
+void
+replaceUses(SSA_Entry& Line, std::map<Operand, Operand> const& Map)
+{
+    if ( (op_phi != Line.Op()) ){
+	renameUses(Line, Map);
+	return;
+    }
+    Phi_Info& info = ir_Phis[Line.LHS().Id()];
+    for ( int k = 0; k < info.Size(); k++ )
+	info.setArg(k, renameOperand(info.Arg(k), Map));
+}
+
+// the edge From -> To goes: so do the arguments of phis of To along it
+void
+dropPhiArgs(ir_Rep& List, CFG const& G, int From, int To)
+{
+    int label = firstLabel(List, G, From);
+    for ( int i = G.Block(To).First(); i <= G.Block(To).Last(); i++ ){
+	if ( (op_phi != List[i].Op()) )
+	    continue;
+	Phi_Info& info = ir_Phis[List[i].LHS().Id()];
+	int k = info.findPred(label);
+	if ( (-1 != k) )
+	    info.removeArg(k);
+    }
+}
+
+// run Pass on List in SSA form, converting in and out unless it already is
+int
+withSSA(ir_Rep& List, int (*Pass)(ir_Rep&))
+{
+    if ( inSSA() )
+	return Pass(List);
+    toSSA(List);
+    int changes = Pass(List);
+    fromSSA(List);
+    return changes;
+}
+
+// Insert a phi for each value defined in more than one block at the
+// iterated dominance frontier of its definitions, where it is live.
+// The phis go to the top of their blocks, taking over the labels.
+void
+placePhis(ir_Rep& List, CFG const& G, int& Count)
+{
+    int n = G.numBlocks();
+    Liveness live(G);
+
+    std::map<Operand, std::vector<int> > def_Blocks;
+    std::vector<Operand> defs;
+    for ( size_t i = 0; i < List.size(); i++ ){
+	lineDefs(List[i], defs);
+	for ( size_t k = 0; k < defs.size(); k++ ){
+	    std::vector<int>& d = def_Blocks[defs[k]];
+	    if ( d.empty() || (d.back() != G.blockOfLine(i)) )
+		d.push_back(G.blockOfLine(i));
+	}
+    }
+
+    std::vector<std::vector<Operand> > phis(n);
+    std::map<Operand, std::vector<int> >::const_iterator iter;
+    for ( iter = def_Blocks.begin(); iter != def_Blocks.end(); iter++ ){
+	Operand v = iter->first;
+	std::vector<int> work = iter->second;
+	std::set<int> seen(work.begin(), work.end());
+	std::set<int> has_Phi;
+	while ( !(work.empty()) ){
+	    int b = work.back();
+	    work.pop_back();
+	    std::vector<int> const& f = G.Block(b).Frontier();
+	    for ( size_t k = 0; k < f.size(); k++ ){
+		if ( has_Phi.count(f[k]) || !(live.LiveIn(f[k]).count(v)) )
+		    continue;
+		has_Phi.insert(f[k]);
+		phis[f[k]].push_back(v);
+		if ( !(seen.count(f[k])) ){
+		    seen.insert(f[k]);
+		    work.push_back(f[k]);
+		}
+	    }
+	}
+    }
+
+    ir_Rep ssa_List;
+    ssa_List.reserve(List.size());
+    for ( int b = 0; b < n; b++ ){
+	Basic_Block const& blk = G.Block(b);
+	SSA_Entry first = List[blk.First()];
+	for ( size_t k = 0; k < phis[b].size(); k++ ){
+	    Phi_Info info;
+	    std::vector<int> const& p = blk.Preds();
+	    for ( size_t j = 0; j < p.size(); j++ )
+		info.addArg(phis[b][k], firstLabel(List, G, p[j]));
+	    ir_Phis.push_back(info);
+	    Operand args(opd_Phi, ir_Phis.size() - 1);
+	    int labels = ( (0 == k) )?first.LabelChain():-1;
+	    ssa_List.push_back(SSA_Entry(op_phi, phis[b][k], args, Operand(),
+					 first.Frame(), labels));
+	    Count++;
+	}
+	if ( !(phis[b].empty()) )
+	    first.setLabelChain(-1);
+	ssa_List.push_back(first);
+	for ( int i = blk.First() + 1; i <= blk.Last(); i++ )
+	    ssa_List.push_back(List[i]);
+    }
+    List.swap(ssa_List);
+}
+
+// walk the dominator tree, keeping the current name of each value
+// (restored when leaving the subtree of a block)
+void
+renameValues(ir_Rep& List, CFG const& G)
+{
+    std::map<Operand, Operand> cur;
+    std::vector<std::vector<std::pair<Operand, Operand> > > saved;
+    saved.resize(G.numBlocks());
+    std::vector<std::pair<int, int> > walk; // block, 1: leaving it
+    std::vector<Operand> defs;
+
+    walk.push_back(std::make_pair(0, 0));
+    while ( !(walk.empty()) ){
+	int b = walk.back().first;
+	int leaving = walk.back().second;
+	walk.pop_back();
+	if ( leaving ){
+	    for ( int k = saved[b].size() - 1; k >= 0; k-- ){
+		if ( saved[b][k].second.isNone() )
+		    cur.erase(saved[b][k].first);
+		else
+		    cur[saved[b][k].first] = saved[b][k].second;
+	    }
+	    continue;
+	}
+	walk.push_back(std::make_pair(b, 1));
+
+	for ( int i = G.Block(b).First(); i <= G.Block(b).Last(); i++ ){
+	    SSA_Entry& line = List[i];
+	    int scaled = (op_scale == line.Op());
+	    if ( scaled ){ // t = t * w: one definition, and one other use
+		line.setOp(op_mult);
+		line.setRHS(line.LHS());
+		line.setLHS(line.Target());
+	    }
+	    renameUses(line, cur);
+	    lineDefs(line, defs);
+	    for ( size_t k = 0; k < defs.size(); k++ ){
+		Operand t = makeTmpOperand();
+		ssa_Origins[t.Id()] = defs[k];
+		std::map<Operand, Operand>::const_iterator iter;
+		iter = cur.find(defs[k]);
+		Operand prev = ( (cur.end() != iter) )?iter->second:Operand();
+		saved[b].push_back(std::make_pair(defs[k], prev));
+		cur[defs[k]] = t;
+		line.setTarget(t);
+		if ( scaled )
+		    ssa_Scaled.insert(t.Id());
+	    }
+	}
+
+	int label = firstLabel(List, G, b);
+	std::vector<int> const& s = G.Block(b).Succs();
+	for ( size_t k = 0; k < s.size(); k++ ){
+	    for ( int i = G.Block(s[k]).First(); i <= G.Block(s[k]).Last() &&
+		      (op_phi == List[i].Op()); i++ ){
+		Phi_Info& info = ir_Phis[List[i].LHS().Id()];
+		Operand v = ssaOrigin(List[i].Target());
+		std::map<Operand, Operand>::const_iterator iter = cur.find(v);
+		info.setArg(info.findPred(label),
+			    ( (cur.end() != iter) )?iter->second:v);
+	    }
+	}
+
+	std::vector<int> const& kids = G.Block(b).DomKids();
+	for ( size_t k = 0; k < kids.size(); k++ )
+	    walk.push_back(std::make_pair(kids[k], 0));
+    }
+}
+
+// Returns the number of phis placed, plus lines dropped as unreachable
+int
+toSSA(ir_Rep& List)
+{
+    if ( ssa_Active || List.empty() )
+	return 0;
+
+    int changes = removeUnreachable(List);
+    ssa_Active = 1;
+    ssa_Origins.clear();
+    ssa_Labels.clear();
+    ssa_Scaled.clear();
+    if ( List.empty() )
+	return changes;
+
+    // the entry block must not have predecessors: values come from outside
+    if ( !(CFG(List).Block(0).Preds().empty()) )
+	List.insert(List.begin(), SSA_Entry(op_nop, Operand(), Operand(),
+					    Operand(), List[0].Frame()));
+
+    CFG g(List);
+    for ( int b = 0; b < g.numBlocks(); b++ ){
+	SSA_Entry& first = List[g.Block(b).First()];
+	if ( !(first.hasLabels()) ){
+	    int label = makeLabelId();
+	    first.addLabel(label);
+	    ssa_Labels.insert(label);
+	}
+    }
+
+    placePhis(List, g, changes);
+    renameValues(List, CFG(List));
+
+    return changes;
+}
+
+// Give each value in SSA form its original name, unless it interferes
+// with another value already given that name (one defined while the
+// other is live; a copy between the two doesn't count).
+void
+coalesceNames(ir_Rep& List)
+{
+    CFG g(List);
+    Liveness live(g);
+    std::set<std::pair<Operand, Operand> > interf;
+    std::vector<Operand> defs, uses;
+
+    for ( int b = 0; b < g.numBlocks(); b++ ){
+	opd_Set cur = live.LiveOut(b);
+	for ( int i = g.Block(b).Last(); i >= g.Block(b).First(); i-- ){
+	    lineDefs(List[i], defs);
+	    for ( size_t k = 0; k < defs.size(); k++ ){
+		Operand d = defs[k];
+		opd_Set::const_iterator iter;
+		for ( iter = cur.begin(); iter != cur.end(); iter++ ){
+		    if ( (*iter == d) || (ssaOrigin(*iter) != ssaOrigin(d)) )
+			continue;
+		    if ( (op_copy == List[i].Op()) && (List[i].LHS() == *iter) )
+			continue;
+		    interf.insert(std::make_pair(std::min(d, *iter),
+						 std::max(d, *iter)));
+		}
+		cur.erase(d);
+	    }
+	    lineUses(List[i], uses);
+	    cur.insert(uses.begin(), uses.end());
+	}
+    }
+
+    // original names keep theirs; the others follow in order of definition
+    std::map<Operand, std::vector<Operand> > given;
+    std::map<Operand, Operand> names;
+    for ( size_t i = 0; i < List.size(); i++ ){
+	lineUses(List[i], uses);
+	lineDefs(List[i], defs);
+	uses.insert(uses.end(), defs.begin(), defs.end());
+	for ( size_t k = 0; k < uses.size(); k++ )
+	    if ( (ssaOrigin(uses[k]) == uses[k]) && !(names.count(uses[k])) ){
+		names[uses[k]] = uses[k];
+		given[uses[k]].push_back(uses[k]);
+	    }
+    }
+    for ( size_t i = 0; i < List.size(); i++ ){
+	lineDefs(List[i], defs);
+	for ( size_t k = 0; k < defs.size(); k++ ){
+	    Operand d = defs[k];
+	    if ( names.count(d) )
+		continue;
+	    Operand rep = ssaOrigin(d);
+	    std::vector<Operand>& members = given[rep];
+	    size_t j = 0;
+	    for ( ; j < members.size(); j++ )
+		if ( interf.count(std::make_pair(std::min(d, members[j]),
+						 std::max(d, members[j]))) )
+		    break;
+	    if ( (members.size() == j) ){
+		names[d] = rep;
+		members.push_back(d);
+	    }
+	    else
+		names[d] = d;
+	}
+    }
+
+    for ( size_t i = 0; i < List.size(); i++ ){
+	SSA_Entry& line = List[i];
+	renameUses(line, names);
+	lineDefs(line, defs);
+	if ( !(defs.empty()) )
+	    line.setTarget(renameOperand(line.Target(), names));
+    }
+}
+
+// Returns the number of phis removed
+int
+fromSSA(ir_Rep& List)
+{
+    if ( !(ssa_Active) )
+	return 0;
+    ssa_Active = 0;
+    if ( List.empty() )
+	return 0;
+
+    int changes = 0;
+    CFG g(List);
+    std::vector<ir_Rep> copies(g.numBlocks());
+    for ( size_t i = 0; i < List.size(); i++ ){
+	SSA_Entry& line = List[i];
+	if ( (op_phi != line.Op()) )
+	    continue;
+	Operand p = makeTmpOperand();
+	ssa_Origins[p.Id()] = ssaOrigin(line.Target());
+	Phi_Info const& info = ir_Phis[line.LHS().Id()];
+	for ( int k = 0; k < info.Size(); k++ ){
+	    int b = g.blockOfLabel(info.Pred(k));
+	    if ( (-1 == b) )
+		continue;
+	    int frame = List[g.Block(b).Last()].Frame();
+	    copies[b].push_back(SSA_Entry(op_copy, p, info.Arg(k), Operand(),
+					  frame));
+	}
+	line.setOp(op_copy);
+	line.setLHS(p);
+	changes++;
+    }
+
+    // copies go before the jump ending a block (taking over its labels)
+    ir_Rep out;
+    out.reserve(List.size() + changes);
+    for ( int b = 0; b < g.numBlocks(); b++ ){
+	int last = g.Block(b).Last();
+	for ( int i = g.Block(b).First(); i < last; i++ )
+	    out.push_back(List[i]);
+	SSA_Entry line = List[last];
+	if ( isJump(line.Op()) && !(copies[b].empty()) ){
+	    copies[b][0].setLabelChain(line.LabelChain());
+	    line.setLabelChain(-1);
+	    out.insert(out.end(), copies[b].begin(), copies[b].end());
+	    out.push_back(line);
+	}
+	else{
+	    out.push_back(line);
+	    out.insert(out.end(), copies[b].begin(), copies[b].end());
+	}
+    }
+
+    std::vector<int> scaled;
+    for ( size_t i = 0; i < out.size(); i++ )
+	if ( (op_mult == out[i].Op()) && ssa_Scaled.count(out[i].Target().Id()) )
+	    scaled.push_back(i);
+    coalesceNames(out);
+    // t = t * w, as before
+    for ( size_t k = 0; k < scaled.size(); k++ ){
+	SSA_Entry& line = out[scaled[k]];
+	if ( (line.Target() == line.LHS()) ){
+	    line.setOp(op_scale);
+	    line.setLHS(line.RHS());
+	    line.setRHS(Operand());
+	}
+    }
+
+    std::set<int> jumped_To;
+    for ( size_t i = 0; i < out.size(); i++ )
+	if ( (-1 != jumpLabel(out[i])) )
+	    jumped_To.insert(jumpLabel(out[i]));
+    for ( size_t i = 0; i < out.size(); i++ ){
+	SSA_Entry& line = out[i];
+	if ( (op_copy == line.Op()) && (line.Target() == line.LHS()) )
+	    line.setOp(op_nop);
+	if ( line.hasLabels() ){
+	    std::vector<int> labels = line.Labels(), keep;
+	    for ( size_t k = 0; k < labels.size(); k++ )
+		if ( !(ssa_Labels.count(labels[k])) || jumped_To.count(labels[k]) )
+		    keep.push_back(labels[k]);
+	    if ( (keep.size() != labels.size()) )
+		line.replaceLabels(keep);
+	}
+    }
+    removeNOPs(out);
+
+    List.swap(out);
+    ssa_Origins.clear();
+    ssa_Labels.clear();
+    ssa_Scaled.clear();
+    return changes;
+}
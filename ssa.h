@@ -0,0 +1,42 @@
+/********************************************************************
+* ssa.h - static single assignment form of the IR
+*
+* Into SSA (toSSA): unreachable blocks are dropped, every block gets a
+*         label (phi arguments name their predecessor by it), phis are
+*         placed at the iterated dominance frontier of the definitions
+*         of a value where it is live (pruned SSA; Cytron et al.), and
+*         every definition is renamed to a new tmp in a walk of the
+*         dominator tree. A use without a reaching definition keeps
+*         the original name (its value on entry).
+*         Scalar variables and tmps are renamed; array elements are
+*         memory, and stay as they are.
+* Out of SSA (fromSSA): each phi gets a tmp of its own, set by copies
+*         at the end of all predecessors, and read in place of the phi
+*         (no lost copies or swaps, no critical edges to split). Names
+*         then fall back to the original ones wherever their live
+*         ranges don't interfere, and the labels added are removed.
+*
+* Passes needing SSA form convert the list themselves if it is not
+* in SSA form yet, and leave it as they found it.
+*
+********************************************************************/
+
+#ifndef SSA_H_
+#define SSA_H_
+
+#include <map>
+
+#include "ir.h"
+#include "cfg.h"
+
+int inSSA(void);
+Operand ssaOrigin(Operand const& O);
+int withSSA(ir_Rep& List, int (*Pass)(ir_Rep&));
+void replaceUses(SSA_Entry& Line, std::map<Operand, Operand> const& Map);
+void dropPhiArgs(ir_Rep& List, CFG const& G, int From, int To);
+
+// passes
+int toSSA(ir_Rep& List);
+int fromSSA(ir_Rep& List);
+
+#endif
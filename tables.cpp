@@ -193,6 +193,25 @@ findVarFrame(Env* p, std::string Name)
     return 0;
 }
 
+// search the tree of frames below p (initial call: root_Env)
+Env*
+findEnvByName(Env* p, std::string Name)
+{
+    if ( (0 == p) ) return 0;
+    if ( (Name == p->getTableName()) )
+	return p;
+
+    std::vector<Env*>::const_iterator iter;
+    std::vector<Env*> c = p->Children();
+    for ( iter = c.begin(); iter != c.end(); iter++ ){
+	Env* ret = findEnvByName(*iter, Name);
+	if ( (0 != ret) )
+	    return ret;
+    }
+
+    return 0;
+}
+
 void
 printEnvAncestorInfo(Env* p)
 {
@@ -48,6 +48,7 @@ int addDeclToEnv(Env* pEnv, Decl_AST* new_Object, std::string MemType);
 Decl_AST* findVarByIdId(Env* p, IdExpr_AST* Id);
 Decl_AST* findVarByName(Env* p, std::string Name);
 Env* findVarFrame(Env* p, std::string Name);
+Env* findEnvByName(Env* p, std::string Name);
 
 // runtime globals
 class Symbol_Table;
@@ -65,7 +66,7 @@ public:
 	std::stringstream tmp;
 	tmp << "Env" << ++count_;
 	name_ = tmp.str();
-	runtime_StackAdj_ = std::vector<std::string>();
+	runtime_StackAdj_ = std::vector<Operand>();
 	if ( (0 != P) ) prior_->addChild(this);
     }
 
@@ -73,8 +74,8 @@ public:
     std::string getTableName(void) const { return name_; }
     std::map<std::string, Decl_AST*> getType(void) const { return type_; } 
 
-    void addAdj(std::string New_Adj) { runtime_StackAdj_.push_back(New_Adj); }
-    std::vector<std::string> getAdj(void) const { return runtime_StackAdj_; }
+    void addAdj(Operand New_Adj) { runtime_StackAdj_.push_back(New_Adj); }
+    std::vector<Operand> getAdj(void) const { return runtime_StackAdj_; }
 
     std::vector<Env*> Children(void) const { return children_; }
     void addChild(Env* C) { children_.push_back(C); }
@@ -107,7 +108,7 @@ private:
     std::string name_;
     Env* prior_;
     std::map<std::string, Decl_AST*> type_;
-    std::vector<std::string> runtime_StackAdj_; // for variable length arrays
+    std::vector<Operand> runtime_StackAdj_; // for variable length arrays
     std::vector<Env*> children_; // only use: to be able to de-allocate
     // the multi-ary tree starting at root_Env
 };
@@ -0,0 +1,263 @@
+/********************************************************************
+* tile.cpp - loop tiling (on the AST, before the visitor)
+*
+* In a perfect nest of for loops (c. interchange.cpp) over arrays
+* larger than the cache, an element (or its cache line) comes back
+* only after the loops inside have gone through all their iterations:
+*     for (i ...) for (k ...) for (j ...) c[i][j] = c[i][j] + a[i][k] * b[k][j];
+* reads all of b for each i. Tiling runs the loops of the nest but the
+* outermost in blocks of -T iterations, their tile loops around it:
+*     for (_k1 = e; _k1 < f; _k1 = _k1 + T) for (_j2 = ...)
+*       for (i ...) for (k = _k1; k < _k1 + T && k < f; k++)
+*         for (j = _j2; j < _j2 + T && j < f; j++) ...
+* so a T x T block of b is read for each i while it is in the cache.
+* Tiled are nests of loops i = e; i < f (or <=); i += c, c > 0, with
+* a body of assignments, if
+* - an access reuses a line across a loop that isn't the innermost
+*   (its stride in it is below INTERCHANGE_LINE) while a loop inside
+*   moves it (c. strideOf()),
+* - a loop to tile may run more than T trips,
+* - the loops may run in another order (c. whyNotPermuted()): the
+*   iterations meeting at an element written differ in one variable,
+*   whose tiles, and iterations in a tile, run in the order they did.
+* The tile variables are ints declared in front of the nest (_<var><n>,
+* not a name the source can use). Runs at -O 3, after interchange;
+* with -s, each nest is listed, and whether it was tiled.
+*
+********************************************************************/
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "tables.h"
+#include "nest.h"
+#include "opt.h"
+
+extern int option_Stats;
+extern int option_Tile; // -T: iterations per tile (1: no tiling)
+
+// For and the loops nested in it without other statements, outermost
+// first (empty: the innermost body has loops as well)
+static void
+nestOf(For_AST* F, std::vector<For_AST*>& Loops)
+{
+    Loops.clear();
+    for ( For_AST* loop = F; (0 != loop); ){
+	if ( (dynamic_cast<While_AST*>(loop)) ){
+	    Loops.clear();
+	    return;
+	}
+	Loops.push_back(loop);
+	std::vector<Node_AST*> stmts;
+	collectStmts(loop->RChild(), stmts);
+	loop = ( (1 == stmts.size()) )?dynamic_cast<For_AST*>(stmts[0]):0;
+	if ( (0 == loop) && (hasLoop(Loops.back()->RChild())) )
+	    Loops.clear();
+    }
+}
+
+// trips of L if its bounds are literals (-1: not known)
+static long
+tripsOf(Nest_Loop const& L)
+{
+    IterExprList_AST* list = L.List();
+    long first, end;
+    if ( !(intLiteral(list->Init()->RChild(), first)) ||
+	 !(intLiteral(list->Cond()->RChild(), end)) )
+	return -1;
+    if ( (tok_le == list->Cond()->Op().Tok()) )
+	end++;
+    return (end > first)?(end - first + L.Step() - 1) / L.Step():0;
+}
+
+// does an access use a line again across a loop (not the innermost)
+// while a loop inside that one moves it?
+static int
+hasReuse(std::vector<Nest_Loop> const& Loops,
+	 std::vector<ArrayIdExpr_AST*> const& Elems)
+{
+    for ( size_t k = 0; k < Elems.size(); k++ ){
+	std::vector<long> cost(Loops.size());
+	for ( size_t l = 0; l < Loops.size(); l++ )
+	    strideOf(Elems[k], Loops[l], cost[l]);
+	for ( size_t p = 0; p + 1 < Loops.size(); p++ )
+	    for ( size_t q = p + 1; q < Loops.size(); q++ )
+		if ( (INTERCHANGE_LINE > cost[p]) && (0 != cost[q]) )
+		    return 1;
+    }
+    return 0;
+}
+
+// a new int variable for the tiles of L, declared in Scope
+static IdExpr_AST*
+tileVar(Nest_Loop const& L, Env* Scope, std::vector<Node_AST*>& Decls)
+{
+    static int count = 0;
+
+    std::ostringstream tmp_Stream;
+    tmp_Stream << "_" << L.Name() << ++count;
+    IdExpr_AST* var = new IdExpr_AST(token(tok_int),
+				     token(tok_ID, tmp_Stream.str()), 1);
+    VarDecl_AST* decl = new VarDecl_AST(var);
+    int err_Code;
+    if ( (0 != (err_Code = addDeclToEnv(Scope, decl, "stack"))) )
+	errExit(0, "tile: cannot insert \"%s\" into symbol table (code %d)",
+		tmp_Stream.str().c_str(), err_Code);
+    Decls.push_back(decl);
+    return var;
+}
+
+// tiles the loops of the nest but the outermost; Vars: the tile variables
+static void
+tileNest(std::vector<Nest_Loop> const& Loops, long Size,
+	 std::vector<IdExpr_AST*>& Vars)
+{
+    For_AST* top = Loops[0].For();
+    Node_AST* parent = top->Parent();
+    Env* env_Old = top_Env;
+    int line_Old = line_No;
+    top_Env = top->getEnv(); // new nodes belong to the scope of the nest
+    line_No = top->Line();
+
+    std::vector<Node_AST*> decls;
+    std::vector<IterExprList_AST*> tiles;
+    for ( size_t l = 1; l < Loops.size(); l++ ){
+	IterExprList_AST* list = Loops[l].List();
+	IdExpr_AST* var = Loops[l].Var();
+	Expr_AST* first = dynamic_cast<Expr_AST*>(list->Init()->RChild());
+	Expr_AST* cond = list->Cond();
+	Expr_AST* end = dynamic_cast<Expr_AST*>(cond->RChild());
+	IdExpr_AST* tile = tileVar(Loops[l], top_Env, decls);
+	Vars.push_back(tile);
+
+	// tile = first; tile REL end; tile = tile + Size * step
+	std::ostringstream tmp_Stream;
+	tmp_Stream << Size * Loops[l].Step();
+	token width(tok_intV, tmp_Stream.str());
+	Expr_AST* next = new ArithmExpr_AST(token(tok_plus), tile,
+					    new IntExpr_AST(width));
+	tiles.push_back(new IterExprList_AST(new AssignExpr_AST(tile, first),
+					     new RelExpr_AST(cond->Op(), tile,
+							     end),
+					     new AssignExpr_AST(tile, next)));
+
+	// var = tile; var < tile + Size * step && var REL end; (as it was)
+	Expr_AST* last = new ArithmExpr_AST(token(tok_plus), tile,
+					    new IntExpr_AST(width));
+	Expr_AST* in = new AndExpr_AST(new RelExpr_AST(token(tok_lt), var, last),
+				       cond);
+	Loops[l].For()->setExprList(new IterExprList_AST(
+					new AssignExpr_AST(var, tile), in,
+					list->Iter()));
+    }
+
+    Block_AST* body = top;
+    for ( int l = tiles.size() - 1; l >= 0; l-- )
+	body = new For_AST(tiles[l], body);
+    Node_AST* stmts = body;
+    for ( int k = decls.size() - 1; k >= 0; k-- )
+	stmts = new StmtList_AST(decls[k], stmts);
+    parent->replaceChild(top, stmts);
+
+    top_Env = env_Old;
+    line_No = line_Old;
+}
+
+// tries to tile the nest headed by F (1: done, 0: kept, -1: no nest)
+static int
+tileAt(For_AST* F, Node_AST* Root)
+{
+    std::vector<For_AST*> fors;
+    nestOf(F, fors);
+    if ( (2 > fors.size()) || (0 == F->Parent()) )
+	return -1;
+    std::vector<Nest_Loop> loops(fors.size());
+    for ( size_t l = 0; l < fors.size(); l++ )
+	if ( !(headerOf(fors[l], loops[l])) )
+	    return -1;
+
+    std::ostringstream tmp_Stream;
+    std::string why;
+    std::vector<Node_AST*> body;
+    collectStmts(fors.back()->RChild(), body);
+    tmp_Stream << " (";
+    for ( size_t l = 0; l < loops.size(); l++ ){
+	tmp_Stream << ( (0 == l)?"":", " ) << loops[l].Name();
+	tokenType rel = loops[l].List()->Cond()->Op().Tok();
+	for ( size_t m = 0; m < l; m++ )
+	    if ( (loops[m].Var() == loops[l].Var()) )
+		why = "loops not of the form i = e; i < e; i++";
+	if ( (0 > loops[l].Step()) || ( (tok_lt != rel) && (tok_le != rel) ) )
+	    why = "loops not of the form i = e; i < e; i++";
+    }
+    tmp_Stream << ")";
+    for ( size_t k = 0; k < body.size(); k++ ){
+	Assign_AST* assign = dynamic_cast<Assign_AST*>(body[k]);
+	if ( ("" == why) && ( (0 == assign) || (0 == assign->RChild()) ||
+			      !(isPure(assign->LChild())) ||
+			      !(isPure(assign->RChild())) ) )
+	    why = "body not only assignments";
+    }
+
+    if ( ("" == why) ){
+	std::vector<ArrayIdExpr_AST*> elems;
+	for ( size_t k = 0; k < body.size(); k++ ){
+	    collectElems(body[k]->LChild(), elems);
+	    collectElems(body[k]->RChild(), elems);
+	}
+	int small = 1;
+	for ( size_t l = 1; l < loops.size(); l++ ){
+	    long trips = tripsOf(loops[l]);
+	    small = ( (small) && (-1 != trips) && (option_Tile >= trips) );
+	}
+	if ( !(hasReuse(loops, elems)) )
+	    why = "no reuse across the outer loops";
+	else if (small)
+	    why = "loops fit in a tile";
+	else
+	    why = whyNotPermuted(loops, Root, body);
+    }
+
+    std::vector<IdExpr_AST*> vars;
+    if ( ("" == why) )
+	tileNest(loops, option_Tile, vars);
+    if (option_Stats){
+	IterExprList_AST* list = loops[0].List();
+	std::cerr << "tile: loops at line " << list->Init()->Line();
+	std::cerr << tmp_Stream.str() << "; ";
+	if ( ("" == why) ){
+	    std::cerr << "tiled by " << option_Tile << " (";
+	    for ( size_t k = 0; k < vars.size(); k++ )
+		std::cerr << ( (0 == k)?"":", " ) << vars[k]->Op().Lex();
+	    std::cerr << ")\n";
+	}
+	else
+	    std::cerr << "kept (" << why << ")\n";
+    }
+    return ("" == why);
+}
+
+static int
+tileIn(Node_AST* N, Node_AST* Root)
+{
+    if ( (0 == N) || (dynamic_cast<Expr_AST*>(N)) )
+	return 0;
+    For_AST* loop = dynamic_cast<For_AST*>(N);
+    if ( (0 != loop) && !(dynamic_cast<While_AST*>(loop)) ){
+	int done = tileAt(loop, Root);
+	if ( (-1 != done) )
+	    return done;
+    }
+    return tileIn(N->LChild(), Root) + tileIn(N->RChild(), Root);
+}
+
+int
+tileLoops(Node_AST* Root)
+{
+    if ( (1 >= option_Tile) )
+	return 0;
+    return tileIn(Root, Root);
+}
@@ -0,0 +1,417 @@
+/********************************************************************
+* unroll.cpp - loop unrolling
+*
+* Out of SSA form, on loops as the visitor makes them (c. rotate.cpp):
+*     H: t = i < n; iffalse t goto Out; body; i = i + c; goto H
+* i a variable (or tmp) set by one line in the body, in the block of
+* the goto back (so once per iteration; a continue goes there as well),
+* c a constant, and n a constant or a value the loop doesn't set. The
+* loop occupies the lines from H to the goto; only its own jumps go to
+* labels in it, and only the goto back goes to H. Out is not a bound
+* error (c. CFG::isErrorExit()): where sccp folded the test of a loop
+* away, a bound check can take its place at H.
+* Trip count: with i set to a constant right before the loop, and n a
+*     constant, the test is evaluated as it would run (c. fold.h).
+* Full:    up to UNROLL_FULL_TRIPS trips, the body is copied once per
+*     trip, without the test; i is then a constant in each copy, so the
+*     passes after (sccp, ranges) fold the offsets and bound checks.
+* Partial: otherwise (innermost loops), -U copies of the body run while
+*     the last of them would still pass the test, and the loop as it
+*     was runs the remaining trips (if U divides the trips known, there
+*     are none, and it goes). The test is i != (i after the last trip of U
+*     copies) with the trips known, else i + (U - 1) * c < n, with i
+*     moving towards n (c > 0 for < and <=, c < 0 for > and >=). (That
+*     wraps, as i would, only for n a variable within (U - 1) * c of the
+*     end of the int range; a constant n that close isn't unrolled.)
+*     Loops with bound checks (jumps to the run-time error section)
+*     aren't partially unrolled: the copies would keep them.
+* The pass runs before SSA form (-O 3), for the constants of fully
+* unrolled loops to be folded, and after it, where loops have shed
+* their bound checks and carry strength-reduced offsets (c. ivsr.cpp).
+* A loop partially unrolled isn't unrolled again.
+* Copies get labels of their own; break still leaves for Out. Loops
+* growing beyond UNROLL_MAX_LINES lines stay as they are. With -s, the
+* loops unrolled are listed (to std::cerr).
+*
+********************************************************************/
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "ssa.h"
+#include "fold.h"
+#include "opt.h"
+#include "unroll.h"
+
+#define UNROLL_FULL_TRIPS 16
+#define UNROLL_MAX_LINES 512
+#define UNROLL_MAX_SIM (1 << 16) // trips evaluated at most
+
+extern int option_Unroll; // -U: copies per partially unrolled loop
+extern int option_Stats;
+
+// c of a line i = i + c, i = i - c (0: not one)
+long
+stepOf(SSA_Entry const& Line, Operand const& I)
+{
+    if ( (Line.Target() != I) )
+	return 0;
+    if ( (op_add == Line.Op()) && (Line.LHS() == I) && Line.RHS().isImm() )
+	return constOf(Line.RHS()).IntVal();
+    if ( (op_add == Line.Op()) && (Line.RHS() == I) && Line.LHS().isImm() )
+	return constOf(Line.LHS()).IntVal();
+    if ( (op_sub == Line.Op()) && (Line.LHS() == I) && Line.RHS().isImm() )
+	return -(constOf(Line.RHS()).IntVal());
+    return 0;
+}
+
+// the one line setting I in the block [First, Last] (-1: none, or more)
+static int
+ivDef(ir_Rep const& List, Unroll_Loop const& L, Operand const& I)
+{
+    int def = -1;
+    for ( int k = L.First(); k <= L.Last(); k++ )
+	if ( isValueOp(List[k].Op()) && (List[k].Target() == I) ){
+	    if ( (-1 != def) )
+		return -1;
+	    def = k;
+	}
+    return def;
+}
+
+static int
+definedIn(ir_Rep const& List, Unroll_Loop const& L, Operand const& O)
+{
+    for ( int k = L.First(); k <= L.Last(); k++ )
+	if ( isValueOp(List[k].Op()) && (List[k].Target() == O) )
+	    return 1;
+    return 0;
+}
+
+// jumps: only the loop's own reach labels in it, and only the goto back H
+static int
+isClosed(ir_Rep const& List, CFG const& G, Unroll_Loop const& L, int Out)
+{
+    std::set<int> inside;
+    for ( int k = L.First(); k <= L.Last(); k++ ){
+	std::vector<int> labels = List[k].Labels();
+	inside.insert(labels.begin(), labels.end());
+    }
+    int head = G.blockOfLine(L.First());
+    for ( int k = 0; k < static_cast<int>(List.size()); k++ ){
+	int label = jumpLabel(List[k]);
+	if ( (-1 == label) )
+	    continue;
+	int in = ( (L.First() <= k) && (L.Last() >= k) );
+	if ( !(in) && (inside.count(label)) )
+	    return 0;
+	if ( in && (head == G.blockOfLabel(label)) && (L.Last() != k) )
+	    return 0;
+	if ( in && !(inside.count(label)) && (-1 != G.blockOfLabel(label)) &&
+	     (Out != G.blockOfLabel(label)) )
+	    return 0;
+    }
+    return 1;
+}
+
+// trips of the test, evaluated from the constants (-1: not known)
+static long
+tripsOf(Unroll_Loop const& L, ir_Op Rel)
+{
+    if ( !(L.initKnown()) || !(L.Bound().isImm()) )
+	return -1;
+    Const_Val n = constOf(L.Bound());
+    Const_Val i = Const_Val(L.Init());
+    Const_Val c = Const_Val(L.Step());
+    for ( long trips = 0; trips <= UNROLL_MAX_SIM; trips++ ){
+	Const_Val t;
+	if ( !(foldOp(Rel, (L.ivLeft())?i:n, (L.ivLeft())?n:i, 0, t)) )
+	    return -1;
+	if ( t.isZero() )
+	    return trips;
+	foldOp(op_add, i, c, 0, i);
+    }
+    return -1;
+}
+
+// test relation with i on the left
+static ir_Op
+leftRel(ir_Op Rel, int Left)
+{
+    if ( (Left) )
+	return Rel;
+    switch(Rel){
+    case op_lt: return op_gt;
+    case op_le: return op_ge;
+    case op_gt: return op_lt;
+    case op_ge: return op_le;
+    default: return Rel;
+    }
+}
+
+// Returns 1 if loop Loop of G has the shape above (filling L)
+int
+analyzeLoop(ir_Rep const& List, CFG const& G, Loop_Info const& Loop,
+	    opd_Set const& Flt, Unroll_Loop& L)
+{
+    Basic_Block const& head = G.Block(Loop.Header());
+    if ( (1 != Loop.Latches().size()) || (2 != head.Size()) )
+	return 0;
+    Basic_Block const& latch = G.Block(Loop.Latches()[0]);
+    SSA_Entry const& cmp = List[head.First()];
+    SSA_Entry const& test = List[head.Last()];
+    if ( (op_goto != List[latch.Last()].Op()) || (op_iffalse != test.Op()) ||
+	 (test.Target() != cmp.Target()) || (op_lt > cmp.Op()) ||
+	 (op_ne < cmp.Op()) || (head.First() > latch.Last()) ||
+	 (0 == head.First()) )
+	return 0;
+    L = Unroll_Loop(head.First(), latch.Last());
+
+    std::set<int>::const_iterator iter;
+    for ( iter = Loop.Blocks().begin(); iter != Loop.Blocks().end(); iter++ )
+	if ( (G.Block(*iter).First() < L.First()) ||
+	     (G.Block(*iter).Last() > L.Last()) )
+	    return 0;
+    int out = G.blockOfLabel(jumpLabel(test));
+    if ( (-1 == out) || (Loop.contains(out)) || !(isClosed(List, G, L, out)) )
+	return 0;
+    if ( G.isErrorExit(jumpLabel(test)) ) // a bound check, not the exit
+	return 0;
+    for ( int k = L.First(); k <= L.Last(); k++ ){
+	if ( (op_movl == List[k].Op()) || (op_lea == List[k].Op()) ||
+	     (op_call == List[k].Op()) || (op_syscall == List[k].Op()) )
+	    return 0; // arrays sized at run time
+	if ( (isJump(List[k].Op())) && (-1 == G.blockOfLabel(jumpLabel(List[k]))) )
+	    L.setChecks();
+    }
+
+    // i: a variable of the test, the other side n
+    int left = isValue(cmp.LHS()) && (-1 != ivDef(List, L, cmp.LHS()));
+    Operand i = (left)?cmp.LHS():cmp.RHS();
+    Operand n = (left)?cmp.RHS():cmp.LHS();
+    if ( !(isValue(i)) || isFltOperand(i, Flt) || isFltOperand(n, Flt) ||
+	 !( n.isImm() || ( isValue(n) && !(definedIn(List, L, n)) ) ) )
+	return 0;
+    L.setIV(i, n, left);
+
+    int def = ivDef(List, L, i);
+    if ( (-1 == def) || (G.blockOfLine(def) != latch.Id()) )
+	return 0;
+    long c = stepOf(List[def], i);
+    int pair = ( (op_copy == List[def].Op()) && List[def].LHS().isTmp() )?
+	ivDef(List, L, List[def].LHS()):-1;
+    if ( (latch.First() <= pair) && (def > pair) ){
+	SSA_Entry t = List[pair]; // t = i + c; (...) i = t
+	t.setTarget(i);
+	c = stepOf(t, i);
+    }
+    if ( (0 == c) )
+	return 0;
+    L.setStep(c);
+
+    // i = k in the block entering the loop (falling through to H)
+    int pre = G.blockOfLine(L.First() - 1);
+    for ( int k = G.Block(pre).Last(); k >= G.Block(pre).First(); k-- )
+	if ( isValueOp(List[k].Op()) && (List[k].Target() == i) ){
+	    if ( (op_copy == List[k].Op()) && List[k].LHS().isImm() &&
+		 !(constOf(List[k].LHS()).isFlt()) )
+		L.setInit(constOf(List[k].LHS()).IntVal());
+	    break;
+	}
+    L.setTrips(tripsOf(L, cmp.Op()));
+    return 1;
+}
+
+// copy of lines [First, Last] of Old, labels made anew
+void
+copyLines(ir_Rep const& Old, int First, int Last, ir_Rep& New)
+{
+    std::map<int, int> fresh;
+    for ( int k = First; k <= Last; k++ ){
+	std::vector<int> labels = Old[k].Labels();
+	for ( size_t m = 0; m < labels.size(); m++ )
+	    fresh[labels[m]] = makeLabelId();
+    }
+    for ( int k = First; k <= Last; k++ ){
+	SSA_Entry line = Old[k];
+	std::vector<int> labels = line.Labels();
+	for ( size_t m = 0; m < labels.size(); m++ )
+	    labels[m] = fresh[labels[m]];
+	line.replaceLabels(labels);
+	std::map<int, int>::const_iterator iter = fresh.find(jumpLabel(line));
+	if ( (fresh.end() != iter) && (op_goto == line.Op()) )
+	    line.setTarget(Operand(opd_Label, iter->second));
+	else if ( (fresh.end() != iter) )
+	    line.setRHS(Operand(opd_Label, iter->second));
+	New.push_back(line);
+    }
+}
+
+// The test of a chunk of U trips of L (its lines appended to Test):
+// M: t = i != end; iffalse t goto H  (end: i after the last trip of
+//    the chunks), if the trips are known, else
+// M: last = i + (U - 1) * c; t = last REL n; iffalse t goto H
+// Returns 0 if i doesn't move towards n, or a constant n is too close to
+// the end of the int range for last not to wrap
+int
+chunkTest(ir_Rep const& List, Unroll_Loop const& L, int U, ir_Rep& Test)
+{
+    SSA_Entry const& cmp = List[L.First()];
+    ir_Op rel = leftRel(cmp.Op(), L.ivLeft());
+    Operand head = Operand(opd_Label, cmp.Labels()[0]);
+    Operand t = makeTmpOperand();
+    if ( (-1 != L.Trips()) ){
+	Const_Val end;
+	foldOp(op_mult, Const_Val(L.Step()),
+	       Const_Val(L.Trips() - L.Trips() % U), 0, end);
+	foldOp(op_add, Const_Val(L.Init()), end, 0, end);
+	Test.push_back(SSA_Entry(op_ne, t, L.IV(), constOperand(end),
+				 cmp.Frame()));
+	Test.push_back(SSA_Entry(op_iffalse, t, Operand(), head, cmp.Frame()));
+	return 1;
+    }
+
+    int toward = ( (op_lt == rel) || (op_le == rel) )?(0 < L.Step()):
+	( (op_gt == rel) || (op_ge == rel) )?(0 > L.Step()):0;
+    Const_Val ahead, end;
+    foldOp(op_mult, Const_Val(L.Step()), Const_Val(U - 1), 0, ahead);
+    if ( !(toward) || ( (L.Bound().isImm()) &&
+	 ( !(foldOp(op_add, constOf(L.Bound()), ahead, 0, end)) ||
+	   ( (0 < L.Step()) != (end.IntVal() > constOf(L.Bound()).IntVal()) ) ) ) )
+	return 0;
+    Operand last = makeTmpOperand();
+    Test.push_back(SSA_Entry(op_add, last, L.IV(), constOperand(ahead),
+			     cmp.Frame()));
+    Test.push_back(SSA_Entry(cmp.Op(), t, (L.ivLeft())?last:L.Bound(),
+			     (L.ivLeft())?L.Bound():last, cmp.Frame()));
+    Test.push_back(SSA_Entry(op_iffalse, t, Operand(), head, cmp.Frame()));
+    return 1;
+}
+
+static void
+report(ir_Rep const& List, Unroll_Loop const& L, int Copies, int Grown)
+{
+    if ( !(option_Stats) )
+	return;
+    int line = -1; // a test made by a pass has none
+    for ( int k = L.First(); (k <= L.Last()) && (-1 == line); k++ )
+	line = List[k].SrcLine();
+    std::cerr << "unroll: loop at line " << line << ": ";
+    if ( (0 == Copies) )
+	std::cerr << L.Trips() << " trips, fully unrolled";
+    else{
+	std::cerr << "by " << Copies;
+	if ( (-1 != L.Trips()) )
+	    std::cerr << " (" << L.Trips() << " trips)";
+	int rest = (-1 == L.Trips()) || (0 != L.Trips() % Copies);
+	std::cerr << ( (rest)?", remainder loop":", no remainder" );
+    }
+    std::cerr << ", " << ( (0 <= Grown)?"+":"" ) << Grown << " lines\n";
+}
+
+// headers of the loops partially unrolled (so far, by either run): the
+// unrolled one, and the one left for the remaining trips (and those
+// of loops vectorized, c. keepRolled())
+static std::set<int> unrolled_Heads;
+
+void
+keepRolled(int Head)
+{
+    unrolled_Heads.insert(Head);
+}
+
+// Unrolls L in List; returns 1 if it did
+static int
+unrollLoop(ir_Rep& List, Unroll_Loop const& L)
+{
+    int size = L.Last() - L.First() + 1;
+    int body_First = L.First() + 2;
+    int body_Last = L.Last() - 1;
+    SSA_Entry const cmp = List[L.First()];
+    ir_Rep old = List;
+    ir_Rep loop;
+    int copies = 0; // full
+
+    if ( (-1 != L.Trips()) && (UNROLL_FULL_TRIPS >= L.Trips()) &&
+	 (UNROLL_MAX_LINES >= L.Trips() * size) ){
+	loop.push_back(SSA_Entry(op_nop, Operand(), Operand(), Operand(),
+				 cmp.Frame(), cmp.LabelChain()));
+	for ( long k = 0; k < L.Trips(); k++ )
+	    copyLines(old, body_First, body_Last, loop);
+    }
+    else{
+	int u = copies = option_Unroll;
+	if ( (2 > u) || !(L.isInner()) || (L.hasChecks()) ||
+	     (UNROLL_MAX_LINES < u * size) ||
+	     ( (-1 != L.Trips()) && (u > L.Trips()) ) )
+	    return 0;
+
+	int top = makeLabelId();
+	int head = cmp.Labels()[0];
+	if ( !(chunkTest(old, L, u, loop)) )
+	    return 0;
+	loop[0].addLabel(top);
+	for ( int k = 0; k < u; k++ )
+	    copyLines(old, body_First, body_Last, loop);
+	loop.push_back(SSA_Entry(op_goto, Operand(opd_Label, top), Operand(),
+				 Operand(), cmp.Frame()));
+	if ( (-1 != L.Trips()) && (0 == L.Trips() % u) )
+	    loop.push_back(SSA_Entry(op_nop, Operand(), Operand(), Operand(),
+				     cmp.Frame(), cmp.LabelChain()));
+	else
+	    for ( int k = L.First(); k <= L.Last(); k++ )
+		loop.push_back(old[k]);
+	unrolled_Heads.insert(head);
+	unrolled_Heads.insert(top);
+    }
+    report(old, L, copies, loop.size() - size);
+
+    List.clear();
+    List.insert(List.end(), old.begin(), old.begin() + L.First());
+    List.insert(List.end(), loop.begin(), loop.end());
+    List.insert(List.end(), old.begin() + L.Last() + 1, old.end());
+    return 1;
+}
+
+int
+unrollLoops(ir_Rep& List)
+{
+    if ( (inSSA()) || (List.empty()) )
+	return 0;
+
+    int changes = 0;
+    std::set<int> tried; // headers
+    for ( int more = 1; more; ){
+	more = 0;
+	CFG g(List);
+	opd_Set flt;
+	findFloats(List, flt);
+	// inner loops first: deeper ones
+	for ( int depth = 16; (depth > 0) && !(more); depth-- )
+	    for ( size_t l = 0; (l < g.Loops().size()) && !(more); l++ ){
+		Loop_Info const& loop = g.Loops()[l];
+		SSA_Entry const& first = List[g.Block(loop.Header()).First()];
+		if ( (depth != loop.Depth()) || !(first.hasLabels()) ||
+		     tried.count(first.Labels()[0]) ||
+		     unrolled_Heads.count(first.Labels()[0]) )
+		    continue;
+		tried.insert(first.Labels()[0]);
+		Unroll_Loop u;
+		if ( !(analyzeLoop(List, g, loop, flt, u)) )
+		    continue;
+		for ( size_t m = 0; m < g.Loops().size(); m++ )
+		    if ( (static_cast<int>(l) == g.Loops()[m].Parent()) )
+			u.setInner(0);
+		if ( unrollLoop(List, u) ){
+		    changes++;
+		    more = 1;
+		}
+	    }
+    }
+    return changes;
+}
@@ -0,0 +1,70 @@
+/********************************************************************
+* unroll.h - counted loops, as unroll.cpp finds them
+*
+* The loops unroll.cpp works on (c. the shape described there): the
+* line of the test, the induction variable, its step and bound, and the
+* trips if known. Shared with vectorize.cpp, which runs a loop in
+* chunks of trips as well, guarded by the same test.
+*
+********************************************************************/
+
+#ifndef UNROLL_H_
+#define UNROLL_H_
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+
+// a loop of that shape, lines [First(), Last()] (Last(): goto H)
+class Unroll_Loop{
+public:
+Unroll_Loop(int First = -1, int Last = -1)
+    : first_(First), last_(Last), step_(0), init_Known_(0), init_(0),
+	trips_(-1), iv_Left_(1), checks_(0), inner_(1) {}
+
+    int First(void) const { return first_; }
+    int Last(void) const { return last_; }
+    Operand IV(void) const { return iv_; }
+    Operand Bound(void) const { return bound_; }
+    long Step(void) const { return step_; }
+    int ivLeft(void) const { return iv_Left_; } // i REL n (or n REL i)
+    long Trips(void) const { return trips_; }   // -1: not known
+
+    void setIV(Operand I, Operand N, int Left)
+    {
+	iv_ = I;
+	bound_ = N;
+	iv_Left_ = Left;
+    }
+    void setStep(long C) { step_ = C; }
+    void setInit(long V) { init_Known_ = 1; init_ = V; }
+    int initKnown(void) const { return init_Known_; }
+    long Init(void) const { return init_; }
+    void setTrips(long T) { trips_ = T; }
+    int hasChecks(void) const { return checks_; } // jumps to L_e0...
+    void setChecks(void) { checks_ = 1; }
+    int isInner(void) const { return inner_; } // no loop in it
+    void setInner(int I) { inner_ = I; }
+
+private:
+    int first_;
+    int last_;
+    Operand iv_;
+    Operand bound_;
+    long step_;
+    int init_Known_;
+    long init_;
+    long trips_;
+    int iv_Left_;
+    int checks_;
+    int inner_;
+};
+
+long stepOf(SSA_Entry const& Line, Operand const& I);
+int analyzeLoop(ir_Rep const& List, CFG const& G, Loop_Info const& Loop,
+		opd_Set const& Flt, Unroll_Loop& L);
+void copyLines(ir_Rep const& Old, int First, int Last, ir_Rep& New);
+int chunkTest(ir_Rep const& List, Unroll_Loop const& L, int U, ir_Rep& Test);
+void keepRolled(int Head); // a loop with this header isn't unrolled
+
+#endif
@@ -0,0 +1,567 @@
+/********************************************************************
+* vectorize.cpp - loop vectorization
+*
+* Out of SSA form, on the counted loops unroll.cpp finds (c. unroll.h),
+* innermost ones, before they are unrolled (-O 3); a loop headed by a
+* bound check, its own test folded away, isn't one of them. A loop is vectorized
+* if each trip is the same straight line code on the elements its
+* induction variables point to, e.g. for c[i] = a[i] * b[i] + d:
+*     t1 = (-x)a * (-x)b; t2 = t1 + d; (-x)c = t2
+* Each line a copy, +, - or * into a tmp or an element, of elements at
+* an induction variable x moving by their width (unit stride), of tmps
+* set before in the trip, of values the loop doesn't set (the same in
+* each lane), or of an induction variable (lanes i, i + c, ...: ints).
+* The elements are of one type. An array stored to is only accessed at
+* one operand, so a trip doesn't depend on another: lane k of a line
+* only reads what lane k of the lines before it wrote. The induction
+* variables are set at the end of the trip; tmps the loop sets are used
+* in it only. Such a loop becomes
+*     (values the same in each lane; lanes of induction variables)
+*  M: the test of W trips more (c. chunkTest()); iffalse goto H
+*     the bound checks of the W trips; iffalse goto H
+*     v*<W> V1, (-x)a, (-x)b; v+<W> (-x)c, V1, D
+*     x = x + W * c; goto M
+*  H: the loop as it was, for the trips left
+* W = VECTOR_BYTES / the width of the elements (4 ints, 2 doubles). The
+* lanes of tmps (and broadcast values) are scratch arrays of W elements,
+* _v1..., in the outermost frame; a tmp stored by the line after it is
+* not kept: its line writes the elements stored.
+* Bound checks left (t = n > i; iffalse t goto E, c. version.cpp) are
+* made once per chunk: for the first lane, and the last (i + (W - 1) *
+* c, which must not wrap around); they are linear in i, so all lanes
+* pass if those do. If one fails, the loop as it was runs from there,
+* and reports the error at the element it does now. With the trips
+* known and a multiple of W, and no checks, H goes. Loops vectorized
+* aren't unrolled after. With -s they are listed (to std::cerr).
+*
+********************************************************************/
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include "tables.h"
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "ssa.h"
+#include "fold.h"
+#include "opt.h"
+#include "unroll.h"
+
+#define VECTOR_BYTES 16 // an SSE register
+
+extern int option_Stats;
+
+// how a line of the loop sees an operand, trip by trip
+enum lane_Kind{ lane_Same, lane_Vector, lane_IV, lane_None };
+
+class Loop_Vectorizer{
+public:
+Loop_Vectorizer(ir_Rep& List, CFG const& G, Loop_Info const& Loop,
+		opd_Set const& Flt, Unroll_Loop const& L)
+    : list_(List), g_(G), loop_(Loop), flt_(Flt), l_(L), tail_(-1),
+	is_Flt_(-1), lanes_(0) {}
+
+    int analyze(void);
+    int apply(ir_Rep& Decs);
+
+private:
+    int inLoop(int I) const { return loop_.contains(g_.blockOfLine(I)); }
+    int nextIn(int I) const;
+    int findIVs(void);
+    int sameType(int Flt);
+    int hasLanes(Operand const& O) const;
+    lane_Kind kindOf(Operand const& O);
+    int analyzeLine(int I);
+    int analyzeCheck(int I);
+    Operand area(ir_Rep& Decs);
+    Operand elemAt(Operand const& Base, long Off) const;
+    Operand lanesOf(Operand const& O, ir_Rep& Pre, ir_Rep& Decs);
+    void makeChecks(int Head, ir_Rep& Loop);
+    void report(int Vector_Ops, int Keep) const;
+
+    ir_Rep& list_;
+    CFG const& g_;
+    Loop_Info const& loop_;
+    opd_Set const& flt_;
+    Unroll_Loop const& l_;
+    std::map<Operand, std::vector<int> > defs_; // in the loop
+    std::map<Operand, int> uses_;               // in the loop
+    std::map<Operand, int> uses_Out_;           // anywhere else
+    std::map<Operand, long> ivs_;               // -> step
+    std::set<int> iv_Lines_;
+    int tail_;                                  // first line setting one
+    std::vector<int> checks_;                   // their compares
+    std::vector<int> body_;                     // lines made vector ops
+    std::set<Operand> vectors_;                 // tmps set by those
+    std::map<int, std::set<Operand> > access_;  // array -> its elements
+    std::set<int> stored_;
+    int is_Flt_;                                // type of the elements
+    int lanes_;
+    std::map<Operand, Operand> lanes_Of_;       // value -> its lanes
+};
+
+// the next line after I in the loop (its blocks)
+int
+Loop_Vectorizer::nextIn(int I) const
+{
+    for ( int k = I + 1; k <= l_.Last(); k++ )
+	if ( inLoop(k) )
+	    return k;
+    return -1;
+}
+
+// the basic induction variables (i = i + c, or t = i + c; i = t, once
+// per trip), set by the lines at the end of the trip
+int
+Loop_Vectorizer::findIVs(void)
+{
+    int latch = loop_.Latches()[0];
+    std::map<Operand, std::vector<int> >::const_iterator iter;
+    for ( iter = defs_.begin(); iter != defs_.end(); iter++ ){
+	Operand i = iter->first;
+	if ( (1 != iter->second.size()) || isFltOperand(i, flt_) )
+	    continue;
+	int def = iter->second[0];
+	SSA_Entry const& line = list_[def];
+	long c = stepOf(line, i);
+	int pair = -1;
+	if ( (0 == c) && (op_copy == line.Op()) && line.LHS().isTmp() &&
+	     (defs_.count(line.LHS())) && (1 == defs_[line.LHS()].size()) &&
+	     (1 == uses_[line.LHS()]) && !(uses_Out_.count(line.LHS())) ){
+	    pair = defs_[line.LHS()][0];
+	    SSA_Entry t = list_[pair];
+	    t.setTarget(i);
+	    c = stepOf(t, i);
+	}
+	if ( (0 == c) )
+	    continue;
+	if ( (latch != g_.blockOfLine(def)) ||
+	     ( (-1 != pair) && (latch != g_.blockOfLine(pair)) ) )
+	    return 0;
+	ivs_[i] = c;
+	iv_Lines_.insert(def);
+	if ( (-1 != pair) )
+	    iv_Lines_.insert(pair);
+    }
+    if ( !(ivs_.count(l_.IV())) )
+	return 0;
+
+    // from the first of them to the goto back, nothing else runs
+    tail_ = *(iv_Lines_.begin());
+    for ( int k = tail_; k < l_.Last(); k++ )
+	if ( inLoop(k) && !(iv_Lines_.count(k)) && (op_nop != list_[k].Op()) )
+	    return 0;
+    return 1;
+}
+
+// the lanes of the loop are all of type Flt
+int
+Loop_Vectorizer::sameType(int Flt)
+{
+    if ( (-1 == is_Flt_) )
+	is_Flt_ = Flt;
+    return (Flt == is_Flt_);
+}
+
+// an element, or a value with lanes of its own (not a broadcast)
+int
+Loop_Vectorizer::hasLanes(Operand const& O) const
+{
+    return ( O.isElem() || ivs_.count(O) || vectors_.count(O) );
+}
+
+lane_Kind
+Loop_Vectorizer::kindOf(Operand const& O)
+{
+    if ( O.isImm() )
+	return lane_Same;
+    if ( O.isElem() ){
+	Operand x = O.Offset();
+	int flt = flt_.count(Operand(opd_Var, O.Id()));
+	long width = (flt)?TYPE_WIDTH_FLT:TYPE_WIDTH_INT;
+	if ( !(ivs_.count(x)) || (width != ivs_[x]) || !(sameType(flt)) )
+	    return lane_None;
+	access_[O.Id()].insert(O);
+	return lane_Vector;
+    }
+    if ( !(isValue(O)) )
+	return lane_None;
+    if ( ivs_.count(O) )
+	return ( sameType(0) )?lane_IV:lane_None;
+    if ( vectors_.count(O) )
+	return lane_Vector;
+    if ( defs_.count(O) ) // set later in the trip, or by no vector op
+	return lane_None;
+    return lane_Same;
+}
+
+// I: t = a OP b, or a copy, into a tmp or an element
+int
+Loop_Vectorizer::analyzeLine(int I)
+{
+    SSA_Entry const& line = list_[I];
+    Operand t = line.Target();
+    int vector = 0;
+    if ( t.isElem() ){
+	if ( (lane_Vector != kindOf(t)) )
+	    return 0;
+	stored_.insert(t.Id());
+	vector = 1;
+    }
+    else if ( !(t.isTmp()) || (1 != defs_[t].size()) ||
+	      (uses_Out_.count(t)) || (ivs_.count(t)) ||
+	      !(sameType(flt_.count(t))) )
+	return 0;
+
+    Operand opds[2] = { line.LHS(), line.RHS() };
+    int n = ( (op_copy == line.Op()) )?1:2;
+    for ( int k = 0; k < n; k++ ){
+	lane_Kind kind = kindOf(opds[k]);
+	if ( (lane_None == kind) ||
+	     ( (lane_Same == kind) && isFltOperand(opds[k], flt_) &&
+	       !(is_Flt_) ) )
+	    return 0;
+	if ( (lane_Same != kind) )
+	    vector = 1;
+    }
+    if ( !(vector) ) // the same in each lane: licm's business
+	return 0;
+    if ( t.isTmp() )
+	vectors_.insert(t);
+    body_.push_back(I);
+    return 1;
+}
+
+// I: t = a REL b; iffalse t goto E (E reporting an error), a and b
+// induction variables or values the loop doesn't set
+int
+Loop_Vectorizer::analyzeCheck(int I)
+{
+    SSA_Entry const& cmp = list_[I];
+    int next = nextIn(I);
+    if ( (op_lt > cmp.Op()) || (op_ge < cmp.Op()) || !(cmp.Target().isTmp()) ||
+	 (-1 == next) || (op_iffalse != list_[next].Op()) ||
+	 (list_[next].Target() != cmp.Target()) ||
+	 (1 != uses_[cmp.Target()]) || (uses_Out_.count(cmp.Target())) ||
+	 !(g_.isErrorExit(jumpLabel(list_[next]))) )
+	return 0;
+    Operand opds[2] = { cmp.LHS(), cmp.RHS() };
+    for ( int k = 0; k < 2; k++ )
+	if ( !( opds[k].isImm() || ivs_.count(opds[k]) ||
+		( isValue(opds[k]) && !(defs_.count(opds[k])) ) ) ||
+	     isFltOperand(opds[k], flt_) )
+	    return 0;
+    checks_.push_back(I);
+    return 1;
+}
+
+// Returns 1 if the loop can be vectorized
+int
+Loop_Vectorizer::analyze(void)
+{
+    if ( !(l_.isInner()) )
+	return 0;
+    std::vector<Operand> found;
+    for ( int k = 0; k < static_cast<int>(list_.size()); k++ ){
+	int in = ( (l_.First() <= k) && (l_.Last() >= k) );
+	lineUses(list_[k], found);
+	for ( size_t m = 0; m < found.size(); m++ )
+	    if (in)
+		uses_[found[m]]++;
+	    else
+		uses_Out_[found[m]]++;
+	lineDefs(list_[k], found);
+	if ( in && !(found.empty()) )
+	    defs_[found[0]].push_back(k);
+    }
+    std::map<Operand, std::vector<int> >::const_iterator iter;
+    for ( iter = defs_.begin(); iter != defs_.end(); iter++ )
+	if ( iter->first.isTmp() && (uses_Out_.count(iter->first)) )
+	    return 0;
+    if ( !(findIVs()) )
+	return 0;
+
+    for ( int k = l_.First() + 2; k < tail_; k++ ){
+	if ( !(inLoop(k)) )
+	    continue;
+	SSA_Entry const& line = list_[k];
+	switch(line.Op()){
+	case op_nop:
+	    break;
+	case op_goto: // on to the next line of the loop
+	    if ( (-1 == g_.blockOfLabel(jumpLabel(line))) ||
+		 (nextIn(k) !=
+		  g_.Block(g_.blockOfLabel(jumpLabel(line))).First()) )
+		return 0;
+	    break;
+	case op_copy: case op_add: case op_sub: case op_mult:
+	    if ( !(analyzeLine(k)) )
+		return 0;
+	    break;
+	case op_lt: case op_le: case op_gt: case op_ge:
+	    if ( !(analyzeCheck(k)) )
+		return 0;
+	    k = nextIn(k);
+	    break;
+	default:
+	    return 0;
+	}
+    }
+    if ( stored_.empty() || (-1 == is_Flt_) )
+	return 0;
+    std::set<int>::const_iterator a;
+    for ( a = stored_.begin(); a != stored_.end(); a++ )
+	if ( (1 != access_[*a].size()) )
+	    return 0;
+
+    lanes_ = VECTOR_BYTES / ( (is_Flt_)?TYPE_WIDTH_FLT:TYPE_WIDTH_INT );
+    return ( (-1 == l_.Trips()) || (lanes_ <= l_.Trips()) );
+}
+
+// scratch elements for the lanes of a value, in the outermost frame
+Operand
+Loop_Vectorizer::area(ir_Rep& Decs)
+{
+    static int count = 0;
+
+    int frame = -1;
+    for ( size_t i = 0; (i < list_.size()) && (-1 == frame); i++ )
+	frame = list_[i].Frame();
+    std::ostringstream tmp_Stream;
+    tmp_Stream << "_v" << ++count;
+    std::string name = tmp_Stream.str();
+    tokenType type = (is_Flt_)?tok_double:tok_int;
+    std::string lex = token(type).Lex();
+    ST[ir_Frames[frame].Name()].insertName(name, lex, "stack",
+					   lanes_ * typeWidth(lex));
+    Operand base = Operand(opd_Var, internVar(name, frame));
+    Decs.push_back(SSA_Entry(op_dec, base, Operand(opd_Type, type),
+			     Operand(), frame));
+    return elemAt(base, 0);
+}
+
+// element Off bytes into the array Base (an element, or its variable)
+Operand
+Loop_Vectorizer::elemAt(Operand const& Base, long Off) const
+{
+    Operand off = constOperand(Const_Val(Off));
+    return Operand(opd_Elem, Base.Id(), opd_Imm, off.Id());
+}
+
+// the lanes of O as an element (those of a value the same in each lane,
+// or of an induction variable, are set up in Pre)
+Operand
+Loop_Vectorizer::lanesOf(Operand const& O, ir_Rep& Pre, ir_Rep& Decs)
+{
+    if ( O.isElem() )
+	return O;
+    std::map<Operand, Operand>::const_iterator iter = lanes_Of_.find(O);
+    if ( (lanes_Of_.end() != iter) )
+	return iter->second;
+    Operand lanes = area(Decs);
+    lanes_Of_[O] = lanes;
+    int frame = list_[l_.First()].Frame();
+    if ( ivs_.count(O) ){
+	for ( int k = 0; k < lanes_; k++ ){
+	    Operand lane = O;
+	    if ( (0 < k) ){
+		Const_Val c;
+		foldOp(op_mult, Const_Val(ivs_[O]), Const_Val(k), 0, c);
+		lane = makeTmpOperand();
+		Pre.push_back(SSA_Entry(op_add, lane, O, constOperand(c), frame));
+	    }
+	    Pre.push_back(SSA_Entry(op_copy, elemAt(lanes, k * TYPE_WIDTH_INT),
+				    lane, Operand(), frame));
+	}
+    }
+    else if ( !(vectors_.count(O)) ){
+	SSA_Entry line(op_vcopy, lanes, O, Operand(), frame);
+	line.setLanes(lanes_);
+	Pre.push_back(line);
+    }
+    return lanes;
+}
+
+// the checks of a chunk: each of the first lane, then of the last (once
+// the induction variables in it don't wrap around to get there)
+void
+Loop_Vectorizer::makeChecks(int Head, ir_Rep& Loop)
+{
+    Operand head = Operand(opd_Label, Head);
+    std::map<Operand, Operand> last;
+    for ( size_t k = 0; k < checks_.size(); k++ ){
+	SSA_Entry const& cmp = list_[checks_[k]];
+	Operand opds[2] = { cmp.LHS(), cmp.RHS() };
+	int frame = cmp.Frame();
+	Operand t = makeTmpOperand();
+	Loop.push_back(SSA_Entry(cmp.Op(), t, opds[0], opds[1], frame));
+	Loop.push_back(SSA_Entry(op_iffalse, t, Operand(), head, frame));
+	int moves = 0;
+	for ( int m = 0; m < 2; m++ ){
+	    if ( !(ivs_.count(opds[m])) )
+		continue;
+	    moves = 1;
+	    if ( (last.count(opds[m])) )
+		continue;
+	    long c = ivs_[opds[m]];
+	    Const_Val ahead;
+	    foldOp(op_mult, Const_Val(c), Const_Val(lanes_ - 1), 0, ahead);
+	    Operand x = last[opds[m]] = makeTmpOperand();
+	    Operand w = makeTmpOperand();
+	    Loop.push_back(SSA_Entry(op_add, x, opds[m], constOperand(ahead),
+				     frame));
+	    Loop.push_back(SSA_Entry( (0 < c)?op_gt:op_lt, w, x, opds[m],
+				      frame));
+	    Loop.push_back(SSA_Entry(op_iffalse, w, Operand(), head, frame));
+	}
+	if ( !(moves) )
+	    continue;
+	t = makeTmpOperand();
+	Loop.push_back(SSA_Entry(cmp.Op(), t,
+				 (last.count(opds[0]))?last[opds[0]]:opds[0],
+				 (last.count(opds[1]))?last[opds[1]]:opds[1],
+				 frame));
+	Loop.push_back(SSA_Entry(op_iffalse, t, Operand(), head, frame));
+    }
+}
+
+void
+Loop_Vectorizer::report(int Vector_Ops, int Keep) const
+{
+    if ( !(option_Stats) )
+	return;
+    int line = -1; // a test made by a pass has none
+    for ( int k = l_.First(); (k <= l_.Last()) && (-1 == line); k++ )
+	line = list_[k].SrcLine();
+    std::cerr << "vectorize: loop at line " << line << ": " << lanes_
+	      << ( (is_Flt_)?" doubles":" ints" ) << " per chunk, "
+	      << Vector_Ops << " vector ops";
+    if ( !(checks_.empty()) )
+	std::cerr << ", " << checks_.size() << " bound checks per chunk";
+    if ( (-1 != l_.Trips()) )
+	std::cerr << " (" << l_.Trips() << " trips)";
+    std::cerr << ( (Keep)?", remainder loop\n":", no remainder\n" );
+}
+
+// Replaces the loop by its vector loop, and the loop as it was (Decs:
+// the declarations of the scratch arrays made); returns 1 if it did
+int
+Loop_Vectorizer::apply(ir_Rep& Decs)
+{
+    SSA_Entry const cmp = list_[l_.First()];
+    int frame = cmp.Frame();
+    int head = cmp.Labels()[0];
+    int top = makeLabelId();
+    ir_Rep pre, loop;
+    if ( !(chunkTest(list_, l_, lanes_, loop)) )
+	return 0;
+    loop[0].addLabel(top);
+    makeChecks(head, loop);
+
+    int ops = 0;
+    for ( size_t k = 0; k < body_.size(); k++ ){
+	SSA_Entry line = list_[body_[k]];
+	Operand t = line.Target();
+	// a tmp only stored by the next line: the line stores it
+	if ( t.isTmp() && (k + 1 < body_.size()) && (1 == uses_[t]) &&
+	     (op_copy == list_[body_[k + 1]].Op()) &&
+	     (list_[body_[k + 1]].LHS() == t) &&
+	     list_[body_[k + 1]].Target().isElem() ){
+	    t = list_[body_[++k]].Target();
+	}
+	line.setLabelChain(-1);
+	switch(line.Op()){
+	case op_copy: line.setOp(op_vcopy); break;
+	case op_add: line.setOp(op_vadd); break;
+	case op_sub: line.setOp(op_vsub); break;
+	default: line.setOp(op_vmult); break;
+	}
+	line.setTarget(lanesOf(t, pre, Decs));
+	if ( (op_vcopy != line.Op()) || hasLanes(line.LHS()) )
+	    line.setLHS(lanesOf(line.LHS(), pre, Decs));
+	if ( (op_vcopy != line.Op()) )
+	    line.setRHS(lanesOf(line.RHS(), pre, Decs));
+	line.setLanes(lanes_);
+	loop.push_back(line);
+	ops++;
+    }
+
+    std::map<Operand, long>::const_iterator iter;
+    for ( iter = ivs_.begin(); iter != ivs_.end(); iter++ ){
+	Const_Val c;
+	foldOp(op_mult, Const_Val(iter->second), Const_Val(lanes_), 0, c);
+	loop.push_back(SSA_Entry(op_add, iter->first, iter->first,
+				 constOperand(c), frame));
+	if ( !(lanes_Of_.count(iter->first)) )
+	    continue;
+	Operand lanes = lanes_Of_[iter->first];
+	SSA_Entry line(op_vadd, lanes, lanes, lanesOf(constOperand(c), pre,
+						      Decs), frame);
+	line.setLanes(lanes_);
+	loop.push_back(line);
+    }
+    loop.push_back(SSA_Entry(op_goto, Operand(opd_Label, top), Operand(),
+			     Operand(), frame));
+
+    int keep = ( (-1 == l_.Trips()) || (0 != l_.Trips() % lanes_) ||
+		 !(checks_.empty()) );
+    if ( (keep) )
+	loop.insert(loop.end(), list_.begin() + l_.First(),
+		    list_.begin() + l_.Last() + 1);
+    else
+	loop.push_back(SSA_Entry(op_nop, Operand(), Operand(), Operand(),
+				 frame, cmp.LabelChain()));
+    keepRolled(head);
+    keepRolled(top);
+    report(ops, keep);
+
+    ir_Rep old;
+    old.swap(list_);
+    list_.insert(list_.end(), old.begin(), old.begin() + l_.First());
+    list_.insert(list_.end(), pre.begin(), pre.end());
+    list_.insert(list_.end(), loop.begin(), loop.end());
+    list_.insert(list_.end(), old.begin() + l_.Last() + 1, old.end());
+    return 1;
+}
+
+int
+vectorizeLoops(ir_Rep& List)
+{
+    if ( (inSSA()) || (List.empty()) )
+	return 0;
+
+    int changes = 0;
+    ir_Rep decs;
+    std::set<int> tried; // headers
+    for ( int more = 1; more; ){
+	more = 0;
+	CFG g(List);
+	opd_Set flt;
+	findFloats(List, flt);
+	for ( size_t l = 0; (l < g.Loops().size()) && !(more); l++ ){
+	    Loop_Info const& loop = g.Loops()[l];
+	    SSA_Entry const& first = List[g.Block(loop.Header()).First()];
+	    if ( !(first.hasLabels()) || tried.count(first.Labels()[0]) )
+		continue;
+	    tried.insert(first.Labels()[0]);
+	    Unroll_Loop u;
+	    if ( !(analyzeLoop(List, g, loop, flt, u)) )
+		continue;
+	    for ( size_t m = 0; m < g.Loops().size(); m++ )
+		if ( (static_cast<int>(l) == g.Loops()[m].Parent()) )
+		    u.setInner(0);
+	    Loop_Vectorizer v(List, g, loop, flt, u);
+	    if ( v.analyze() && v.apply(decs) ){
+		changes++;
+		more = 1;
+	    }
+	}
+    }
+    // the scratch arrays are declared on entry
+    List.insert(List.begin(), decs.begin(), decs.end());
+    return changes;
+}
@@ -0,0 +1,434 @@
+/********************************************************************
+* version.cpp - loop versioning: bound checks hoisted to loop entry
+*
+* Bound checks (c. compAndJumpFalse()) range analysis could not remove
+* (ranges.cpp) are done once, in front of a loop, for all the values
+* the index takes in it. The loop is copied; if all the guards in
+* front of it pass, the loop without the checks runs, else the copy,
+* with all of them (any error is then reported as before). A check
+* comparing a constant with
+* - a value not changed in the loop: its guard is the same compare
+*   (or the same jump, if the compare was hoisted already);
+* - i + c, i the induction variable: the loop is entered at a test
+*   i < n (or i <= n), n not changed in the loop, and i is changed once
+*   in it, by adding a positive constant, after the check. i then goes
+*   from its value on entry up to n - 1 (n), and the guard compares
+*   these bounds instead. A lower bound is only hoisted together with
+*   an upper one (i could wrap around, else).
+* Checks that can't be hoisted stay in both versions. The copy with
+* the checks is not versioned again.
+* Not in SSA form.
+*
+********************************************************************/
+
+#include <set>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "ir.h"
+#include "cfg.h"
+#include "live.h"
+#include "ssa.h"
+#include "fold.h"
+#include "opt.h"
+
+#define VERSION_MAX_LINES 200 // size of a loop copied, at most
+#define VERSION_MAX_LOOPS 32  // loops versioned in one run, at most
+#define VERSION_MAX_CONST (1L << 24) // i + c can't overflow: |c|, |k| less
+
+std::set<int> version_Checked; // labels of the copies keeping the checks
+
+// a block of pushes, and a jump to the run-time error section
+int
+isErrorStub(CFG const& G, int B)
+{
+    return ( G.Block(B).Succs().empty() &&
+	     !(G.Block(B).ExitTargets().empty()) );
+}
+
+int
+isIntImm(Operand const& O)
+{
+    return ( O.isImm() && !(constOf(O).isFlt()) );
+}
+
+// Op mirrored: a < b is b > a
+ir_Op
+mirrorOp(ir_Op Op)
+{
+    switch(Op){
+    case op_lt: return op_gt;
+    case op_le: return op_ge;
+    case op_gt: return op_lt;
+    case op_ge: return op_le;
+    default: return Op;
+    }
+}
+
+class Loop_Version{
+public:
+    Loop_Version(ir_Rep& List, CFG const& G, int Loop,
+		 std::set<Operand> const& Ints);
+
+    int apply(void);
+
+private:
+    int findShape(void);
+    int findIncrement(void);
+    int afterIncrement(int B, int I) const;
+    void findChecks(void);
+    void addGuard(ir_Op Op, Operand L, Operand R, int Check);
+
+    ir_Rep& list_;
+    CFG const& g_;
+    Loop_Info const& loop_;
+    std::set<Operand> const& ints_; // declared int
+    int lo_, hi_;                   // lines copied
+    Operand iv_, bound_;
+    int test_Lt_;                   // i < n (else i <= n)
+    int incr_Block_, incr_Line_;
+    std::set<int> after_;           // blocks after the increment
+    std::map<Operand, int> defs_;   // # definitions in the loop
+    std::map<Operand, int> def_Line_;
+    std::vector<SSA_Entry> guards_;
+    std::vector<int> hoisted_;      // lines of the checks (iffalse)
+};
+
+Loop_Version::Loop_Version(ir_Rep& List, CFG const& G, int Loop,
+			   std::set<Operand> const& Ints)
+    : list_(List), g_(G), loop_(G.Loops()[Loop]), ints_(Ints), lo_(0),
+      hi_(0), test_Lt_(0), incr_Block_(-1), incr_Line_(-1)
+{
+}
+
+// the loop, with the error stubs it jumps to, is a range of lines
+// entered at its header only, by falling into it
+int
+Loop_Version::findShape(void)
+{
+    Basic_Block const& head = g_.Block(loop_.Header());
+    lo_ = head.First();
+    hi_ = head.Last();
+    if ( (0 == lo_) || !(list_[lo_].hasLabels()) )
+	return 0;
+    std::vector<int> labels = list_[lo_].Labels();
+    for ( size_t k = 0; k < labels.size(); k++ )
+	if ( version_Checked.count(labels[k]) )
+	    return 0;
+
+    std::set<int>::const_iterator iter;
+    for ( iter = loop_.Blocks().begin(); iter != loop_.Blocks().end(); iter++ ){
+	if ( (g_.Block(*iter).First() < lo_) )
+	    return 0;
+	hi_ = std::max(hi_, g_.Block(*iter).Last());
+    }
+    if ( (VERSION_MAX_LINES < hi_ - lo_ + 1) )
+	return 0;
+
+    int first = g_.blockOfLine(lo_), last = g_.blockOfLine(hi_);
+    for ( int b = first; b <= last; b++ ){
+	if ( !(loop_.contains(b)) && !(isErrorStub(g_, b)) )
+	    return 0;
+	std::vector<int> const& preds = g_.Block(b).Preds();
+	for ( size_t k = 0; k < preds.size(); k++ ){
+	    if ( (first <= preds[k]) && (preds[k] <= last) )
+		continue;
+	    if ( (b != first) || (first - 1 != preds[k]) ||
+		 isJump(list_[lo_ - 1].Op()) || endsFlow(list_[lo_ - 1]) )
+		return 0;
+	}
+    }
+
+    // the test: c = i < n; iffalse c goto exit
+    SSA_Entry const& jump = list_[head.Last()];
+    if ( (op_iffalse != jump.Op()) || (head.First() == head.Last()) ||
+	 loop_.contains(g_.blockOfLabel(jumpLabel(jump))) )
+	return 0;
+    SSA_Entry const& test = list_[head.Last() - 1];
+    if ( (test.Target() != jump.Target()) ||
+	 ( (op_lt != test.Op()) && (op_le != test.Op()) ) )
+	return 0;
+    iv_ = test.LHS();
+    bound_ = test.RHS();
+    test_Lt_ = (op_lt == test.Op());
+    if ( !(iv_.isVar()) || !(ints_.count(iv_)) )
+	return 0;
+    if ( !(isIntImm(bound_)) && !(isValue(bound_)) ) // int: i isn't cast
+	return 0;
+
+    std::vector<Operand> defs;
+    for ( iter = loop_.Blocks().begin(); iter != loop_.Blocks().end(); iter++ )
+	for ( int i = g_.Block(*iter).First(); i <= g_.Block(*iter).Last(); i++ ){
+	    lineDefs(list_[i], defs);
+	    for ( size_t k = 0; k < defs.size(); k++ )
+		if ( (1 == ++defs_[defs[k]]) )
+		    def_Line_[defs[k]] = i;
+	}
+    return ( !(defs_.count(bound_)) && (1 == defs_[iv_]) );
+}
+
+// i = i + k, or t = i + k; i = t
+int
+Loop_Version::findIncrement(void)
+{
+    std::vector<Operand> defs;
+    std::set<int>::const_iterator iter;
+    for ( iter = loop_.Blocks().begin(); iter != loop_.Blocks().end(); iter++ )
+	for ( int i = g_.Block(*iter).First(); i <= g_.Block(*iter).Last(); i++ ){
+	    lineDefs(list_[i], defs);
+	    if ( !(defs.empty()) && (iv_ == defs[0]) ){
+		incr_Block_ = *iter;
+		incr_Line_ = i;
+	    }
+	}
+
+    SSA_Entry add = list_[incr_Line_];
+    if ( (op_copy == add.Op()) ){
+	if ( (g_.Block(incr_Block_).First() == incr_Line_) ||
+	     (list_[incr_Line_ - 1].Target() != add.LHS()) )
+	    return 0;
+	add = list_[incr_Line_ - 1];
+    }
+    if ( (op_add != add.Op()) || (add.LHS() != iv_) || !(isIntImm(add.RHS())) )
+	return 0;
+    long step = constOf(add.RHS()).IntVal();
+    if ( (0 >= step) || (VERSION_MAX_CONST < step) )
+	return 0;
+
+    // blocks the increment reaches without going through the header
+    std::vector<int> work(1, incr_Block_);
+    while ( !(work.empty()) ){
+	int b = work.back();
+	work.pop_back();
+	std::vector<int> const& succs = g_.Block(b).Succs();
+	for ( size_t k = 0; k < succs.size(); k++ )
+	    if ( loop_.contains(succs[k]) && (loop_.Header() != succs[k]) &&
+		 !(after_.count(succs[k])) ){
+		after_.insert(succs[k]);
+		work.push_back(succs[k]);
+	    }
+    }
+    return 1;
+}
+
+// the induction variable may have been changed when line I of B runs
+int
+Loop_Version::afterIncrement(int B, int I) const
+{
+    if ( after_.count(B) )
+	return 1;
+    return ( (incr_Block_ == B) && (incr_Line_ - 1 <= I) );
+}
+
+void
+Loop_Version::addGuard(ir_Op Op, Operand L, Operand R, int Check)
+{
+    Const_Val res;
+    if ( L.isImm() && R.isImm() &&
+	 foldOp(Op, constOf(L), constOf(R), -1, res) ){
+	if ( res.isZero() ) // never passes: leave the check
+	    return;
+    }
+    else{
+	Operand g = makeTmpOperand();
+	guards_.push_back(SSA_Entry(Op, g, L, R, list_[lo_].Frame()));
+	guards_.push_back(SSA_Entry(op_iffalse, g, list_[Check].LHS(),
+				    Operand(), list_[lo_].Frame()));
+    }
+    hoisted_.push_back(Check);
+}
+
+void
+Loop_Version::findChecks(void)
+{
+    std::vector<SSA_Entry> lower_Guards;
+    std::vector<int> lower_Checks;
+    int uppers = 0;
+    long wrap = intMin(); // least i + c may not wrap around at
+
+    std::set<int>::const_iterator iter;
+    for ( iter = loop_.Blocks().begin(); iter != loop_.Blocks().end(); iter++ ){
+	if ( (loop_.Header() == *iter) )
+	    continue;
+	for ( int i = g_.Block(*iter).First() + 1; i <= g_.Block(*iter).Last(); i++ ){
+	    SSA_Entry const& jump = list_[i];
+	    SSA_Entry const& cmp = list_[i - 1];
+	    if ( (op_iffalse != jump.Op()) ||
+		 !(isErrorStub(g_, g_.blockOfLabel(jumpLabel(jump)))) )
+		continue;
+	    if ( isValue(jump.Target()) && !(defs_.count(jump.Target())) ){
+		// compared outside of the loop (licm.cpp): the same jump
+		guards_.push_back(SSA_Entry(op_iffalse, jump.Target(),
+					    jump.LHS(), Operand(),
+					    list_[lo_].Frame()));
+		hoisted_.push_back(i);
+		continue;
+	    }
+	    if ( (cmp.Target() != jump.Target()) ||
+		 (cmp.Op() < op_lt) || (op_ge < cmp.Op()) )
+		continue;
+
+	    // x op k
+	    ir_Op op = cmp.Op();
+	    Operand x = cmp.LHS(), k = cmp.RHS();
+	    if ( isIntImm(x) ){
+		std::swap(x, k);
+		op = mirrorOp(op);
+	    }
+	    if ( !(isIntImm(k)) || !(isValue(x)) )
+		continue;
+	    if ( !(defs_.count(x)) ){
+		addGuard(cmp.Op(), cmp.LHS(), cmp.RHS(), i);
+		continue;
+	    }
+
+	    // x = i + c, in the same iteration: i hasn't changed since
+	    long c = 0;
+	    if ( afterIncrement(*iter, i) )
+		continue;
+	    if ( (x != iv_) ){
+		int at = def_Line_[x], b = g_.blockOfLine(at);
+		if ( (1 != defs_[x]) || afterIncrement(b, at) ||
+		     !(g_.dominates(b, *iter)) || ( (b == *iter) && (at > i) ) )
+		    continue;
+		SSA_Entry const& def = list_[at];
+		if ( (op_add == def.Op()) && (def.LHS() == iv_) &&
+		     isIntImm(def.RHS()) )
+		    c = constOf(def.RHS()).IntVal();
+		else if ( (op_add == def.Op()) && (def.RHS() == iv_) &&
+			  isIntImm(def.LHS()) )
+		    c = constOf(def.LHS()).IntVal();
+		else if ( (op_sub == def.Op()) && (def.LHS() == iv_) &&
+			  isIntImm(def.RHS()) )
+		    c = -constOf(def.RHS()).IntVal();
+		else
+		    continue;
+	    }
+
+	    long bound = constOf(k).IntVal() - c;
+	    if ( (VERSION_MAX_CONST < labs(c)) ||
+		 (VERSION_MAX_CONST < labs(constOf(k).IntVal())) )
+		continue;
+	    if ( (op_lt == op) || (op_le == op) ){ // i + c < k: n - 1 + c < k
+		if ( test_Lt_ )
+		    bound++;
+		addGuard(op, bound_, constOperand(Const_Val(bound)), i);
+		if ( (0 > c) )
+		    wrap = std::max(wrap, intMin() - c);
+		uppers++;
+	    }
+	    else{ // i + c > k: i on entry + c > k
+		lower_Guards.push_back(SSA_Entry(op, iv_,
+						 constOperand(Const_Val(bound))));
+		lower_Checks.push_back(i);
+	    }
+	}
+    }
+
+    if ( (0 == uppers) )
+	return;
+    if ( lower_Guards.empty() && (intMin() < wrap) ) // i + c doesn't wrap
+	addGuard(op_ge, iv_, constOperand(Const_Val(wrap)), hoisted_.back());
+    for ( size_t k = 0; k < lower_Guards.size(); k++ )
+	addGuard(lower_Guards[k].Op(), lower_Guards[k].Target(),
+		 lower_Guards[k].LHS(), lower_Checks[k]);
+}
+
+// Returns 1 if the loop was versioned
+int
+Loop_Version::apply(void)
+{
+    if ( !(findShape()) || !(findIncrement()) )
+	return 0;
+    findChecks();
+    if ( hoisted_.empty() )
+	return 0;
+
+    // the copy keeping the checks, with labels of its own
+    std::map<int, int> labels;
+    std::vector<int> l;
+    for ( int i = lo_; i <= hi_; i++ ){
+	l = list_[i].Labels();
+	for ( size_t k = 0; k < l.size(); k++ )
+	    labels[l[k]] = makeLabelId();
+    }
+    ir_Rep copy(list_.begin() + lo_, list_.begin() + hi_ + 1);
+    for ( size_t i = 0; i < copy.size(); i++ ){
+	SSA_Entry& line = copy[i];
+	l = line.Labels();
+	for ( size_t k = 0; k < l.size(); k++ ){
+	    if ( (0 == i) || version_Checked.count(l[k]) )
+		version_Checked.insert(labels[l[k]]);
+	    l[k] = labels[l[k]];
+	}
+	line.replaceLabels(l);
+	std::map<int, int>::const_iterator to = labels.find(jumpLabel(line));
+	if ( (labels.end() == to) )
+	    continue;
+	if ( (op_goto == line.Op()) )
+	    line.setTarget(Operand(opd_Label, to->second));
+	else
+	    line.setRHS(Operand(opd_Label, to->second));
+    }
+    Operand copy_Head(opd_Label, labels[list_[lo_].Labels()[0]]);
+    for ( size_t k = 0; k < guards_.size(); k++ )
+	if ( (op_iffalse == guards_[k].Op()) )
+	    guards_[k].setRHS(copy_Head);
+
+    for ( size_t k = 0; k < hoisted_.size(); k++ )
+	makeNOP(list_[hoisted_[k]]);
+
+    // both fall through to the line after the loop
+    std::vector<SSA_Entry> exit;
+    if ( !(endsFlow(list_[hi_])) ){
+	if ( (list_.size() == (size_t)(hi_ + 1)) )
+	    list_.push_back(SSA_Entry(op_nop, Operand(), Operand(), Operand(),
+				      list_[hi_].Frame()));
+	if ( !(list_[hi_ + 1].hasLabels()) )
+	    list_[hi_ + 1].addLabel(makeLabelId());
+	exit.push_back(SSA_Entry(op_goto,
+				 Operand(opd_Label, list_[hi_ + 1].Labels()[0]),
+				 Operand(), Operand(), list_[hi_].Frame()));
+    }
+
+    ir_Rep out(list_.begin(), list_.begin() + lo_);
+    out.insert(out.end(), guards_.begin(), guards_.end());
+    out.insert(out.end(), list_.begin() + lo_, list_.begin() + hi_ + 1);
+    out.insert(out.end(), exit.begin(), exit.end());
+    out.insert(out.end(), copy.begin(), copy.end());
+    out.insert(out.end(), exit.begin(), exit.end());
+    out.insert(out.end(), list_.begin() + hi_ + 1, list_.end());
+    list_.swap(out);
+    return 1;
+}
+
+int
+versionLoops(ir_Rep& List)
+{
+    if ( inSSA() )
+	return 0;
+
+    std::set<Operand> ints;
+    for ( size_t i = 0; i < List.size(); i++ )
+	if ( (op_dec == List[i].Op()) && (tok_int == List[i].LHS().Id()) )
+	    ints.insert(List[i].Target());
+
+    int versioned = 0;
+    for ( int done = 1; done && (versioned < VERSION_MAX_LOOPS); ){
+	CFG g(List);
+	std::vector<std::pair<int, int> > order; // innermost loops first
+	for ( int l = 0; l < static_cast<int>(g.Loops().size()); l++ )
+	    order.push_back(std::make_pair(-g.Loops()[l].Depth(), l));
+	std::sort(order.begin(), order.end());
+
+	done = 0;
+	for ( size_t k = 0; !(done) && (k < order.size()); k++ ){
+	    Loop_Version v(List, g, order[k].second, ints);
+	    done = v.apply();
+	}
+	versioned += done;
+    }
+    return versioned;
+}
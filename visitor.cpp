@@ -5,7 +5,7 @@
 
 #include "visitor.h"
 
-std::string MakeIR_Visitor::last_Tmp_ = "";
+Operand MakeIR_Visitor::last_Tmp_;
 
 std::string MakeIR_Visitor::label_Break_ = "";
 std::string MakeIR_Visitor::label_Cont_ = "";
@@ -8,6 +8,7 @@
 *             re-factored to greatly simplify the emission of labels
 *             in || and && objects; and to a lesser extent in if -
 *             else if - else tropes.
+*             Conditions of if/for/while at -O 1 and up: c. jumpIf().
 *
 * Errors: 
 * Compile-time: when visitor operates, handed on code should be 
@@ -31,6 +32,7 @@
 
 typedef std::vector<std::string> label_Vec;
 extern int option_Debug;
+extern int option_OptLevel;
 
 class MakeIR_Visitor: public AST_Visitor{
 public:
@@ -83,19 +85,20 @@ public:
     void visit(PreIncrIdExpr_AST* V) 
     {
 	if (option_Debug) std::cout << "\tvisiting PreIncrIdExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	label_Vec labels = active_Labels_;
 	active_Labels_.clear();
 	Env* pFrame = V->getEnv();
 	std::string frame = pFrame->getTableName();
 
-	V->setAddr( (V->Name())->Addr() ); // don't forget update!
-	std::string target = V->Addr();
+	V->setOpd( opdOf(V->Name()) ); // don't forget update!
+	Operand target = V->Opd();
 	token op;
 	op = ( (1 == V->IncValue()) )?tok_plus:tok_minus;
-	std::string LHS = target;
-	std::string RHS = "1";
-	SSA_Entry* line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	Operand LHS = target;
+	Operand RHS = makeImmOperand("1");
+	SSA_Entry line(labels, op, target, LHS, RHS, frame);
 	insertLine(line, iR_List);
 
 	needs_Label_ = 0;
@@ -104,34 +107,35 @@ public:
     void visit(PostIncrIdExpr_AST* V) 
     {
 	if (option_Debug) std::cout << "\tvisiting PostIncrIdExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	label_Vec labels = active_Labels_;
 	active_Labels_.clear();
 	Env* pFrame = V->getEnv();
 	std::string frame = pFrame->getTableName();
-	std::string target, LHS, RHS;
+	Operand target, LHS, RHS;
 	token op;
-	SSA_Entry* line;
+	SSA_Entry line;
 
 	// create a tmp linking to the variable to use in post-increment
 	// Note: not needed if this is a line a++;
-	V->setAddr( (V->Name())->Addr() ); // don't forget update!
-	LHS = V->Addr();
+	V->setOpd( opdOf(V->Name()) ); // don't forget update!
+	LHS = V->Opd();
 	if ( !(dynamic_cast<Assign_AST*>(V->Parent())) ){
 	    target = makeTmp();
 	    op = tok_eq;
-	    line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	    line = SSA_Entry(labels, op, target, LHS, RHS, frame);
 	    insertLine(line, iR_List);
 	    labels.clear();
-	    // hand it on for use in next Addr() retrieval (c. IdExpr_AST)
-	    V->setTmpAddr(target);
+	    // hand it on for use in next Opd() retrieval (c. IdExpr_AST)
+	    V->setTmpOpd(target);
 	}
 
 	// post-increment
 	target = LHS;
 	op = ( (1 == V->IncValue()) )?tok_plus:tok_minus;
-	RHS = "1";
-	line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	RHS = makeImmOperand("1");
+	line = SSA_Entry(labels, op, target, LHS, RHS, frame);
 	insertLine(line, iR_List);
 
 	needs_Label_ = 0;
@@ -140,15 +144,16 @@ public:
     void visit(ArrayIdExpr_AST* V)
     {
 	if (option_Debug) std::cout << "visiting ArrayIdExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	std::ostringstream tmp_Stream;
 	Env* pFrame = V->getEnv();
 	std::string frame = pFrame->getTableName();
-	std::string target;
+	Operand target;
 	token op;
-	std::string LHS;
-	std::string RHS;
-	SSA_Entry* line;
+	Operand LHS;
+	Operand RHS;
+	SSA_Entry line;
 	label_Vec labels = active_Labels_;
 	active_Labels_.clear();
 
@@ -161,15 +166,18 @@ public:
 	if ( (V->numDims() != defined->numDims()) )
 	    errExit(0, "fatal logic error in calculating array dimensions");
 	int size = V->numDims();
-	tmp_Stream << defined->Expr()->TypeW();
-	std::string width = tmp_Stream.str();
-	tmp_Stream.str("");
 	int def_HasFinals = V->allInts(); // always here, but still need (*)
 	int acc_HasFinals = defined->allInts();
-	// recall that define->DimsFinal() already has calculated bounds
-	std::vector<std::string> bounds = *(defined->DimsFinal());
+	// recall that defined has calculated bounds: literals, or (if sized
+	// at run time) their operands
+	std::vector<Operand> bounds = defined->DimOpds();
+	if ( (acc_HasFinals) ){
+	    std::vector<std::string>::const_iterator iter;
+	    for ( iter = defined->DimsFinal()->begin();
+		  iter != defined->DimsFinal()->end(); iter++ )
+		bounds.push_back(makeImmOperand(*iter));
+	}
 	std::vector<Expr_AST*> access_Expr = *(V->Dims());
-	std::vector<std::string> access = *(V->DimsFinal());
 
 	// Bound check
 	// All dimensions = integers handled in parser; if at least one
@@ -180,16 +188,16 @@ public:
 	    std::string e_bound = makeLabel();
 
 	    // initialize offset calculation variables (c. parseArrayIdExpr())
-	    std::string offset;
-	    std::string size_Par;
+	    Operand offset;
+	    Operand size_Par;
 	    op = token(tok_eq);
 	    target = offset = makeTmp();
-	    LHS = "0";
-	    line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	    LHS = makeImmOperand("0");
+	    line = SSA_Entry(labels, op, target, LHS, RHS, frame);
 	    insertLine(line, iR_List);
 	    target = size_Par = makeTmp();
-	    LHS = "1";
-	    line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	    LHS = makeImmOperand("1");
+	    line = SSA_Entry(labels, op, target, LHS, RHS, frame);
 	    insertLine(line, iR_List);
 
 	    // Iterate per dimension: bound check, then update offset/size_P
@@ -197,35 +205,34 @@ public:
 	    // is easier that way, .
 	    for ( int i = (size-1); i >= 0; i-- ){
 		Expr_AST* a_Expr = access_Expr[i];
-		std::string a_Str;
-		std::string d_Str = bounds[i];
+		Operand a_Opd;
+		Operand d_Opd = bounds[i];
  		if ( dynamic_cast<IntExpr_AST*>(a_Expr) || 
 		     (dynamic_cast<IdExpr_AST*>(a_Expr)) ){
-		    a_Str = a_Expr->Addr();
+		    a_Opd = opdOf(a_Expr);
 		}
 		else{
 		    a_Expr->accept(this);
-		    a_Str = last_Tmp_;
+		    a_Opd = last_Tmp_;
 		}
-		V->addToDimsFinalFront(a_Str); // we are building backwards
 
 		// jump and continue if (expr < 0) or (expr > bound)
-		compAndJumpFalse(e_zero, token(tok_le), "0", a_Str, frame);
-		compAndJumpFalse(e_bound, token(tok_gt), d_Str,a_Str,frame);
+		Operand zero = makeImmOperand("0");
+		compAndJumpFalse(e_zero, token(tok_le), zero, a_Opd, frame);
+		compAndJumpFalse(e_bound, token(tok_gt), d_Opd,a_Opd,frame);
 
 		// update offset and size_Par
-		adj_Offset(offset, a_Str, size_Par, d_Str, frame);
+		adj_Offset(offset, a_Opd, size_Par, d_Opd, frame);
 	    }
 	    // account for type width (bytes), and finalize address
 	    op = token(tok_mult);
 	    target = offset;
 	    tmp_Stream << V->TypeW();
-	    LHS = tmp_Stream.str();
+	    LHS = makeImmOperand(tmp_Stream.str());
 	    tmp_Stream.str("");
-	    line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	    line = SSA_Entry(labels, op, target, LHS, RHS, frame);
 	    insertLine(line, iR_List);
-	    tmp_Stream << "(-" <<  offset << ")" << defined->Addr();
-	    V->setAddr(tmp_Stream.str());
+	    V->setOpd(makeElemOperand(varOf(defined->Expr()), offset));
 
 	    // prepare jump to runtime error by pushing lNo & variable name
 	    int lNo = V->Line();
@@ -238,6 +245,7 @@ public:
     void visit(PreIncrArrayIdExpr_AST* V) 
     {
 	if (option_Debug) std::cout << "\tvisiting PreIncrArrayIdExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	(V->Name())->accept(this); // get offset/address
 
@@ -245,13 +253,13 @@ public:
 	active_Labels_.clear();
 	Env* pFrame = V->getEnv();
 	std::string frame = pFrame->getTableName();
-	V->setAddr( (V->Name())->Addr() ); // don't forget update!
-	std::string target = V->Addr();
+	V->setOpd( opdOf(V->Name()) ); // don't forget update!
+	Operand target = V->Opd();
 	token op;
 	op = ( (1 == V->IncValue()) )?tok_plus:tok_minus;
-	std::string LHS = target;
-	std::string RHS = "1";
-	SSA_Entry* line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	Operand LHS = target;
+	Operand RHS = makeImmOperand("1");
+	SSA_Entry line(labels, op, target, LHS, RHS, frame);
 	insertLine(line, iR_List);
 
 	needs_Label_ = 0;
@@ -260,6 +268,7 @@ public:
     void visit(PostIncrArrayIdExpr_AST* V) 
     {
 	if (option_Debug) std::cout <<"\tvisiting PostIncrArrayIdExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	(V->Name())->accept(this); // get offset/address
 
@@ -267,29 +276,29 @@ public:
 	active_Labels_.clear();
 	Env* pFrame = V->getEnv();
 	std::string frame = pFrame->getTableName();
-	std::string target, LHS, RHS;
+	Operand target, LHS, RHS;
 	token op;
-	SSA_Entry* line;
+	SSA_Entry line;
 
 	// create a tmp linking to the variable to use in post-increment
 	// Note: not needed if this is a line a++;
-	V->setAddr( (V->Name())->Addr() ); // don't forget update!
-	LHS = V->Addr();
+	V->setOpd( opdOf(V->Name()) ); // don't forget update!
+	LHS = V->Opd();
 	if ( !(dynamic_cast<Assign_AST*>(V->Parent())) ){
 	    target = makeTmp();
 	    op = tok_eq;
-	    line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	    line = SSA_Entry(labels, op, target, LHS, RHS, frame);
 	    insertLine(line, iR_List);
 	    labels.clear();
-	    // hand it on for use in next Addr() retrieval (c. IdExpr_AST)
-	    V->setTmpAddr(target);
+	    // hand it on for use in next Opd() retrieval (c. IdExpr_AST)
+	    V->setTmpOpd(target);
 	}
 
 	// post-increment
 	target = LHS;
 	op = ( (1 == V->IncValue()) )?tok_plus:tok_minus;
-	RHS = "1";
-	line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	RHS = makeImmOperand("1");
+	line = SSA_Entry(labels, op, target, LHS, RHS, frame);
 	insertLine(line, iR_List);
 
 	needs_Label_ = 0;
@@ -313,6 +322,7 @@ public:
     void visit(ArithmExpr_AST* V)
     {  
 	if (option_Debug) std::cout << "\tvisiting ArithmExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	std::string frame = V->getEnv()->getTableName();
 	needs_Label_ = 0;
@@ -327,19 +337,20 @@ public:
 
 	label_Vec labels = active_Labels_;
 	active_Labels_.clear();
-	std::string target = makeTmp();
-	V->setAddr(target);
+	Operand target = makeTmp();
+	V->setOpd(target);
 	token Op = V->Op();
-	std::string LHS = V->LChild()->Addr();
-	std::string RHS = V->RChild()->Addr();
+	Operand LHS = opdOf(V->LChild());
+	Operand RHS = opdOf(V->RChild());
 
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, LHS, RHS, frame);
+	SSA_Entry line(labels, Op, target, LHS, RHS, frame);
 	insertLine(line, iR_List);
     }
 
     void visit(CoercedExpr_AST* V)
     {
 	if (option_Debug) std::cout << "\tvisiting CoercedExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	std::string frame = V->getEnv()->getTableName();
 	needs_Label_ = 0;
@@ -354,25 +365,25 @@ public:
 
 	label_Vec labels = active_Labels_;
 	active_Labels_.clear();
-	std::string target = makeTmp();
-	V->setAddr(target);
+	Operand target = makeTmp();
+	V->setOpd(target);
 	token Op = token(tok_cast);
-	std::string LHS = V->RChild()->Addr();  // lChild has tmp assigned to
-	std::string to_Str;
+	Operand LHS = opdOf(V->RChild());  // lChild has tmp assigned to
 	switch (V->To()){
-	case tok_int: to_Str = "int"; break;
-	case tok_double: to_Str = "double"; break;
+	case tok_int: case tok_double: break;
 	default:
 	    errExit(0, "invalid use of visit(CoercedExpr_AST*)");
 	}
+	Operand to(opd_Type, V->To());
 
-	SSA_Entry* line = new SSA_Entry(labels, Op, target,LHS, to_Str, frame);;
+	SSA_Entry line(labels, Op, target,LHS, to, frame);
 	insertLine(line, iR_List);
     }
 
     void visit(UnaryArithmExpr_AST* V)
     {
 	if (option_Debug) std::cout << "\tvisiting UnaryArithmExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	std::string frame = V->getEnv()->getTableName();
 	needs_Label_ = 0;
@@ -384,12 +395,12 @@ public:
 
 	label_Vec labels = active_Labels_;
 	active_Labels_.clear();
-	std::string target = makeTmp();
-	V->setAddr(target);
+	Operand target = makeTmp();
+	V->setOpd(target);
 	token Op = V->Op();
-	std::string LHS = V->LChild()->Addr();
+	Operand LHS = opdOf(V->LChild());
 
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, LHS, "", frame);
+	SSA_Entry line(labels, Op, target, LHS, Operand(), frame);
 	insertLine(line, iR_List);
     }
 
@@ -397,6 +408,7 @@ public:
     void visit(AssignExpr_AST* V)
     {
 	if (option_Debug) std::cout << "\tvisiting AssignExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	std::string frame = V->getEnv()->getTableName();
 	// get expr to be assigned ready
@@ -408,23 +420,24 @@ public:
 
 	label_Vec labels = active_Labels_;
 	active_Labels_.clear();
-	std::string target, LHS, RHS;
+	Operand target, LHS, RHS;
 	token op;
 	// handle '+' in case we actually have '+=' (and similar)
 	// Note: this means that in a += expr <=> a = a + expr, 
 	//       pre-increments to a in expr affect the second a too. 
 	ModAssignExpr_AST* tmp_AST;
 	if ( (tmp_AST = dynamic_cast<ModAssignExpr_AST*>(V)) ){
-	    target = LHS = V->LChild()->Addr();
+	    target = LHS = opdOf(V->LChild());
 	    op = tmp_AST->ModType();
-	    RHS = V->RChild()->Addr();
+	    RHS = opdOf(V->RChild());
 	}
 	else{ // regular '=' assignment
-	    target = V->LChild()->Addr();
+	    target = opdOf(V->LChild());
 	    op = token(tok_eq);
-	    LHS = V->RChild()->Addr();
+	    LHS = opdOf(V->RChild());
 	}
-	SSA_Entry* line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	V->setOpd(target); // the value of the expression
+	SSA_Entry line(labels, op, target, LHS, RHS, frame);
 	insertLine(line, iR_List);
     }
 
@@ -441,6 +454,7 @@ public:
     void visit(OrExpr_AST* V)
     {
 	if (option_Debug) std::cout << "\tvisiting OrExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	std::string frame = V->getEnv()->getTableName();
 	std::string cond_End = makeLabel(); 
@@ -448,7 +462,7 @@ public:
 	// If we have an || expression as the outer expression of a
 	// compound expression index of a dynamic array, this is the
 	// variable to hand on to a caller.  (*)
-	std::string res_Var = makeTmp(); 
+	Operand res_Var = makeTmp(); 
 
 	// get to bottom left
 	while ( (dynamic_cast<OrExpr_AST*>(V->LChild())) )
@@ -461,10 +475,10 @@ public:
 	// ...and assign its result to the status variable (res_Var)
 	label_Vec labels;
 	token Op = token(tok_eq);
-	std::string target = res_Var;
-	std::string LHS = V->LChild()->Addr();
-	std::string RHS = "";
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, LHS,RHS, frame);
+	Operand target = res_Var;
+	Operand LHS = opdOf(V->LChild());
+	Operand RHS;
+	SSA_Entry line(labels, Op, target, LHS,RHS, frame);
 	insertLine(line, iR_List);
 
 	doOr(V, res_Var, cond_End);
@@ -481,26 +495,26 @@ public:
 
     // if we find OrExprList = OrExpr(LHS, OrExprList), the current
     // RHS is in position V->RChild()->LChild()
-    void doOr(OrExpr_AST* V, std::string res_Var, std::string cond_End)
+    void doOr(OrExpr_AST* V, Operand res_Var, std::string cond_End)
     {
 	std::string cond_First = makeLabel();
 
 	// make iffalse SSA entry
 	label_Vec labels;
 	token Op = token(tok_iffalse);
-	std::string target = res_Var;
-	std::string LHS = "goto";
-	std::string RHS = cond_First;
+	Operand target = res_Var;
+	Operand LHS;
+	Operand RHS = labelOpd(cond_First);
 	Env* pFrame = V->getEnv();
 	std::string frame_Str = pFrame->getTableName();
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, LHS,RHS, frame_Str);
+	SSA_Entry line(labels, Op, target, LHS,RHS, frame_Str);
 	insertLine(line, iR_List);
 
 	// jump over expr 2
 	Op = token(tok_goto);
-	target = cond_End;
-	LHS = RHS = "";
-	line = new SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
+	target = labelOpd(cond_End);
+	LHS = RHS = Operand();
+	line = SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
 	insertLine(line, iR_List);
 
 	// handle expr2
@@ -512,16 +526,16 @@ public:
 	// ...and assign its result to the status variable (res_Var)
 	Op = token(tok_eq);
 	target = res_Var;
-	LHS = V->RChild()->Addr();
-	RHS = "";
-	line = new SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
+	LHS = opdOf(V->RChild());
+	RHS = Operand();
+	line = SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
 	insertLine(line, iR_List);
 
 	if ( (dynamic_cast<OrExpr_AST*>(V->Parent())) )
 	    doOr(dynamic_cast<OrExpr_AST*>(V->Parent()), res_Var, cond_End);
 	else{
-	    if ( ("" == V->Addr()) )
-		V->setAddr(res_Var);
+	    if ( (V->Opd().isNone()) )
+		V->setOpd(res_Var);
 	    return;
 	}
     }
@@ -530,13 +544,14 @@ public:
     void visit(AndExpr_AST* V)
     {
 	if (option_Debug) std::cout << "\tvisiting AndExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	std::string frame = V->getEnv()->getTableName();
 	// variable holding the truth value of the overall expression. 
 	// If we have an || expression as the outer expression of a
 	// compound expression index of a dynamic array, this is the
 	// variable to hand on to a caller.  (*)
-	std::string res_Var = makeTmp();
+	Operand res_Var = makeTmp();
 	std::string cond_End = makeLabel();
 
 	// get to bottom left
@@ -550,10 +565,10 @@ public:
 	// ...and assign its result to the status variable (res_Var)
 	label_Vec labels;
 	token Op = token(tok_eq);
-	std::string target = res_Var;
-	std::string LHS = V->LChild()->Addr();
-	std::string RHS = "";
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, LHS, RHS, frame);
+	Operand target = res_Var;
+	Operand LHS = opdOf(V->LChild());
+	Operand RHS;
+	SSA_Entry line(labels, Op, target, LHS, RHS, frame);
 	insertLine(line, iR_List);
 
 	doAnd(V, res_Var, cond_End);
@@ -570,26 +585,26 @@ public:
 
     // if we find OrExprList = OrExpr(LHS, OrExprList), the current
     // RHS is in position V->RChild()->LChild()
-    void doAnd(AndExpr_AST* V, std::string res_Var, std::string cond_End)
+    void doAnd(AndExpr_AST* V, Operand res_Var, std::string cond_End)
     {
 	std::string cond_First = makeLabel();
 
 	// make iftrue SSA entry
 	label_Vec labels;
 	token Op = token(tok_iftrue);
-	std::string target = res_Var;
-	std::string LHS = "goto";
-	std::string RHS = cond_First;
+	Operand target = res_Var;
+	Operand LHS;
+	Operand RHS = labelOpd(cond_First);
 	Env* pFrame = V->getEnv();
 	std::string frame_Str = pFrame->getTableName();
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, LHS,RHS, frame_Str);
+	SSA_Entry line(labels, Op, target, LHS,RHS, frame_Str);
 	insertLine(line, iR_List);
 
 	// jump over expr 2
 	Op = token(tok_goto);
-	target = cond_End;
-	LHS = RHS = "";
-	line = new SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
+	target = labelOpd(cond_End);
+	LHS = RHS = Operand();
+	line = SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
 	insertLine(line, iR_List);
 
 	// handle expr2
@@ -601,16 +616,16 @@ public:
 	// ...and assign its result to the status variable (res_Var)
 	Op = token(tok_eq);
 	target = res_Var;
-	LHS = V->RChild()->Addr();
-	RHS = "";
-	line = new SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
+	LHS = opdOf(V->RChild());
+	RHS = Operand();
+	line = SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
 	insertLine(line, iR_List);
 
 	if ( (dynamic_cast<AndExpr_AST*>(V->Parent())) )
 	    doAnd(dynamic_cast<AndExpr_AST*>(V->Parent()), res_Var, cond_End);
 	else{
-	    if ( ("" == V->Addr()) )
-		V->setAddr(res_Var);
+	    if ( (V->Opd().isNone()) )
+		V->setOpd(res_Var);
 	    return;
 	}
     }
@@ -618,6 +633,7 @@ public:
     void visit(RelExpr_AST* V)
     {
 	if (option_Debug) std::cout << "\tvisiting RelExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	std::string frame = V->getEnv()->getTableName();
 	needs_Label_ = 0;
@@ -633,19 +649,20 @@ public:
 	label_Vec labels = active_Labels_;
 	active_Labels_.clear();
 
-	std::string target = makeTmp();
-	V->setAddr(target);
+	Operand target = makeTmp();
+	V->setOpd(target);
 	token Op = V->Op();
-	std::string LHS = V->LChild()->Addr();
-	std::string RHS = V->RChild()->Addr();
+	Operand LHS = opdOf(V->LChild());
+	Operand RHS = opdOf(V->RChild());
 
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, LHS, RHS, frame);
+	SSA_Entry line(labels, Op, target, LHS, RHS, frame);
 	insertLine(line, iR_List);
     }
 
     void visit(NotExpr_AST* V)
     {
 	if (option_Debug) std::cout << "\tvisiting NotExpr_AST...\n";
+	ir_SrcLine = V->Line();
 
 	std::string frame = V->getEnv()->getTableName();
 	needs_Label_ = 0;
@@ -656,12 +673,12 @@ public:
 	label_Vec labels = active_Labels_;
 	active_Labels_.clear();
 
-	std::string target = makeTmp();
-	V->setAddr(target);
+	Operand target = makeTmp();
+	V->setOpd(target);
 	token Op = V->Op();
-	std::string LHS = V->LChild()->Addr();
+	Operand LHS = opdOf(V->LChild());
 
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, LHS, "", frame);
+	SSA_Entry line(labels, Op, target, LHS, Operand(), frame);
 	insertLine(line, iR_List);
     }
 
@@ -669,6 +686,7 @@ public:
     void visit(EOB_AST* V)
     {
 	if (option_Debug) std::cout << "visiting EOB_AST...\n";
+	ir_SrcLine = V->Line();
 
 	Env* frame = V->getEnv();
 	shrinkStackVec(frame);
@@ -677,32 +695,34 @@ public:
     void visit(VarDecl_AST* V)
     {
 	if (option_Debug) std::cout << "visiting VarDecl_AST...\n";
+	ir_SrcLine = V->Line();
 
 	label_Vec labels = active_Labels_;
 	active_Labels_.clear();
 
-	std::string target = V->LChild()->Addr();
+	Operand target = varOf(V->Expr());
 	token Op = token(tok_dec);
-	std::string LHS = V->Type().Lex();
+	Operand LHS(opd_Type, typeFromLex(V->Type().Lex()));
 	Env* pFrame = V->getEnv();
 	std::string frame_Str = pFrame->getTableName();
 
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, LHS, "", frame_Str);
+	SSA_Entry line(labels, Op, target, LHS, Operand(), frame_Str);
 	insertLine(line, iR_List);
     }
 
     void visit(ArrayVarDecl_AST* V)
     {
 	if (option_Debug) std::cout << "visiting ArrayVarDecl_AST...\n";
+	ir_SrcLine = V->Line();
 
 	std::ostringstream tmp_Stream;
 	Env* pFrame = V->getEnv();
 	std::string frame = pFrame->getTableName();
-	std::string target;
+	Operand target;
 	token op;
-	std::string LHS;
-	std::string RHS;
-	SSA_Entry* line;
+	Operand LHS;
+	Operand RHS;
+	SSA_Entry line;
 	label_Vec labels = active_Labels_;
 	active_Labels_.clear();
 
@@ -713,8 +733,8 @@ public:
 	    target = makeTmp();
 	    op = token(tok_eq);
 	    tmp_Stream << V->Expr()->TypeW();
-	    LHS = tmp_Stream.str();
-	    line = new SSA_Entry(labels, op, target, LHS, "", frame);
+	    LHS = makeImmOperand(tmp_Stream.str());
+	    line = SSA_Entry(labels, op, target, LHS, Operand(), frame);
 	    insertLine(line, iR_List);
 
 	    // generate dimension bounds, and multiply them;
@@ -729,11 +749,11 @@ public:
 		     (dynamic_cast<IdExpr_AST*>(*iter)) ){
 		    // calculate bound, and store result for future reference
 		    LHS = target;
-		    RHS = (*iter)->Addr();
+		    RHS = opdOf(*iter);
 		    target = makeTmp();
-		    line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+		    line = SSA_Entry(labels, op, target, LHS, RHS, frame);
 		    insertLine(line, iR_List);
-		    V->addToDimsFinalEnd(RHS); // used if we later need dims
+		    V->addDimOpd(RHS); // used if we later need dims
 		}
 		else{
 		    // calculate bound, and store result for future reference
@@ -741,12 +761,13 @@ public:
 		    LHS = target;
 		    RHS = last_Tmp_; // note how order of RHS->target matters
 		    target = makeTmp();
-		    line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+		    line = SSA_Entry(labels, op, target, LHS, RHS, frame);
 		    insertLine(line, iR_List);
-		    V->addToDimsFinalEnd(RHS);
+		    V->addDimOpd(RHS);
 		}
 		// jump and continue if (expr > 0)
-		compAndJumpFalse(l_ErrTarget, token(tok_lt), "0", RHS, frame);
+		Operand zero = makeImmOperand("0");
+		compAndJumpFalse(l_ErrTarget, token(tok_lt), zero, RHS, frame);
 	    }
 
 	    // prepare jump to runtime error by pushing lNo & variable name
@@ -759,17 +780,17 @@ public:
 	}
 
 	// declare the array
-	target = V->LChild()->Addr();
+	target = varOf(V->Expr());
 	op = token(tok_dec);
-	LHS = V->Type().Lex();
-	line = new SSA_Entry(labels, op, target, LHS, "", frame);
+	LHS = Operand(opd_Type, typeFromLex(V->Type().Lex()));
+	line = SSA_Entry(labels, op, target, LHS, Operand(), frame);
 	insertLine(line, iR_List);
 
 	if ( !(V->allInts()) ){
 	    // link the new array to its memory location
 	    op = token(tok_lea);
-	    LHS = "%esp";
-	    line = new SSA_Entry(labels, op, target, LHS, "", frame);
+	    LHS = stackPtr();
+	    line = SSA_Entry(labels, op, target, LHS, Operand(), frame);
 	    insertLine(line, iR_List);
 	}
     }
@@ -777,6 +798,7 @@ public:
     void visit(Assign_AST* V)
     {
 	if (option_Debug) std::cout << "visiting Assign_AST...\n";
+	ir_SrcLine = V->Line();
 
 	// empty assignment?
 	if ( (0 == V->RChild()) )
@@ -785,21 +807,21 @@ public:
 	std::string frame = V->getEnv()->getTableName();
 	label_Vec labels = active_Labels_;
 	active_Labels_.clear();
-	std::string target, LHS, RHS;
+	Operand target, LHS, RHS;
 	token op;
 	// handle '+' in case we actually have '+=' (and similar)
 	ModAssign_AST* tmp_AST;
 	if ( (tmp_AST = dynamic_cast<ModAssign_AST*>(V)) ){
-	    target = LHS = V->LChild()->Addr();
+	    target = LHS = opdOf(V->LChild());
 	    op = tmp_AST->ModType();
-	    RHS = V->RChild()->Addr();
+	    RHS = opdOf(V->RChild());
 	}
 	else{ // regular '=' assignment
-	    target = V->LChild()->Addr();
+	    target = opdOf(V->LChild());
 	    op = token(tok_eq);
-	    LHS = V->RChild()->Addr();
+	    LHS = opdOf(V->RChild());
 	}
-	SSA_Entry* line = new SSA_Entry(labels, op, target, LHS, RHS, frame);
+	SSA_Entry line(labels, op, target, LHS, RHS, frame);
 	insertLine(line, iR_List);
     }
 
@@ -828,29 +850,42 @@ public:
     void visit(If_AST* V)
     {
 	if (option_Debug) std::cout << "visiting If_AST...\n";
-	// dispatch expr - labels handled through global active_Labels_
-	needs_Label_ = 1;
-	V->LChild()->accept(this);
-
-	// make labels
+	Env* pFrame = V->getEnv();
+	std::string frame_Str = pFrame->getTableName();
 	std::string if_Next;
 	std::string if_Done;
-	if_Next = makeLabel();
-	if (V->hasElse())
-	    if_Done = makeLabel();
-	else
-	    if_Done = if_Next;
- 
-	// make iffalse SSA entry
 	label_Vec labels;
-	token Op = token(tok_iffalse);
-	std::string target = V->LChild()->Addr();
-	std::string LHS = "goto";
-	std::string RHS = if_Next;
-	Env* pFrame = V->getEnv();
-	std::string frame_Str = pFrame->getTableName();
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, LHS,RHS, frame_Str);
-	insertLine(line, iR_List);
+	token Op;
+	Operand target;
+	Operand LHS;
+	Operand RHS;
+	SSA_Entry line;
+
+	if ( (condJumps()) ){
+	    if_Next = makeLabel();
+	    if_Done = ( (V->hasElse()) )?makeLabel():if_Next;
+	    jumpIf(V->LChild(), 0, if_Next, frame_Str);
+	}
+	else{
+	    // dispatch expr - labels handled through global active_Labels_
+	    needs_Label_ = 1;
+	    V->LChild()->accept(this);
+
+	    // make labels
+	    if_Next = makeLabel();
+	    if (V->hasElse())
+		if_Done = makeLabel();
+	    else
+		if_Done = if_Next;
+ 
+	    // make iffalse SSA entry
+	    Op = token(tok_iffalse);
+	    target = opdOf(V->LChild());
+	    LHS = Operand();
+	    RHS = labelOpd(if_Next);
+	    line = SSA_Entry(labels, Op, target, LHS,RHS, frame_Str);
+	    insertLine(line, iR_List);
+	}
 
 	// make stmt (block) SSA entry (entries), if there is at least one
 	if ( (0 != V->RChild()) )
@@ -859,9 +894,9 @@ public:
 	// make goto SSA entry
 	if (V->hasElse()){
 	    Op = token(tok_goto);
-	    target = if_Done;
-	    LHS = RHS = "";
-	    line = new SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
+	    target = labelOpd(if_Done);
+	    LHS = RHS = Operand();
+	    line = SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
 	    insertLine(line, iR_List);
 	}
 
@@ -883,26 +918,39 @@ public:
     {
 	if (option_Debug) std::cout << "visiting doElseIf...\n";
 
-	// dispatch expr (no labels outside {if- else if - else} scope possible)
-	V->LChild()->accept(this);
-
-	// make labels
-	std::string if_Next;
-	if ( !(V->hasElse()) ) // terminating else if
-	    if_Next = if_Done;
-	else
-	    if_Next = makeLabel();
- 
-	// make iffalse SSA entry
-	label_Vec labels;
-	token Op = token(tok_iffalse);
-	std::string target = V->LChild()->Addr();
-	std::string LHS = "goto";
-	std::string RHS = if_Next;
 	Env* pFrame = V->getEnv();
 	std::string frame_Str = pFrame->getTableName();
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, LHS,RHS, frame_Str);
-	insertLine(line, iR_List);
+	std::string if_Next;
+	label_Vec labels;
+	token Op;
+	Operand target;
+	Operand LHS;
+	Operand RHS;
+	SSA_Entry line;
+
+	if ( (condJumps()) ){
+	    if_Next = ( !(V->hasElse()) )?if_Done:makeLabel();
+	    jumpIf(V->LChild(), 0, if_Next, frame_Str);
+	}
+	else{
+	    // dispatch expr (no labels outside {if- else if - else} scope
+	    // possible)
+	    V->LChild()->accept(this);
+
+	    // make labels
+	    if ( !(V->hasElse()) ) // terminating else if
+		if_Next = if_Done;
+	    else
+		if_Next = makeLabel();
+ 
+	    // make iffalse SSA entry
+	    Op = token(tok_iffalse);
+	    target = opdOf(V->LChild());
+	    LHS = Operand();
+	    RHS = labelOpd(if_Next);
+	    line = SSA_Entry(labels, Op, target, LHS,RHS, frame_Str);
+	    insertLine(line, iR_List);
+	}
 
 	// make stmt (block) SSA entry (entries), if there is at least one
 	if ( (0 != V->RChild()) )
@@ -911,9 +959,9 @@ public:
 	// make goto SSA entry
 	if (V->hasElse()){
 	    Op = token(tok_goto);
-	    target = if_Done;
-	    LHS = RHS = "";
-	    line = new SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
+	    target = labelOpd(if_Done);
+	    LHS = RHS = Operand();
+	    line = SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
 	    insertLine(line, iR_List);
 	}
 
@@ -984,27 +1032,35 @@ public:
 	// Cond could be 0 (infinite loop), but we always need a label
 	active_Labels_.push_back(label_Top);
 	needs_Label_ = 1;
-	std::string target;
-	if ( (0 != expr) && (0 != expr->Cond()) ){
-	    expr->Cond()->accept(this);
-	    if ( ("" == expr->Cond()->Addr()) )
-		target = "1";
-	    else
-		target = expr->Cond()->Addr();
+	label_Vec labels;
+	token Op;
+	Operand target;
+	Operand LHS;
+	Operand RHS;
+	SSA_Entry line;
+	if ( (condJumps()) && (0 != expr) && (0 != expr->Cond()) ){
+	    jumpIf(expr->Cond(), 0, label_Out, frame_Str);
 	}
 	else{
-	    insertNOP(active_Labels_, frame_Str);
-	    target = "1"; // dummy for forever loop if no cond
-	}
-	active_Labels_.clear();
+	    if ( (0 != expr) && (0 != expr->Cond()) ){
+		expr->Cond()->accept(this);
+		target = opdOf(expr->Cond());
+		if ( (target.isNone()) )
+		    target = makeImmOperand("1");
+	    }
+	    else{
+		insertNOP(active_Labels_, frame_Str);
+		target = makeImmOperand("1"); // dummy for forever loop if no cond
+	    }
+	    active_Labels_.clear();
 
-	// make iffalse SSA entry
-	label_Vec labels;
-	token Op = token(tok_iffalse);
-	std::string LHS = "goto";
-	std::string RHS = label_Out;
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, LHS,RHS, frame_Str);
-	insertLine(line, iR_List);
+	    // make iffalse SSA entry
+	    Op = token(tok_iffalse);
+	    LHS = Operand();
+	    RHS = labelOpd(label_Out);
+	    line = SSA_Entry(labels, Op, target, LHS,RHS, frame_Str);
+	    insertLine(line, iR_List);
+	}
 
 	// handle statement
 	std::string labelBreak_Old = label_Break_;
@@ -1029,9 +1085,9 @@ public:
 
 	// make goto SSA entry (continuing loop)
 	Op = token(tok_goto);
-	target = label_Top;
-	LHS = RHS = "";
-	line = new SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
+	target = labelOpd(label_Top);
+	LHS = RHS = Operand();
+	line = SSA_Entry(labels, Op, target, LHS, RHS, frame_Str);
 	insertLine(line, iR_List);
 
 	// handle target of jump out from within for logic
@@ -1043,14 +1099,15 @@ public:
     void visit(Break_AST* V)
     {
 	if (option_Debug) std::cout << "visiting Break_AST...\n";
+	ir_SrcLine = V->Line();
 
 	// make goto SSA entry
 	label_Vec labels;
 	Env* pFrame = V->getEnv();
 	std::string frame_Str = pFrame->getTableName();
 	token Op = token(tok_goto);
-	std::string target = label_Break_;
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, "", "", frame_Str);
+	Operand target = labelOpd(label_Break_);
+	SSA_Entry line(labels, Op, target, Operand(), Operand(), frame_Str);
 	insertLine(line, iR_List);
     }
 
@@ -1058,35 +1115,112 @@ public:
     void visit(Cont_AST* V)
     {
 	if (option_Debug) std::cout << "visiting Cont_AST...\n";
+	ir_SrcLine = V->Line();
 
 	// make goto SSA entry
 	label_Vec labels;
 	Env* pFrame = V->getEnv();
 	std::string frame_Str = pFrame->getTableName();
 	token Op = token(tok_goto);
-	std::string target = label_Cont_;
-	SSA_Entry* line = new SSA_Entry(labels, Op, target, "", "", frame_Str);
+	Operand target = labelOpd(label_Cont_);
+	SSA_Entry line(labels, Op, target, Operand(), Operand(), frame_Str);
+	insertLine(line, iR_List);
+    }
+
+    // Condition context (if, else if, for, while; -O 1 and up): jump to
+    // Label when E has truth value Sense, fall through otherwise. || and
+    // && (and ! above them) become chains of conditional jumps, and no
+    // truth value of the sequence is materialized:
+    //   a && b, false:  iffalse a goto F; iffalse b goto F
+    //   a || b, false:  iftrue a goto S; iffalse b goto F; S:
+    // Labels pending for the condition go to its first line.
+    int condJumps(void) const { return (1 <= option_OptLevel); }
+
+    void jumpIf(Node_AST* E, int Sense, std::string Label, std::string Frame)
+    {
+	int is_Or = (0 != dynamic_cast<OrExpr_AST*>(E));
+	int is_And = (0 != dynamic_cast<AndExpr_AST*>(E));
+
+	if ( (is_Or && Sense) || (is_And && !Sense) ){
+	    // either side decides the sequence
+	    jumpIf(E->LChild(), Sense, Label, Frame);
+	    jumpIf(E->RChild(), Sense, Label, Frame);
+	    return;
+	}
+	if ( (is_Or || is_And) ){
+	    // the left side decides only the other way: skip the right one
+	    std::string skip = makeLabel();
+	    jumpIf(E->LChild(), !Sense, skip, Frame);
+	    jumpIf(E->RChild(), Sense, Label, Frame);
+	    label_Vec labels;
+	    labels.push_back(skip);
+	    insertNOP(labels, Frame);
+	    return;
+	}
+	if ( (dynamic_cast<NotExpr_AST*>(E)) && (0 != E->LChild()) ){
+	    jumpIf(E->LChild(), !Sense, Label, Frame);
+	    return;
+	}
+
+	needs_Label_ = !(active_Labels_.empty());
+	E->accept(this);
+	label_Vec labels = active_Labels_;
+	active_Labels_.clear();
+	needs_Label_ = 0;
+
+	token Op = ( (Sense) )?token(tok_iftrue):token(tok_iffalse);
+	Operand target = opdOf(E);
+	if ( (target.isNone()) )
+	    target = makeImmOperand("1");
+	SSA_Entry line(labels, Op, target, Operand(), labelOpd(Label), Frame);
 	insertLine(line, iR_List);
     }
 
     void insertNOP(label_Vec const& Labels, std::string Env)
     {
 	token Op = token(tok_nop);
-	SSA_Entry* line = new SSA_Entry(Labels, Op, "", "", "", Env);
+	SSA_Entry line(Labels, Op, Operand(), Operand(), Operand(), Env);
 	insertLine(line, iR_List);
     }
 
-    std::string makeTmp(void)
+    Operand makeTmp(void)
     {
-	static int count = 0;
+	last_Tmp_ = makeTmpOperand(); // for arrays with integer expression
+	return last_Tmp_;             // bounds
+    }
 
-	std::ostringstream tmp_Stream;
-	tmp_Stream << "t" << ++count;
-	std::string ret = tmp_Stream.str();
-	last_Tmp_ = ret; // for arrays with integer expression bounds
+    // The operand of an expression: as set when it was visited, else
+    // the literal or the variable it spells
+    Operand opdOf(Node_AST* E)
+    {
+	Operand ret = E->Opd();
+	if ( !(ret.isNone()) )
+	    return ret;
+
+	if ( dynamic_cast<IntExpr_AST*>(E) || dynamic_cast<FltExpr_AST*>(E) )
+	    return makeImmOperand(E->Addr());
+	ArrayIdExpr_AST* elem = dynamic_cast<ArrayIdExpr_AST*>(E);
+	if ( (0 != elem) && (elem->allInts()) )
+	    return makeElemOperand(varOf(elem->Base()->Expr()),
+				   makeImmOperand(elem->ConstOffset()));
+	if ( dynamic_cast<IdExpr_AST*>(E) )
+	    return varOf(dynamic_cast<IdExpr_AST*>(E));
 	return ret;
     }
 
+    // a variable, as declared in the scope of its Id
+    Operand varOf(IdExpr_AST* Id)
+    {
+	return makeVarOperand(Id->Op().Lex(), Id->getEnv());
+    }
+
+    Operand labelOpd(std::string Label)
+    {
+	return Operand(opd_Label, internLabel(Label));
+    }
+
+    Operand stackPtr(void) { return Operand(opd_Reg, internReg("%esp")); }
+
     std::string makeLabel(void)
     {
 	static int count = 0;
@@ -1100,20 +1234,20 @@ public:
     // growStack())
     void shrinkStackVec(Env* Frame)
     {
-	std::vector<std::string> V = Frame->getAdj();
+	std::vector<Operand> V = Frame->getAdj();
 	if (V.empty())
 	    return;
 	std::string frame_Str = Frame->getTableName();
 
 	label_Vec labels;
 	token op(tok_plus);
-	std::string target = "%esp";
-	std::string LHS = "%esp";
-	SSA_Entry* line;
+	Operand target = stackPtr();
+	Operand LHS = stackPtr();
+	SSA_Entry line;
 
-	std::vector<std::string>::const_iterator iter;
+	std::vector<Operand>::const_iterator iter;
 	for ( iter = V.begin(); iter != V.end(); iter++ ){
-	    line = new SSA_Entry(labels, op, target, LHS, *iter, frame_Str);
+	    line = SSA_Entry(labels, op, target, LHS, *iter, frame_Str);
 	    insertLine(line, iR_List);
 	}
     }
@@ -1121,36 +1255,36 @@ public:
     // Helper function for run-time stack management.
     // Typically,stack is extended item by item (but shrunk by the sum of 
     // these extensions; see shrinkStackVec())
-    void growStack(Env* Frame, std::string Name)
+    void growStack(Env* Frame, Operand Name)
     {
 	Frame->addAdj(Name);
 
 	std::string frame_Str = Frame->getTableName();
 	label_Vec labels;
 	token op(tok_minus);
-	std::string target = "%esp";
-	std::string LHS = "%esp";
-	SSA_Entry* line;
-	line = new SSA_Entry(labels, op, target, LHS, Name, frame_Str);
+	Operand target = stackPtr();
+	Operand LHS = stackPtr();
+	SSA_Entry line;
+	line = SSA_Entry(labels, op, target, LHS, Name, frame_Str);
 	insertLine(line, iR_List);
     }
 
     // Compare two variables, and jump to 'Label' if false (currently
     // only used for run-time arrays)
-    void compAndJumpFalse(std::string Label, token Op, std::string LHS, 
-			  std::string RHS, std::string Frame)
+    void compAndJumpFalse(std::string Label, token Op, Operand LHS, 
+			  Operand RHS, std::string Frame)
     {
 	std::vector<std::string> labels;
-	SSA_Entry* line;
+	SSA_Entry line;
 
-	std::string target = makeTmp();
-	line = new SSA_Entry(labels, Op, target, LHS, RHS, Frame);
+	Operand target = makeTmp();
+	line = SSA_Entry(labels, Op, target, LHS, RHS, Frame);
 	insertLine(line, iR_List);
 
 	Op = token(tok_iffalse);
-	LHS = "goto";
-	RHS = Label;
-	line = new SSA_Entry(labels, Op, target, LHS, RHS, Frame);
+	LHS = Operand();
+	RHS = labelOpd(Label);
+	line = SSA_Entry(labels, Op, target, LHS, RHS, Frame);
 	insertLine(line, iR_List);
     }
 
@@ -1172,15 +1306,16 @@ public:
 	std::ostringstream tmp_Stream;
 	std::vector<std::string> labels;
 	token op;
-	std::string target;
-	std::string LHS, RHS;
-	SSA_Entry* line;
+	Operand target;
+	Operand LHS, RHS;
+	SSA_Entry line;
 
 	// goto to jump to end of this function (when falling through)
 	if ( (0 == N) || (1 == N) ){
 	op = token(tok_goto);
-	target = label_End = makeLabel();
-	line = new SSA_Entry(labels, op, target, LHS, RHS, Frame);
+	label_End = makeLabel();
+	target = labelOpd(label_End);
+	line = SSA_Entry(labels, op, target, LHS, RHS, Frame);
 	insertLine(line, iR_List);
 	labels.clear();
 	}
@@ -1188,26 +1323,23 @@ public:
 	// push variable name
 	labels.push_back(Label_ErrTarget);
 	op = token(tok_pushl);
-	tmp_Stream << "$";
-	tmp_Stream << makeDsErrVar(Var);
-	target = tmp_Stream.str();
-	line = new SSA_Entry(labels, op, target, LHS, RHS, Frame);
+	target = Operand(opd_Sym, internSym(makeDsErrVar(Var)));
+	line = SSA_Entry(labels, op, target, LHS, RHS, Frame);
 	insertLine(line, iR_List);
-	tmp_Stream.str(""); // flushing is meaningless for string objects
-	labels.clear();  // as there is no natural device attached to flush to
+	labels.clear();
 
 	// push line number
-	tmp_Stream << "$" << lNo;
-	target = tmp_Stream.str();
-	line = new SSA_Entry(labels, op, target, LHS, RHS, Frame);
+	tmp_Stream << lNo;
+	target = makeImmOperand(tmp_Stream.str());
+	line = SSA_Entry(labels, op, target, LHS, RHS, Frame);
 	insertLine(line, iR_List);
 	tmp_Stream.str("");
 	labels.clear();
 
 	// jump to error code
-	target = Label_ErrExit;
+	target = labelOpd(Label_ErrExit);
 	op = token(tok_goto);
-	line = new SSA_Entry(labels, op, target, LHS, RHS, Frame);
+	line = SSA_Entry(labels, op, target, LHS, RHS, Frame);
 	insertLine(line, iR_List);
 
 	// emit jump target
@@ -1243,29 +1375,29 @@ public:
     // update offset & size_Parents when new dimension bound-checked
     // offset_V += index * size_Parents; (1)
     // size_Parents *= last_Dimension;   (2)
-    void adj_Offset(std::string Offset, std::string Index, std::string size_P, 
-		    std::string Dim, std::string Frame)
+    void adj_Offset(Operand Offset, Operand Index, Operand size_P, 
+		    Operand Dim, std::string Frame)
     {
 	// handle (1)
 	label_Vec labels;
 	token op = token(tok_mult);
-	std::string target = makeTmp();
-	std::string LHS = Index;
-	std::string RHS = size_P;
-	SSA_Entry* line = new SSA_Entry(labels, op, target, LHS, RHS, Frame);
+	Operand target = makeTmp();
+	Operand LHS = Index;
+	Operand RHS = size_P;
+	SSA_Entry line(labels, op, target, LHS, RHS, Frame);
 	insertLine(line, iR_List);
 
 	op = token(tok_plus);
 	RHS = target;
 	target = LHS = Offset;
-	line = new SSA_Entry(labels, op, target, LHS, RHS, Frame);
+	line = SSA_Entry(labels, op, target, LHS, RHS, Frame);
 	insertLine(line, iR_List);
 
 	// handle (2)
 	op = token(tok_mult);
 	target = LHS = size_P;
 	RHS = Dim;
-	line = new SSA_Entry(labels, op, target, LHS, RHS, Frame);
+	line = SSA_Entry(labels, op, target, LHS, RHS, Frame);
 	insertLine(line, iR_List);
     }	
 
@@ -1282,7 +1414,7 @@ public:
     }
 
 private:
-static std::string last_Tmp_; // for variable length arrays
+static Operand last_Tmp_; // for variable length arrays
 
 static std::string label_Break_;
 static std::string label_Cont_;
@@ -0,0 +1,707 @@
+/********************************************************************
+* vm.cpp - implementation file for vm.h
+*
+********************************************************************/
+
+#include <sys/time.h>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "lexer.h"
+#include "tables.h"
+#include "ir.h"
+#include "live.h"
+#include "ssa.h"
+#include "x86.h"
+#include "vm.h"
+#include "cache.h"
+
+void errExit(int pError, const char* msg, ...);
+
+static const int max_Args = 16; // pushed by the error section
+
+// in the order of the handlers in Decaf_VM::run()
+enum vm_Code{
+    vm_halt, vm_exit,
+    vm_copy_i, vm_copy_d, vm_i2d, vm_d2i, vm_b_i, vm_b_d,
+    vm_add_i, vm_sub_i, vm_mul_i, vm_div_i, vm_mod_i, vm_neg_i, vm_not_i,
+    vm_add_d, vm_sub_d, vm_mul_d, vm_div_d, vm_neg_d, vm_not_d,
+    vm_lt_i, vm_le_i, vm_gt_i, vm_ge_i, vm_eq_i, vm_ne_i,
+    vm_lt_d, vm_le_d, vm_gt_d, vm_ge_d, vm_eq_d, vm_ne_d,
+    vm_ld_i, vm_ld_d, vm_st_i, vm_st_d, vm_lea,
+    vm_jmp, vm_jz_i, vm_jnz_i, vm_jz_d, vm_jnz_d,
+    vm_push_i, vm_push_s, vm_printf,
+    vm_vcopy_i, vm_vcopy_d, vm_vset_i, vm_vset_d,
+    vm_vadd_i, vm_vsub_i, vm_vmul_i, vm_vadd_d, vm_vsub_d, vm_vmul_d,
+    vm_touch,
+    vm_Codes
+};
+
+union VM_Cell{
+    int I;
+    double D;
+};
+
+// A = target (ld_/st_: the value), B, C = operands (ld_/st_: base
+// address and offset); jumps: B the condition, Jump the target; vector
+// ops: A, B, C hold the addresses of their first elements (vset_: B
+// the value set in each lane), Lanes the elements; touch: B, C as for
+// ld_, Lanes the bytes
+struct VM_Instr{
+    void const* Handler; // set by run()
+    int Code;
+    int Line;            // of the IR, as printed
+    void* A;
+    void* B;
+    void* C;
+    int To;              // label jumped to (until resolved into Jump)
+    VM_Instr* Jump;
+    int Lanes;
+};
+
+// cells may sit unaligned in the frame area
+inline int getI(void const* P) { int v; memcpy(&v, P, sizeof(v)); return v; }
+inline double getD(void const* P)
+{
+    double v;
+    memcpy(&v, P, sizeof(v));
+    return v;
+}
+inline void setI(void* P, int V) { memcpy(P, &V, sizeof(V)); }
+inline void setD(void* P, double V) { memcpy(P, &V, sizeof(V)); }
+
+// ints wrap around as they do on the target
+inline int wrapAdd(int L, int R)
+{
+    return static_cast<int>(static_cast<unsigned>(L) + R);
+}
+inline int wrapSub(int L, int R)
+{
+    return static_cast<int>(static_cast<unsigned>(L) - R);
+}
+inline int wrapMul(int L, int R)
+{
+    return static_cast<int>(static_cast<unsigned>(L) * R);
+}
+
+class Decaf_VM{
+public:
+    Decaf_VM(Cache_Sim* Cache = 0)
+	: stack_Base_(0), cache_(Cache), status_(0), sp_(0) {}
+
+    void load(ir_Rep const& List, ir_Rep const& Errors);
+    VM_Result run(void);
+
+private:
+    void layoutFrames(ir_Rep const& List);
+    int isFlt(Operand const& O) const;
+    void* cell(void);
+    void* intCell(int V);
+    void* fltCell(double V);
+    void* home(Operand const& O);
+    void* convert(void* From, int Flt, int Line);
+    void* read(Operand const& O, int Flt, int Line);
+    void* write(Operand const& T, int Flt, int Line);
+    void* address(Operand const& O, int Line);
+    void emit(int Code, int Line, void* A = 0, void* B = 0, void* C = 0,
+	      int To = -1);
+    void touch(int Line, void* Base, void* Off, int Bytes);
+    void loadVector(SSA_Entry const& Line, int N);
+    void flushPending(void);
+    void loadLine(SSA_Entry const& Line, int N);
+
+    std::vector<char> mem_;           // frames, then the stack
+    size_t stack_Base_;
+    std::map<int, int> var_Offset_;
+    std::set<int> vla_;               // arrays sized at run time
+    opd_Set flt_;
+    std::deque<VM_Cell> cells_;
+    std::map<Operand, void*> homes_;
+    std::map<int, void*> int_Cells_;
+    std::map<double, void*> flt_Cells_;
+    std::deque<std::string> strings_; // of the .data section, unquoted
+    std::vector<VM_Instr> code_;
+    std::vector<VM_Instr> pending_;   // after the line's instruction
+    std::map<int, int> label_At_;     // label -> instruction
+    Cache_Sim* cache_;
+
+    int status_;
+    VM_Instr const* args_[max_Args];
+    int sp_;
+};
+
+// frame areas of ST in order, each variable at its Symbol_Table offset
+void
+Decaf_VM::layoutFrames(ir_Rep const& List)
+{
+    for ( size_t i = 0; i < List.size(); i++ )
+	if ( (op_lea == List[i].Op()) )
+	    vla_.insert(List[i].Target().Id());
+
+    int cursor = 0;
+    std::map<std::string, int> base;
+    std::map<std::string, Symbol_Table>::iterator iter;
+    for ( iter = ST.begin(); iter != ST.end(); iter++ ){
+	base[iter->first] = cursor;
+	cursor += iter->second.getOffsetStack();
+    }
+    for ( size_t v = 0; v < ir_Vars.size(); v++ ){
+	if ( (-1 == ir_Vars[v].Frame()) || vla_.count(v) )
+	    continue;
+	std::string frame = ir_Frames[ir_Vars[v].Frame()].Name();
+	std::string name = ir_Vars[v].Name();
+	if ( (ST.end() == (iter = ST.find(frame))) ||
+	     (-1 == iter->second.findName(name)) )
+	    continue;
+	var_Offset_[v] = base[frame] + iter->second.getOffset(name);
+    }
+    stack_Base_ = (cursor + 15) & ~15;
+    mem_.assign(stack_Base_ + VM_STACK_SIZE, 0);
+}
+
+int
+Decaf_VM::isFlt(Operand const& O) const
+{
+    if ( (opd_Reg == O.Kind()) )
+	return (0 == ir_Regs[O.Id()].compare(0, 4, "%xmm"));
+    return isFltOperand(O, flt_);
+}
+
+void*
+Decaf_VM::cell(void)
+{
+    cells_.push_back(VM_Cell());
+    cells_.back().D = 0;
+    return &cells_.back();
+}
+
+void*
+Decaf_VM::intCell(int V)
+{
+    void*& c = int_Cells_[V];
+    if ( (0 == c) ){
+	c = cell();
+	setI(c, V);
+    }
+    return c;
+}
+
+void*
+Decaf_VM::fltCell(double V)
+{
+    void*& c = flt_Cells_[V];
+    if ( (0 == c) ){
+	c = cell();
+	setD(c, V);
+    }
+    return c;
+}
+
+// where a tmp, register or variable lives (an array sized at run time:
+// the cell holding its address)
+void*
+Decaf_VM::home(Operand const& O)
+{
+    void*& h = homes_[O];
+    if ( (0 != h) )
+	return h;
+    if ( O.isVar() && var_Offset_.count(O.Id()) )
+	h = &mem_[var_Offset_[O.Id()]];
+    else{
+	h = cell();
+	if ( (opd_Reg == O.Kind()) && ("%esp" == ir_Regs[O.Id()]) )
+	    setI(h, mem_.size());
+    }
+    return h;
+}
+
+void*
+Decaf_VM::convert(void* From, int Flt, int Line)
+{
+    void* to = cell();
+    emit( (Flt)?vm_i2d:vm_d2i, Line, to, From);
+    return to;
+}
+
+// O as an int (Flt 0) or a double (1), or as it is (-1)
+void*
+Decaf_VM::read(Operand const& O, int Flt, int Line)
+{
+    int own = isFlt(O);
+    if ( (-1 == Flt) )
+	Flt = own;
+    if ( O.isImm() ){
+	IR_Const const& c = ir_Consts[O.Id()];
+	if (Flt)
+	    return fltCell( (own)?c.FltVal():c.IntVal() );
+	return intCell( (own)?static_cast<int>(c.FltVal()):c.IntVal() );
+    }
+
+    void* from = 0;
+    if ( O.isElem() ){
+	void* base = ( vla_.count(O.Id()) )?home(Operand(opd_Var, O.Id())):
+	    intCell(var_Offset_[O.Id()]);
+	void* off = read(O.Offset(), 0, Line);
+	from = cell();
+	touch(Line, base, off, (own)?8:4);
+	emit( (own)?vm_ld_d:vm_ld_i, Line, from, base, off);
+    }
+    else if ( (opd_Tmp == O.Kind()) || O.isVar() || (opd_Reg == O.Kind()) )
+	from = home(O);
+    else
+	errExit(0, "run: invalid operand (%s)", operandStr(O).c_str());
+
+    if ( (own != Flt) )
+	return convert(from, Flt, Line);
+    return from;
+}
+
+// The cell an instruction of type Flt writes T to; what brings the
+// value to T (a conversion, the store of an element) is pending until
+// the instruction is emitted
+void*
+Decaf_VM::write(Operand const& T, int Flt, int Line)
+{
+    int own = isFlt(T);
+    void* to;
+    if ( T.isElem() ){
+	void* base = ( vla_.count(T.Id()) )?home(Operand(opd_Var, T.Id())):
+	    intCell(var_Offset_[T.Id()]);
+	void* off = read(T.Offset(), 0, Line);
+	to = cell();
+	VM_Instr st = { 0, (own)?vm_st_d:vm_st_i, Line, to, base, off, -1, 0,
+			1 };
+	pending_.insert(pending_.begin(), st);
+	if ( (0 != cache_) ){
+	    VM_Instr at = { 0, vm_touch, Line, 0, base, off, -1, 0, (own)?8:4 };
+	    pending_.insert(pending_.begin(), at);
+	}
+    }
+    else
+	to = home(T);
+
+    if ( (own != Flt) ){
+	void* from = cell();
+	VM_Instr cvt = { 0, (own)?vm_i2d:vm_d2i, Line, to, from, 0, -1, 0, 1 };
+	pending_.insert(pending_.begin(), cvt);
+	return from;
+    }
+    return to;
+}
+
+// the cell holding the address of element O (base + offset)
+void*
+Decaf_VM::address(Operand const& O, int Line)
+{
+    Operand off = O.Offset();
+    if ( !(vla_.count(O.Id())) && off.isImm() )
+	return intCell(var_Offset_[O.Id()] + ir_Consts[off.Id()].IntVal());
+    void* base = ( vla_.count(O.Id()) )?home(Operand(opd_Var, O.Id())):
+	intCell(var_Offset_[O.Id()]);
+    void* at = cell();
+    emit(vm_add_i, Line, at, base, read(off, 0, Line));
+    return at;
+}
+
+void
+Decaf_VM::emit(int Code, int Line, void* A, void* B, void* C, int To)
+{
+    VM_Instr in = { 0, Code, Line, A, B, C, To, 0, 1 };
+    code_.push_back(in);
+}
+
+// the access to Bytes at Base + Off, for the cache simulator
+void
+Decaf_VM::touch(int Line, void* Base, void* Off, int Bytes)
+{
+    if ( (0 == cache_) )
+	return;
+    emit(vm_touch, Line, 0, Base, Off);
+    code_.back().Lanes = Bytes;
+}
+
+// one instruction for the lanes (their addresses computed first)
+void
+Decaf_VM::loadVector(SSA_Entry const& Line, int N)
+{
+    Operand t = Line.Target(), l = Line.LHS(), r = Line.RHS();
+    int flt = isFlt(t);
+    void* a = address(t, N);
+    void* b = ( l.isElem() )?address(l, N):read(l, flt, N);
+    void* c = ( r.isElem() )?address(r, N):0;
+    int bytes = Line.Lanes() * ( (flt)?8:4 );
+    if ( l.isElem() )
+	touch(N, b, intCell(0), bytes);
+    if ( r.isElem() )
+	touch(N, c, intCell(0), bytes);
+    touch(N, a, intCell(0), bytes);
+    int code;
+    switch(Line.Op()){
+    case op_vcopy:
+	code = ( l.isElem() )?( (flt)?vm_vcopy_d:vm_vcopy_i ):
+	    ( (flt)?vm_vset_d:vm_vset_i );
+	break;
+    case op_vadd: code = (flt)?vm_vadd_d:vm_vadd_i; break;
+    case op_vsub: code = (flt)?vm_vsub_d:vm_vsub_i; break;
+    default: code = (flt)?vm_vmul_d:vm_vmul_i; break;
+    }
+    emit(code, N, a, b, c);
+    code_.back().Lanes = Line.Lanes();
+}
+
+void
+Decaf_VM::flushPending(void)
+{
+    code_.insert(code_.end(), pending_.begin(), pending_.end());
+    pending_.clear();
+}
+
+void
+Decaf_VM::loadLine(SSA_Entry const& Line, int N)
+{
+    std::vector<int> labels = Line.Labels();
+    for ( size_t k = 0; k < labels.size(); k++ )
+	label_At_[labels[k]] = code_.size();
+
+    Operand t = Line.Target(), l = Line.LHS(), r = Line.RHS();
+    int flt = 0;
+    void *a, *b, *c;
+    switch(Line.Op()){
+    case op_nop: case op_dec:
+	break;
+    case op_copy:
+	flt = isFlt(t);
+	b = read(l, flt, N);
+	a = write(t, flt, N);
+	emit( (flt)?vm_copy_d:vm_copy_i, N, a, b);
+	break;
+    case op_add: case op_sub: case op_mult: case op_div: case op_mod:
+	flt = ( (op_mod != Line.Op()) && isFlt(t) );
+	b = read(l, flt, N);
+	c = read(r, flt, N);
+	a = write(t, flt, N);
+	switch(Line.Op()){
+	case op_add: emit( (flt)?vm_add_d:vm_add_i, N, a, b, c); break;
+	case op_sub: emit( (flt)?vm_sub_d:vm_sub_i, N, a, b, c); break;
+	case op_mult: emit( (flt)?vm_mul_d:vm_mul_i, N, a, b, c); break;
+	case op_div: emit( (flt)?vm_div_d:vm_div_i, N, a, b, c); break;
+	default: emit(vm_mod_i, N, a, b, c); break;
+	}
+	break;
+    case op_scale: // t = t * w
+	b = read(t, 0, N);
+	c = read(l, 0, N);
+	a = write(t, 0, N);
+	emit(vm_mul_i, N, a, b, c);
+	break;
+    case op_neg:
+	flt = isFlt(t);
+	b = read(l, flt, N);
+	a = write(t, flt, N);
+	emit( (flt)?vm_neg_d:vm_neg_i, N, a, b);
+	break;
+    case op_not:
+	flt = isFlt(l);
+	b = read(l, flt, N);
+	a = write(t, 0, N);
+	emit( (flt)?vm_not_d:vm_not_i, N, a, b);
+	break;
+    case op_lt: case op_le: case op_gt: case op_ge: case op_eq: case op_ne:
+	flt = ( isFlt(l) || isFlt(r) );
+	b = read(l, flt, N);
+	c = read(r, flt, N);
+	a = write(t, 0, N);
+	emit( ( (flt)?vm_lt_d:vm_lt_i ) + (Line.Op() - op_lt), N, a, b, c);
+	break;
+    case op_cast:
+	if ( (tok_double == r.Id()) || (tok_int == r.Id()) ){
+	    flt = (tok_double == r.Id());
+	    b = read(l, flt, N);
+	    a = write(t, flt, N);
+	    emit( (flt)?vm_copy_d:vm_copy_i, N, a, b);
+	}
+	else{ // bool
+	    flt = isFlt(l);
+	    b = read(l, flt, N);
+	    a = write(t, 0, N);
+	    emit( (flt)?vm_b_d:vm_b_i, N, a, b);
+	}
+	break;
+    case op_lea:
+	emit(vm_lea, N, home(t), home(l));
+	break;
+    case op_iffalse: case op_iftrue:
+	flt = isFlt(t);
+	b = read(t, flt, N);
+	if ( (op_iffalse == Line.Op()) )
+	    emit( (flt)?vm_jz_d:vm_jz_i, N, 0, b, 0, r.Id());
+	else
+	    emit( (flt)?vm_jnz_d:vm_jnz_i, N, 0, b, 0, r.Id());
+	break;
+    case op_goto:
+	emit(vm_jmp, N, 0, 0, 0, t.Id());
+	break;
+    case op_pushl:
+	if ( t.isImm() )
+	    emit(vm_push_i, N, read(t, 0, N));
+	else{
+	    std::vector<Ds_Object*>::const_iterator ds;
+	    for ( ds = Ds_Table.begin(); ds != Ds_Table.end(); ds++ )
+		if ( ((*ds)->Name() == ir_Syms[t.Id()]) )
+		    break;
+	    if ( (Ds_Table.end() == ds) )
+		errExit(0, "run: no data for %s", ir_Syms[t.Id()].c_str());
+	    std::string value = (*ds)->Value();
+	    strings_.push_back(value.substr(1, value.size() - 2));
+	    emit(vm_push_s, N, const_cast<char*>(strings_.back().c_str()));
+	}
+	break;
+    case op_call:
+	if ( ("printf" != ir_Syms[t.Id()]) )
+	    errExit(0, "run: unknown call (%s)", ir_Syms[t.Id()].c_str());
+	emit(vm_printf, N);
+	break;
+    case op_syscall:
+	if ( ("exit" != ir_Syms[t.Id()]) )
+	    errExit(0, "run: unknown syscall (%s)", ir_Syms[t.Id()].c_str());
+	emit(vm_exit, N);
+	break;
+    case op_vcopy: case op_vadd: case op_vsub: case op_vmult:
+	loadVector(Line, N);
+	break;
+    case op_phi:
+	errExit(0, "run: IR in SSA form (line %d)", N);
+	break;
+    default:
+	errExit(0, "run: no instruction for IR line (%s)", Line.str().c_str());
+    }
+    flushPending();
+}
+
+void
+Decaf_VM::load(ir_Rep const& List, ir_Rep const& Errors)
+{
+    ir_Rep all = List;
+    all.insert(all.end(), Errors.begin(), Errors.end());
+    layoutFrames(all);
+    findFloats(all, flt_);
+
+    for ( size_t i = 0; i < List.size(); i++ )
+	loadLine(List[i], i + 1);
+    emit(vm_halt, List.size());
+    for ( size_t i = 0; i < Errors.size(); i++ )
+	loadLine(Errors[i], List.size() + i + 1);
+    emit(vm_halt, all.size());
+
+    for ( size_t i = 0; i < code_.size(); i++ ){
+	if ( (-1 == code_[i].To) )
+	    continue;
+	std::map<int, int>::const_iterator iter = label_At_.find(code_[i].To);
+	if ( (label_At_.end() == iter) )
+	    errExit(0, "run: jump to %s, not in the IR",
+		    ir_Labels[code_[i].To].c_str());
+	code_[i].Jump = &code_[iter->second];
+    }
+}
+
+#ifdef __GNUC__
+#define VM_OP(Name) do_##Name:
+#define VM_DISPATCH goto *ip->Handler
+#define VM_LOOP VM_DISPATCH;
+#define VM_END
+#else
+#define VM_OP(Name) case vm_##Name:
+#define VM_DISPATCH continue
+#define VM_LOOP for ( ;; ) switch(ip->Code){
+#define VM_END }
+#endif
+#define VM_NEXT { ip++; count++; VM_DISPATCH; }
+#define VM_JUMP { ip = ip->Jump; count++; VM_DISPATCH; }
+
+#define VM_BIN_I(Name, Expr) VM_OP(Name) { \
+	int l = getI(ip->B), r = getI(ip->C); setI(ip->A, Expr); } VM_NEXT
+#define VM_BIN_D(Name, Expr) VM_OP(Name) { \
+	double l = getD(ip->B), r = getD(ip->C); setD(ip->A, Expr); } VM_NEXT
+#define VM_CMP_D(Name, Expr) VM_OP(Name) { \
+	double l = getD(ip->B), r = getD(ip->C); setI(ip->A, Expr); } VM_NEXT
+// lane k of a vector op: Size bytes each, from the addresses in A, B, C
+#define VM_LANE(P, K, Size) (mem + getI(P) + (K) * (Size))
+#define VM_VEC_I(Name, Expr) VM_OP(Name) \
+	for ( int k = 0; k < ip->Lanes; k++ ){ \
+	    int l = getI(VM_LANE(ip->B, k, 4)), r = getI(VM_LANE(ip->C, k, 4)); \
+	    setI(VM_LANE(ip->A, k, 4), Expr); } VM_NEXT
+#define VM_VEC_D(Name, Expr) VM_OP(Name) \
+	for ( int k = 0; k < ip->Lanes; k++ ){ \
+	    double l = getD(VM_LANE(ip->B, k, 8)); \
+	    double r = getD(VM_LANE(ip->C, k, 8)); \
+	    setD(VM_LANE(ip->A, k, 8), Expr); } VM_NEXT
+
+VM_Result
+Decaf_VM::run(void)
+{
+#ifdef __GNUC__
+    static void* const handlers[vm_Codes] = {
+	&&do_halt, &&do_exit,
+	&&do_copy_i, &&do_copy_d, &&do_i2d, &&do_d2i, &&do_b_i, &&do_b_d,
+	&&do_add_i, &&do_sub_i, &&do_mul_i, &&do_div_i, &&do_mod_i,
+	&&do_neg_i, &&do_not_i,
+	&&do_add_d, &&do_sub_d, &&do_mul_d, &&do_div_d, &&do_neg_d,
+	&&do_not_d,
+	&&do_lt_i, &&do_le_i, &&do_gt_i, &&do_ge_i, &&do_eq_i, &&do_ne_i,
+	&&do_lt_d, &&do_le_d, &&do_gt_d, &&do_ge_d, &&do_eq_d, &&do_ne_d,
+	&&do_ld_i, &&do_ld_d, &&do_st_i, &&do_st_d, &&do_lea,
+	&&do_jmp, &&do_jz_i, &&do_jnz_i, &&do_jz_d, &&do_jnz_d,
+	&&do_push_i, &&do_push_s, &&do_printf,
+	&&do_vcopy_i, &&do_vcopy_d, &&do_vset_i, &&do_vset_d,
+	&&do_vadd_i, &&do_vsub_i, &&do_vmul_i, &&do_vadd_d, &&do_vsub_d,
+	&&do_vmul_d, &&do_touch
+    };
+    for ( size_t i = 0; i < code_.size(); i++ )
+	code_[i].Handler = handlers[code_[i].Code];
+#endif
+
+    struct timeval t_Start, t_End;
+    char* mem = &mem_[0];
+    long count = 0;
+    VM_Instr const* ip = &code_[0];
+    gettimeofday(&t_Start, 0);
+
+    VM_LOOP
+    VM_OP(halt) count++; goto done;
+    VM_OP(exit) count++; status_ = 1; goto done;
+
+    VM_OP(copy_i) setI(ip->A, getI(ip->B)); VM_NEXT
+    VM_OP(copy_d) setD(ip->A, getD(ip->B)); VM_NEXT
+    VM_OP(i2d) setD(ip->A, getI(ip->B)); VM_NEXT
+    VM_OP(d2i) setI(ip->A, static_cast<int>(getD(ip->B))); VM_NEXT
+    VM_OP(b_i) setI(ip->A, (0 != getI(ip->B))); VM_NEXT
+    VM_OP(b_d) setI(ip->A, (0 != getD(ip->B))); VM_NEXT
+
+    VM_BIN_I(add_i, wrapAdd(l, r))
+    VM_BIN_I(sub_i, wrapSub(l, r))
+    VM_BIN_I(mul_i, wrapMul(l, r))
+    VM_OP(div_i)
+	if ( (0 == getI(ip->C)) )
+	    goto div_Zero;
+	if ( (-1 == getI(ip->C)) )
+	    setI(ip->A, wrapSub(0, getI(ip->B)));
+	else
+	    setI(ip->A, getI(ip->B) / getI(ip->C));
+	VM_NEXT
+    VM_OP(mod_i)
+	if ( (0 == getI(ip->C)) )
+	    goto div_Zero;
+	if ( (-1 == getI(ip->C)) )
+	    setI(ip->A, 0);
+	else
+	    setI(ip->A, getI(ip->B) % getI(ip->C));
+	VM_NEXT
+    VM_OP(neg_i) setI(ip->A, wrapSub(0, getI(ip->B))); VM_NEXT
+    VM_OP(not_i) setI(ip->A, !getI(ip->B)); VM_NEXT
+
+    VM_BIN_D(add_d, l + r)
+    VM_BIN_D(sub_d, l - r)
+    VM_BIN_D(mul_d, l * r)
+    VM_BIN_D(div_d, l / r)
+    VM_OP(neg_d) setD(ip->A, -getD(ip->B)); VM_NEXT
+    VM_OP(not_d) setI(ip->A, !getD(ip->B)); VM_NEXT
+
+    VM_BIN_I(lt_i, (l < r))
+    VM_BIN_I(le_i, (l <= r))
+    VM_BIN_I(gt_i, (l > r))
+    VM_BIN_I(ge_i, (l >= r))
+    VM_BIN_I(eq_i, (l == r))
+    VM_BIN_I(ne_i, (l != r))
+    VM_CMP_D(lt_d, (l < r))
+    VM_CMP_D(le_d, (l <= r))
+    VM_CMP_D(gt_d, (l > r))
+    VM_CMP_D(ge_d, (l >= r))
+    VM_CMP_D(eq_d, (l == r))
+    VM_CMP_D(ne_d, (l != r))
+
+    VM_OP(ld_i) setI(ip->A, getI(mem + getI(ip->B) + getI(ip->C))); VM_NEXT
+    VM_OP(ld_d) setD(ip->A, getD(mem + getI(ip->B) + getI(ip->C))); VM_NEXT
+    VM_OP(st_i) setI(mem + getI(ip->B) + getI(ip->C), getI(ip->A)); VM_NEXT
+    VM_OP(st_d) setD(mem + getI(ip->B) + getI(ip->C), getD(ip->A)); VM_NEXT
+    VM_OP(lea)
+	if ( (getI(ip->B) < static_cast<int>(stack_Base_)) ||
+	     (getI(ip->B) > static_cast<int>(mem_.size())) ){
+	    fprintf(stderr, "run: out of stack (IR line %d)\n", ip->Line);
+	    status_ = 2;
+	    goto done;
+	}
+	setI(ip->A, getI(ip->B));
+	VM_NEXT
+
+    VM_OP(jmp) VM_JUMP
+    VM_OP(jz_i) if ( !(getI(ip->B)) ) VM_JUMP else VM_NEXT
+    VM_OP(jnz_i) if ( getI(ip->B) ) VM_JUMP else VM_NEXT
+    VM_OP(jz_d) if ( !(getD(ip->B)) ) VM_JUMP else VM_NEXT
+    VM_OP(jnz_d) if ( getD(ip->B) ) VM_JUMP else VM_NEXT
+
+    VM_OP(push_i)
+    VM_OP(push_s)
+	if ( (max_Args == sp_) )
+	    errExit(0, "run: too many arguments pushed (IR line %d)", ip->Line);
+	args_[sp_++] = ip;
+	VM_NEXT
+    VM_OP(printf) // format, line no., name
+	if ( (X86_CALL_ARGS > sp_) )
+	    errExit(0, "run: printf without its arguments");
+	sp_ -= X86_CALL_ARGS;
+	printf(static_cast<const char*>(args_[sp_ + 2]->A),
+	       getI(args_[sp_ + 1]->A),
+	       static_cast<const char*>(args_[sp_]->A));
+	fflush(stdout);
+	VM_NEXT
+
+    VM_OP(vcopy_i)
+    VM_OP(vcopy_d)
+	memmove(mem + getI(ip->A), mem + getI(ip->B),
+		ip->Lanes * ( (vm_vcopy_d == ip->Code)?8:4 ));
+	VM_NEXT
+    VM_OP(vset_i)
+	for ( int k = 0; k < ip->Lanes; k++ )
+	    setI(VM_LANE(ip->A, k, 4), getI(ip->B));
+	VM_NEXT
+    VM_OP(vset_d)
+	for ( int k = 0; k < ip->Lanes; k++ )
+	    setD(VM_LANE(ip->A, k, 8), getD(ip->B));
+	VM_NEXT
+    VM_VEC_I(vadd_i, wrapAdd(l, r))
+    VM_VEC_I(vsub_i, wrapSub(l, r))
+    VM_VEC_I(vmul_i, wrapMul(l, r))
+    VM_VEC_D(vadd_d, l + r)
+    VM_VEC_D(vsub_d, l - r)
+    VM_VEC_D(vmul_d, l * r)
+
+    VM_OP(touch)
+	cache_->access(getI(ip->B) + getI(ip->C), ip->Lanes);
+	ip++;
+	VM_DISPATCH;
+    VM_END
+
+div_Zero:
+    fprintf(stderr, "run: division by zero (IR line %d)\n", ip->Line);
+    status_ = 2;
+done:
+    gettimeofday(&t_End, 0);
+    long usec = (t_End.tv_sec - t_Start.tv_sec) * 1000000L +
+	(t_End.tv_usec - t_Start.tv_usec);
+    return VM_Result(status_, count, usec);
+}
+
+VM_Result
+runIR(ir_Rep const& List, ir_Rep const& Errors, Cache_Sim* Cache)
+{
+    if ( inSSA() )
+	errExit(0, "run: IR in SSA form");
+    Decaf_VM vm(Cache);
+    vm.load(List, Errors);
+    return vm.run();
+}
@@ -0,0 +1,56 @@
+/********************************************************************
+* vm.h - direct-threaded interpreter for the IR (-run)
+*
+* Encoding: the IR (out of SSA form, after any passes, registers
+*           allocated or not) is translated once into an array of
+*           instructions of up to three cell pointers each; a cell is
+*           an int or a double. Tmps and registers have cells of their
+*           own, variables live in a byte array laid out from the
+*           Symbol_Table offsets (frames in the order of ST), literals
+*           in cells of the type they are read as. Array elements are
+*           read by ld_ into a cell before the instruction and written
+*           by st_ after it; an int read as a double (or the reverse) is
+*           converted the same way. NOPs and dec: lines take no
+*           instruction. With a cache simulator, each ld_, st_ and
+*           vector op is preceded by a touch (not counted as executed).
+* Dispatch: each instruction holds the address of its handler, and
+*           each handler ends in a jump to the next one (computed goto;
+*           a switch where labels as values aren't available).
+* Stack:    arrays sized at run time are taken from VM_STACK_SIZE bytes
+*           after the frames, by the %esp lines; lea: takes the address.
+* Errors:   the run-time error section is run as it is: pushl pushes,
+*           the call to printf prints what was pushed (c. x86.h), and
+*           the exit syscall stops with status 1. Division by zero and
+*           running out of stack stop with status 2.
+*
+********************************************************************/
+
+#ifndef VM_H_
+#define VM_H_
+
+#include "ir.h"
+
+class Cache_Sim;
+
+// bytes for arrays sized at run time
+#define VM_STACK_SIZE (1 << 20)
+
+class VM_Result{
+public:
+VM_Result(int Status = 0, long Count = 0, long Usec = 0)
+    : status_(Status), count_(Count), usec_(Usec) {}
+
+    int Status(void) const { return status_; }
+    long Count(void) const { return count_; } // instructions executed
+    long Usec(void) const { return usec_; }
+
+private:
+    int status_;
+    long count_;
+    long usec_;
+};
+
+// Cache: fed the element accesses (c. cache.h; 0: none)
+VM_Result runIR(ir_Rep const& List, ir_Rep const& Errors, Cache_Sim* Cache = 0);
+
+#endif
@@ -0,0 +1,674 @@
+/********************************************************************
+* x86.cpp - implementation file for x86.h
+*
+********************************************************************/
+
+#include <map>
+#include <set>
+#include <vector>
+#include <sstream>
+#include <cstring>
+
+#include "tables.h"
+#include "ir.h"
+#include "regalloc.h"
+#include "x86.h"
+
+class X86_Emitter{
+public:
+X86_Emitter(std::ostream& Out, int In_Process)
+    : out_(Out), in_Process_(In_Process), src_Line_(-1), frame_Size_(0) {}
+
+    void emit(ir_Rep const& List, ir_Rep const& Errors);
+
+private:
+    void layoutFrame(ir_Rep const& List);
+    int isFlt(Operand const& O) const;
+    int isReg(Operand const& O) const { return (opd_Reg == O.Kind()); }
+    int isMem(Operand const& O) const { return ( O.isVar() || O.isElem() ); }
+    std::string reg64(Operand const& O) const;
+    std::string fltConst(double V);
+    std::string opd(Operand const& O, long Disp = 0);
+    void ins(std::string const& Op, std::string const& A = "",
+	     std::string const& B = "", std::string const& C = "");
+
+    void loadFlt(Operand const& O, std::string const& Xmm);
+    void emitLine(SSA_Entry const& Line);
+    void emitCopy(Operand const& T, Operand const& L);
+    void emitIntOp(ir_Op Op, Operand const& T, Operand const& L,
+		   Operand const& R);
+    void emitFltOp(ir_Op Op, Operand const& T, Operand const& L,
+		   Operand const& R);
+    void emitUnary(ir_Op Op, Operand const& T, Operand const& L);
+    void emitCompare(ir_Op Op, Operand const& T, Operand const& L,
+		     Operand const& R);
+    void emitCast(Operand const& T, Operand const& L, int Type);
+    void emitJump(SSA_Entry const& Line);
+    void emitStack(ir_Op Op, Operand const& R);
+    void emitVector(SSA_Entry const& Line);
+    void emitData(void);
+
+    std::ostream& out_;
+    int in_Process_;                // calls by address (c. jit.h)
+    int src_Line_;
+    std::map<int, int> var_Offset_; // %rbp relative (arrays sized at run
+    std::set<int> vla_;             // time: of their pointer)
+    std::set<int> flt_Vars_;
+    std::map<std::string, std::string> flt_Consts_; // .quad bits -> label
+    int frame_Size_;
+};
+
+static const char* saved_Regs[] = { "%rbx", "%r12", "%r13", "%r14", "%r15" };
+static const int no_Saved = sizeof(saved_Regs) / sizeof(saved_Regs[0]);
+static const char* arg_Regs[] = { "%rdi", "%rsi", "%rdx", "%rcx", "%r8",
+				  "%r9" };
+
+std::string
+asmLabel(int Label)
+{
+    return ".L" + ir_Labels[Label];
+}
+
+void
+X86_Emitter::layoutFrame(ir_Rep const& List)
+{
+    for ( size_t i = 0; i < List.size(); i++ )
+	if ( (op_lea == List[i].Op()) )
+	    vla_.insert(List[i].Target().Id());
+
+    int cursor = 8 * no_Saved;
+    std::map<std::string, int> base;
+    std::map<std::string, Symbol_Table>::iterator iter;
+    for ( iter = ST.begin(); iter != ST.end(); iter++ ){
+	cursor += iter->second.getOffsetStack();
+	base[iter->first] = -cursor;
+    }
+    for ( size_t v = 0; v < ir_Vars.size(); v++ ){
+	if ( (-1 == ir_Vars[v].Frame()) )
+	    continue;
+	std::string frame = ir_Frames[ir_Vars[v].Frame()].Name();
+	std::string name = ir_Vars[v].Name();
+	if ( (ST.end() == (iter = ST.find(frame))) ||
+	     (-1 == iter->second.findName(name)) )
+	    continue;
+	if ( ("double" == iter->second.getType(name)) )
+	    flt_Vars_.insert(v);
+	if ( vla_.count(v) ){
+	    cursor += 8;
+	    var_Offset_[v] = -cursor;
+	}
+	else
+	    var_Offset_[v] = base[frame] + iter->second.getOffset(name);
+    }
+    frame_Size_ = (cursor + 15) & ~15;
+}
+
+int
+X86_Emitter::isFlt(Operand const& O) const
+{
+    switch(O.Kind()){
+    case opd_Reg: return (0 == ir_Regs[O.Id()].compare(0, 4, "%xmm"));
+    case opd_Imm: return ir_Consts[O.Id()].isFlt();
+    case opd_Var: case opd_Elem: return flt_Vars_.count(O.Id());
+    default: return 0;
+    }
+}
+
+// "$k" if O is the int literal 2^k, 0 < k < 31 (a mult by it is a
+// shift left by k), else ""
+static std::string
+shiftOf(Operand const& O)
+{
+    if ( !(O.isImm()) || ir_Consts[O.Id()].isFlt() )
+	return "";
+    long v = ir_Consts[O.Id()].IntVal();
+    for ( int k = 1; k < 31; k++ )
+	if ( ((1L << k) == v) ){
+	    std::ostringstream tmp_Stream;
+	    tmp_Stream << "$" << k;
+	    return tmp_Stream.str();
+	}
+    return "";
+}
+
+// %ebx -> %rbx, %r12d -> %r12 (an int index into an address)
+std::string
+X86_Emitter::reg64(Operand const& O) const
+{
+    if ( !(isReg(O)) )
+	errExit(0, "x86: array offset not in a register (%s)",
+		operandStr(O).c_str());
+    std::string name = ir_Regs[O.Id()];
+    if ( ('d' == name[name.size() - 1]) )
+	return name.substr(0, name.size() - 1);
+    return "%r" + name.substr(2);
+}
+
+std::string
+X86_Emitter::fltConst(double V)
+{
+    unsigned long bits;
+    memcpy(&bits, &V, sizeof(bits));
+    std::ostringstream tmp_Stream;
+    tmp_Stream << "0x" << std::hex << bits;
+    std::string& label = flt_Consts_[tmp_Stream.str()];
+    if ( ("" == label) ){
+	std::ostringstream name_Stream;
+	name_Stream << ".LC" << flt_Consts_.size() - 1;
+	label = name_Stream.str();
+    }
+    return label;
+}
+
+// An element of an array sized at run time loads its base into %rcx
+// first: the string returned goes into the next instruction emitted,
+// before opd() is called for another operand. Disp: bytes past an element
+std::string
+X86_Emitter::opd(Operand const& O, long Disp)
+{
+    std::ostringstream tmp_Stream;
+    Operand off;
+    switch(O.Kind()){
+    case opd_Reg:
+	return ir_Regs[O.Id()];
+    case opd_Imm:
+	if ( ir_Consts[O.Id()].isFlt() )
+	    return fltConst(ir_Consts[O.Id()].FltVal()) + "(%rip)";
+	tmp_Stream << "$" << static_cast<int>(ir_Consts[O.Id()].IntVal());
+	return tmp_Stream.str();
+    case opd_Var:
+	if ( !(var_Offset_.count(O.Id())) )
+	    errExit(0, "x86: no frame slot for %s", operandStr(O).c_str());
+	tmp_Stream << var_Offset_[O.Id()] << "(%rbp)";
+	return tmp_Stream.str();
+    case opd_Elem:
+	off = O.Offset();
+	if ( vla_.count(O.Id()) ){
+	    tmp_Stream << var_Offset_[O.Id()] << "(%rbp)";
+	    ins("movq", tmp_Stream.str(), "%rcx");
+	    tmp_Stream.str("");
+	    if ( off.isImm() )
+		tmp_Stream << ir_Consts[off.Id()].IntVal() + Disp << "(%rcx)";
+	    else if ( (0 != Disp) )
+		tmp_Stream << Disp << "(%rcx," << reg64(off) << ")";
+	    else
+		tmp_Stream << "(%rcx," << reg64(off) << ")";
+	    return tmp_Stream.str();
+	}
+	if ( off.isImm() )
+	    tmp_Stream << var_Offset_[O.Id()] + ir_Consts[off.Id()].IntVal() +
+		Disp << "(%rbp)";
+	else
+	    tmp_Stream << var_Offset_[O.Id()] + Disp << "(%rbp," << reg64(off)
+		       << ")";
+	return tmp_Stream.str();
+    default:
+	errExit(0, "x86: invalid operand (%s)", operandStr(O).c_str());
+    }
+    return "";
+}
+
+void
+X86_Emitter::ins(std::string const& Op, std::string const& A,
+		 std::string const& B, std::string const& C)
+{
+    out_ << "\t" << Op;
+    if ( ("" != A) )
+	out_ << "\t" << A;
+    if ( ("" != B) )
+	out_ << ", " << B;
+    if ( ("" != C) )
+	out_ << ", " << C;
+    out_ << "\n";
+}
+
+// O into Xmm, converted if it is an int
+void
+X86_Emitter::loadFlt(Operand const& O, std::string const& Xmm)
+{
+    if ( isFlt(O) ){
+	if ( !(isReg(O)) || (ir_Regs[O.Id()] != Xmm) )
+	    ins("movsd", opd(O), Xmm);
+    }
+    else if ( O.isImm() ){
+	ins("movl", opd(O), "%eax");
+	ins("cvtsi2sdl", "%eax", Xmm);
+    }
+    else
+	ins("cvtsi2sdl", opd(O), Xmm);
+}
+
+void
+X86_Emitter::emitCopy(Operand const& T, Operand const& L)
+{
+    if ( (T == L) )
+	return;
+    if ( isFlt(T) || isFlt(L) ){
+	if ( isReg(T) )
+	    loadFlt(L, ir_Regs[T.Id()]);
+	else if ( isReg(L) && isFlt(L) )
+	    ins("movsd", opd(L), opd(T));
+	else{
+	    loadFlt(L, "%xmm0");
+	    ins("movsd", "%xmm0", opd(T));
+	}
+	return;
+    }
+    if ( isMem(T) && isMem(L) ){
+	ins("movl", opd(L), "%eax");
+	ins("movl", "%eax", opd(T));
+    }
+    else
+	ins("movl", opd(L), opd(T));
+}
+
+void
+X86_Emitter::emitIntOp(ir_Op Op, Operand const& T, Operand const& L,
+		       Operand const& R)
+{
+    if ( (op_div == Op) || (op_mod == Op) ){
+	ins("movl", opd(L), "%eax");
+	ins("cltd");
+	if ( R.isImm() ){
+	    ins("movl", opd(R), "%ecx");
+	    ins("idivl", "%ecx");
+	}
+	else
+	    ins("idivl", opd(R));
+	ins("movl", (op_div == Op)?"%eax":"%edx", opd(T));
+	return;
+    }
+
+    if ( (op_sub != Op) && (T == R) && (T != L) ){ // t = a + t: t = t + a
+	emitIntOp(Op, T, R, L);
+	return;
+    }
+    const char* mnem = ( (op_add == Op) )?"addl":
+	( (op_sub == Op) )?"subl":"imull";
+    int shift = ( (op_mult == Op) && ("" != shiftOf(R)) );
+    if (shift)
+	mnem = "shll";
+    // T may hold the offset of R (t = b[t] * 2): R is read before T is
+    // written only if the result goes to %eax (c. regalloc.h)
+    int in_R = ( R.isElem() && (R.Offset() == T) );
+    std::string dst = ( isReg(T) && (T != R) && !(in_R) )?ir_Regs[T.Id()]:
+	"%eax";
+    if ( (L != T) || ("%eax" == dst) )
+	ins("movl", opd(L), dst);
+    ins(mnem, (shift)?shiftOf(R):opd(R), dst); // R's base after L's
+    if ( ("%eax" == dst) )
+	ins("movl", "%eax", opd(T));
+}
+
+void
+X86_Emitter::emitFltOp(ir_Op Op, Operand const& T, Operand const& L,
+		       Operand const& R)
+{
+    const char* mnem = ( (op_add == Op) )?"addsd":( (op_sub == Op) )?"subsd":
+	( (op_mult == Op) )?"mulsd":"divsd";
+    if ( (op_mod == Op) )
+	errExit(0, "x86: %% of doubles");
+    loadFlt(L, "%xmm0");
+    if ( isFlt(R) )
+	ins(mnem, opd(R), "%xmm0");
+    else{
+	loadFlt(R, "%xmm1");
+	ins(mnem, "%xmm1", "%xmm0");
+    }
+    ins("movsd", "%xmm0", opd(T));
+}
+
+void
+X86_Emitter::emitUnary(ir_Op Op, Operand const& T, Operand const& L)
+{
+    if ( (op_neg == Op) && isFlt(T) ){
+	loadFlt(L, "%xmm0");
+	ins("xorpd", ".LCsign(%rip)", "%xmm0");
+	ins("movsd", "%xmm0", opd(T));
+	return;
+    }
+    if ( (op_neg == Op) ){
+	ins("movl", opd(L), "%eax");
+	ins("negl", "%eax");
+    }
+    else if ( (op_scale == Op) ){ // t = t * w
+	const char* mnem = ( ("" != shiftOf(L)) )?"shll":"imull";
+	if ( isReg(T) ){
+	    ins(mnem, ( ("" != shiftOf(L)) )?shiftOf(L):opd(L), opd(T));
+	    return;
+	}
+	ins("movl", opd(T), "%eax");
+	ins(mnem, ( ("" != shiftOf(L)) )?shiftOf(L):opd(L), "%eax");
+    }
+    else if ( isFlt(L) ){ // !
+	loadFlt(L, "%xmm0");
+	ins("xorpd", "%xmm1", "%xmm1");
+	ins("ucomisd", "%xmm1", "%xmm0");
+	ins("sete", "%al");
+	ins("setnp", "%dl");
+	ins("andb", "%dl", "%al");
+	ins("movzbl", "%al", "%eax");
+    }
+    else{
+	ins("movl", opd(L), "%eax");
+	ins("testl", "%eax", "%eax");
+	ins("sete", "%al");
+	ins("movzbl", "%al", "%eax");
+    }
+    ins("movl", "%eax", opd(T));
+}
+
+void
+X86_Emitter::emitCompare(ir_Op Op, Operand const& T, Operand const& L,
+			 Operand const& R)
+{
+    if ( !(isFlt(L)) && !(isFlt(R)) ){
+	const char* set = ( (op_lt == Op) )?"setl":( (op_le == Op) )?"setle":
+	    ( (op_gt == Op) )?"setg":( (op_ge == Op) )?"setge":
+	    ( (op_eq == Op) )?"sete":"setne";
+	ins("movl", opd(L), "%eax");
+	ins("cmpl", opd(R), "%eax");
+	ins(set, "%al");
+    }
+    else{ // unordered (NaN) compares false, but for !=
+	int swap = ( (op_lt == Op) || (op_le == Op) );
+	loadFlt( (swap)?R:L, "%xmm0");
+	loadFlt( (swap)?L:R, "%xmm1");
+	ins("ucomisd", "%xmm1", "%xmm0");
+	if ( (op_eq == Op) || (op_ne == Op) ){
+	    ins( (op_eq == Op)?"sete":"setne", "%al");
+	    ins( (op_eq == Op)?"setnp":"setp", "%dl");
+	    ins( (op_eq == Op)?"andb":"orb", "%dl", "%al");
+	}
+	else
+	    ins( ( (op_lt == Op) || (op_gt == Op) )?"seta":"setae", "%al");
+    }
+    ins("movzbl", "%al", "%eax");
+    ins("movl", "%eax", opd(T));
+}
+
+void
+X86_Emitter::emitCast(Operand const& T, Operand const& L, int Type)
+{
+    if ( (tok_double == Type) ){
+	if ( isReg(T) )
+	    loadFlt(L, ir_Regs[T.Id()]);
+	else{
+	    loadFlt(L, "%xmm0");
+	    ins("movsd", "%xmm0", opd(T));
+	}
+	return;
+    }
+    if ( (tok_int == Type) && isFlt(L) )
+	ins("cvttsd2si", opd(L), "%eax");
+    else if ( (tok_int == Type) )
+	ins("movl", opd(L), "%eax");
+    else if ( isFlt(L) ){ // bool
+	loadFlt(L, "%xmm0");
+	ins("xorpd", "%xmm1", "%xmm1");
+	ins("ucomisd", "%xmm1", "%xmm0");
+	ins("setne", "%al");
+	ins("setp", "%dl");
+	ins("orb", "%dl", "%al");
+	ins("movzbl", "%al", "%eax");
+    }
+    else{
+	ins("movl", opd(L), "%eax");
+	ins("testl", "%eax", "%eax");
+	ins("setne", "%al");
+	ins("movzbl", "%al", "%eax");
+    }
+    ins("movl", "%eax", opd(T));
+}
+
+void
+X86_Emitter::emitJump(SSA_Entry const& Line)
+{
+    if ( (op_goto == Line.Op()) ){
+	ins("jmp", asmLabel(Line.Target().Id()));
+	return;
+    }
+
+    Operand c = Line.Target();
+    std::string target = asmLabel(Line.RHS().Id());
+    int on_Zero = (op_iffalse == Line.Op());
+    if ( c.isImm() ){
+	int zero = ( (isFlt(c)) )?(0 == ir_Consts[c.Id()].FltVal()):
+	    (0 == ir_Consts[c.Id()].IntVal());
+	if ( (zero == on_Zero) )
+	    ins("jmp", target);
+	return;
+    }
+    if ( isFlt(c) ){ // unordered is not zero
+	loadFlt(c, "%xmm0");
+	ins("xorpd", "%xmm1", "%xmm1");
+	ins("ucomisd", "%xmm1", "%xmm0");
+	if ( on_Zero ){
+	    ins("jp", "1f");
+	    ins("je", target);
+	    out_ << "1:\n";
+	}
+	else{
+	    ins("jp", target);
+	    ins("jne", target);
+	}
+	return;
+    }
+    if ( isReg(c) )
+	ins("testl", opd(c), opd(c));
+    else
+	ins("cmpl", "$0", opd(c));
+    ins( (on_Zero)?"je":"jne", target);
+}
+
+// %esp -/+ the size of an array sized at run time
+void
+X86_Emitter::emitStack(ir_Op Op, Operand const& R)
+{
+    const char* mnem = ( (op_add == Op) )?"addq":"subq";
+    if ( R.isImm() )
+	ins(mnem, opd(R), "%rsp");
+    else{
+	ins("movslq", opd(R), "%rax");
+	ins(mnem, "%rax", "%rsp");
+    }
+}
+
+// 16 bytes of lanes at a time, through %xmm0 and %xmm1 (pmulld: SSE4.1)
+void
+X86_Emitter::emitVector(SSA_Entry const& Line)
+{
+    Operand t = Line.Target(), l = Line.LHS(), r = Line.RHS();
+    int flt = isFlt(t);
+    int bytes = Line.Lanes() * ( (flt)?8:4 );
+    if ( (0 != bytes % 16) )
+	errExit(0, "x86: vector of %d bytes (%s)", bytes, Line.str().c_str());
+    const char* mov = (flt)?"movupd":"movdqu";
+
+    if ( (op_vcopy == Line.Op()) && !(l.isElem()) ){ // the same in each
+	if (flt){
+	    loadFlt(l, "%xmm0");
+	    ins("unpcklpd", "%xmm0", "%xmm0");
+	}
+	else{
+	    if ( l.isImm() ){
+		ins("movl", opd(l), "%eax");
+		ins("movd", "%eax", "%xmm0");
+	    }
+	    else
+		ins("movd", opd(l), "%xmm0");
+	    ins("pshufd", "$0", "%xmm0", "%xmm0");
+	}
+	for ( int k = 0; k < bytes; k += 16 )
+	    ins(mov, "%xmm0", opd(t, k));
+	return;
+    }
+
+    const char* mnem = ( (op_vadd == Line.Op()) )?( (flt)?"addpd":"paddd" ):
+	( (op_vsub == Line.Op()) )?( (flt)?"subpd":"psubd" ):
+	( (flt)?"mulpd":"pmulld" );
+    for ( int k = 0; k < bytes; k += 16 ){
+	ins(mov, opd(l, k), "%xmm0");
+	if ( (op_vcopy != Line.Op()) ){
+	    ins(mov, opd(r, k), "%xmm1");
+	    ins(mnem, "%xmm1", "%xmm0");
+	}
+	ins(mov, "%xmm0", opd(t, k));
+    }
+}
+
+void
+X86_Emitter::emitLine(SSA_Entry const& Line)
+{
+    std::vector<int> labels = Line.Labels();
+    for ( size_t k = 0; k < labels.size(); k++ )
+	out_ << asmLabel(labels[k]) << ":\n";
+    if ( (-1 != Line.SrcLine()) && (src_Line_ != Line.SrcLine()) ){
+	src_Line_ = Line.SrcLine();
+	out_ << "# line " << src_Line_ << "\n";
+    }
+
+    Operand t = Line.Target(), l = Line.LHS(), r = Line.RHS();
+    std::ostringstream tmp_Stream;
+    switch(Line.Op()){
+    case op_nop: case op_dec:
+	break;
+    case op_lea:
+	tmp_Stream << var_Offset_[t.Id()] << "(%rbp)";
+	ins("movq", "%rsp", tmp_Stream.str());
+	break;
+    case op_copy:
+	emitCopy(t, l);
+	break;
+    case op_add: case op_sub: case op_mult: case op_div: case op_mod:
+	if ( isReg(t) && ("%esp" == ir_Regs[t.Id()]) )
+	    emitStack(Line.Op(), r);
+	else if ( isFlt(t) )
+	    emitFltOp(Line.Op(), t, l, r);
+	else
+	    emitIntOp(Line.Op(), t, l, r);
+	break;
+    case op_neg: case op_not: case op_scale:
+	emitUnary(Line.Op(), t, l);
+	break;
+    case op_lt: case op_le: case op_gt: case op_ge: case op_eq: case op_ne:
+	emitCompare(Line.Op(), t, l, r);
+	break;
+    case op_cast:
+	emitCast(t, l, r.Id());
+	break;
+    case op_iffalse: case op_iftrue: case op_goto:
+	emitJump(Line);
+	break;
+    case op_vcopy: case op_vadd: case op_vsub: case op_vmult:
+	emitVector(Line);
+	break;
+    case op_pushl:
+	if ( t.isImm() )
+	    ins("pushq", opd(t));
+	else{
+	    ins("leaq", ir_Syms[t.Id()] + "(%rip)", "%rax");
+	    ins("pushq", "%rax");
+	}
+	break;
+    case op_call:
+	for ( int k = 0; k < X86_CALL_ARGS; k++ )
+	    ins("popq", arg_Regs[k]);
+	ins("andq", "$-16", "%rsp");
+	if (in_Process_){
+	    ins("movabsq", "$" + ir_Syms[t.Id()], "%r11");
+	    ins("xorl", "%eax", "%eax");
+	    ins("call", "*%r11");
+	}
+	else{
+	    ins("xorl", "%eax", "%eax");
+	    ins("call", ir_Syms[t.Id()] + "@PLT");
+	}
+	break;
+    case op_syscall: // main() returns 1
+	if ( ("exit" != ir_Syms[t.Id()]) )
+	    errExit(0, "x86: unknown syscall (%s)", ir_Syms[t.Id()].c_str());
+	ins("movl", "$1", "%eax");
+	ins("jmp", ".Lmain_Ret");
+	break;
+    default:
+	errExit(0, "x86: no code for IR line (%s)", Line.str().c_str());
+    }
+}
+
+void
+X86_Emitter::emitData(void)
+{
+    out_ << "\t.section\t.rodata\n";
+    out_ << "\t.align\t16\n";
+    out_ << ".LCsign:\n";
+    ins(".quad", "0x8000000000000000", "0");
+    std::map<std::string, std::string>::const_iterator iter;
+    for ( iter = flt_Consts_.begin(); iter != flt_Consts_.end(); iter++ ){
+	out_ << "\t.align\t8\n";
+	out_ << iter->second << ":\n";
+	ins(".quad", iter->first);
+    }
+
+    out_ << "\t.data\n";
+    std::vector<Ds_Object*>::const_iterator ds;
+    for ( ds = Ds_Table.begin(); ds != Ds_Table.end(); ds++ ){
+	std::string directive = (*ds)->Directive();
+	if ( (".asciiz" == directive) )
+	    directive = ".asciz";
+	out_ << (*ds)->Name() << ":\n";
+	ins(directive, (*ds)->Value());
+    }
+    out_ << "\t.section\t.note.GNU-stack,\"\",@progbits\n";
+}
+
+void
+X86_Emitter::emit(ir_Rep const& List, ir_Rep const& Errors)
+{
+    layoutFrame(List);
+    std::ostringstream tmp_Stream;
+    tmp_Stream << "$" << frame_Size_;
+
+    out_ << "\t.text\n";
+    out_ << "\t.globl\tmain\n";
+    out_ << "\t.type\tmain, @function\n";
+    out_ << "main:\n";
+    ins("pushq", "%rbp");
+    ins("movq", "%rsp", "%rbp");
+    ins("subq", tmp_Stream.str(), "%rsp");
+    for ( int k = 0; k < no_Saved; k++ ){
+	tmp_Stream.str("");
+	tmp_Stream << -8 * (k + 1) << "(%rbp)";
+	ins("movq", saved_Regs[k], tmp_Stream.str());
+    }
+
+    for ( size_t i = 0; i < List.size(); i++ )
+	emitLine(List[i]);
+
+    ins("xorl", "%eax", "%eax");
+    out_ << ".Lmain_Ret:\n";
+    for ( int k = 0; k < no_Saved; k++ ){
+	tmp_Stream.str("");
+	tmp_Stream << -8 * (k + 1) << "(%rbp)";
+	ins("movq", tmp_Stream.str(), saved_Regs[k]);
+    }
+    ins("leave");
+    ins("ret");
+
+    out_ << "# run-time errors\n";
+    for ( size_t i = 0; i < Errors.size(); i++ )
+	emitLine(Errors[i]);
+    out_ << "\t.size\tmain, .-main\n";
+
+    emitData();
+}
+
+void
+emitX86(ir_Rep const& List, ir_Rep const& Errors, std::ostream& Out,
+	int In_Process)
+{
+    ir_Rep list = List;
+    allocateRegisters(list);
+    X86_Emitter x86(Out, In_Process);
+    x86.emit(list, Errors);
+}
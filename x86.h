@@ -0,0 +1,39 @@
+/********************************************************************
+* x86.h - x86-64 code generation (GNU as, System V ABI)
+*
+* Input:   the IR after register assignment (c. regalloc.h); the list
+*          is copied and allocated first if it isn't yet. The program
+*          becomes main(); the run-time error section follows it.
+* Frame:   %rbp based. The callee-saved registers come first, then
+*          the stack areas of all frames (Symbol_Table offsets, in the
+*          order of ST), then a pointer for each array sized at run
+*          time. Arrays sized at run time live below %rsp (the %esp
+*          lines grow and shrink the stack, lea: takes the address).
+* Lines:   ints go through %eax (%edx for cltd/idivl, %ecx for the
+*          base of a run-time sized array), doubles through %xmm0 and
+*          %xmm1; an int read where a double is wanted is converted.
+*          Double literals go to .rodata, the strings of the error
+*          section to .data (.asciiz as .asciz).
+* Errors:  pushl pushes; the call to printf takes what was pushed as
+*          its arguments (format, line number, name; c. X86_CALL_ARGS)
+*          and the exit syscall that follows returns 1 from main().
+* Calls:   through the PLT; In_Process (c. jit.h) by absolute address
+*          (movabsq $printf, %r11), as the code isn't linked.
+*          Comments (# line 12) mark the source line of the IR lines.
+*
+********************************************************************/
+
+#ifndef X86_H_
+#define X86_H_
+
+#include <ostream>
+
+#include "ir.h"
+
+// arguments of a call in the error section (format, line no., name)
+#define X86_CALL_ARGS 3
+
+void emitX86(ir_Rep const& List, ir_Rep const& Errors, std::ostream& Out,
+	     int In_Process = 0);
+
+#endif